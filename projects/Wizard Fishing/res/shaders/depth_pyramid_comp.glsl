@@ -0,0 +1,34 @@
+#version 430
+
+// Builds one level of GpuCuller's depth pyramid, where each texel holds the farthest depth of
+// the texels it covers in the level before it. Level 0 is built from the scene's depth
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 8) uniform sampler2D s_Depth;
+layout (r32f, binding = 0) uniform writeonly image2D i_Destination;
+layout (r32f, binding = 1) uniform readonly image2D i_Source;
+
+uniform int   u_Level;
+uniform ivec2 u_SourceSize;
+uniform ivec2 u_DestinationSize;
+
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, u_DestinationSize))) {
+		return;
+	}
+
+	// Every texel covers between 1 and 2 source texels on each axis, which may not line up
+	// with the source texels when building level 0
+	ivec2 first = (texel * u_SourceSize) / u_DestinationSize;
+	ivec2 last = ((texel + 1) * u_SourceSize + u_DestinationSize - 1) / u_DestinationSize - 1;
+	last = clamp(last, first, u_SourceSize - 1);
+
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++) {
+		for (int x = first.x; x <= last.x; x++) {
+			depth = max(depth, u_Level == 0 ? texelFetch(s_Depth, ivec2(x, y), 0).r : imageLoad(i_Source, ivec2(x, y)).r);
+		}
+	}
+	imageStore(i_Destination, texel, vec4(depth));
+}
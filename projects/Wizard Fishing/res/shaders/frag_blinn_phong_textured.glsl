@@ -1,5 +1,8 @@
 #version 430
 
+// REFLECTIVE mixes the environment map into the result, using the material's shininess as the amount
+#pragma multi_compile REFLECTIVE
+
 layout(location = 0) in vec3 inWorldPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
@@ -15,12 +18,17 @@ layout(location = 0) out vec4 frag_color;
 // Represents a collection of attributes that would define a material
 // For instance, you can think of this like material settings in 
 // Unity
-struct Material {
-	sampler2D Diffuse;
-	float     Shininess;
-};
-// Create a uniform for the material
-uniform Material u_Material;
+// Each material owns a uniform buffer with these, so they are only uploaded when they change
+layout (std140, binding = 1) uniform b_Material {
+	float Shininess;
+	// The layer in s_DiffuseAtlas to sample, or -1 to use s_Diffuse
+	int   AtlasLayer;
+} u_Material;
+
+// Samplers can't live in a uniform block, so their texture slots are fixed here instead
+layout (binding = 1) uniform sampler2D s_Diffuse;
+// Materials that share a texture size are packed into this array (see Material::BuildTextureArrays)
+layout (binding = 2) uniform sampler2DArray s_DiffuseAtlas;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -44,10 +52,19 @@ void main() {
 	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos, u_Material.Shininess);
 
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = u_Material.AtlasLayer >= 0 ?
+		texture(s_DiffuseAtlas, vec3(inUV, u_Material.AtlasLayer)) :
+		texture(s_Diffuse, inUV);
 
 	// combine for the final result
 	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
 
+#ifdef REFLECTIVE
+	vec3 toEye = normalize(u_CamPos - inWorldPos);
+	vec3 environmentDir = reflect(-toEye, normal);
+	vec3 reflected = SampleEnvironmentMap(environmentDir);
+	result = mix(result, reflected, u_Material.Shininess);
+#endif
+
 	frag_color = vec4(result, textureColor.a);
 }
\ No newline at end of file
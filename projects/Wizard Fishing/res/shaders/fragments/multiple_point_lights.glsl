@@ -7,11 +7,12 @@
  * Usage:
  * vec3 normal = normalize(inNormal);
  * vec3 lighting = CalculateAllLightContribution(inWorldPos, normal, u_CamPos);
+ *
+ * Lights are culled using clustered shading, the view frustum is split into a
+ * grid of clusters and each cluster stores a list of the lights that can reach it.
+ * The grid is built on the CPU by Gameplay::ClusteredLighting
 */
 
-// The maximum number of lights the shader supports, increasing this will lower performance!
-#define MAX_LIGHTS 8
-
 // Represents a single light source
 struct Light {
 	vec4  Position;
@@ -27,13 +28,32 @@ layout (std140, binding = 0) uniform b_LightBlock {
 	// on the C++ side
     vec4  AmbientColAndNumLights;
 
-    // Our array of all lights
-    Light Lights[MAX_LIGHTS];
+	// The number of clusters along each axis in xyz, w is 1 for orthographic cameras
+	uvec4 ClusterGridSize;
+	// The near plane, far plane, and the scale and bias for finding the depth slice
+	vec4  ClusterDepthParams;
+	// The size of a cluster in pixels in xy
+	vec4  ClusterTileSize;
 
     // The rotation of the skybox/environment map
 	mat3  EnvironmentRotation;
 };
 
+// Our array of all lights in the scene
+layout (std430, binding = 1) readonly buffer b_Lights {
+	Light Lights[];
+};
+
+// Stores the offset into LightIndices in x, and number of lights in y, for every cluster
+layout (std430, binding = 2) readonly buffer b_LightClusters {
+	uvec2 LightClusters[];
+};
+
+// The lists of light indices for all clusters, packed together
+layout (std430, binding = 3) readonly buffer b_LightIndices {
+	uint LightIndices[];
+};
+
 // Uniform for our environment map / skybox, bound to slot 0 by default
 uniform layout(binding=0) samplerCube s_EnvironmentMap;
 
@@ -81,6 +101,29 @@ vec3 CalcPointLightContribution(vec3 worldPos, vec3 normal, vec3 viewDir, Light
 	return (diffuseOut + specularOut) * attenuation;
 }
 
+// Finds the index of the light cluster that the current fragment falls in
+// @returns The index into LightClusters for this fragment
+uint GetLightClusterIndex() {
+	float near = ClusterDepthParams.x;
+	float far  = ClusterDepthParams.y;
+
+	// Recover the view space depth from the depth buffer value
+	float depth;
+	if (ClusterGridSize.w != 0) {
+		depth = near + gl_FragCoord.z * (far - near);
+	} else {
+		float ndcDepth = gl_FragCoord.z * 2.0 - 1.0;
+		depth = (2.0 * near * far) / (far + near - ndcDepth * (far - near));
+	}
+
+	// Depth slices are exponential, so we use the log of the depth to find our slice
+	uint slice = uint(max(log(depth) * ClusterDepthParams.z + ClusterDepthParams.w, 0.0));
+	uvec3 cluster = uvec3(uvec2(gl_FragCoord.xy / ClusterTileSize.xy), slice);
+	cluster = min(cluster, ClusterGridSize.xyz - uvec3(1));
+
+	return cluster.x + ClusterGridSize.x * (cluster.y + ClusterGridSize.y * cluster.z);
+}
+
 /*
  * Calculates the lighting contribution for all lights in the scene
  * for a given fragment
@@ -95,10 +138,11 @@ vec3 CalcAllLightContribution(vec3 worldPos, vec3 normal, vec3 camPos, float shi
 	// Direction between camera and fragment will be shared for all lights
 	vec3 viewDir  = normalize(camPos - worldPos);
 	
-	// Iterate over all lights
-	for(int ix = 0; ix < AmbientColAndNumLights.w && ix < MAX_LIGHTS; ix++) {
+	// Only iterate over the lights that can reach this fragment's cluster
+	uvec2 cluster = LightClusters[GetLightClusterIndex()];
+	for(uint ix = 0; ix < cluster.y; ix++) {
 		// Additive lighting model
-		lightAccumulation += CalcPointLightContribution(worldPos, viewDir, normal, Lights[ix], shininess);
+		lightAccumulation += CalcPointLightContribution(worldPos, viewDir, normal, Lights[LightIndices[cluster.x + ix]], shininess);
 	}
 
 	return lightAccumulation;
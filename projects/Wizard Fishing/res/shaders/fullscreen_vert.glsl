@@ -0,0 +1,13 @@
+#version 450
+
+// Draws a single triangle that covers the whole screen, without needing any vertex buffers.
+// Call with glDrawArrays(GL_TRIANGLES, 0, 3)
+
+layout(location = 0) out vec2 outUV;
+
+void main() {
+	// Vertices land at (-1,-1), (3,-1) and (-1,3), so UVs cover 0-1 across the screen
+	vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	outUV = uv;
+	gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,142 @@
+#version 430
+
+// Tests every object that GpuCuller uploaded against the camera, and appends a draw command for
+// each one that is visible to the range of the command buffer for it's material
+layout(local_size_x = 64) in;
+
+// Must match GpuCuller::ObjectData
+struct CulledObject {
+	mat4  Model;
+	vec4  NormalMatrix[3];
+	// The world space bounding sphere, with the radius in w
+	vec4  Bounds;
+	uvec4 LodIndexCounts;
+	uvec4 LodFirstIndices;
+	int   BaseVertex;
+	uint  LodCount;
+	uint  FirstCommand;
+	uint  Group;
+};
+
+// Laid out the way glMultiDrawElementsIndirect expects
+struct DrawCommand {
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int  BaseVertex;
+	uint BaseInstance;
+};
+
+layout (std430, binding = 6) readonly buffer b_CulledObjects {
+	CulledObject Objects[];
+};
+layout (std430, binding = 7) writeonly buffer b_DrawCommands {
+	DrawCommand Commands[];
+};
+// The number of commands written for each group
+layout (std430, binding = 8) buffer b_DrawCounts {
+	uint Counts[];
+};
+
+// The farthest depth of the previous frame, see depth_pyramid_comp.glsl
+layout (binding = 8) uniform sampler2D s_DepthPyramid;
+
+uniform int   u_ObjectCount;
+// Pointing into the frustum, with normalized normals
+uniform vec4  u_FrustumPlanes[6];
+uniform mat4  u_View;
+// projection[1][1], for estimating how big an object is on screen
+uniform float u_ProjectionScale;
+uniform int   u_Perspective;
+uniform int   u_UseLods;
+// See RenderComponent::LOD_SCREEN_SIZES
+uniform float u_LodScreenSizes[3];
+uniform int   u_UseDepthPyramid;
+// The camera that the depth pyramid was rendered with
+uniform mat4  u_PreviousViewProjection;
+uniform int   u_PyramidLevels;
+// The fraction of each level of the pyramid that the viewport covered, see GpuCuller::_pyramidUvScale
+uniform vec2  u_PyramidUvScale;
+
+bool IsInFrustum(vec3 center, float radius) {
+	for (int ix = 0; ix < 6; ix++) {
+		if (dot(u_FrustumPlanes[ix].xyz, center) + u_FrustumPlanes[ix].w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsOccluded(vec3 center, float radius) {
+	// Project the corners of the sphere's bounding box with last frame's camera
+	vec3 ndcMin = vec3(1.0);
+	vec3 ndcMax = vec3(-1.0);
+	for (int ix = 0; ix < 8; ix++) {
+		vec3 corner = center + radius * vec3((ix & 1) != 0 ? 1.0 : -1.0, (ix & 2) != 0 ? 1.0 : -1.0, (ix & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = u_PreviousViewProjection * vec4(corner, 1.0);
+		// Anything that crosses the near plane can't be tested
+		if (clip.w <= 0.0) {
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+	if (ndcMin.z < -1.0) {
+		return false;
+	}
+	// Last frame's depth says nothing about what was outside of it's view, so anything that
+	// wasn't entirely on screen (ex: coming in from the edges as the camera turns) is drawn
+	if (any(lessThan(ndcMin.xy, vec2(-1.0))) || any(greaterThan(ndcMax.xy, vec2(1.0)))) {
+		return false;
+	}
+
+	// Pick the level where the box covers at most 2x2 texels, and take the farthest of them. Only
+	// the bottom left corner of each level was built, so that's all we look at
+	vec2 uvMin = (ndcMin.xy * 0.5 + 0.5) * u_PyramidUvScale;
+	vec2 uvMax = (ndcMax.xy * 0.5 + 0.5) * u_PyramidUvScale;
+	vec2 extent = (uvMax - uvMin) * vec2(textureSize(s_DepthPyramid, 0));
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, u_PyramidLevels - 1);
+	ivec2 levelSize = textureSize(s_DepthPyramid, level);
+	ivec2 usedSize = max(ivec2(ceil(vec2(levelSize) * u_PyramidUvScale - 0.001)), ivec2(1));
+	ivec2 texelMin = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), usedSize - 1);
+	ivec2 texelMax = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), usedSize - 1);
+	float farthest = max(
+		max(texelFetch(s_DepthPyramid, texelMin, level).r, texelFetch(s_DepthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+		max(texelFetch(s_DepthPyramid, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(s_DepthPyramid, texelMax, level).r));
+
+	// Hidden if the closest point of the box is behind everything drawn over it
+	return ndcMin.z * 0.5 + 0.5 > farthest;
+}
+
+void main() {
+	uint ix = gl_GlobalInvocationID.x;
+	if (ix >= uint(u_ObjectCount)) {
+		return;
+	}
+
+	vec3 center = Objects[ix].Bounds.xyz;
+	float radius = Objects[ix].Bounds.w;
+	if (!IsInFrustum(center, radius) || (u_UseDepthPyramid != 0 && IsOccluded(center, radius))) {
+		return;
+	}
+
+	// The same estimate as RenderComponent::UpdateLod, without the hysteresis since we don't
+	// keep anything between frames
+	uint lod = 0;
+	if (u_UseLods != 0) {
+		float depth = -(u_View * vec4(center, 1.0)).z;
+		float screenSize = u_Perspective != 0 ? (depth > radius ? radius * u_ProjectionScale / depth : 1.0) : radius * u_ProjectionScale;
+		while (lod + 1 < Objects[ix].LodCount && screenSize < u_LodScreenSizes[lod]) {
+			lod++;
+		}
+	}
+
+	uint slot = Objects[ix].FirstCommand + atomicAdd(Counts[Objects[ix].Group], 1u);
+	Commands[slot].Count = Objects[ix].LodIndexCounts[lod];
+	Commands[slot].InstanceCount = 1;
+	Commands[slot].FirstIndex = Objects[ix].LodFirstIndices[lod];
+	Commands[slot].BaseVertex = Objects[ix].BaseVertex;
+	// Picks our index out of GpuCuller's object index buffer for the vertex shader
+	Commands[slot].BaseInstance = ix;
+}
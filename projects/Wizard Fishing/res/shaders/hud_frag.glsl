@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 frag_color;
+
+// The atlas that all of our HUD sprites are packed into
+layout(binding = 0) uniform sampler2D s_Atlas;
+
+void main() {
+	frag_color = texture(s_Atlas, inUV) * inColor;
+}
@@ -0,0 +1,23 @@
+#version 450
+
+// xy is the anchor as a fraction of the screen, zw is the offset from it in reference pixels
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec4 outColor;
+
+// Maps pixels to clip space, with (0, 0) at the top left of the screen
+uniform mat4  u_Projection;
+// The size of the screen in pixels
+uniform vec2  u_ScreenSize;
+// The number of screen pixels per reference pixel
+uniform float u_Scale;
+
+void main() {
+	vec2 pixel = inPosition.xy * u_ScreenSize + inPosition.zw * u_Scale;
+	gl_Position = u_Projection * vec4(pixel, 0.0, 1.0);
+	outUV = inUV;
+	outColor = inColor;
+}
@@ -0,0 +1,23 @@
+#version 430
+
+layout(location = 0) in vec3 inColor;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in float inDepth;
+
+// Albedo in rgb and coverage in a
+layout(location = 0) out vec4 out_albedo;
+// The model space normal in rgb, and the depth in a
+layout(location = 1) out vec4 out_normal_depth;
+
+layout (binding = 1) uniform sampler2D s_Diffuse;
+
+void main() {
+	vec4 textureColor = texture(s_Diffuse, inUV);
+	// Matches how frag_blinn_phong_textured.glsl combines the vertex color and texture
+	out_albedo = vec4(inColor * textureColor.rgb, textureColor.a);
+
+	// Back faces are drawn too, so flip their normals to face the camera
+	vec3 normal = normalize(inNormal) * (gl_FrontFacing ? 1.0 : -1.0);
+	out_normal_depth = vec4(normal * 0.5 + 0.5, clamp(inDepth * 0.5 + 0.5, 0.0, 1.0));
+}
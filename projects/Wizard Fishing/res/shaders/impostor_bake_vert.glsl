@@ -0,0 +1,32 @@
+#version 430
+
+// Renders a mesh into one frame of an impostor atlas, see Gameplay::Impostor
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inUV;
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV;
+layout(location = 3) out float outDepth;
+
+// The orthographic camera for this frame, in model space
+uniform mat4  u_ViewProjection;
+// The model space bounding sphere of the mesh
+uniform vec3  u_BoundsCenter;
+uniform float u_BoundsRadius;
+// The direction from the mesh towards the camera for this frame
+uniform vec3  u_FrameDirection;
+
+void main() {
+	gl_Position = u_ViewProjection * vec4(inPosition, 1.0);
+
+	// Normals are kept in model space, so the impostor can be lit from any angle
+	outNormal = inNormal;
+	outColor = inColor;
+	outUV = inUV;
+	// How far the surface is in front of the bounds' center, from -1 to 1
+	outDepth = dot(inPosition - u_BoundsCenter, u_FrameDirection) / u_BoundsRadius;
+}
@@ -0,0 +1,67 @@
+#version 430
+
+layout(location = 0) in vec3 inWorldPos;
+layout(location = 1) in vec2 inFrameUV0;
+layout(location = 2) in vec2 inFrameUV1;
+layout(location = 3) in vec2 inFrameUV2;
+layout(location = 4) flat in vec2 inFrame0;
+layout(location = 5) flat in vec2 inFrame1;
+layout(location = 6) flat in vec2 inFrame2;
+layout(location = 7) flat in vec3 inWeights;
+layout(location = 8) flat in vec3 inDepthAxis;
+layout(location = 9) flat in mat3 inNormalMatrix;
+
+layout(location = 0) out vec4 frag_color;
+
+// Albedo and coverage for every frame
+layout (binding = 1) uniform sampler2D s_ImpostorAlbedo;
+// Model space normals, with the depth in front of the bounds' center in alpha
+layout (binding = 2) uniform sampler2D s_ImpostorNormalDepth;
+
+#include "fragments/multiple_point_lights.glsl"
+
+uniform mat4  u_ViewProjection;
+uniform vec3  u_CamPos;
+uniform int   u_Frames;
+uniform float u_Shininess;
+
+// Adds one frame's albedo and normal/depth to the running totals. The ray can leave a frame
+// near the edges of the quad, in which case that frame doesn't contribute
+void SampleFrame(vec2 frame, vec2 uv, float weight, inout vec4 albedo, inout vec4 normalDepth, inout float totalWeight) {
+	if (weight <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+		return;
+	}
+	vec2 atlasUV = (frame + uv) / float(u_Frames);
+	albedo += texture(s_ImpostorAlbedo, atlasUV) * weight;
+	normalDepth += texture(s_ImpostorNormalDepth, atlasUV) * weight;
+	totalWeight += weight;
+}
+
+void main() {
+	vec4 albedo = vec4(0.0);
+	vec4 normalDepth = vec4(0.0);
+	float totalWeight = 0.0;
+	SampleFrame(inFrame0, inFrameUV0, inWeights.x, albedo, normalDepth, totalWeight);
+	SampleFrame(inFrame1, inFrameUV1, inWeights.y, albedo, normalDepth, totalWeight);
+	SampleFrame(inFrame2, inFrameUV2, inWeights.z, albedo, normalDepth, totalWeight);
+	if (totalWeight <= 0.0) {
+		discard;
+	}
+	albedo /= totalWeight;
+	normalDepth /= totalWeight;
+
+	// Impostors are alpha tested, so they can be drawn in any order with the opaque geometry
+	if (albedo.a < 0.5) {
+		discard;
+	}
+
+	// Push the fragment out from the quad to where the mesh's surface was
+	vec3 worldPos = inWorldPos + inDepthAxis * (normalDepth.a * 2.0 - 1.0);
+	vec4 clipPos = u_ViewProjection * vec4(worldPos, 1.0);
+	gl_FragDepth = (clipPos.z / clipPos.w) * 0.5 + 0.5;
+
+	vec3 normal = normalize(inNormalMatrix * (normalDepth.rgb * 2.0 - 1.0));
+	vec3 lightAccumulation = CalcAllLightContribution(worldPos, normal, u_CamPos, u_Shininess);
+	// Empty texels are black, so filtering darkens the edges of the mesh. Dividing by the coverage undoes that
+	frag_color = vec4(lightAccumulation * albedo.rgb / albedo.a, 1.0);
+}
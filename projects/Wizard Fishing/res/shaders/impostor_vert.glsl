@@ -0,0 +1,110 @@
+#version 430
+
+// Draws impostors as camera facing quads, see Gameplay::Impostor. There are no vertex
+// attributes, each instance is 6 vertices and gets it's transform from b_ImpostorInstances
+
+// The model matrix of every impostor drawn this frame
+layout (std430, binding = 5) readonly buffer b_ImpostorInstances {
+	mat4 Instances[];
+};
+
+layout(location = 0) out vec3 outWorldPos;
+// The UVs inside each of the 3 frames we blend, and the bottom left of those frames in the atlas
+layout(location = 1) out vec2 outFrameUV0;
+layout(location = 2) out vec2 outFrameUV1;
+layout(location = 3) out vec2 outFrameUV2;
+layout(location = 4) flat out vec2 outFrame0;
+layout(location = 5) flat out vec2 outFrame1;
+layout(location = 6) flat out vec2 outFrame2;
+layout(location = 7) flat out vec3 outWeights;
+// The world space offset for a depth of 1, pointing towards the camera
+layout(location = 8) flat out vec3 outDepthAxis;
+layout(location = 9) flat out mat3 outNormalMatrix;
+
+uniform mat4  u_ViewProjection;
+uniform vec3  u_CamPos;
+// The model space bounding sphere of the mesh
+uniform vec3  u_BoundsCenter;
+uniform float u_BoundsRadius;
+// The number of frames along each side of the atlas
+uniform int   u_Frames;
+// Where this batch's instances start in b_ImpostorInstances
+uniform int   u_FirstInstance;
+
+const vec2 CORNERS[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// Must match OctahedralToDirection in Impostor.cpp
+vec3 OctahedralToDirection(vec2 uv) {
+	vec2 p = uv * 2.0 - 1.0;
+	vec3 dir = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	if (dir.z < 0.0) {
+		dir.xy = (1.0 - abs(dir.yx)) * sign(dir.xy);
+	}
+	return normalize(dir);
+}
+
+// The inverse of OctahedralToDirection
+vec2 DirectionToOctahedral(vec3 dir) {
+	dir /= abs(dir.x) + abs(dir.y) + abs(dir.z);
+	vec2 p = dir.z >= 0.0 ? dir.xy : (1.0 - abs(dir.yx)) * sign(dir.xy);
+	return p * 0.5 + 0.5;
+}
+
+// Must match GetFrameBasis in Impostor.cpp
+void GetFrameBasis(vec3 dir, out vec3 right, out vec3 up) {
+	vec3 reference = abs(dir.z) > 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(0.0, 0.0, 1.0);
+	right = normalize(cross(reference, dir));
+	up = cross(dir, right);
+}
+
+// Finds where the ray from the camera through a point on the quad hits the image plane of a
+// frame, and returns the UV of that spot within the frame
+vec2 ProjectToFrame(vec2 frame, vec3 camera, vec3 point) {
+	vec3 dir = OctahedralToDirection(frame / float(u_Frames - 1));
+	vec3 right, up;
+	GetFrameBasis(dir, right, up);
+
+	vec3 ray = point - camera;
+	float t = dot(u_BoundsCenter - camera, dir) / dot(ray, dir);
+	vec3 hit = camera + ray * t - u_BoundsCenter;
+	return vec2(dot(hit, right), dot(hit, up)) / (2.0 * u_BoundsRadius) + 0.5;
+}
+
+void main() {
+	mat4 model = Instances[u_FirstInstance + gl_InstanceID];
+
+	// Everything is worked out in model space, which is the space the frames were rendered in
+	vec3 camera = (inverse(model) * vec4(u_CamPos, 1.0)).xyz;
+	vec3 viewDir = normalize(camera - u_BoundsCenter);
+	vec3 right, up;
+	GetFrameBasis(viewDir, right, up);
+	vec3 position = u_BoundsCenter + (CORNERS[gl_VertexID].x * right + CORNERS[gl_VertexID].y * up) * u_BoundsRadius;
+
+	// Find the triangle of frames on the grid around our view direction, and our barycentric
+	// coordinates inside of it. These are the same for the whole quad
+	vec2 grid = DirectionToOctahedral(viewDir) * float(u_Frames - 1);
+	vec2 cell = min(floor(grid), vec2(u_Frames - 2));
+	vec2 f = grid - cell;
+	if (f.x + f.y < 1.0) {
+		outFrame0 = cell;
+		outWeights = vec3(1.0 - f.x - f.y, f.x, f.y);
+	} else {
+		outFrame0 = cell + vec2(1.0);
+		outWeights = vec3(f.x + f.y - 1.0, 1.0 - f.y, 1.0 - f.x);
+	}
+	outFrame1 = cell + vec2(1.0, 0.0);
+	outFrame2 = cell + vec2(0.0, 1.0);
+
+	outFrameUV0 = ProjectToFrame(outFrame0, camera, position);
+	outFrameUV1 = ProjectToFrame(outFrame1, camera, position);
+	outFrameUV2 = ProjectToFrame(outFrame2, camera, position);
+
+	vec4 worldPos = model * vec4(position, 1.0);
+	outWorldPos = worldPos.xyz;
+	outDepthAxis = mat3(model) * viewDir * u_BoundsRadius;
+	outNormalMatrix = transpose(inverse(mat3(model)));
+	gl_Position = u_ViewProjection * worldPos;
+}
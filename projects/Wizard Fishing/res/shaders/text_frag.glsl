@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 frag_color;
+
+// The font's glyph atlas, with the glyph coverage stored in the red channel
+layout(binding = 0) uniform sampler2D s_Atlas;
+
+void main() {
+	frag_color = vec4(inColor.rgb, inColor.a * texture(s_Atlas, inUV).r);
+}
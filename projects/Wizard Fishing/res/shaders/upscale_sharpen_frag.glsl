@@ -0,0 +1,38 @@
+#version 450
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+// The scene, rendered into the bottom left corner of the texture
+layout(binding = 0) uniform sampler2D s_Source;
+
+// The fraction of the source texture that was rendered to, in xy
+uniform vec2  u_UvScale;
+// 0 for plain bilinear upscaling, up to 1 for the strongest sharpening
+uniform float u_Sharpness;
+
+void main() {
+	vec2 texel = 1.0 / vec2(textureSize(s_Source, 0));
+	// Keep every tap inside the rendered region, so we never pull in stale pixels from outside it
+	vec2 minUV = texel * 0.5;
+	vec2 maxUV = u_UvScale - texel * 0.5;
+	vec2 uv = clamp(inUV * u_UvScale, minUV, maxUV);
+
+	vec3 center = texture(s_Source, uv).rgb;
+	if (u_Sharpness <= 0.0) {
+		frag_color = vec4(center, 1.0);
+		return;
+	}
+
+	vec3 north = texture(s_Source, clamp(uv + vec2(0.0, texel.y), minUV, maxUV)).rgb;
+	vec3 south = texture(s_Source, clamp(uv - vec2(0.0, texel.y), minUV, maxUV)).rgb;
+	vec3 east  = texture(s_Source, clamp(uv + vec2(texel.x, 0.0), minUV, maxUV)).rgb;
+	vec3 west  = texture(s_Source, clamp(uv - vec2(texel.x, 0.0), minUV, maxUV)).rgb;
+
+	// Unsharp mask, clamped to the range of the neighbourhood so edges don't ring
+	vec3 sharpened = center + (4.0 * center - north - south - east - west) * (u_Sharpness * 0.25);
+	vec3 lo = min(center, min(min(north, south), min(east, west)));
+	vec3 hi = max(center, max(max(north, south), max(east, west)));
+	frag_color = vec4(clamp(sharpened, lo, hi), 1.0);
+}
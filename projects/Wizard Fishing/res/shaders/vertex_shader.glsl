@@ -1,9 +1,36 @@
-#version 410
+#version 430
 
+// MORPH blends between two key frames of the mesh, using t as the blend factor
+#pragma multi_compile MORPH
+// These are enabled by the renderer, never by materials:
+// VERTEX_PULLING fetches the vertices from the geometry pool instead of from vertex attributes
+// GPU_CULLED draws an object from GpuCuller's indirect commands, and needs VERTEX_PULLING as well
+#pragma multi_compile_engine VERTEX_PULLING GPU_CULLED
+
+#ifdef VERTEX_PULLING
+// Every vertex in the pool is 12 floats: position, normal, UV and color (see GeometryPool)
+layout (std430, binding = 4) readonly buffer b_PulledVertices {
+	float PulledVertices[];
+};
+#ifdef MORPH
+// The number of vertices from ours to the matching vertex of the frame we blend towards
+uniform int u_MorphTargetOffset;
+#endif
+
+vec3 PullVec3(int vertex, int offset) {
+	int ix = vertex * 12 + offset;
+	return vec3(PulledVertices[ix], PulledVertices[ix + 1], PulledVertices[ix + 2]);
+}
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
+#ifdef MORPH
+layout(location = 4) in vec3 inPosition2;
+layout(location = 5) in vec3 inNormal2;
+#endif
+#endif
 
 layout(location = 0) out vec3 outWorldPos;
 layout(location = 1) out vec3 outColor;
@@ -16,23 +43,74 @@ uniform mat4 u_ModelViewProjection;
 uniform mat4 u_Model;
 // Normal Matrix for transforming normals
 uniform mat3 u_NormalMatrix;
+#ifdef MORPH
+uniform float t;
+#endif
+
+#ifdef GPU_CULLED
+// Must match GpuCuller::ObjectData, we only need the transforms
+struct CulledObject {
+	mat4  Model;
+	vec4  NormalMatrix[3];
+	vec4  Bounds;
+	uvec4 LodIndexCounts;
+	uvec4 LodFirstIndices;
+	int   BaseVertex;
+	uint  LodCount;
+	uint  FirstCommand;
+	uint  Group;
+};
+layout (std430, binding = 6) readonly buffer b_CulledObjects {
+	CulledObject CulledObjects[];
+};
+// Read at the command's base instance, which is the index of the object being drawn
+layout(location = 4) in uint inObjectIndex;
+uniform mat4 u_ViewProjection;
+#endif
 
 void main() {
+#ifdef VERTEX_PULLING
+	// gl_VertexID already has the mesh's base vertex added in
+	vec3 position = PullVec3(gl_VertexID, 0);
+	vec3 normal = PullVec3(gl_VertexID, 3);
+	vec2 uv = vec2(PulledVertices[gl_VertexID * 12 + 6], PulledVertices[gl_VertexID * 12 + 7]);
+	vec3 color = PullVec3(gl_VertexID, 8);
+	#ifdef MORPH
+	position = mix(position, PullVec3(gl_VertexID + u_MorphTargetOffset, 0), t);
+	normal = mix(normal, PullVec3(gl_VertexID + u_MorphTargetOffset, 3), t);
+	#endif
+#else
+	vec3 position = inPosition;
+	vec3 normal = inNormal;
+	vec2 uv = inUV;
+	vec3 color = inColor;
+	#ifdef MORPH
+	position = mix(inPosition, inPosition2, t);
+	normal = mix(inNormal, inNormal2, t);
+	#endif
+#endif
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+#ifdef GPU_CULLED
+	mat4 model = CulledObjects[inObjectIndex].Model;
+	mat3 normalMatrix = mat3(CulledObjects[inObjectIndex].NormalMatrix[0].xyz, CulledObjects[inObjectIndex].NormalMatrix[1].xyz, CulledObjects[inObjectIndex].NormalMatrix[2].xyz);
+	gl_Position = u_ViewProjection * model * vec4(position, 1.0);
+#else
+	mat4 model = u_Model;
+	mat3 normalMatrix = u_NormalMatrix;
+	gl_Position = u_ModelViewProjection * vec4(position, 1.0);
+#endif
 
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outWorldPos = (u_Model * vec4(inPosition, 1.0)).xyz;
+	outWorldPos = (model * vec4(position, 1.0)).xyz;
 
 	// Normals
-	outNormal = u_NormalMatrix * inNormal;
+	outNormal = normalMatrix * normal;
 
 	// Pass our UV coords to the fragment shader
-	outUV = inUV;
+	outUV = uv;
 
 	///////////
-	outColor = inColor;
+	outColor = color;
 
 }
-
@@ -0,0 +1,228 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Logging.h"
+#include "Graphics/RenderThread.h"
+
+namespace Gameplay {
+	// Sends data to a storage buffer from the render thread. Assignment runs on the main thread, so the
+	// data is moved into the command, leaving us free to overwrite our copy next frame
+	template <typename T>
+	static void UploadToBuffer(const ShaderStorageBuffer::Sptr& buffer, std::vector<T> data) {
+		RenderThread::Enqueue([buffer, data = std::move(data)]() {
+			buffer->LoadData(data.data(), data.size());
+		});
+	}
+
+	ClusteredLighting::ClusteredLighting() :
+		_lightBuffer(ShaderStorageBuffer::Create()),
+		_clusterBuffer(ShaderStorageBuffer::Create()),
+		_lightIndexBuffer(ShaderStorageBuffer::Create()),
+		_lightSpheres(std::vector<glm::vec4>()),
+		_clusterBounds(std::vector<ClusterBounds>(CLUSTER_COUNT)),
+		_clusters(std::vector<glm::uvec2>(CLUSTER_COUNT, glm::uvec2(0))),
+		_lightIndices(std::vector<uint32_t>()),
+		_assignments(std::vector<glm::uvec2>()),
+		_cachedProjection(glm::mat4(0.0f)),
+		_cachedView(glm::mat4(0.0f)),
+		_isDirty(true)
+	{
+		_params.GridSize    = glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0);
+		_params.DepthParams = glm::vec4(0.0f);
+		_params.TileSize    = glm::vec4(1.0f);
+
+		// Make sure every buffer has a data store, so shaders have something valid to read
+		// before our first update (all clusters are empty)
+		GpuLight emptyLight = GpuLight();
+		uint32_t emptyIndex = 0;
+		_lightBuffer->LoadData(&emptyLight, 1);
+		_clusterBuffer->LoadData(_clusters.data(), _clusters.size());
+		_lightIndexBuffer->LoadData(&emptyIndex, 1);
+	}
+
+	void ClusteredLighting::SetLights(const std::vector<Light>& lights) {
+		std::vector<GpuLight> gpuLights;
+		gpuLights.resize(std::max(lights.size(), (size_t)1));
+		_lightSpheres.resize(lights.size());
+
+		for (size_t ix = 0; ix < lights.size(); ix++) {
+			const Light& light = lights[ix];
+			GpuLight& data = gpuLights[ix];
+
+			data.Position = light.Position;
+			data.Color = light.Color;
+			data.Attenuation = 1.0f / (1.0f + light.Range);
+
+			// Diffuse and specular are both at most the light color, so the light can contribute
+			// at most 2 * color / (1 + attenuation * d^2). Solve for where that hits the cutoff
+			float maxComponent = glm::max(glm::max(light.Color.r, light.Color.g), light.Color.b);
+			float radius = sqrtf(glm::max(2.0f * maxComponent / ATTENUATION_CUTOFF - 1.0f, 0.0f) / data.Attenuation);
+			_lightSpheres[ix] = glm::vec4(light.Position, radius);
+		}
+
+		UploadToBuffer(_lightBuffer, std::move(gpuLights));
+		_isDirty = true;
+	}
+
+	void ClusteredLighting::Update(const Camera::Sptr& camera, const glm::ivec2& viewportSize) {
+		if (camera == nullptr || viewportSize.x <= 0 || viewportSize.y <= 0) {
+			return;
+		}
+
+		// The clusters are evenly spaced in NDC, so a resize only changes the tile size
+		_params.TileSize = glm::vec4(
+			(float)viewportSize.x / (float)CLUSTERS_X,
+			(float)viewportSize.y / (float)CLUSTERS_Y,
+			0.0f, 0.0f
+		);
+
+		const glm::mat4& projection = camera->GetProjection();
+		if (projection != _cachedProjection) {
+			_cachedProjection = projection;
+			_RebuildClusterBounds(projection, camera->GetOrthoEnabled());
+			_isDirty = true;
+		}
+
+		const glm::mat4& view = camera->GetView();
+		if (view != _cachedView) {
+			_cachedView = view;
+			_isDirty = true;
+		}
+
+		if (!_isDirty) {
+			return;
+		}
+		_isDirty = false;
+
+		float nearPlane = _params.DepthParams.x;
+		float farPlane = _params.DepthParams.y;
+
+		// Find every (cluster, light) pair where the light's sphere touches the cluster
+		_assignments.clear();
+		for (uint32_t lightIx = 0; lightIx < _lightSpheres.size(); lightIx++) {
+			glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(_lightSpheres[lightIx]), 1.0f));
+			float radius = _lightSpheres[lightIx].w;
+			float depth = -center.z;
+
+			// Skip anything entirely in front of the near plane or behind the far plane
+			if (depth + radius < nearPlane || depth - radius > farPlane) {
+				continue;
+			}
+
+			int minSlice = _GetDepthSlice(depth - radius);
+			int maxSlice = _GetDepthSlice(depth + radius);
+			for (int z = minSlice; z <= maxSlice; z++) {
+				for (int y = 0; y < CLUSTERS_Y; y++) {
+					for (int x = 0; x < CLUSTERS_X; x++) {
+						uint32_t clusterIx = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+						const ClusterBounds& bounds = _clusterBounds[clusterIx];
+
+						// Sphere vs AABB, using the closest point in the box to the sphere
+						glm::vec3 closest = glm::clamp(center, bounds.Min, bounds.Max);
+						glm::vec3 delta = closest - center;
+						if (glm::dot(delta, delta) <= radius * radius) {
+							_assignments.push_back(glm::uvec2(clusterIx, lightIx));
+						}
+					}
+				}
+			}
+		}
+
+		// Counting sort the assignments by cluster, so each cluster's lights are contiguous
+		for (glm::uvec2& cluster : _clusters) {
+			cluster = glm::uvec2(0);
+		}
+		for (const glm::uvec2& assignment : _assignments) {
+			_clusters[assignment.x].y++;
+		}
+		uint32_t offset = 0;
+		for (glm::uvec2& cluster : _clusters) {
+			cluster.x = offset;
+			offset += cluster.y;
+			cluster.y = 0;
+		}
+		_lightIndices.resize(_assignments.size());
+		for (const glm::uvec2& assignment : _assignments) {
+			glm::uvec2& cluster = _clusters[assignment.x];
+			_lightIndices[cluster.x + cluster.y] = assignment.y;
+			cluster.y++;
+		}
+
+		UploadToBuffer(_clusterBuffer, _clusters);
+		if (!_lightIndices.empty()) {
+			UploadToBuffer(_lightIndexBuffer, _lightIndices);
+		}
+	}
+
+	void ClusteredLighting::Bind() const {
+		_lightBuffer->Bind(LIGHT_SSBO_BINDING_SLOT);
+		_clusterBuffer->Bind(CLUSTER_SSBO_BINDING_SLOT);
+		_lightIndexBuffer->Bind(LIGHT_INDEX_SSBO_BINDING_SLOT);
+	}
+
+	void ClusteredLighting::_RebuildClusterBounds(const glm::mat4& projection, bool isOrtho) {
+		glm::mat4 invProjection = glm::inverse(projection);
+
+		// Recover the near and far planes from the projection, so that we match it exactly
+		glm::vec4 nearPoint = invProjection * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+		glm::vec4 farPoint = invProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		float nearPlane = -nearPoint.z / nearPoint.w;
+		float farPlane = -farPoint.z / farPoint.w;
+		if (nearPlane <= 0.0f || farPlane <= nearPlane) {
+			LOG_WARN("Camera near and far planes are not usable for light clustering ({}, {})", nearPlane, farPlane);
+			nearPlane = glm::max(nearPlane, 0.001f);
+			farPlane = glm::max(farPlane, nearPlane + 1.0f);
+		}
+
+		// Depth slices are exponential, so slice = log(depth) * scale + bias
+		float logRatio = logf(farPlane / nearPlane);
+		float sliceScale = (float)CLUSTERS_Z / logRatio;
+		float sliceBias = -(float)CLUSTERS_Z * logf(nearPlane) / logRatio;
+		_params.GridSize.w = isOrtho ? 1 : 0;
+		_params.DepthParams = glm::vec4(nearPlane, farPlane, sliceScale, sliceBias);
+
+		for (int y = 0; y < CLUSTERS_Y; y++) {
+			for (int x = 0; x < CLUSTERS_X; x++) {
+				// Find the corners of this tile on the near plane in view space
+				glm::vec3 corners[4];
+				for (int ix = 0; ix < 4; ix++) {
+					glm::vec2 ndc = glm::vec2(
+						-1.0f + 2.0f * (float)(x + (ix & 1)) / (float)CLUSTERS_X,
+						-1.0f + 2.0f * (float)(y + (ix >> 1)) / (float)CLUSTERS_Y
+					);
+					glm::vec4 point = invProjection * glm::vec4(ndc, -1.0f, 1.0f);
+					corners[ix] = glm::vec3(point) / point.w;
+				}
+
+				for (int z = 0; z < CLUSTERS_Z; z++) {
+					float sliceNear = nearPlane * powf(farPlane / nearPlane, (float)z / (float)CLUSTERS_Z);
+					float sliceFar = nearPlane * powf(farPlane / nearPlane, (float)(z + 1) / (float)CLUSTERS_Z);
+
+					ClusterBounds& bounds = _clusterBounds[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+					bounds.Min = glm::vec3(std::numeric_limits<float>::max());
+					bounds.Max = glm::vec3(std::numeric_limits<float>::lowest());
+					for (int ix = 0; ix < 4; ix++) {
+						for (float depth : { sliceNear, sliceFar }) {
+							// Perspective tiles widen with depth, orthographic tiles do not
+							glm::vec3 point = isOrtho ?
+								glm::vec3(corners[ix].x, corners[ix].y, -depth) :
+								corners[ix] * (depth / -corners[ix].z);
+							bounds.Min = glm::min(bounds.Min, point);
+							bounds.Max = glm::max(bounds.Max, point);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	int ClusteredLighting::_GetDepthSlice(float depth) const {
+		if (depth <= _params.DepthParams.x) {
+			return 0;
+		}
+		int slice = (int)floorf(logf(depth) * _params.DepthParams.z + _params.DepthParams.w);
+		return glm::clamp(slice, 0, CLUSTERS_Z - 1);
+	}
+}
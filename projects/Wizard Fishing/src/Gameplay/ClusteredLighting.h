@@ -0,0 +1,142 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Light.h"
+#include "Gameplay/Components/Camera.h"
+#include "Graphics/ShaderStorageBuffer.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Handles assigning the lights in a scene to a 3D grid of clusters that subdivide
+	/// the camera's frustum, so that each fragment only needs to shade the lights that
+	/// can actually reach it
+	///
+	/// Clusters are tiled evenly across the screen, and exponentially along the depth
+	/// axis. Light assignment happens on the CPU, and the results are uploaded into
+	/// the shader storage buffers used by fragments/multiple_point_lights.glsl
+	///
+	/// SetLights and Update can be called from the main thread, the uploads are sent to the
+	/// render thread. Bind must be called from the render thread
+	/// </summary>
+	class ClusteredLighting {
+	public:
+		typedef std::shared_ptr<ClusteredLighting> Sptr;
+
+		// The number of clusters along each axis, must match what we upload in GridParams
+		static const int CLUSTERS_X = 16;
+		static const int CLUSTERS_Y = 9;
+		static const int CLUSTERS_Z = 24;
+		static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+		// Shader storage binding slots, these must match multiple_point_lights.glsl
+		static const int LIGHT_SSBO_BINDING_SLOT = 1;
+		static const int CLUSTER_SSBO_BINDING_SLOT = 2;
+		static const int LIGHT_INDEX_SSBO_BINDING_SLOT = 3;
+
+		// Our lights never fully fall off, so we treat them as out of range once their
+		// contribution drops below what an 8 bit color channel can represent
+		static constexpr float ATTENUATION_CUTOFF = 1.0f / 256.0f;
+
+		/// <summary>
+		/// Represents a single light as it is laid out in the light SSBO (std430)
+		/// </summary>
+		struct GpuLight {
+			// This lets us continue to access Position as a vec3, but also allocates space for the
+			// pack at the end (since objects are vec4 aligned)
+			union {
+				glm::vec3 Position;
+				glm::vec4 Position4;
+			};
+			// Since these are tightly packed, will match the vec4 in light
+			glm::vec3 Color;
+			float     Attenuation;
+		};
+
+		/// <summary>
+		/// The parameters that the shaders need to find which cluster a fragment is in,
+		/// these are stored in the lighting UBO
+		/// </summary>
+		struct GridParams {
+			// The number of clusters along each axis in xyz, w is 1 for orthographic cameras
+			glm::uvec4 GridSize;
+			// The near plane, far plane, and the scale and bias for finding the depth slice
+			glm::vec4  DepthParams;
+			// The size of a cluster in pixels in xy, zw are unused
+			glm::vec4  TileSize;
+		};
+
+		static inline Sptr Create() {
+			return std::make_shared<ClusteredLighting>();
+		}
+
+		ClusteredLighting();
+		~ClusteredLighting() = default;
+
+		ClusteredLighting(const ClusteredLighting& other) = delete;
+		ClusteredLighting(ClusteredLighting&& other) = delete;
+		ClusteredLighting& operator=(const ClusteredLighting& other) = delete;
+		ClusteredLighting& operator=(ClusteredLighting&& other) = delete;
+
+		/// <summary>
+		/// Uploads a new set of lights, and marks the clusters as needing to be rebuilt
+		/// </summary>
+		/// <param name="lights">The lights to upload</param>
+		void SetLights(const std::vector<Light>& lights);
+
+		/// <summary>
+		/// Re-assigns lights to clusters if the camera, viewport or lights have changed
+		/// since the last update, and uploads the results to the GPU
+		/// </summary>
+		/// <param name="camera">The camera that the scene will be rendered with</param>
+		/// <param name="viewportSize">The size of the viewport in pixels</param>
+		void Update(const Camera::Sptr& camera, const glm::ivec2& viewportSize);
+
+		/// <summary>
+		/// Binds the light, cluster and light index buffers to their slots
+		/// </summary>
+		void Bind() const;
+
+		/// <summary>
+		/// Gets the parameters that shaders need to look up clusters
+		/// </summary>
+		const GridParams& GetGridParams() const { return _params; }
+		/// <summary>
+		/// Gets the total number of light indices assigned across all clusters
+		/// </summary>
+		size_t GetAssignedLightCount() const { return _lightIndices.size(); }
+
+	protected:
+		// Represents the view space bounds of a single cluster
+		struct ClusterBounds {
+			glm::vec3 Min;
+			glm::vec3 Max;
+		};
+
+		ShaderStorageBuffer::Sptr _lightBuffer;
+		ShaderStorageBuffer::Sptr _clusterBuffer;
+		ShaderStorageBuffer::Sptr _lightIndexBuffer;
+
+		// World space light positions, and the distance at which the light falls below ATTENUATION_CUTOFF
+		std::vector<glm::vec4>     _lightSpheres;
+		std::vector<ClusterBounds> _clusterBounds;
+
+		// These are all kept around between updates so that we don't re-allocate every frame
+		// Stores (offset, count) into _lightIndices for each cluster
+		std::vector<glm::uvec2>    _clusters;
+		std::vector<uint32_t>      _lightIndices;
+		// Pairs of (cluster, light) found during assignment, before they are sorted by cluster
+		std::vector<glm::uvec2>    _assignments;
+
+		GridParams _params;
+		glm::mat4  _cachedProjection;
+		glm::mat4  _cachedView;
+		bool       _isDirty;
+
+		// Re-calculates the view space bounds for every cluster, only needed when the projection changes
+		void _RebuildClusterBounds(const glm::mat4& projection, bool isOrtho);
+		// Finds the depth slice that a given view space depth falls into
+		int _GetDepthSlice(float depth) const;
+	};
+}
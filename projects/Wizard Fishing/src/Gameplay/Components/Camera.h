@@ -75,7 +75,7 @@ namespace Gameplay {
 		/// <summary>
 		/// Gets the projection matrix for this camera
 		/// </summary>
-		const glm::mat4& GetProjection() const { return _projection; }
+		const glm::mat4& GetProjection() const { return __CalculateProjection(); }
 		/// <summary>
 		/// Gets the combined view-projection matrix for this camera, calculating if needed
 		/// </summary>
@@ -6,6 +6,7 @@
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 #include <Gameplay/Components/Minigame.h>
 #include <Gameplay/Components/FishMovement.h>
 #include <Gameplay/Components/MorphAnimator.h>
@@ -52,14 +53,14 @@ void Casting::Update(float deltaTime) {
 
 
 
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_R) == GLFW_PRESS && !hasCast)
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_R) == GLFW_PRESS && !hasCast)
 	{
 		hasCast = true;
 		SetTarget(GetGameObject()->GetScene()->FindObjectByName("Target")->GetPosition());
 		GetGameObject()->GetScene()->FindObjectByName("Target")->Get<TargetComponent>()->fishing = true;
 	}
 
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_E))
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_E))
 	{
 		hasFinished = false;
 		hasCast = false;
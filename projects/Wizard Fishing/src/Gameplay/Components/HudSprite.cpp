@@ -0,0 +1,64 @@
+#include "Gameplay/Components/HudSprite.h"
+
+#include "Graphics/HudBatcher.h"
+#include "Utils/ImGuiHelper.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+
+HudSprite::HudSprite() :
+	IComponent(),
+	Texture(nullptr),
+	UvRect(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)),
+	Anchor(glm::vec2(0.5f)),
+	Offset(glm::vec2(0.0f)),
+	Size(glm::vec2(100.0f)),
+	Pivot(glm::vec2(0.5f)),
+	Color(glm::vec4(1.0f)),
+	Fill(1.0f),
+	FlipX(false)
+{ }
+
+void HudSprite::Draw() const {
+	HudBatcher::Get().DrawSprite(Texture, UvRect, Anchor, Offset, Size, Pivot, Color, Fill, FlipX);
+}
+
+void HudSprite::RenderImGui() {
+	LABEL_LEFT(ImGui::DragFloat2, "Anchor", &Anchor.x, 0.01f, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::DragFloat2, "Offset", &Offset.x);
+	LABEL_LEFT(ImGui::DragFloat2, "Size  ", &Size.x);
+	LABEL_LEFT(ImGui::DragFloat2, "Pivot ", &Pivot.x, 0.01f, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::ColorEdit4, "Color ", &Color.x);
+	LABEL_LEFT(ImGui::SliderFloat, "Fill  ", &Fill, 0.0f, 1.0f);
+	ImGui::Checkbox("Flip X", &FlipX);
+}
+
+nlohmann::json HudSprite::ToJson() const {
+	return {
+		{ "texture", Texture ? Texture->IResource::GetGUID().str() : "null" },
+		{ "uv_rect", GlmToJson(UvRect) },
+		{ "anchor", GlmToJson(Anchor) },
+		{ "offset", GlmToJson(Offset) },
+		{ "size", GlmToJson(Size) },
+		{ "pivot", GlmToJson(Pivot) },
+		{ "color", GlmToJson(Color) },
+		{ "fill", Fill },
+		{ "flip_x", FlipX }
+	};
+}
+
+HudSprite::Sptr HudSprite::FromJson(const nlohmann::json& data) {
+	HudSprite::Sptr result = std::make_shared<HudSprite>();
+	std::string texture = JsonGet<std::string>(data, "texture", "null");
+	if (texture != "null") {
+		result->Texture = ResourceManager::Get<Texture2D>(Guid(texture));
+	}
+	result->UvRect = ParseJsonVec4(data["uv_rect"]);
+	result->Anchor = ParseJsonVec2(data["anchor"]);
+	result->Offset = ParseJsonVec2(data["offset"]);
+	result->Size = ParseJsonVec2(data["size"]);
+	result->Pivot = ParseJsonVec2(data["pivot"]);
+	result->Color = ParseJsonVec4(data["color"]);
+	result->Fill = JsonGet(data, "fill", 1.0f);
+	result->FlipX = JsonGet(data, "flip_x", false);
+	return result;
+}
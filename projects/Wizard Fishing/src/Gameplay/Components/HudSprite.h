@@ -0,0 +1,46 @@
+#pragma once
+#include "IComponent.h"
+#include "Graphics/Texture2D.h"
+
+/// <summary>
+/// A sprite drawn on the HUD, over the top of the scene. The sprite is placed in screen space
+/// relative to an anchor point, and does not care about the transform of it's game object
+///
+/// Offsets and sizes are in pixels on a screen HudBatcher::REFERENCE_HEIGHT pixels tall, and
+/// are scaled with the window. Disable the component to hide the sprite
+/// </summary>
+class HudSprite : public Gameplay::IComponent {
+public:
+	typedef std::shared_ptr<HudSprite> Sptr;
+
+	HudSprite();
+
+	// The texture to cut the sprite out of
+	Texture2D::Sptr Texture;
+	// The region of the texture to draw, as (min u, min v, max u, max v)
+	glm::vec4 UvRect;
+	// The point on the screen the sprite is placed relative to, (0, 0) is the top left and (1, 1) the bottom right
+	glm::vec2 Anchor;
+	// The offset from the anchor to the sprite's pivot, in reference pixels
+	glm::vec2 Offset;
+	// The size of the sprite, in reference pixels
+	glm::vec2 Size;
+	// The point on the sprite that is placed at the offset, (0, 0) is the top left
+	glm::vec2 Pivot;
+	// The color to multiply the sprite by
+	glm::vec4 Color;
+	// How much of the sprite is drawn from left to right, 0 to 1
+	float     Fill;
+	// True to mirror the sprite horizontally
+	bool      FlipX;
+
+	/// <summary>
+	/// Adds this sprite to the HUD batch for the current frame
+	/// </summary>
+	void Draw() const;
+
+	virtual void RenderImGui() override;
+	virtual nlohmann::json ToJson() const override;
+	static HudSprite::Sptr FromJson(const nlohmann::json& data);
+	MAKE_TYPENAME(HudSprite);
+};
@@ -0,0 +1,80 @@
+#include "Gameplay/Components/HudText.h"
+
+#include "Utils/ImGuiHelper.h"
+#include "Utils/JsonGlmHelpers.h"
+
+HudText::HudText() :
+	IComponent(),
+	Text(""),
+	FontFile("fonts/Roboto-Medium.ttf"),
+	FontSize(32.0f),
+	Anchor(glm::vec2(0.5f)),
+	Offset(glm::vec2(0.0f)),
+	Pivot(glm::vec2(0.5f)),
+	Scale(1.0f),
+	Color(glm::vec4(1.0f)),
+	_font(nullptr),
+	_loadedFontFile(""),
+	_loadedFontSize(0.0f),
+	_run(TextRenderer::Run())
+{ }
+
+void HudText::Draw() {
+	if (FontFile != _loadedFontFile || FontSize != _loadedFontSize) {
+		_loadedFontFile = FontFile;
+		_loadedFontSize = FontSize;
+		_font = FontSize > 0.0f ? Font::Get(FontFile, FontSize) : nullptr;
+	}
+
+	bool rebuilt = _run.Update(_font, Text, Anchor, Offset, Pivot, Scale, Color);
+	TextRenderer::Get().DrawRun(_run, rebuilt);
+}
+
+void HudText::RenderImGui() {
+	// Anything past the end of our text boxes is cut off while editing
+	static char buffer[256];
+	size_t length = glm::min(Text.size(), sizeof(buffer) - 1);
+	memcpy(buffer, Text.c_str(), length);
+	buffer[length] = '\0';
+	if (ImGui::InputTextMultiline("##Text", buffer, sizeof(buffer))) {
+		Text = buffer;
+	}
+	length = glm::min(FontFile.size(), sizeof(buffer) - 1);
+	memcpy(buffer, FontFile.c_str(), length);
+	buffer[length] = '\0';
+	if (LABEL_LEFT(ImGui::InputText, "Font  ", buffer, sizeof(buffer))) {
+		FontFile = buffer;
+	}
+	LABEL_LEFT(ImGui::DragFloat, "Size  ", &FontSize, 1.0f, 4.0f, 256.0f);
+	LABEL_LEFT(ImGui::DragFloat2, "Anchor", &Anchor.x, 0.01f, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::DragFloat2, "Offset", &Offset.x);
+	LABEL_LEFT(ImGui::DragFloat2, "Pivot ", &Pivot.x, 0.01f, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::DragFloat, "Scale ", &Scale, 0.01f, 0.01f);
+	LABEL_LEFT(ImGui::ColorEdit4, "Color ", &Color.x);
+}
+
+nlohmann::json HudText::ToJson() const {
+	return {
+		{ "text", Text },
+		{ "font", FontFile },
+		{ "font_size", FontSize },
+		{ "anchor", GlmToJson(Anchor) },
+		{ "offset", GlmToJson(Offset) },
+		{ "pivot", GlmToJson(Pivot) },
+		{ "scale", Scale },
+		{ "color", GlmToJson(Color) }
+	};
+}
+
+HudText::Sptr HudText::FromJson(const nlohmann::json& data) {
+	HudText::Sptr result = std::make_shared<HudText>();
+	result->Text = JsonGet<std::string>(data, "text", "");
+	result->FontFile = JsonGet<std::string>(data, "font", result->FontFile);
+	result->FontSize = JsonGet(data, "font_size", result->FontSize);
+	result->Anchor = ParseJsonVec2(data["anchor"]);
+	result->Offset = ParseJsonVec2(data["offset"]);
+	result->Pivot = ParseJsonVec2(data["pivot"]);
+	result->Scale = JsonGet(data, "scale", 1.0f);
+	result->Color = ParseJsonVec4(data["color"]);
+	return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "IComponent.h"
+#include "Graphics/Font.h"
+#include "Graphics/TextRenderer.h"
+
+/// <summary>
+/// A label drawn on the HUD, over the top of the scene. Like the HudSprite, the text is placed
+/// in screen space relative to an anchor point, in pixels on a HudBatcher::REFERENCE_HEIGHT
+/// pixel tall screen
+///
+/// The glyphs are only laid out again when the text or it's layout changes, so static labels
+/// cost nothing but a copy into the frame's text buffer. Disable the component to hide the text
+/// </summary>
+class HudText : public Gameplay::IComponent {
+public:
+	typedef std::shared_ptr<HudText> Sptr;
+
+	HudText();
+
+	// The text to draw, may contain newlines
+	std::string Text;
+	// The .ttf file to draw the text with
+	std::string FontFile;
+	// The size that the font is rasterized at, in pixels
+	float       FontSize;
+	// The point on the screen the text is placed relative to, (0, 0) is the top left and (1, 1) the bottom right
+	glm::vec2   Anchor;
+	// The offset from the anchor to the text's pivot, in reference pixels
+	glm::vec2   Offset;
+	// The point on the text's bounds that is placed at the offset, (0, 0) is the top left
+	glm::vec2   Pivot;
+	// The number of reference pixels per font pixel
+	float       Scale;
+	// The color of the text
+	glm::vec4   Color;
+
+	/// <summary>
+	/// Adds this label to the text batch for the current frame, laying it out again if it has changed
+	/// </summary>
+	void Draw();
+
+	virtual void RenderImGui() override;
+	virtual nlohmann::json ToJson() const override;
+	static HudText::Sptr FromJson(const nlohmann::json& data);
+	MAKE_TYPENAME(HudText);
+
+protected:
+	Font::Sptr        _font;
+	// The font file and size we last tried to load, so a missing font isn't re-read every frame
+	std::string       _loadedFontFile;
+	float             _loadedFontSize;
+	TextRenderer::Run _run;
+};
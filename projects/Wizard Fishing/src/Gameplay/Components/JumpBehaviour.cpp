@@ -1,5 +1,6 @@
 #include "Gameplay/Components/JumpBehaviour.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
 #include "Utils/ImGuiHelper.h"
@@ -36,7 +37,7 @@ JumpBehaviour::Sptr JumpBehaviour::FromJson(const nlohmann::json& blob) {
 }
 
 void JumpBehaviour::Update(float deltaTime) {
-	bool pressed = glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_SPACE);
+	bool pressed = InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_SPACE);
 	if (pressed) {
 		if (_isPressed == false) {
 			_body->ApplyImpulse(glm::vec3(0.0f, 0.0f, _impulse));
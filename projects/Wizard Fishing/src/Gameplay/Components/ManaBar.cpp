@@ -15,40 +15,26 @@
 
 ManaBar::ManaBar() :
     IComponent(),
-    middleX(),
-    middleY(),
-    middleZ(),
-    rotationX(),
-    rotationZ()
+    _sprite(nullptr)
 {}
 
 ManaBar::~ManaBar() = default;
 
 void ManaBar::Awake() {
     _window = GetGameObject()->GetScene()->Window;
+    _sprite = GetGameObject()->Get<HudSprite>();
+    if (_sprite == nullptr) {
+        LOG_WARN("\"{}\" has no HudSprite, ManaBar will be disabled", GetGameObject()->Name);
+        IsEnabled = false;
+    }
 }
 
 void ManaBar::Update(float deltaTime)
 {
-
-    //calculates the rotation on the X axis
-    rotationX = cameraCords->GetGameObject()->GetRotationEuler().x;
-    //calculates the rotation on the Z axis
-    rotationZ = cameraCords->GetGameObject()->GetRotationEuler().z;
-
-    //my head + how far from my head + sin theta
-    middleX = (cameraCords->GetGameObject()->GetPosition().x) - 1.5f * (sin(((cameraCords->GetGameObject()->GetRotationEuler().z) * 3.141f / 180.0f)));
-    //my head + how far from my head + cos theta
-    middleY = (cameraCords->GetGameObject()->GetPosition().y) + 1.5f * (cos(((cameraCords->GetGameObject()->GetRotationEuler().z) * 3.141f / 180.0f)));
-
-    //my head + how far from my head + cos theta
-    middleZ = (cameraCords->GetGameObject()->GetPosition().z) - 1.5f * (cos(((cameraCords->GetGameObject()->GetRotationEuler().x + 40) * 3.141f / 180.0f)));
-
-    if (ManaBar::cameraCords->gameStart) {
-        GetGameObject()->SetRotation(glm::vec3(-rotationX, 0.0f, rotationZ - 180.0f));
-        GetGameObject()->SetPostion(glm::vec3(middleX, middleY, middleZ));
-        GetGameObject()->SetScale(glm::vec3(0.00025 * GetGameObject()->GetScene()->FindObjectByName("Minigame Pointer")->Get<Minigame>()->mana, 0.05f, 0.05f));
-    }
+    // The bar is drawn on the HUD, so all we need to do is show it and set how full it is
+    Minigame::Sptr minigame = GetGameObject()->GetScene()->FindObjectByName("Minigame Pointer")->Get<Minigame>();
+    _sprite->IsEnabled = ManaBar::cameraCords->gameStart;
+    _sprite->Fill = glm::clamp((float)minigame->mana / (float)minigame->maxMana, 0.0f, 1.0f);
 }
 
 void ManaBar::RenderImGui()
@@ -2,12 +2,13 @@
 #include "IComponent.h"
 #include "SimpleCameraControl.h"
 #include "PauseBehaviour.h"
+#include "HudSprite.h"
 
 struct GLFWwindow;
 
 /// <summary>
-/// A simple behaviour that allows movement of a gameobject with WASD, mouse,
-/// and ctrl + space
+/// Shows how much mana the player has left once the game has started, by filling the
+/// HudSprite on the same object from left to right
 /// </summary>
 class ManaBar : public Gameplay::IComponent {
 public:
@@ -21,12 +22,6 @@ public:
 	virtual void Awake() override;
 	virtual void Update(float deltaTime) override;
 
-	float middleX;
-	float middleY;
-	float middleZ;
-	float rotationX;
-	float rotationZ;
-
 public:
 	virtual void RenderImGui() override;
 	MAKE_TYPENAME(ManaBar);
@@ -36,6 +31,7 @@ public:
 
 
 protected:
+	HudSprite::Sptr _sprite;
 
 	GLFWwindow* _window;
 };
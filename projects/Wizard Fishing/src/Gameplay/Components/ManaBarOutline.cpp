@@ -14,39 +14,24 @@
 
 ManaBarOutline::ManaBarOutline() :
     IComponent(),
-    middleX(),
-    middleY(),
-    middleZ(),
-    rotationX(),
-    rotationZ()
+    _sprite(nullptr)
 {}
 
 ManaBarOutline::~ManaBarOutline() = default;
 
 void ManaBarOutline::Awake() {
 	_window = GetGameObject()->GetScene()->Window;
+	_sprite = GetGameObject()->Get<HudSprite>();
+	if (_sprite == nullptr) {
+		LOG_WARN("\"{}\" has no HudSprite, ManaBarOutline will be disabled", GetGameObject()->Name);
+		IsEnabled = false;
+	}
 }
 
 void ManaBarOutline::Update(float deltaTime)
 {
-
-    //calculates the rotation on the X axis
-    rotationX = cameraCords->GetGameObject()->GetRotationEuler().x;
-    //calculates the rotation on the Z axis
-    rotationZ = cameraCords->GetGameObject()->GetRotationEuler().z;
-
-    //my head + how far from my head + sin theta
-    middleX = (cameraCords->GetGameObject()->GetPosition().x) - 1.5f * (sin(((cameraCords->GetGameObject()->GetRotationEuler().z) * 3.141f / 180.0f)));
-    //my head + how far from my head + cos theta
-    middleY = (cameraCords->GetGameObject()->GetPosition().y) + 1.5f * (cos(((cameraCords->GetGameObject()->GetRotationEuler().z) * 3.141f / 180.0f)));
-
-    //my head + how far from my head + cos theta
-    middleZ = (cameraCords->GetGameObject()->GetPosition().z) - 1.5f * (cos(((cameraCords->GetGameObject()->GetRotationEuler().x + 40) * 3.141f / 180.0f)));
-
-    if (ManaBarOutline::cameraCords->gameStart) {
-        GetGameObject()->SetRotation(glm::vec3(-rotationX, 0, rotationZ - 180.0f));
-        GetGameObject()->SetPostion(glm::vec3(middleX, middleY, middleZ));
-    }
+    // The outline is drawn on the HUD, and only needs to show up once the game starts
+    _sprite->IsEnabled = ManaBarOutline::cameraCords->gameStart;
 }
 
 void ManaBarOutline::RenderImGui()
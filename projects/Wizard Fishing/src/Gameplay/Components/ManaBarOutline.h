@@ -2,12 +2,13 @@
 #include "IComponent.h"
 #include "SimpleCameraControl.h"
 #include "PauseBehaviour.h"
+#include "HudSprite.h"
 
 struct GLFWwindow;
 
 /// <summary>
-/// A simple behaviour that allows movement of a gameobject with WASD, mouse,
-/// and ctrl + space
+/// Shows the outline around the mana bar once the game has started, using the HudSprite on
+/// the same object
 /// </summary>
 class ManaBarOutline : public Gameplay::IComponent {
 public:
@@ -21,12 +22,6 @@ public:
 	virtual void Awake() override;
 	virtual void Update(float deltaTime) override;
 
-	float middleX;
-	float middleY;
-	float middleZ;
-	float rotationX;
-	float rotationZ;
-
 public:
 	virtual void RenderImGui() override;
 	MAKE_TYPENAME(ManaBarOutline);
@@ -36,6 +31,7 @@ public:
 
 
 protected:
+	HudSprite::Sptr _sprite;
 
 	GLFWwindow* _window;
 };
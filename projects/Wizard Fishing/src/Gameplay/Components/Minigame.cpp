@@ -1,6 +1,7 @@
 
 #include "Gameplay/Components/Minigame.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 #define  GLM_SWIZZLE
 #include <GLM/gtc/quaternion.hpp>
 
@@ -27,14 +28,20 @@ Minigame::Minigame() :
     rotation(),
     dif(),
     mana(),
-    leftEdge(),
-    rightEdge()
+    targetHalfWidth(),
+    _sprite(nullptr)
 {}
 
 Minigame::~Minigame() = default;
 
 void Minigame::Awake() {
 	_window = GetGameObject()->GetScene()->Window;
+	_sprite = GetGameObject()->Get<HudSprite>();
+	// Scenes saved before the HUD was drawn in screen space won't have a sprite, the minigame
+	// still runs without it but the pointer won't be shown
+	if (_sprite == nullptr) {
+		LOG_WARN("\"{}\" has no HudSprite, the minigame pointer will not be drawn", GetGameObject()->Name);
+	}
 }
 
 void Minigame::Update(float deltaTime)
@@ -56,9 +63,8 @@ void Minigame::Update(float deltaTime)
     dif = GetGameObject()->GetScene()->FindObjectByName("Fish")->Get<FishMovement>()->difficulty;
 
     //Calculates where the edges of the target are
-    leftEdge = glm::vec3(middleX - ((6 -(2 * dif)) *(0.05 * (cos(cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f)))), middleY - ((6 - (2 * dif)) *(0.05 * (sin(cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f)))), 3.5f);
-    rightEdge = glm::vec3(middleX + ((6 - (2 * dif)) * (0.05 * (cos(cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f)))), middleY + ((6 - (2 * dif)) * (0.05 * (sin(cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f)))), 3.5f);
-    
+    targetHalfWidth = (6 - (2 * dif)) * 0.05f;
+
     if (!(Minigame::pause->isPaused))
     {
         if (GetGameObject()->GetScene()->FindObjectByName("Fish")->Get<FishMovement>()->hooked && !minigameActive) {
@@ -78,19 +84,14 @@ void Minigame::Update(float deltaTime)
             //Uses trig to find how to move each axis
             moveX += moveSpeedX;
             moveY += moveSpeedY;
-    
-            GetGameObject()->SetRotation(glm::vec3(90.0f, 0, rotation));
-            GetGameObject()->SetPostion(glm::vec3(middleX + moveX * (cos((cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f))), middleY + moveY * (sin((cameraCords->GetGameObject()->GetRotationEuler().z * 3.141f / 180.0f))), 4.0f));
         }
         else {
-            GetGameObject()->SetPostion(glm::vec3(0.0, 0.0, -20.0));
             moveX = 0.0f;
         }
-        if (glfwGetKey(_window, GLFW_KEY_SPACE) == GLFW_PRESS && !pressed
+        if (InputEngine::GetKey(_window, GLFW_KEY_SPACE) == GLFW_PRESS && !pressed
             && flip >= 14.0f + 2.0 * dif
             && flip <= 26.0f - 2.0 * dif) {
             minigameActive = false;
-            GetGameObject()->SetPostion(glm::vec3(0.0, 0.0, -20.0));
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->Get<Casting>()->hasCast = false;
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->Get<Casting>()->hasFinished = false;
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->SetPostion(GetGameObject()->GetScene()->FindObjectByName("Main Camera")->GetPosition());
@@ -98,16 +99,15 @@ void Minigame::Update(float deltaTime)
             moveY = 0.0f;
             pressed = true;
         }
-        else if(glfwGetKey(_window, GLFW_KEY_SPACE) == GLFW_PRESS && !pressed) {
+        else if(InputEngine::GetKey(_window, GLFW_KEY_SPACE) == GLFW_PRESS && !pressed) {
             mana -= 40;
             pressed = true;
         }
-        else if(glfwGetKey(_window, GLFW_KEY_SPACE) == GLFW_RELEASE){
+        else if(InputEngine::GetKey(_window, GLFW_KEY_SPACE) == GLFW_RELEASE){
             pressed = false;
         }
         if (mana <= 0 && minigameActive) {
             minigameActive = false;
-            GetGameObject()->SetPostion(glm::vec3(0.0, 0.0, -20.0));
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->Get<Casting>()->hasCast = false;
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->Get<Casting>()->hasFinished = false;
             GetGameObject()->GetScene()->FindObjectByName("Bobber")->SetPostion(GetGameObject()->GetScene()->FindObjectByName("Main Camera")->GetPosition());
@@ -116,6 +116,11 @@ void Minigame::Update(float deltaTime)
         }
     }
 
+    //The pointer is drawn on the HUD, sliding along the track while the minigame is running
+    if (_sprite != nullptr) {
+        _sprite->IsEnabled = minigameActive;
+        _sprite->Offset = glm::vec2(moveX * HUD_PIXELS_PER_UNIT, HUD_TRACK_OFFSET);
+    }
 }
 
 void Minigame::RenderImGui()
@@ -2,6 +2,7 @@
 #include "IComponent.h"
 #include "SimpleCameraControl.h"
 #include "PauseBehaviour.h"
+#include "HudSprite.h"
 
 struct GLFWwindow;
 
@@ -13,6 +14,11 @@ class Minigame : public Gameplay::IComponent {
 public:
 	typedef std::shared_ptr<Minigame> Sptr;
 
+	// How far below the middle of the screen the minigame is drawn on the HUD, in reference pixels
+	static constexpr float HUD_TRACK_OFFSET = 200.0f;
+	// How many HUD reference pixels one unit of the pointer's movement covers
+	static constexpr float HUD_PIXELS_PER_UNIT = 300.0f;
+
 	Minigame();
 	virtual ~Minigame();
 	SimpleCameraControl::Sptr cameraCords;
@@ -27,8 +33,8 @@ public:
 	float rotation;
 	int dif;
 	int maxMana, mana;
-	glm::vec3(leftEdge) = glm::vec3();
-	glm::vec3(rightEdge) = glm::vec3();
+	// How far each edge of the target is from the middle of the track, in the same units as the pointer
+	float targetHalfWidth;
 
 public:
 	virtual void RenderImGui() override;
@@ -45,6 +51,7 @@ protected:
 	float moveSpeedY;
 	float flip;
 
+	HudSprite::Sptr _sprite;
 
 	GLFWwindow* _window;
 };
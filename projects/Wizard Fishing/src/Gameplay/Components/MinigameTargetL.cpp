@@ -19,31 +19,28 @@ MinigameTargetL::MinigameTargetL() :
     moveSpeedY(0.05),
     middleX(),
     middleY(),
-    flip(20.0f)
-
+    flip(20.0f),
+    _sprite(nullptr)
 {}
 
 MinigameTargetL::~MinigameTargetL() = default;
 
 void MinigameTargetL::Awake() {
 	_window = GetGameObject()->GetScene()->Window;
+	_sprite = GetGameObject()->Get<HudSprite>();
+	if (_sprite == nullptr) {
+		LOG_WARN("\"{}\" has no HudSprite, MinigameTargetL will be disabled", GetGameObject()->Name);
+		IsEnabled = false;
+	}
 }
 
 void MinigameTargetL::Update(float deltaTime)
 {
     if (!(MinigameTargetL::pause->isPaused))
     {
-        if ((MinigameTargetL::minigame->minigameActive))
-        {
-            GetGameObject()->SetPostion(glm::vec3(MinigameTargetL::minigame->leftEdge));
-            GetGameObject()->SetRotation(glm::vec3(-90, -45, MinigameTargetL::minigame->rotation - 90.0));
-            GetGameObject()->SetScale(glm::vec3(0.1f, 0.1, 0.1f));
-        }
-        else {
-            GetGameObject()->SetPostion(glm::vec3(0.0, 0.0, -20.0));
-
-        }
- 
+        // The target is drawn on the HUD, at the left edge of the minigame's target zone
+        _sprite->IsEnabled = MinigameTargetL::minigame->minigameActive;
+        _sprite->Offset = glm::vec2(-MinigameTargetL::minigame->targetHalfWidth * Minigame::HUD_PIXELS_PER_UNIT, Minigame::HUD_TRACK_OFFSET);
     }
 
 }
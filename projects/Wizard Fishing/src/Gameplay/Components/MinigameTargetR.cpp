@@ -19,31 +19,28 @@ MinigameTargetR::MinigameTargetR() :
     moveSpeedY(0.05),
     middleX(),
     middleY(),
-    flip(20.0f)
-
+    flip(20.0f),
+    _sprite(nullptr)
 {}
 
 MinigameTargetR::~MinigameTargetR() = default;
 
 void MinigameTargetR::Awake() {
 	_window = GetGameObject()->GetScene()->Window;
+	_sprite = GetGameObject()->Get<HudSprite>();
+	if (_sprite == nullptr) {
+		LOG_WARN("\"{}\" has no HudSprite, MinigameTargetR will be disabled", GetGameObject()->Name);
+		IsEnabled = false;
+	}
 }
 
 void MinigameTargetR::Update(float deltaTime)
 {
     if (!(MinigameTargetR::pause->isPaused))
     {
-        if ((MinigameTargetR::minigame->minigameActive))
-        {
-            GetGameObject()->SetPostion(glm::vec3(MinigameTargetR::minigame->rightEdge));
-            GetGameObject()->SetRotation(glm::vec3(90, 45, MinigameTargetR::minigame->rotation + 90.0));
-            GetGameObject()->SetScale(glm::vec3(0.1f, 0.1, 0.1f));
-        }
-        else {
-            GetGameObject()->SetPostion(glm::vec3(0.0, 0.0, -20.0));
-
-        }
- 
+        // The target is drawn on the HUD, at the right edge of the minigame's target zone
+        _sprite->IsEnabled = MinigameTargetR::minigame->minigameActive;
+        _sprite->Offset = glm::vec2(MinigameTargetR::minigame->targetHalfWidth * Minigame::HUD_PIXELS_PER_UNIT, Minigame::HUD_TRACK_OFFSET);
     }
 
 }
@@ -3,6 +3,7 @@
 #include "Fishmovement.h"
 #include "Minigame.h"
 #include "PauseBehaviour.h"
+#include "HudSprite.h"
 
 struct GLFWwindow;
 
@@ -41,6 +42,8 @@ protected:
 	float middleY;
 	float flip;
 
+	HudSprite::Sptr _sprite;
+
 	GLFWwindow* _window;
 };
 
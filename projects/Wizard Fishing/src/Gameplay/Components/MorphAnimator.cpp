@@ -27,22 +27,27 @@ void MorphAnimator::SetFrameTime(float f) {
 }
 
 void MorphAnimator::SetFrames(const std::vector<Gameplay::MeshResource::Sptr> loadedFrames) {
-	if (data.animFrames.size() == NULL) {
-		data.animFrames.clear();
-	}
+	data.animFrames.clear();
 
 	for (int i = 0; i < loadedFrames.size(); i++) {
 		data.animFrames.push_back(loadedFrames[i]);
 	}
 
 	data.index0 = 0;
+	// The renderer will build its frame pairs on our next update
+	data.started = false;
 }
 
 void MorphAnimator::Update(float deltaTime)
 {
+	MorphMeshRenderer::Sptr renderer = GetGameObject()->Get<MorphMeshRenderer>();
+	if (!data.started) {
+		renderer->SetFrames(data.animFrames);
+		data.started = true;
+	}
+
 	if (shouldAnimate) {
 		float t;
-		int index1;
 
 		timer += deltaTime;
 
@@ -53,13 +58,12 @@ void MorphAnimator::Update(float deltaTime)
 		}
 
 		t = timer / data.frameTime;
-		index1 = ((data.index0 + 1) >= data.animFrames.size()) ? 0 : (data.index0 + 1);
 
-		GetGameObject()->Get<MorphMeshRenderer>()->UpdateData(data.animFrames[data.index0], data.animFrames[index1], t);
+		renderer->UpdateData(data.index0, t);
 	}
 	else {
 		data.index0 = 0;
-		GetGameObject()->Get<MorphMeshRenderer>()->UpdateData(data.animFrames[data.index0], data.animFrames[data.index0], 0);
+		renderer->UpdateData(data.index0, 0.0f);
 	}
 }
 
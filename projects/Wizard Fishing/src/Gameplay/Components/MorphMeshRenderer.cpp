@@ -8,26 +8,86 @@
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/ImGuiHelper.h"
 #include <Gameplay/Components/RenderComponent.h>
+#include "Graphics/RenderThread.h"
+#include "Graphics/GeometryPool.h"
 
-MorphMeshRenderer::MorphMeshRenderer(/*Gameplay::MeshResource baseMesh, Gameplay::MeshResource targetMesh, Gameplay::Material mat*/)
+MorphMeshRenderer::MorphMeshRenderer(/*Gameplay::MeshResource baseMesh, Gameplay::MeshResource targetMesh, Gameplay::Material mat*/) :
+	t(0.0f),
+	_pairVaos(std::vector<VertexArrayObject::Sptr>()),
+	_pairIndex(-1),
+	_window(nullptr)
 {
 
 }
 
-void MorphMeshRenderer::UpdateData(const Gameplay::MeshResource::Sptr &frame0, const Gameplay::MeshResource::Sptr &frame1, float t)
+// Finds the attribute with the given usage in a VAO's buffers, and re-targets it to a new slot
+static const VertexArrayObject::VertexBufferBinding* FindMorphTarget(const VertexArrayObject::Sptr& vao, AttribUsage usage, GLuint slot, BufferAttribute& outAttrib) {
+	for (const auto& binding : vao->GetVertexBuffers()) {
+		for (const BufferAttribute& attrib : binding.Attributes) {
+			if (attrib.Usage == usage) {
+				outAttrib = attrib;
+				outAttrib.Slot = slot;
+				return &binding;
+			}
+		}
+	}
+	return nullptr;
+}
+
+void MorphMeshRenderer::SetFrames(const std::vector<Gameplay::MeshResource::Sptr>& frames)
 {
-	VertexArrayObject::Sptr vao = frame0->Mesh;
-	const VertexBuffer::Sptr vboPos = frame1->Mesh->GetBufferBinding(AttribUsage::Position)->Buffer;
-	const VertexBuffer::Sptr vboNorm = frame1->Mesh->GetBufferBinding(AttribUsage::Normal)->Buffer;
-	const VertexArrayObject::VertexDeclaration dec = frame1->Mesh->GetVDecl();
-	std::vector<BufferAttribute> positionBuffer{BufferAttribute(4, 3, AttributeType::Float, dec.at(0).Stride, dec.at(0).Offset, AttribUsage::Position) };
-	std::vector<BufferAttribute> normalBuffer{BufferAttribute(5, 3, AttributeType::Float, dec.at(2).Stride, dec.at(2).Offset, AttribUsage::Normal) };
-	vao->AddVertexBuffer(vboPos, positionBuffer);
-	vao->AddVertexBuffer(vboNorm, normalBuffer);
+	_pairVaos.clear();
+	_pairIndex = -1;
+	_pairVaos.reserve(frames.size());
+
+	// Building the VAOs needs the GL context, this only happens when the animation is set up
+	RenderThread::Invoke([&]() {
+		for (size_t ix = 0; ix < frames.size(); ix++) {
+			const VertexArrayObject::Sptr& from = frames[ix]->Mesh;
+			const VertexArrayObject::Sptr& to = frames[(ix + 1) % frames.size()]->Mesh;
 
-	GetGameObject()->Get<RenderComponent>()->SetVao(vao);
+			// The pair VAO shares the GPU buffers with the frames, so this only costs us the VAO itself
+			VertexArrayObject::Sptr vao = VertexArrayObject::Create();
+			for (const auto& binding : from->GetVertexBuffers()) {
+				vao->AddVertexBuffer(binding.Buffer, binding.Attributes);
+			}
+			vao->SetIndexBuffer(from->GetIndexBuffer());
+			vao->SetVDecl(from->GetVDecl());
 
+			BufferAttribute position, normal;
+			const VertexArrayObject::VertexBufferBinding* posBinding = FindMorphTarget(to, AttribUsage::Position, 4, position);
+			const VertexArrayObject::VertexBufferBinding* normBinding = FindMorphTarget(to, AttribUsage::Normal, 5, normal);
+			if (posBinding == nullptr || normBinding == nullptr) {
+				LOG_WARN("Morph frame {} is missing positions or normals, it will not blend", (ix + 1) % frames.size());
+				posBinding = FindMorphTarget(from, AttribUsage::Position, 4, position);
+				normBinding = FindMorphTarget(from, AttribUsage::Normal, 5, normal);
+			}
+			if (posBinding != nullptr && normBinding != nullptr) {
+				vao->AddVertexBuffer(posBinding->Buffer, { position });
+				vao->AddVertexBuffer(normBinding->Buffer, { normal });
+			}
+			// With vertex pulling, the pair just needs to know where the next frame's vertices are
+			vao->SetPooledMesh(GeometryPool::MakeMorphPair(from->GetPooledMesh(), to->GetPooledMesh()));
+
+			_pairVaos.push_back(vao);
+		}
+	});
+}
+
+void MorphMeshRenderer::UpdateData(int index0, float t)
+{
 	this->t = t;
+
+	if (_pairVaos.empty()) {
+		return;
+	}
+
+	index0 = index0 % (int)_pairVaos.size();
+	// The VAO only needs to be swapped when we move onto a new pair of frames
+	if (index0 != _pairIndex) {
+		_pairIndex = index0;
+		GetGameObject()->Get<RenderComponent>()->SetVao(_pairVaos[_pairIndex]);
+	}
 }
 
 void MorphMeshRenderer::RenderImGui()
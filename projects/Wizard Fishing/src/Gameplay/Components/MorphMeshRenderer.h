@@ -63,14 +63,26 @@ public:
 	MorphMeshRenderer(MorphMeshRenderer&&) = default;
 	MorphMeshRenderer& operator = (MorphMeshRenderer&&) = default;
 
-	void UpdateData(const Gameplay::MeshResource::Sptr &frame0, const Gameplay::MeshResource::Sptr &frame1, float t);
-	float t;
-protected:
+	/// <summary>
+	/// Builds a VAO for every (frame i, frame i + 1) pair in the animation, which
+	/// feeds frame i + 1's positions and normals into slots 4 and 5 for the morph shader.
+	/// This only needs to be called when the set of frames changes
+	/// </summary>
+	/// <param name="frames">The keyframes of the animation, the last frame will blend back into the first</param>
+	void SetFrames(const std::vector<Gameplay::MeshResource::Sptr>& frames);
+	/// <summary>
+	/// Selects which pair of frames to draw, and how far between them we are
+	/// </summary>
+	/// <param name="index0">The index of the frame that we are blending from</param>
+	/// <param name="t">The t-value for interpolating between the frames</param>
+	void UpdateData(int index0, float t);
 
-	//Pointers to the frames we're currently in between.
-	Gameplay::MeshResource::Sptr* frame0;
-	Gameplay::MeshResource::Sptr* frame1;
 	//The t-value for interpolating between our frames.
-	VertexArrayObject vao;
+	float t;
+protected:
+	// One VAO per pair of frames, these are never modified after SetFrames
+	std::vector<VertexArrayObject::Sptr> _pairVaos;
+	// The index of the pair currently being drawn
+	int _pairIndex;
 	GLFWwindow* _window;
 };
\ No newline at end of file
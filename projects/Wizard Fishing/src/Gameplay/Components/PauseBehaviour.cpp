@@ -7,6 +7,7 @@
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 
 PauseBehaviour::PauseBehaviour() {
 	isPaused = false;
@@ -14,7 +15,7 @@ PauseBehaviour::PauseBehaviour() {
 }
 
 void PauseBehaviour::Update(float deltaTime) {
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_ESCAPE))
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_ESCAPE))
 	{
 		if (pauseClock == 0) {
 			if (!isPaused)
@@ -33,7 +34,7 @@ void PauseBehaviour::Update(float deltaTime) {
 			}
 		}
 	}
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_ENTER))
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_ENTER))
 	{
 		if (isPaused) {
 		glfwSetWindowShouldClose(GetGameObject()->GetScene()->Window, true);
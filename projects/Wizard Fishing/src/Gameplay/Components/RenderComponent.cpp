@@ -1,34 +1,124 @@
 #include "Gameplay/Components/RenderComponent.h"
 
 #include "Utils/ResourceManager/ResourceManager.h"
+#include "Gameplay/GameObject.h"
+#include "Utils/JsonGlmHelpers.h"
 
+bool RenderComponent::LodsEnabled = true;
 
 RenderComponent::RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material) :
 	_mesh(mesh), 
+	_vaoOverride(nullptr),
 	_material(material), 
+	_currentLod(0),
+	_screenSize(1.0f),
+	_occluder(nullptr),
+	_impostor(nullptr),
+	_isStatic(false),
+	_isBatched(false),
+	_isGpuCulled(false),
 	_meshBuilderParams(std::vector<MeshBuilderParam>()) 
 { }
 
 RenderComponent::RenderComponent() : 
 	_mesh(nullptr), 
+	_vaoOverride(nullptr),
 	_material(nullptr), 
+	_currentLod(0),
+	_screenSize(1.0f),
+	_occluder(nullptr),
+	_impostor(nullptr),
+	_isStatic(false),
+	_isBatched(false),
+	_isGpuCulled(false),
 	_meshBuilderParams(std::vector<MeshBuilderParam>())
 { }
 
 void RenderComponent::SetMesh(const Gameplay::MeshResource::Sptr& mesh) {
 	_mesh = mesh;
+	_currentLod = 0;
 }
 
-void RenderComponent::SetVao(VertexArrayObject::Sptr& mesh) {
-	_mesh->Mesh = mesh;
+void RenderComponent::SetVao(const VertexArrayObject::Sptr& vao) {
+	_vaoOverride = vao;
 }
 
 const Gameplay::MeshResource::Sptr& RenderComponent::GetMeshResource() const {
 	return _mesh;
 }
 
-const VertexArrayObject::Sptr& RenderComponent::GetMesh() const {
-	return _mesh ? _mesh->Mesh : nullptr;
+VertexArrayObject::Sptr RenderComponent::GetMesh() const {
+	if (_vaoOverride != nullptr) {
+		return _vaoOverride;
+	}
+	return _mesh ? _mesh->GetLod(LodsEnabled ? _currentLod : 0) : nullptr;
+}
+
+bool RenderComponent::GetWorldBounds(glm::vec3& outCenter, float& outRadius) const {
+	// Overridden VAOs (ex: morph targets) may not match the mesh resource's bounds
+	if (_mesh == nullptr || _vaoOverride != nullptr || _mesh->BoundsRadius <= 0.0f) {
+		return false;
+	}
+
+	// Find the radius of our bounding sphere in world space, using the largest axis scale
+	const glm::mat4& transform = GetGameObject()->GetTransform();
+	float maxScale = glm::max(glm::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))), glm::length(glm::vec3(transform[2])));
+	outRadius = _mesh->BoundsRadius * maxScale;
+	outCenter = glm::vec3(transform * glm::vec4(_mesh->BoundsCenter, 1.0f));
+	return true;
+}
+
+void RenderComponent::SetOccluder(const Gameplay::MeshResource::Sptr& proxy) {
+	_occluder = proxy;
+}
+
+void RenderComponent::SetUseImpostor(bool useImpostor) {
+	_impostor = useImpostor ? Gameplay::Impostor::Get(_mesh, _material) : nullptr;
+	if (useImpostor && _impostor == nullptr) {
+		LOG_WARN("Could not make an impostor for \"{}\", it needs a loaded mesh and a textured material", GetGameObject()->Name);
+	}
+}
+
+float RenderComponent::CalcScreenSize(const glm::vec3& worldCenter, float radius, const glm::mat4& view, const glm::mat4& projection) {
+	glm::vec3 center = glm::vec3(view * glm::vec4(worldCenter, 1.0f));
+
+	// projection[2][3] is -1 for perspective and 0 for ortho projections
+	if (projection[2][3] != 0.0f) {
+		float depth = -center.z;
+		return depth > radius ? radius * projection[1][1] / depth : 1.0f;
+	} else {
+		return radius * projection[1][1];
+	}
+}
+
+void RenderComponent::UpdateLod(const glm::mat4& view, const glm::mat4& projection) {
+	glm::vec3 worldCenter;
+	float radius;
+	if (_mesh == nullptr || !GetWorldBounds(worldCenter, radius)) {
+		_currentLod = 0;
+		_screenSize = 1.0f;
+		return;
+	}
+
+	// The screen size is also used to pick how much of our material's texture to stream in,
+	// so it's worked out even if we have no LODs
+	float screenSize = CalcScreenSize(worldCenter, radius, view, projection);
+	_screenSize = screenSize;
+	if (_mesh->Lods.empty()) {
+		_currentLod = 0;
+		return;
+	}
+
+	// Step towards finer or coarser LODs, requiring us to be past the threshold by the hysteresis margin
+	const int thresholdCount = sizeof(LOD_SCREEN_SIZES) / sizeof(LOD_SCREEN_SIZES[0]);
+	int maxLod = glm::min((int)_mesh->Lods.size(), thresholdCount);
+	_currentLod = glm::min(_currentLod, maxLod);
+	while (_currentLod < maxLod && screenSize < LOD_SCREEN_SIZES[_currentLod] * (1.0f - LOD_HYSTERESIS)) {
+		_currentLod++;
+	}
+	while (_currentLod > 0 && screenSize > LOD_SCREEN_SIZES[_currentLod - 1] * (1.0f + LOD_HYSTERESIS)) {
+		_currentLod--;
+	}
 }
 
 void RenderComponent::SetMaterial(const Gameplay::Material::Sptr& mat) {
@@ -43,6 +133,9 @@ nlohmann::json RenderComponent::ToJson() const {
 	nlohmann::json result;
 	result["mesh"] = _mesh ? _mesh->GetGUID().str() : "null";
 	result["material"] = _material ? _material->GetGUID().str() : "null";
+	result["occluder"] = _occluder ? _occluder->GetGUID().str() : "null";
+	result["static"] = _isStatic;
+	result["impostor"] = _impostor != nullptr;
 	return result;
 }
 
@@ -50,14 +143,34 @@ RenderComponent::Sptr RenderComponent::FromJson(const nlohmann::json& data) {
 	RenderComponent::Sptr result = std::make_shared<RenderComponent>();
 	result->_mesh = ResourceManager::Get<Gameplay::MeshResource>(Guid(data["mesh"].get<std::string>()));
 	result->_material = ResourceManager::Get<Gameplay::Material>(Guid(data["material"].get<std::string>()));
+	// Older scenes won't have an occluder saved
+	std::string occluder = JsonGet<std::string>(data, "occluder", "null");
+	if (occluder != "null") {
+		result->_occluder = ResourceManager::Get<Gameplay::MeshResource>(Guid(occluder));
+	}
+	result->_isStatic = JsonGet(data, "static", false);
+	if (JsonGet(data, "impostor", false)) {
+		result->_impostor = Gameplay::Impostor::Get(result->_mesh, result->_material);
+	}
 
 	return result;
 }
 
 void RenderComponent::RenderImGui() {
 	ImGui::Text("Indexed:   %s", GetMesh() != nullptr ? (_mesh->Mesh->GetIndexBuffer() != nullptr ? "true" : "false") : "N/A");
-	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (_mesh->Mesh->GetElementCount() / 3) : 0);
+	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (GetMesh()->GetElementCount() / 3) : 0);
+	ImGui::Text("LOD:       %d / %d", _currentLod, _mesh != nullptr ? (int)_mesh->Lods.size() : 0);
 	ImGui::Text("Source:    %s", (_mesh == nullptr || _mesh->Filename.empty()) ? "Generated" : _mesh->Filename.c_str());
+	ImGui::Text("Impostor:  %s", _impostor != nullptr ? "Yes" : "No");
+	ImGui::Text("Occluder:  %s", _occluder == nullptr ? "None" : (_occluder == _mesh ? "Self" : (_occluder->Filename.empty() ? "Generated" : _occluder->Filename.c_str())));
+	// Batches are only built when the scene wakes up, so this won't do anything until the next load
+	ImGui::Checkbox("Static", &_isStatic);
+	ImGui::SameLine();
+	ImGui::Text("(%s%s)", _isBatched ? "Batched" : "Not batched", _isGpuCulled ? ", GPU culled" : "");
 	ImGui::Separator();
 	ImGui::Text("Material:  %s", _material != nullptr ? _material->Name.c_str() : "NULL");
+	if (_material != nullptr) {
+		// Note that materials are shared, so this will edit every object using the material
+		_material->RenderImGui();
+	}
 }
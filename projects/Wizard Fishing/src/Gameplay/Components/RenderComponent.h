@@ -2,6 +2,7 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
+#include "Gameplay/Impostor.h"
 #include "Utils/MeshFactory.h"
 
 /// <summary>
@@ -13,6 +14,18 @@ class RenderComponent : public Gameplay::IComponent {
 public:
 	typedef std::shared_ptr<RenderComponent> Sptr;
 
+	// The projected size (as a fraction of the screen height) below which we switch to each LOD,
+	// LOD 1 is used below the first size, LOD 2 below the second, etc...
+	static constexpr float LOD_SCREEN_SIZES[] = { 0.25f, 0.1f, 0.04f };
+	// How far (as a fraction of the threshold) an object must move past a LOD threshold before
+	// we switch back, so objects sitting right on the threshold don't flicker between LODs
+	static constexpr float LOD_HYSTERESIS = 0.15f;
+
+	/// <summary>
+	/// Global toggle for mesh LODs, when false every object draws at full detail
+	/// </summary>
+	static bool LodsEnabled;
+
 	RenderComponent();
 	RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material);
 
@@ -24,7 +37,7 @@ public:
 	/// <summary>
 	/// Gets the VAO of the underlying mesh resource
 	/// </summary>
-	const VertexArrayObject::Sptr& GetMesh() const;
+	VertexArrayObject::Sptr GetMesh() const;
 	/// <summary>
 	/// Gets the material that this renderer is using
 	/// </summary>
@@ -35,7 +48,12 @@ public:
 	/// </summary>
 	/// <param name="mesh">The mesh resource containing info about the model to be rendered</param>
 	void SetMesh(const Gameplay::MeshResource::Sptr& mesh);
-	void SetVao(VertexArrayObject::Sptr& mesh);
+	/// <summary>
+	/// Overrides the VAO that this component will draw, without touching the mesh resource
+	/// (which may be shared with other objects). Pass nullptr to go back to the mesh resource's VAO
+	/// </summary>
+	/// <param name="vao">The VAO to draw in place of the mesh resource's VAO</param>
+	void SetVao(const VertexArrayObject::Sptr& vao);
 	/// <summary>
 	/// Sets this render component's material, which will be used to feed material parameters to the appropriate
 	/// shader, and ensure that the shader is bound when this object should be drawn
@@ -43,6 +61,85 @@ public:
 	/// <param name="mat">The material for this object</param>
 	void SetMaterial(const Gameplay::Material::Sptr& mat);
 
+	/// <summary>
+	/// Selects which LOD of the mesh to draw based on how large the mesh's bounding sphere
+	/// appears on screen. Should be called once per frame before drawing
+	/// </summary>
+	/// <param name="view">The camera's view matrix</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	void UpdateLod(const glm::mat4& view, const glm::mat4& projection);
+	/// <summary>
+	/// Gets the LOD that this component is currently drawing, where 0 is full detail
+	/// </summary>
+	int GetCurrentLod() const { return _currentLod; }
+	/// <summary>
+	/// Gets how much of the screen's height our bounding sphere covered when UpdateLod was last
+	/// called, or 1 if we don't know our bounds
+	/// </summary>
+	float GetScreenSize() const { return _screenSize; }
+	/// <summary>
+	/// Estimates the fraction of the screen's height covered by a sphere
+	/// </summary>
+	/// <param name="worldCenter">The center of the sphere in world space</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <param name="view">The camera's view matrix</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	static float CalcScreenSize(const glm::vec3& worldCenter, float radius, const glm::mat4& view, const glm::mat4& projection);
+
+	/// <summary>
+	/// Gets the world space bounding sphere of the mesh we are drawing
+	/// </summary>
+	/// <param name="outCenter">Will store the center of the sphere</param>
+	/// <param name="outRadius">Will store the radius of the sphere</param>
+	/// <returns>False if the bounds are unknown (ex: no mesh, or the VAO has been overridden)</returns>
+	bool GetWorldBounds(glm::vec3& outCenter, float& outRadius) const;
+
+	/// <summary>
+	/// Marks this object as an occluder, so that it will hide other objects behind it from
+	/// the occlusion culler. The proxy is drawn into the culler's depth buffer using this
+	/// object's transform, and should never stick out past the visible mesh. Pass nullptr to
+	/// stop this object from occluding anything
+	/// </summary>
+	/// <param name="proxy">The mesh to use as the occluder, will usually be this object's own mesh</param>
+	void SetOccluder(const Gameplay::MeshResource::Sptr& proxy);
+	/// <summary>
+	/// Gets the mesh that this object occludes with, or nullptr if it is not an occluder
+	/// </summary>
+	const Gameplay::MeshResource::Sptr& GetOccluder() const { return _occluder; }
+
+	/// <summary>
+	/// Marks this object as static, meaning it will never move, or change it's mesh or material,
+	/// after the scene wakes up. Static objects are merged with their neighbours by the scene's
+	/// StaticBatcher, and no longer draw on their own
+	/// </summary>
+	void SetStatic(bool isStatic) { _isStatic = isStatic; }
+	bool IsStatic() const { return _isStatic; }
+	/// <summary>
+	/// Gets whether this object's mesh was merged into a static batch, in which case the batch
+	/// draws it instead of this component. Set by the StaticBatcher
+	/// </summary>
+	bool IsBatched() const { return _isBatched; }
+	void SetBatched(bool isBatched) { _isBatched = isBatched; }
+	/// <summary>
+	/// Gets whether this object was uploaded to the scene's GpuCuller, in which case it is culled
+	/// and drawn on the GPU instead of by this component while GPU culling is enabled
+	/// </summary>
+	bool IsGpuCulled() const { return _isGpuCulled; }
+	void SetGpuCulled(bool isGpuCulled) { _isGpuCulled = isGpuCulled; }
+
+	/// <summary>
+	/// Gives this object an impostor, which it draws instead of it's mesh when it is further than
+	/// Impostor::SwitchDistance from the camera. The impostor is baked from the mesh and material,
+	/// so they must be set first, and the first object to use a mesh and material pair will stall
+	/// while it's impostor is loaded or baked
+	/// </summary>
+	/// <param name="useImpostor">True to use an impostor, false to always draw the mesh</param>
+	void SetUseImpostor(bool useImpostor);
+	/// <summary>
+	/// Gets the impostor this object switches to in the distance, or nullptr if it doesn't have one
+	/// </summary>
+	const Gameplay::Impostor::Sptr& GetImpostor() const { return _impostor; }
+
 	// Inherited from IComponent
 
 	virtual void RenderImGui() override;
@@ -53,8 +150,24 @@ public:
 protected:
 	// The object's mesh
 	Gameplay::MeshResource::Sptr _mesh;
+	// Optional VAO to draw instead of the mesh resource's, owned by whoever set it
+	VertexArrayObject::Sptr      _vaoOverride;
 	// The object's material
 	Gameplay::Material::Sptr      _material;
+	// The LOD of the mesh that we are currently drawing, 0 is the full detail mesh
+	int                           _currentLod;
+	// How much of the screen we covered the last time our LOD was picked
+	float                         _screenSize;
+	// The simplified mesh we draw into the occlusion culler, if we are an occluder
+	Gameplay::MeshResource::Sptr  _occluder;
+	// Drawn in place of the mesh when we are far from the camera
+	Gameplay::Impostor::Sptr      _impostor;
+	// True if the object never moves after the scene wakes up
+	bool                          _isStatic;
+	// True if the object is being drawn by a static batch instead
+	bool                          _isBatched;
+	// True if the object can be drawn by the scene's GPU culler instead
+	bool                          _isGpuCulled;
 
 	// If we want to use MeshFactory, we can populate this list
 	std::vector<MeshBuilderParam> _meshBuilderParams;
@@ -1,5 +1,6 @@
 #include "Gameplay/Components/SimpleCameraControl.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 #define  GLM_SWIZZLE
 #include <GLM/gtc/quaternion.hpp>
 
@@ -27,7 +28,7 @@ void SimpleCameraControl::Awake() {
 
 void SimpleCameraControl::Update(float deltaTime)
 {
-	if (glfwGetKey(_window, GLFW_KEY_ENTER)) {
+	if (InputEngine::GetKey(_window, GLFW_KEY_ENTER)) {
 		gameStart = true;
 		GetGameObject()->SetPostion(glm::vec3(51.0f, 17.0f, 4.0f));
 		GetGameObject()->SetRotation(glm::vec3(75.0f, 0.0f, 135.0f));
@@ -36,9 +37,9 @@ void SimpleCameraControl::Update(float deltaTime)
 		if (!(SimpleCameraControl::pause->isPaused))
 		{
 			if(!(GetGameObject()->GetScene()->FindObjectByName("Minigame Pointer")->Get<Minigame>()->minigameActive)){
-				if (glfwGetMouseButton(_window, 0)) {
+				if (InputEngine::GetMouseButton(_window, 0)) {
 					if (_isMousePressed == false) {
-						glfwGetCursorPos(_window, &_prevMousePos.x, &_prevMousePos.y);
+						InputEngine::GetCursorPos(_window, &_prevMousePos.x, &_prevMousePos.y);
 					}
 					_isMousePressed = true;
 				}
@@ -47,7 +48,7 @@ void SimpleCameraControl::Update(float deltaTime)
 				}
 
 				glm::dvec2 currentMousePos;
-				glfwGetCursorPos(_window, &currentMousePos.x, &currentMousePos.y);
+				InputEngine::GetCursorPos(_window, &currentMousePos.x, &currentMousePos.y);
 
 				if (_isMousePressed) {
 
@@ -68,24 +69,24 @@ void SimpleCameraControl::Update(float deltaTime)
 					_prevMousePos = currentMousePos;
 
 					glm::vec3 input = glm::vec3(0.0f);
-					if (glfwGetKey(_window, GLFW_KEY_W)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_W)) {
 						input.z -= _moveSpeeds.x;
 					}
-					if (glfwGetKey(_window, GLFW_KEY_S)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_S)) {
 						input.z += _moveSpeeds.x;
 					}
-					if (glfwGetKey(_window, GLFW_KEY_A)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_A)) {
 						input.x -= _moveSpeeds.y;
 					}
-					if (glfwGetKey(_window, GLFW_KEY_D)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_D)) {
 						input.x += _moveSpeeds.y;
 					}
-					if (glfwGetKey(_window, GLFW_KEY_LEFT_CONTROL)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_LEFT_CONTROL)) {
 						input.y -= _moveSpeeds.z;
 					}
 
 
-					if (glfwGetKey(_window, GLFW_KEY_LEFT_SHIFT)) {
+					if (InputEngine::GetKey(_window, GLFW_KEY_LEFT_SHIFT)) {
 						input *= _shiftMultipler;
 					}
 
@@ -1,5 +1,6 @@
 #include "Gameplay/Components/TargetComponent.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 #define  GLM_SWIZZLE
 #include <GLM/gtc/quaternion.hpp>
 
@@ -30,20 +31,20 @@ void TargetComponent::Update(float deltaTime)
 	if (!(TargetComponent::pause->isPaused))
 	{
             glm::vec3 input = glm::vec3(0.0f);
-            if (glfwGetKey(_window, GLFW_KEY_UP)) {
+            if (InputEngine::GetKey(_window, GLFW_KEY_UP)) {
                 input.z -= _moveSpeeds.x;
             }
-            if (glfwGetKey(_window, GLFW_KEY_DOWN)) {
+            if (InputEngine::GetKey(_window, GLFW_KEY_DOWN)) {
                 input.z += _moveSpeeds.x;
             }
-            if (glfwGetKey(_window, GLFW_KEY_LEFT)) {
+            if (InputEngine::GetKey(_window, GLFW_KEY_LEFT)) {
                 input.x -= _moveSpeeds.y;
             }
-            if (glfwGetKey(_window, GLFW_KEY_RIGHT)) {
+            if (InputEngine::GetKey(_window, GLFW_KEY_RIGHT)) {
                 input.x += _moveSpeeds.y;
             }
 
-            if (glfwGetKey(_window, GLFW_KEY_LEFT_SHIFT)) {
+            if (InputEngine::GetKey(_window, GLFW_KEY_LEFT_SHIFT)) {
                 input *= _shiftMultipler;
             }
 
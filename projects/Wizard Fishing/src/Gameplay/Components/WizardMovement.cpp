@@ -6,25 +6,26 @@
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
 #include <GLFW/glfw3.h>
+#include "Utils/InputEngine.h"
 
 void WizardMovement::Update(float deltaTime) {
-/*	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_W) == GLFW_PRESS) {
+/*	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_W) == GLFW_PRESS) {
 
 		GetGameObject()->SetPostion(glm::vec3(GetGameObject()->GetPosition().x, GetGameObject()->GetPosition().y + speed * deltaTime, 0.0f));
 	}
 
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_S) == GLFW_PRESS) {
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_S) == GLFW_PRESS) {
 	
 		GetGameObject()->SetPostion(glm::vec3(GetGameObject()->GetPosition().x, GetGameObject()->GetPosition().y - speed * deltaTime, 0.0f));
 	}
 
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_D) == GLFW_PRESS) {
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_D) == GLFW_PRESS) {
 
 		GetGameObject()->SetPostion(glm::vec3(GetGameObject()->GetPosition().x + speed * deltaTime, GetGameObject()->GetPosition().y, 0.0f));
 
 	}
 
-	if (glfwGetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_A) == GLFW_PRESS) {
+	if (InputEngine::GetKey(GetGameObject()->GetScene()->Window, GLFW_KEY_A) == GLFW_PRESS) {
 
 		GetGameObject()->SetPostion(glm::vec3(GetGameObject()->GetPosition().x - speed * deltaTime, GetGameObject()->GetPosition().y, 0.0f));
 		
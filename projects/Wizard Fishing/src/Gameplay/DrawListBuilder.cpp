@@ -0,0 +1,295 @@
+#include "Gameplay/DrawListBuilder.h"
+
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+#include <imgui.h>
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Components/ComponentManager.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/MorphMeshRenderer.h"
+
+namespace Gameplay {
+	DrawListBuilder::DrawListBuilder() :
+		Enabled(true),
+		_renderables(std::vector<RenderComponent*>()),
+		_chunks(std::vector<Chunk>()),
+		_chunkCount(0),
+		_scene(nullptr),
+		_culler(nullptr),
+		_skipBatched(false),
+		_skipGpuCulled(false),
+		_view(glm::mat4(1.0f)),
+		_projection(glm::mat4(1.0f)),
+		_cameraPosition(glm::vec3(0.0f)),
+		_useImpostors(false),
+		_impostors(std::vector<ImpostorInstance>()),
+		_objectCount(0),
+		_buildTime(0.0f),
+		_workers(std::vector<std::thread>()),
+		_generation(0),
+		_workersBusy(0),
+		_stopRequested(false),
+		_nextChunk(0)
+	{
+		// Leave a core for the render thread, hardware_concurrency may also return 0 if it doesn't know
+		int workerCount = glm::clamp((int)std::thread::hardware_concurrency() - 2, 0, MAX_WORKERS);
+		for (int ix = 0; ix < workerCount; ix++) {
+			_workers.emplace_back(&DrawListBuilder::_WorkerMain, this);
+		}
+	}
+
+	DrawListBuilder::~DrawListBuilder() {
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_stopRequested = true;
+			_workQueued.notify_all();
+		}
+		for (auto& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	void DrawListBuilder::Build(const Scene::Sptr& scene, const OcclusionCuller::Sptr& culler, FramePacket& packet) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		// The GPU culler covers the same objects as the static batches, so only one of them draws
+		_skipGpuCulled = scene->GetGpuCuller()->IsActive();
+		_skipBatched = scene->GetStaticBatcher()->Enabled && !_skipGpuCulled;
+
+		// Looking up the components is the only part that has to be done in order, after this
+		// every renderable can be handled on it's own
+		_renderables.clear();
+		ComponentManager::Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+			if (!_skipGpuCulled || !renderable->IsGpuCulled()) {
+				_renderables.push_back(renderable.get());
+			}
+		});
+
+		_objectCount = _renderables.size();
+		_chunkCount = (_objectCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		if (_chunks.size() < _chunkCount) {
+			size_t oldSize = _chunks.size();
+			_chunks.resize(_chunkCount);
+			for (size_t ix = oldSize; ix < _chunkCount; ix++) {
+				_chunks[ix].DrawCalls.reserve(CHUNK_SIZE);
+			}
+		}
+		_scene = scene.get();
+		_culler = culler != nullptr && culler->Enabled ? culler.get() : nullptr;
+		_view = packet.View;
+		_projection = packet.Projection;
+		_cameraPosition = packet.CameraPosition;
+		_useImpostors = Impostor::Enabled;
+
+		// Wake up the workers, and help them out until all the chunks have been taken. With only
+		// one chunk there's nothing to share, so we don't bother waking anyone
+		_nextChunk = 0;
+		if (Enabled && !_workers.empty() && _chunkCount > 1) {
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				_generation++;
+				_workersBusy = (int)_workers.size();
+				_workQueued.notify_all();
+			}
+			_BuildChunks();
+			{
+				std::unique_lock<std::mutex> guard(_lock);
+				_workDone.wait(guard, [&] { return _workersBusy == 0; });
+			}
+		} else {
+			_BuildChunks();
+		}
+
+		// Merge the chunks in order. Materials are shared between objects, so their changes are
+		// sent from here instead of from the workers
+		size_t callCount = 0;
+		for (size_t ix = 0; ix < _chunkCount; ix++) {
+			callCount += _chunks[ix].DrawCalls.size();
+		}
+		packet.DrawCalls.reserve(callCount);
+		int testedCount = 0;
+		Material* lastMaterial = nullptr;
+		for (size_t ix = 0; ix < _chunkCount; ix++) {
+			Chunk& chunk = _chunks[ix];
+			for (FramePacket::DrawCall& call : chunk.DrawCalls) {
+				// Materials are shared, so most of the time this has nothing to send
+				if (call.DrawMaterial.get() != lastMaterial) {
+					lastMaterial = call.DrawMaterial.get();
+					lastMaterial->SubmitChanges();
+				}
+				// Submitting may have updated the mask, so it's copied afterwards
+				call.ShaderKeywords = lastMaterial->GetKeywordMask();
+			}
+			// The chunk is cleared before it's next used, so we can steal it's calls instead of copying them
+			packet.DrawCalls.insert(packet.DrawCalls.end(), std::make_move_iterator(chunk.DrawCalls.begin()), std::make_move_iterator(chunk.DrawCalls.end()));
+			packet.TriangleCount += chunk.TriangleCount;
+			packet.OccludedCount += chunk.OccludedCount;
+			testedCount += chunk.TestedCount;
+			_impostors.insert(_impostors.end(), std::make_move_iterator(chunk.Impostors.begin()), std::make_move_iterator(chunk.Impostors.end()));
+		}
+
+		// Group the impostors by what they draw, each group is one instanced draw call
+		std::stable_sort(_impostors.begin(), _impostors.end(), [](const ImpostorInstance& a, const ImpostorInstance& b) {
+			return a.Source.get() < b.Source.get();
+		});
+		packet.ImpostorInstances.reserve(_impostors.size());
+		for (ImpostorInstance& instance : _impostors) {
+			if (packet.Impostors.empty() || packet.Impostors.back().Source != instance.Source) {
+				packet.Impostors.push_back({ instance.Source, (uint32_t)packet.ImpostorInstances.size(), 0 });
+			}
+			packet.Impostors.back().InstanceCount++;
+			packet.ImpostorInstances.push_back(instance.Model);
+		}
+		_impostors.clear();
+
+		// Static batches go last, they're tested as a whole since the objects in them no longer draw on their own
+		if (_skipBatched) {
+			for (const StaticBatcher::Batch& batch : scene->GetStaticBatcher()->GetBatches()) {
+				if (_culler != nullptr) {
+					testedCount++;
+					if (!_culler->IsVisible(batch.BoundsCenter, batch.BoundsRadius)) {
+						packet.OccludedCount++;
+						continue;
+					}
+				}
+
+				FramePacket::DrawCall call;
+				call.Mesh = batch.Mesh;
+				call.DrawMaterial = batch.DrawMaterial;
+				// The vertices are already in world space
+				call.Model = glm::mat4(1.0f);
+				call.NormalMatrix = glm::mat3(1.0f);
+				call.HasMorph = false;
+				call.MorphT = 0.0f;
+				call.DrawMaterial->SubmitChanges();
+				call.ShaderKeywords = call.DrawMaterial->GetKeywordMask();
+				call.DrawMaterial->RequestTextureSize(RenderComponent::CalcScreenSize(batch.BoundsCenter, batch.BoundsRadius, _view, _projection));
+				packet.TriangleCount += batch.TriangleCount;
+				packet.DrawCalls.push_back(std::move(call));
+			}
+		}
+
+		if (_culler != nullptr) {
+			culler->RecordResults(testedCount, packet.OccludedCount);
+		}
+
+		// The renderables are only valid for this frame
+		_renderables.clear();
+		_scene = nullptr;
+		_culler = nullptr;
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		_buildTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+	}
+
+	void DrawListBuilder::_WorkerMain() {
+		uint64_t lastGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> guard(_lock);
+				_workQueued.wait(guard, [&] { return _stopRequested || _generation != lastGeneration; });
+				if (_stopRequested) {
+					return;
+				}
+				lastGeneration = _generation;
+			}
+
+			_BuildChunks();
+
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				_workersBusy--;
+				_workDone.notify_all();
+			}
+		}
+	}
+
+	void DrawListBuilder::_BuildChunks() {
+		size_t chunk;
+		while ((chunk = _nextChunk.fetch_add(1)) < _chunkCount) {
+			_BuildChunk(chunk);
+		}
+	}
+
+	void DrawListBuilder::_BuildChunk(size_t chunkIx) {
+		Chunk& chunk = _chunks[chunkIx];
+		chunk.DrawCalls.clear();
+		chunk.Impostors.clear();
+		chunk.TriangleCount = 0;
+		chunk.TestedCount = 0;
+		chunk.OccludedCount = 0;
+
+		// Only the renderable and it's own game object are touched here, anything shared between
+		// objects has to be read only or left for the merge
+		size_t end = glm::min((chunkIx + 1) * CHUNK_SIZE, _renderables.size());
+		for (size_t ix = chunkIx * CHUNK_SIZE; ix < end; ix++) {
+			RenderComponent* renderable = _renderables[ix];
+
+			// These are drawn by their static batch instead
+			if (_skipBatched && renderable->IsBatched()) {
+				continue;
+			}
+
+			// Pick the LOD before grabbing the mesh, since it decides which VAO we get
+			renderable->UpdateLod(_view, _projection);
+
+			// Early bail if mesh not set
+			if (renderable->GetMesh() == nullptr) {
+				continue;
+			}
+
+			// If we don't have a material, try getting the scene's fallback material
+			// If none exists, do not draw anything
+			if (renderable->GetMaterial() == nullptr) {
+				if (_scene->DefaultMaterial != nullptr) {
+					renderable->SetMaterial(_scene->DefaultMaterial);
+				} else {
+					continue;
+				}
+			}
+
+			// Skip anything hidden behind our occluders. Occluders are tested too, since their
+			// depth is written conservatively they can never hide themselves
+			glm::vec3 boundsCenter;
+			float boundsRadius;
+			bool hasBounds = renderable->GetWorldBounds(boundsCenter, boundsRadius);
+			if (_culler != nullptr && hasBounds) {
+				chunk.TestedCount++;
+				if (!_culler->IsVisible(boundsCenter, boundsRadius)) {
+					chunk.OccludedCount++;
+					continue;
+				}
+			}
+
+			GameObject* object = renderable->GetGameObject();
+
+			// Far away objects swap their mesh for a single quad
+			if (_useImpostors && hasBounds && renderable->GetImpostor() != nullptr &&
+				glm::distance(boundsCenter, _cameraPosition) - boundsRadius > Impostor::SwitchDistance) {
+				chunk.Impostors.push_back({ renderable->GetImpostor(), object->GetTransform() });
+				chunk.TriangleCount += 2;
+				continue;
+			}
+
+			FramePacket::DrawCall call;
+			call.Mesh = renderable->GetMesh();
+			call.DrawMaterial = renderable->GetMaterial();
+			call.Model = object->GetTransform();
+			call.NormalMatrix = glm::mat3(glm::transpose(glm::inverse(call.Model)));
+			call.HasMorph = object->Has<MorphMeshRenderer>();
+			call.MorphT = call.HasMorph ? object->Get<MorphMeshRenderer>()->t : 0.0f;
+			call.ShaderKeywords = 0;
+			// Lets the texture streamer know how much of the material's texture we'll need
+			call.DrawMaterial->RequestTextureSize(renderable->GetScreenSize());
+			chunk.TriangleCount += call.Mesh->GetElementCount() / 3;
+			chunk.DrawCalls.push_back(std::move(call));
+		}
+	}
+
+	void DrawListBuilder::RenderImGui() {
+		ImGui::Checkbox("Parallel Draw Lists", &Enabled);
+		ImGui::Text("Draw Lists: %d objects in %.2f ms (%d chunks, %d threads)", (int)_objectCount, _buildTime, (int)_chunkCount,
+			Enabled ? (int)_workers.size() + 1 : 1);
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/FramePacket.h"
+#include "Graphics/OcclusionCuller.h"
+
+class RenderComponent;
+
+namespace Gameplay {
+	/// <summary>
+	/// Builds the list of draw calls for a frame packet, spreading the per-object work (LOD
+	/// selection, occlusion tests, model and normal matrices) over a pool of worker threads
+	///
+	/// The renderables are split into fixed size chunks, which the workers (and the main thread)
+	/// take from a shared counter. Each chunk writes into it's own array of draw calls, which is
+	/// kept between frames so it's only allocated once. The main thread then merges the chunks
+	/// in order, so the draw order is the same as building the list on a single thread
+	///
+	/// Objects that were merged into the scene's static batches are skipped, and the batches are
+	/// added after everything else. While GPU culling is on, the scene's GpuCuller draws the
+	/// static objects instead, and they are skipped along with the batches. Objects that are far
+	/// enough away to draw their impostor are collected separately, and grouped so each impostor
+	/// is drawn in one instanced draw call
+	///
+	/// This only does CPU work, and should be used from the main thread
+	/// </summary>
+	class DrawListBuilder {
+	public:
+		typedef std::shared_ptr<DrawListBuilder> Sptr;
+
+		// The number of renderables in each chunk of work
+		static const size_t CHUNK_SIZE = 256;
+		// The most worker threads we will start, the main thread builds chunks as well
+		static const int MAX_WORKERS = 15;
+
+		static inline Sptr Create() {
+			return std::make_shared<DrawListBuilder>();
+		}
+
+		DrawListBuilder();
+		~DrawListBuilder();
+
+		DrawListBuilder(const DrawListBuilder& other) = delete;
+		DrawListBuilder& operator=(const DrawListBuilder& other) = delete;
+
+		// When false, every chunk is built on the main thread
+		bool Enabled;
+
+		/// <summary>
+		/// Fills in the packet's draw calls, triangle count and occluded count from the scene's
+		/// render components. The packet's camera matrices must already be set
+		/// </summary>
+		/// <param name="scene">The scene to collect the draw calls from</param>
+		/// <param name="culler">If set, objects that this hides are left out. Rasterize must have been called</param>
+		/// <param name="packet">The packet to fill</param>
+		void Build(const Scene::Sptr& scene, const OcclusionCuller::Sptr& culler, FramePacket& packet);
+
+		/// <summary>
+		/// Draws the ImGui controls for our settings, along with stats from the last frame
+		/// </summary>
+		void RenderImGui();
+
+	protected:
+		// A far away object that is drawing it's impostor
+		struct ImpostorInstance {
+			Impostor::Sptr Source;
+			glm::mat4      Model;
+		};
+
+		// The results of building one chunk of renderables
+		struct Chunk {
+			std::vector<FramePacket::DrawCall> DrawCalls;
+			std::vector<ImpostorInstance>      Impostors;
+			int TriangleCount;
+			int TestedCount;
+			int OccludedCount;
+		};
+
+		// The state for the frame being built, only written while the workers are asleep
+		std::vector<RenderComponent*> _renderables;
+		std::vector<Chunk>            _chunks;
+		size_t                        _chunkCount;
+		Scene*                        _scene;
+		const OcclusionCuller*        _culler;
+		// True if objects in static batches should be skipped, and the batches drawn instead
+		bool                          _skipBatched;
+		bool                          _skipGpuCulled;
+		glm::mat4                     _view;
+		glm::mat4                     _projection;
+		glm::vec3                     _cameraPosition;
+		// Copied from Impostor::Enabled
+		bool                          _useImpostors;
+		// Every chunk's impostors, gathered up so they can be grouped by impostor
+		std::vector<ImpostorInstance> _impostors;
+
+		// Stats from the last frame
+		size_t _objectCount;
+		float  _buildTime;
+
+		// Our workers sleep until the generation changes, and then help us build chunks
+		std::vector<std::thread> _workers;
+		std::mutex _lock;
+		std::condition_variable _workQueued;
+		std::condition_variable _workDone;
+		uint64_t _generation;
+		int _workersBusy;
+		bool _stopRequested;
+		std::atomic<size_t> _nextChunk;
+
+		void _WorkerMain();
+		void _BuildChunks();
+		void _BuildChunk(size_t chunk);
+	};
+}
@@ -0,0 +1,191 @@
+#include "Gameplay/FramePacket.h"
+
+#include "Gameplay/GameObject.h"
+#include "Gameplay/DrawListBuilder.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/HudSprite.h"
+#include "Gameplay/Components/HudText.h"
+#include "Graphics/GlStateCache.h"
+#include "Graphics/GeometryPool.h"
+#include "Graphics/GpuProfiler.h"
+#include "Graphics/TextureCube.h"
+
+namespace Gameplay {
+	// Handles for the uniforms we set every frame, hashed at compile time
+	static constexpr UniformHandle U_CAM_POS("u_CamPos");
+	static constexpr UniformHandle U_MODEL_VIEW_PROJECTION("u_ModelViewProjection");
+	static constexpr UniformHandle U_VIEW_PROJECTION("u_ViewProjection");
+	static constexpr UniformHandle U_MODEL("u_Model");
+	static constexpr UniformHandle U_NORMAL_MATRIX("u_NormalMatrix");
+	static constexpr UniformHandle U_MORPH_T("t");
+	static constexpr UniformHandle U_MORPH_TARGET_OFFSET("u_MorphTargetOffset");
+
+	// The shader keyword that fetches vertices from the geometry pool
+	static const std::vector<std::string> VERTEX_PULLING_KEYWORD = { "VERTEX_PULLING" };
+	// The shader keywords that draw from the GPU culler's indirect commands
+	static const std::vector<std::string> GPU_CULLED_KEYWORDS = { "VERTEX_PULLING", "GPU_CULLED" };
+
+	FramePacket::Sptr FramePacket::Build(const Scene::Sptr& scene, DrawListBuilder& drawLists, const OcclusionCuller::Sptr& culler) {
+		FramePacket::Sptr result = std::make_shared<FramePacket>();
+		result->FrameScene = scene;
+		result->TriangleCount = 0;
+		result->OccludedCount = 0;
+		result->UseVertexPulling = GeometryPool::Enabled;
+
+		Camera::Sptr camera = scene->MainCamera;
+		result->View = camera->GetView();
+		result->Projection = camera->GetProjection();
+		result->ViewProjection = camera->GetViewProjection();
+		result->CameraPosition = camera->GetGameObject()->GetPosition();
+
+		// Draw all our occluders first, so we know what they hide before we collect anything
+		bool useOcclusion = culler != nullptr && culler->Enabled;
+		if (useOcclusion) {
+			culler->BeginFrame(result->ViewProjection);
+			ComponentManager::Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+				if (renderable->GetOccluder() != nullptr) {
+					culler->AddOccluder(renderable->GetOccluder()->GetOccluderTriangles(), renderable->GetGameObject()->GetTransform());
+				}
+			});
+			culler->Rasterize();
+		}
+
+		// The per-object work is spread over the draw list builder's workers
+		drawLists.Build(scene, culler, *result);
+
+		// The GPU culler's objects never change, but their materials might
+		if (scene->GetGpuCuller()->IsActive()) {
+			result->GpuCulled = scene->GetGpuCuller();
+			result->GpuCulledKeywords.reserve(result->GpuCulled->GetGroups().size());
+			for (const GpuCuller::Group& group : result->GpuCulled->GetGroups()) {
+				group.DrawMaterial->SubmitChanges();
+				result->GpuCulledKeywords.push_back(group.DrawMaterial->GetKeywordMask());
+				// We don't know which of the objects will be visible, or how close they are, so
+				// their textures are always streamed in at full size
+				group.DrawMaterial->RequestTextureSize(1.0f);
+			}
+		}
+
+		// HUD sprites draw in the order they were created, so later ones go on top
+		ComponentManager::Each<HudSprite>([](const HudSprite::Sptr& sprite) {
+			sprite->Draw();
+		});
+		// Text goes over all of the sprites
+		ComponentManager::Each<HudText>([](const HudText::Sptr& text) {
+			text->Draw();
+		});
+
+		DebugDrawer::Get().TakeBatch(result->DebugPrimitives);
+		HudBatcher::Get().TakeBatch(result->HudSprites);
+		TextRenderer::Get().TakeBatch(result->HudLabels);
+		return result;
+	}
+
+	void FramePacket::Render() const {
+		// Clear the color and depth buffers
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		FrameScene->BindLighting();
+		TextureCube::Sptr environment = FrameScene->GetSkyboxTexture();
+		if (environment) environment->Bind(0);
+
+		// The current material that is bound for rendering
+		Material::Sptr currentMat = nullptr;
+		Shader* shader = nullptr;
+		uint32_t currentKeywords = 0;
+		uint32_t pullingMask = 0;
+
+		// The static objects go first, so they can hide as much as possible of everything else
+		if (GpuCulled != nullptr) {
+			GpuProfiler::BeginScope("GPU Culling");
+			GpuCulled->Cull(View, Projection);
+			const std::vector<GpuCuller::Group>& groups = GpuCulled->GetGroups();
+			for (size_t ix = 0; ix < groups.size(); ix++) {
+				const Material::Sptr& material = groups[ix].DrawMaterial;
+				material->Apply();
+				Shader* variant = material->MatShader->GetVariant(GpuCulledKeywords[ix] | material->MatShader->GetKeywordMask(GPU_CULLED_KEYWORDS));
+				variant->Bind();
+				variant->SetUniform(U_CAM_POS, CameraPosition);
+				variant->SetUniformMatrix(U_VIEW_PROJECTION, ViewProjection);
+				GpuCulled->DrawGroup(ix);
+			}
+			GpuProfiler::EndScope();
+		}
+
+		GpuProfiler::BeginScope("Render Components");
+		for (const DrawCall& call : DrawCalls) {
+			// If the material has changed, we need to bind the new shader and set up our material and frame data
+			// Note: This is a good reason why we should be sorting the render components in ComponentManager
+			bool materialChanged = call.DrawMaterial != currentMat;
+			if (materialChanged) {
+				currentMat = call.DrawMaterial;
+				pullingMask = UseVertexPulling ? currentMat->MatShader->GetKeywordMask(VERTEX_PULLING_KEYWORD) : 0;
+				currentMat->Apply();
+			}
+
+			// Meshes only get pulled if they made it into the pool, and the shader knows how to pull them
+			const PooledMesh* pooled = pullingMask != 0 ? call.Mesh->GetPooledMesh().get() : nullptr;
+			uint32_t keywords = call.ShaderKeywords | (pooled != nullptr ? pullingMask : 0);
+			if (materialChanged || keywords != currentKeywords) {
+				currentKeywords = keywords;
+				// Variants are compiled the first time they are drawn
+				shader = currentMat->MatShader->GetVariant(keywords);
+
+				shader->Bind();
+				shader->SetUniform(U_CAM_POS, CameraPosition);
+			}
+
+			// Set vertex shader parameters
+			shader->SetUniformMatrix(U_MODEL_VIEW_PROJECTION, ViewProjection * call.Model);
+			shader->SetUniformMatrix(U_MODEL, call.Model);
+			shader->SetUniformMatrix(U_NORMAL_MATRIX, call.NormalMatrix);
+			if (call.HasMorph) {
+				shader->SetUniform(U_MORPH_T, call.MorphT);
+			}
+
+			// Draw the object
+			if (pooled != nullptr) {
+				if (call.HasMorph) {
+					shader->SetUniform(U_MORPH_TARGET_OFFSET, pooled->MorphTargetOffset);
+				}
+				GeometryPool::Get().Draw(*pooled);
+			} else {
+				call.Mesh->Draw();
+			}
+		}
+		GpuProfiler::EndScope();
+
+		// Impostors use alpha testing, so they can be drawn with the rest of the opaque geometry
+		GpuProfiler::BeginScope("Impostors");
+		Impostor::DrawBatches(Impostors, ImpostorInstances, ViewProjection, CameraPosition);
+		GpuProfiler::EndScope();
+
+		// Everything that can hide the GPU culler's objects has been drawn, so next frame can be tested against it
+		if (GpuCulled != nullptr) {
+			GpuProfiler::BeginScope("Depth Pyramid");
+			GpuCulled->UpdateDepthPyramid(ViewProjection);
+			GpuProfiler::EndScope();
+		}
+
+		// Use our cubemap to draw our skybox
+		GpuProfiler::BeginScope("Skybox");
+		FrameScene->DrawSkybox(View, Projection);
+		GpuProfiler::EndScope();
+
+		// Debug primitives are depth tested against the scene, so they go last
+		GpuProfiler::BeginScope("Physics Debug");
+		DebugDrawer::Get().DrawBatch(DebugPrimitives);
+		GpuProfiler::EndScope();
+
+		VertexArrayObject::Unbind();
+	}
+
+	void FramePacket::RenderHud(const glm::ivec2& screenSize) const {
+		GpuProfiler::BeginScope("HUD");
+		HudBatcher::Get().DrawBatch(HudSprites, screenSize);
+		TextRenderer::Get().DrawBatch(HudLabels, screenSize);
+		GpuProfiler::EndScope();
+
+		VertexArrayObject::Unbind();
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/Material.h"
+#include "Gameplay/Impostor.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/DebugDraw.h"
+#include "Graphics/HudBatcher.h"
+#include "Graphics/TextRenderer.h"
+#include "Graphics/OcclusionCuller.h"
+
+namespace Gameplay {
+	class DrawListBuilder;
+
+	/// <summary>
+	/// A snapshot of everything the renderer needs to draw a single frame of a scene
+	///
+	/// Packets are built on the main thread once the frame has been simulated, and are then
+	/// handed to the render thread. Since the packet holds it's own copy of every transform and
+	/// camera matrix, the main thread can start updating the next frame while this one draws
+	/// </summary>
+	struct FramePacket {
+	public:
+		typedef std::shared_ptr<FramePacket> Sptr;
+
+		/// <summary>
+		/// A single mesh to draw, with all of the per-object data it needs
+		/// </summary>
+		struct DrawCall {
+			VertexArrayObject::Sptr Mesh;
+			Material::Sptr          DrawMaterial;
+			glm::mat4               Model;
+			glm::mat3               NormalMatrix;
+			// Only uploaded for objects with a morph renderer
+			float                   MorphT;
+			bool                    HasMorph;
+			// The material's keyword mask, which picks the variant of it's shader to draw with
+			uint32_t                ShaderKeywords;
+		};
+
+		// Holds the scene's GPU resources (lighting buffers, skybox) alive until the frame is drawn
+		Scene::Sptr              FrameScene;
+
+		glm::mat4                View;
+		glm::mat4                Projection;
+		glm::mat4                ViewProjection;
+		glm::vec3                CameraPosition;
+
+		// In the order they were collected, which is the order the components were created in
+		std::vector<DrawCall>    DrawCalls;
+		// Culls and draws the scene's static objects on the GPU, or nullptr if GPU culling is off
+		GpuCuller::Sptr          GpuCulled;
+		// The keyword mask of each of the GPU culler's groups, read here since the main thread may
+		// change the materials while this frame draws
+		std::vector<uint32_t>    GpuCulledKeywords;
+		// Far away objects that are drawing their impostors, grouped by impostor
+		std::vector<Impostor::Batch> Impostors;
+		std::vector<glm::mat4>   ImpostorInstances;
+		DebugDrawer::Batch       DebugPrimitives;
+		HudBatcher::Batch        HudSprites;
+		TextRenderer::Batch      HudLabels;
+
+		// The number of triangles in all of our draw calls, for the stats display
+		int                      TriangleCount;
+		// The number of objects that were skipped because they were hidden behind occluders
+		int                      OccludedCount;
+		// Whether meshes in the geometry pool are drawn with vertex pulling, copied from GeometryPool::Enabled
+		bool                     UseVertexPulling;
+
+		/// <summary>
+		/// Collects everything needed to draw the scene from it's main camera. Call from the main
+		/// thread, after the scene has been updated for this frame
+		/// </summary>
+		/// <param name="scene">The scene to capture, must have a main camera</param>
+		/// <param name="drawLists">Builds the draw calls from the scene's render components</param>
+		/// <param name="culler">If set, objects that this hides behind the scene's occluders are left out</param>
+		/// <returns>A new packet ready to be rendered</returns>
+		static Sptr Build(const Scene::Sptr& scene, DrawListBuilder& drawLists, const OcclusionCuller::Sptr& culler = nullptr);
+
+		/// <summary>
+		/// Clears the current render target and draws the packet into it, must be called from
+		/// the render thread
+		/// </summary>
+		void Render() const;
+		/// <summary>
+		/// Draws the HUD over the current render target, must be called from the render thread.
+		/// This is kept separate from Render, so the HUD can be drawn at the output resolution
+		/// after the scene has been upscaled
+		/// </summary>
+		/// <param name="screenSize">The size of the current viewport in pixels</param>
+		void RenderHud(const glm::ivec2& screenSize) const;
+	};
+}
@@ -0,0 +1,467 @@
+#include "Gameplay/GpuCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <imgui.h>
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/MorphMeshRenderer.h"
+#include "Graphics/GeometryPool.h"
+#include "Graphics/GlDeleteList.h"
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+namespace Gameplay {
+	// Handles for the uniforms we set every frame, hashed at compile time
+	static constexpr UniformHandle U_OBJECT_COUNT("u_ObjectCount");
+	static constexpr UniformHandle U_FRUSTUM_PLANES("u_FrustumPlanes");
+	static constexpr UniformHandle U_VIEW("u_View");
+	static constexpr UniformHandle U_PROJECTION_SCALE("u_ProjectionScale");
+	static constexpr UniformHandle U_PERSPECTIVE("u_Perspective");
+	static constexpr UniformHandle U_USE_LODS("u_UseLods");
+	static constexpr UniformHandle U_LOD_SCREEN_SIZES("u_LodScreenSizes");
+	static constexpr UniformHandle U_USE_DEPTH_PYRAMID("u_UseDepthPyramid");
+	static constexpr UniformHandle U_PREVIOUS_VIEW_PROJECTION("u_PreviousViewProjection");
+	static constexpr UniformHandle U_PYRAMID_LEVELS("u_PyramidLevels");
+	static constexpr UniformHandle U_PYRAMID_UV_SCALE("u_PyramidUvScale");
+	static constexpr UniformHandle U_LEVEL("u_Level");
+	static constexpr UniformHandle U_SOURCE_SIZE("u_SourceSize");
+	static constexpr UniformHandle U_DESTINATION_SIZE("u_DestinationSize");
+
+	// The keywords our objects' shaders need, to read their vertices and transforms from our buffers
+	static const std::vector<std::string> VERTEX_PULLING_KEYWORD = { "VERTEX_PULLING" };
+	static const std::vector<std::string> GPU_CULLED_KEYWORD = { "GPU_CULLED" };
+
+	// The size of the work groups in depth_pyramid_comp.glsl
+	static const int PYRAMID_WORKGROUP_SIZE = 8;
+
+	// Gets the size of a framebuffer's depth attachment, or 0 if we can't tell (ex: the window's framebuffer)
+	static glm::ivec2 GetDepthAttachmentSize(GLuint framebuffer) {
+		glm::ivec2 result = glm::ivec2(0);
+		if (framebuffer == 0) {
+			return result;
+		}
+		GLint type = GL_NONE, name = 0;
+		glGetNamedFramebufferAttachmentParameteriv(framebuffer, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+		glGetNamedFramebufferAttachmentParameteriv(framebuffer, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+		if (type == GL_TEXTURE) {
+			glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_WIDTH, &result.x);
+			glGetTextureLevelParameteriv(name, 0, GL_TEXTURE_HEIGHT, &result.y);
+		} else if (type == GL_RENDERBUFFER) {
+			glGetNamedRenderbufferParameteriv(name, GL_RENDERBUFFER_WIDTH, &result.x);
+			glGetNamedRenderbufferParameteriv(name, GL_RENDERBUFFER_HEIGHT, &result.y);
+		}
+		return result;
+	}
+
+	GpuCuller::GpuCuller() :
+		Enabled(false),
+		UseDepthPyramid(true),
+		_groups(std::vector<Group>()),
+		_culledComponents(std::vector<std::weak_ptr<RenderComponent>>()),
+		_objectCount(0),
+		_cullShader(nullptr),
+		_pyramidShader(nullptr),
+		_hasDrawCount(false),
+		_objectBuffer(0),
+		_commandBuffer(0),
+		_countBuffer(0),
+		_objectIndexBuffer(0),
+		_vao(0),
+		_depthCopy(0),
+		_depthFramebuffer(0),
+		_depthSize(glm::ivec2(0)),
+		_pyramid(0),
+		_pyramidSize(glm::ivec2(0)),
+		_pyramidLevels(0),
+		_pyramidViewProjection(glm::mat4(1.0f)),
+		_pyramidUvScale(glm::vec2(1.0f)),
+		_hasPyramid(false),
+		_readbackBuffer(0),
+		_readbackFence(nullptr),
+		_visibleCount(0),
+		_bakeTime(0.0f)
+	{ }
+
+	GpuCuller::~GpuCuller() {
+		GlDeleteList()
+			.Buffer(_objectBuffer).Buffer(_commandBuffer).Buffer(_countBuffer).Buffer(_objectIndexBuffer).Buffer(_readbackBuffer)
+			.Texture(_depthCopy).Texture(_pyramid)
+			.VertexArray(_vao)
+			.Framebuffer(_depthFramebuffer)
+			.Fence(_readbackFence)
+			.DeleteLater();
+	}
+
+	void GpuCuller::Clear() {
+		for (auto& weakComponent : _culledComponents) {
+			if (RenderComponent::Sptr component = weakComponent.lock()) {
+				component->SetGpuCulled(false);
+			}
+		}
+		_culledComponents.clear();
+		// The render thread may still be drawing our groups, so they're only dropped once it's done
+		RenderThread::Invoke([this]() {
+			_groups.clear();
+			_objectCount = 0;
+			_visibleCount = 0;
+			_DeleteObjectBuffers();
+		});
+	}
+
+	void GpuCuller::Bake(const std::vector<GameObject::Sptr>& objects) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		Clear();
+
+		// A static object that we can draw, along with the pooled meshes for each of it's LODs
+		struct Entry {
+			RenderComponent::Sptr Component;
+			const PooledMesh*     Lods[MAX_LODS];
+			uint32_t              LodCount;
+			glm::vec3             BoundsCenter;
+			float                 BoundsRadius;
+		};
+		std::vector<Entry> entries;
+
+		for (const GameObject::Sptr& object : objects) {
+			RenderComponent::Sptr renderer = object->Get<RenderComponent>();
+			if (renderer == nullptr || !renderer->IsStatic() || renderer->GetMaterial() == nullptr || renderer->GetMeshResource() == nullptr) {
+				continue;
+			}
+			// Morphing objects change every frame, and impostors are picked on the CPU. Overridden
+			// VAOs don't match the mesh resource, which also means we don't get any bounds for them
+			Entry entry;
+			if (object->Has<MorphMeshRenderer>() || renderer->GetImpostor() != nullptr || !renderer->GetWorldBounds(entry.BoundsCenter, entry.BoundsRadius)) {
+				continue;
+			}
+			// The shader has to know how to find the object's vertices and transform in our buffers
+			const Material::Sptr& material = renderer->GetMaterial();
+			if (material->MatShader == nullptr ||
+				material->MatShader->GetKeywordMask(VERTEX_PULLING_KEYWORD) == 0 || material->MatShader->GetKeywordMask(GPU_CULLED_KEYWORD) == 0 ||
+				std::find(material->Keywords.begin(), material->Keywords.end(), "MORPH") != material->Keywords.end()) {
+				continue;
+			}
+			// Only meshes that made it into the geometry pool can be drawn from our commands
+			const MeshResource::Sptr& mesh = renderer->GetMeshResource();
+			const PooledMesh* pooled = mesh->Mesh != nullptr ? mesh->Mesh->GetPooledMesh().get() : nullptr;
+			if (pooled == nullptr || pooled->IndexCount == 0) {
+				continue;
+			}
+
+			entry.Component = renderer;
+			entry.Lods[0] = pooled;
+			entry.LodCount = 1;
+			// LODs share the full detail mesh's vertices, so they only need their own indices
+			for (const VertexArrayObject::Sptr& lod : mesh->Lods) {
+				const PooledMesh* pooledLod = lod->GetPooledMesh().get();
+				if (entry.LodCount == MAX_LODS || pooledLod == nullptr || pooledLod->BaseVertex != pooled->BaseVertex) {
+					break;
+				}
+				entry.Lods[entry.LodCount++] = pooledLod;
+			}
+			entries.push_back(entry);
+		}
+
+		// Each material gets it's own range of the command buffer, so sort them next to each other
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			return a.Component->GetMaterial().get() < b.Component->GetMaterial().get();
+		});
+
+		std::vector<Group> groups;
+		std::vector<ObjectData> objectData;
+		objectData.reserve(entries.size());
+		for (const Entry& entry : entries) {
+			const Material::Sptr& material = entry.Component->GetMaterial();
+			if (groups.empty() || groups.back().DrawMaterial != material) {
+				groups.push_back({ material, (uint32_t)objectData.size(), 0 });
+			}
+			groups.back().ObjectCount++;
+
+			ObjectData data;
+			data.Model = entry.Component->GetGameObject()->GetTransform();
+			glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(data.Model)));
+			for (int ix = 0; ix < 3; ix++) {
+				data.NormalMatrix[ix] = glm::vec4(normalMatrix[ix], 0.0f);
+			}
+			data.Bounds = glm::vec4(entry.BoundsCenter, entry.BoundsRadius);
+			data.LodIndexCounts = glm::uvec4(0);
+			data.LodFirstIndices = glm::uvec4(0);
+			for (uint32_t ix = 0; ix < entry.LodCount; ix++) {
+				data.LodIndexCounts[ix] = entry.Lods[ix]->IndexCount;
+				data.LodFirstIndices[ix] = entry.Lods[ix]->FirstIndex;
+			}
+			data.BaseVertex = (int32_t)entry.Lods[0]->BaseVertex;
+			data.LodCount = entry.LodCount;
+			data.FirstCommand = groups.back().FirstCommand;
+			data.Group = (uint32_t)(groups.size() - 1);
+			objectData.push_back(data);
+
+			entry.Component->SetGpuCulled(true);
+			_culledComponents.push_back(entry.Component);
+		}
+
+		std::vector<uint32_t> objectIndices(objectData.size());
+		std::iota(objectIndices.begin(), objectIndices.end(), 0u);
+
+		// The pool's buffers need to exist before we can point our VAO at them
+		GeometryPool& pool = GeometryPool::Get();
+		RenderThread::Invoke([&]() {
+			_Initialize();
+			_groups = std::move(groups);
+			_objectCount = (uint32_t)objectData.size();
+			if (_objectCount == 0) {
+				return;
+			}
+
+			// The objects never change, but the commands and counts are rewritten every frame
+			glCreateBuffers(1, &_objectBuffer);
+			glNamedBufferStorage(_objectBuffer, sizeof(ObjectData) * objectData.size(), objectData.data(), 0);
+			glCreateBuffers(1, &_commandBuffer);
+			glNamedBufferStorage(_commandBuffer, sizeof(DrawCommand) * objectData.size(), nullptr, 0);
+			glCreateBuffers(1, &_countBuffer);
+			glNamedBufferStorage(_countBuffer, sizeof(uint32_t) * _groups.size(), nullptr, 0);
+			glCreateBuffers(1, &_readbackBuffer);
+			glNamedBufferStorage(_readbackBuffer, sizeof(uint32_t) * _groups.size(), nullptr, GL_CLIENT_STORAGE_BIT);
+			glCreateBuffers(1, &_objectIndexBuffer);
+			glNamedBufferStorage(_objectIndexBuffer, sizeof(uint32_t) * objectIndices.size(), objectIndices.data(), 0);
+
+			// With a divisor of 1, the attribute is read at the command's base instance
+			const GLuint attribute = OBJECT_INDEX_ATTRIBUTE;
+			glCreateVertexArrays(1, &_vao);
+			glVertexArrayElementBuffer(_vao, pool.GetIndexBuffer());
+			glVertexArrayVertexBuffer(_vao, 0, _objectIndexBuffer, 0, sizeof(uint32_t));
+			glVertexArrayBindingDivisor(_vao, 0, 1);
+			glEnableVertexArrayAttrib(_vao, attribute);
+			glVertexArrayAttribIFormat(_vao, attribute, 1, GL_UNSIGNED_INT, 0);
+			glVertexArrayAttribBinding(_vao, attribute, 0);
+		});
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		_bakeTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+		LOG_INFO("Uploaded {} static objects in {} groups for GPU culling in {:.2f} ms", _objectCount, _groups.size(), _bakeTime);
+	}
+
+	void GpuCuller::Cull(const glm::mat4& view, const glm::mat4& projection) {
+		if (_objectCount == 0) {
+			return;
+		}
+
+		// Pick up the stats from an earlier frame, but only if the GPU is done with them so we never stall
+		if (_readbackFence != nullptr) {
+			GLenum status = glClientWaitSync(_readbackFence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				std::vector<uint32_t> counts(_groups.size());
+				glGetNamedBufferSubData(_readbackBuffer, 0, sizeof(uint32_t) * counts.size(), counts.data());
+				_visibleCount = (int)std::accumulate(counts.begin(), counts.end(), 0u);
+				glDeleteSync(_readbackFence);
+				_readbackFence = nullptr;
+			}
+		}
+
+		const uint32_t zero = 0;
+		glClearNamedBufferData(_countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		if (!_hasDrawCount) {
+			// Every command gets drawn, so the ones we don't write need to draw nothing
+			glClearNamedBufferData(_commandBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		}
+
+		// The planes of the frustum, pointing inwards (Gribb & Hartmann)
+		glm::mat4 viewProjection = projection * view;
+		glm::vec4 rows[4];
+		for (int ix = 0; ix < 4; ix++) {
+			rows[ix] = glm::vec4(viewProjection[0][ix], viewProjection[1][ix], viewProjection[2][ix], viewProjection[3][ix]);
+		}
+		glm::vec4 planes[6] = {
+			rows[3] + rows[0], rows[3] - rows[0],
+			rows[3] + rows[1], rows[3] - rows[1],
+			rows[3] + rows[2], rows[3] - rows[2]
+		};
+		for (glm::vec4& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		// projection[2][3] is -1 for perspective and 0 for ortho projections
+		int objectCount = (int)_objectCount;
+		int perspective = projection[2][3] != 0.0f ? 1 : 0;
+		int useLods = RenderComponent::LodsEnabled ? 1 : 0;
+		int useDepthPyramid = UseDepthPyramid && _hasPyramid ? 1 : 0;
+		float lodScreenSizes[MAX_LODS - 1];
+		for (int ix = 0; ix < MAX_LODS - 1; ix++) {
+			lodScreenSizes[ix] = RenderComponent::LOD_SCREEN_SIZES[ix];
+		}
+
+		_cullShader->Bind();
+		_cullShader->SetUniform(U_OBJECT_COUNT, objectCount);
+		_cullShader->SetUniform(U_FRUSTUM_PLANES, planes, 6);
+		_cullShader->SetUniformMatrix(U_VIEW, view);
+		_cullShader->SetUniform(U_PROJECTION_SCALE, projection[1][1]);
+		_cullShader->SetUniform(U_PERSPECTIVE, perspective);
+		_cullShader->SetUniform(U_USE_LODS, useLods);
+		_cullShader->SetUniform(U_LOD_SCREEN_SIZES, lodScreenSizes, MAX_LODS - 1);
+		_cullShader->SetUniform(U_USE_DEPTH_PYRAMID, useDepthPyramid);
+		_cullShader->SetUniformMatrix(U_PREVIOUS_VIEW_PROJECTION, _pyramidViewProjection);
+		_cullShader->SetUniform(U_PYRAMID_LEVELS, _pyramidLevels);
+		_cullShader->SetUniform(U_PYRAMID_UV_SCALE, _pyramidUvScale);
+		GlStateCache::BindTextureUnit(DEPTH_PYRAMID_TEXTURE_SLOT, _pyramid);
+		GlStateCache::BindStorageBuffer(OBJECT_SSBO_BINDING_SLOT, _objectBuffer);
+		GlStateCache::BindStorageBuffer(COMMAND_SSBO_BINDING_SLOT, _commandBuffer);
+		GlStateCache::BindStorageBuffer(COUNT_SSBO_BINDING_SLOT, _countBuffer);
+		glDispatchCompute((_objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		// Only one copy is in flight at a time, the stats don't need to be exact
+		if (_readbackFence == nullptr) {
+			glCopyNamedBufferSubData(_countBuffer, _readbackBuffer, 0, 0, sizeof(uint32_t) * _groups.size());
+			_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+
+	void GpuCuller::DrawGroup(size_t group) {
+		const Group& info = _groups[group];
+		GlStateCache::BindStorageBuffer(GeometryPool::VERTEX_SSBO_BINDING_SLOT, GeometryPool::Get().GetVertexBuffer());
+		GlStateCache::BindStorageBuffer(OBJECT_SSBO_BINDING_SLOT, _objectBuffer);
+		GlStateCache::BindVertexArray(_vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+
+		const void* firstCommand = (const void*)(sizeof(DrawCommand) * (size_t)info.FirstCommand);
+		if (_hasDrawCount) {
+			glBindBuffer(GL_PARAMETER_BUFFER, _countBuffer);
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, firstCommand, (GLintptr)(sizeof(uint32_t) * group), (GLsizei)info.ObjectCount, 0);
+		} else {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, firstCommand, (GLsizei)info.ObjectCount, 0);
+		}
+	}
+
+	void GpuCuller::UpdateDepthPyramid(const glm::mat4& viewProjection) {
+		if (_objectCount == 0 || !UseDepthPyramid) {
+			_hasPyramid = false;
+			return;
+		}
+
+		// Copy the depth out of whatever we just rendered into
+		GLint framebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glm::ivec2 size = glm::ivec2(viewport[2], viewport[3]);
+		if (size.x <= 0 || size.y <= 0) {
+			_hasPyramid = false;
+			return;
+		}
+		// The render graph allocates the scene targets at the output size and only renders into the
+		// corner of them, so we size ours the same way rather than following the viewport
+		glm::ivec2 capacity = glm::max(_depthSize, glm::max(size, GetDepthAttachmentSize(framebuffer)));
+		if (capacity != _depthSize) {
+			_ResizePyramid(capacity);
+		}
+		glBlitNamedFramebuffer(framebuffer, _depthFramebuffer, viewport[0], viewport[1], viewport[0] + size.x, viewport[1] + size.y,
+			0, 0, size.x, size.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+		// Level 0 shrinks the viewport's corner of the depth copy by the same ratio as the full
+		// textures, and every level after halves the one before it (rounding up, so nothing is lost)
+		glm::ivec2 levelSize = glm::max((_pyramidSize * size + _depthSize - 1) / _depthSize, glm::ivec2(1));
+		_pyramidUvScale = glm::vec2(levelSize) / glm::vec2(_pyramidSize);
+
+		_pyramidShader->Bind();
+		GlStateCache::BindTextureUnit(DEPTH_PYRAMID_TEXTURE_SLOT, _depthCopy);
+		glm::ivec2 sourceSize = size;
+		for (int level = 0; level < _pyramidLevels; level++) {
+			glBindImageTexture(0, _pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			glBindImageTexture(1, _pyramid, glm::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+			_pyramidShader->SetUniform(U_LEVEL, level);
+			_pyramidShader->SetUniform(U_SOURCE_SIZE, sourceSize);
+			_pyramidShader->SetUniform(U_DESTINATION_SIZE, levelSize);
+			glDispatchCompute((levelSize.x + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, (levelSize.y + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, 1);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+			sourceSize = levelSize;
+			levelSize = glm::max((levelSize + 1) / 2, glm::ivec2(1));
+		}
+
+		_pyramidViewProjection = viewProjection;
+		_hasPyramid = true;
+	}
+
+	void GpuCuller::RenderImGui() {
+		ImGui::Checkbox("GPU Culling", &Enabled);
+		ImGui::SameLine();
+		ImGui::Checkbox("Depth Pyramid", &UseDepthPyramid);
+		ImGui::Text("GPU Cull:   %d/%d objects visible in %d draws (uploaded in %.2f ms)", Enabled ? _visibleCount.load() : 0, (int)_objectCount, Enabled ? (int)_groups.size() : 0, _bakeTime);
+	}
+
+	void GpuCuller::_Initialize() {
+		if (_cullShader != nullptr) {
+			return;
+		}
+		_cullShader = Shader::Create();
+		_cullShader->LoadShaderPartFromFile("shaders/gpu_cull_comp.glsl", ShaderPartType::Compute);
+		_cullShader->Link();
+
+		_pyramidShader = Shader::Create();
+		_pyramidShader->LoadShaderPartFromFile("shaders/depth_pyramid_comp.glsl", ShaderPartType::Compute);
+		_pyramidShader->Link();
+
+		_hasDrawCount = GLAD_GL_VERSION_4_6 != 0;
+		if (!_hasDrawCount) {
+			LOG_WARN("glMultiDrawElementsIndirectCount is not supported, GPU culled groups will draw every command");
+		}
+	}
+
+	void GpuCuller::_DeleteObjectBuffers() {
+		GLuint* buffers[] = { &_objectBuffer, &_commandBuffer, &_countBuffer, &_objectIndexBuffer, &_readbackBuffer };
+		for (GLuint* buffer : buffers) {
+			if (*buffer != 0) {
+				GlStateCache::OnBufferDeleted(*buffer);
+				glDeleteBuffers(1, buffer);
+				*buffer = 0;
+			}
+		}
+		if (_vao != 0) {
+			GlStateCache::OnVertexArrayDeleted(_vao);
+			glDeleteVertexArrays(1, &_vao);
+			_vao = 0;
+		}
+		if (_readbackFence != nullptr) {
+			glDeleteSync(_readbackFence);
+			_readbackFence = nullptr;
+		}
+	}
+
+	void GpuCuller::_ResizePyramid(const glm::ivec2& size) {
+		if (_depthCopy != 0) {
+			GlStateCache::OnTextureDeleted(_depthCopy);
+			glDeleteTextures(1, &_depthCopy);
+		}
+		if (_pyramid != 0) {
+			GlStateCache::OnTextureDeleted(_pyramid);
+			glDeleteTextures(1, &_pyramid);
+		}
+		if (_depthFramebuffer == 0) {
+			glCreateFramebuffers(1, &_depthFramebuffer);
+		}
+		_depthSize = size;
+
+		// Depth blits need matching formats, which is what our scene targets and the window use
+		glCreateTextures(GL_TEXTURE_2D, 1, &_depthCopy);
+		glTextureStorage2D(_depthCopy, 1, GL_DEPTH24_STENCIL8, size.x, size.y);
+		glTextureParameteri(_depthCopy, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(_depthCopy, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glNamedFramebufferTexture(_depthFramebuffer, GL_DEPTH_STENCIL_ATTACHMENT, _depthCopy, 0);
+
+		// Rounding down means every texel of level 0 covers between 1 and 2 texels of the depth
+		_pyramidSize = glm::ivec2(1);
+		while (_pyramidSize.x * 2 <= size.x) _pyramidSize.x *= 2;
+		while (_pyramidSize.y * 2 <= size.y) _pyramidSize.y *= 2;
+		_pyramidLevels = 1;
+		while ((glm::max(_pyramidSize.x, _pyramidSize.y) >> _pyramidLevels) > 0) {
+			_pyramidLevels++;
+		}
+		glCreateTextures(GL_TEXTURE_2D, 1, &_pyramid);
+		glTextureStorage2D(_pyramid, _pyramidLevels, GL_R32F, _pyramidSize.x, _pyramidSize.y);
+		glTextureParameteri(_pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(_pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(_pyramid, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(_pyramid, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		_hasPyramid = false;
+	}
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Material.h"
+#include "Graphics/Shader.h"
+
+class RenderComponent;
+
+namespace Gameplay {
+	/// <summary>
+	/// Culls the static render components (see RenderComponent::SetStatic) on the GPU, and draws
+	/// whatever survives with one indirect draw call per material, so that the CPU cost of the
+	/// static parts of the scene stays the same no matter how many objects they are made of
+	///
+	/// When baked, the transform, bounds and LODs of every static object whose meshes are in the
+	/// geometry pool are uploaded once. Each frame a compute shader tests every object against
+	/// the camera's frustum, and against a depth pyramid built from the previous frame's depth
+	/// buffer, picks it's LOD, and appends a draw command for it to it's material's range of the
+	/// command buffer. Since the pyramid is a frame behind, objects that come out from behind
+	/// something can show up a frame late
+	///
+	/// Objects must not move, or change their mesh or material, until the next bake. Baking is
+	/// done from the main thread, everything else must be called from the render thread
+	/// </summary>
+	class GpuCuller {
+	public:
+		typedef std::shared_ptr<GpuCuller> Sptr;
+
+		// The shader storage slots that we use, must match gpu_cull_comp.glsl and vertex_shader.glsl
+		static const int OBJECT_SSBO_BINDING_SLOT = 6;
+		static const int COMMAND_SSBO_BINDING_SLOT = 7;
+		static const int COUNT_SSBO_BINDING_SLOT = 8;
+		// The texture slot that the depth pyramid is sampled from
+		static const int DEPTH_PYRAMID_TEXTURE_SLOT = 8;
+		// The vertex attribute that passes each object's index to the vertex shader, must match inObjectIndex
+		static const int OBJECT_INDEX_ATTRIBUTE = 4;
+		// The number of objects each work group of the culling shader tests
+		static const int WORKGROUP_SIZE = 64;
+		// The most LODs we keep for each object, including the full detail mesh
+		static const int MAX_LODS = 4;
+
+		/// <summary>
+		/// The objects that share a material, and the range of the command buffer they are written to
+		/// </summary>
+		struct Group {
+			Material::Sptr DrawMaterial;
+			uint32_t       FirstCommand;
+			uint32_t       ObjectCount;
+		};
+
+		static inline Sptr Create() {
+			return std::make_shared<GpuCuller>();
+		}
+
+		GpuCuller();
+		~GpuCuller();
+
+		GpuCuller(const GpuCuller& other) = delete;
+		GpuCuller& operator=(const GpuCuller& other) = delete;
+
+		// When false, our objects are drawn on the CPU with everything else. This can be toggled at any time
+		bool Enabled;
+		// When false, objects are only tested against the frustum
+		bool UseDepthPyramid;
+
+		/// <summary>
+		/// Throws away our objects, and uploads the static render components of the given objects
+		/// instead. Should be called from the main thread once the objects' transforms are set
+		/// </summary>
+		/// <param name="objects">The objects to search for static render components</param>
+		void Bake(const std::vector<GameObject::Sptr>& objects);
+		/// <summary>
+		/// Forgets all of our objects, and lets them draw on the CPU again
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Gets whether there is anything for us to draw this frame
+		/// </summary>
+		bool IsActive() const { return Enabled && _objectCount > 0; }
+		/// <summary>
+		/// Gets the material groups from the last bake
+		/// </summary>
+		const std::vector<Group>& GetGroups() const { return _groups; }
+
+		/// <summary>
+		/// Tests every object against the camera, and writes the draw commands for the ones that
+		/// are visible. Must be called from the render thread
+		/// </summary>
+		/// <param name="view">The camera's view matrix</param>
+		/// <param name="projection">The camera's projection matrix</param>
+		void Cull(const glm::mat4& view, const glm::mat4& projection);
+		/// <summary>
+		/// Draws the visible objects of one group, must be called from the render thread after Cull.
+		/// The group's material must be applied, with a variant of it's shader that has the
+		/// VERTEX_PULLING and GPU_CULLED keywords enabled
+		/// </summary>
+		/// <param name="group">The index of the group to draw</param>
+		void DrawGroup(size_t group);
+		/// <summary>
+		/// Builds the depth pyramid that the next frame will be tested against, from the depth
+		/// buffer of the framebuffer that is currently bound. Must be called from the render thread
+		/// </summary>
+		/// <param name="viewProjection">The view projection matrix that the depth was rendered with</param>
+		void UpdateDepthPyramid(const glm::mat4& viewProjection);
+
+		/// <summary>
+		/// Draws the ImGui controls for our settings, along with stats from a recent frame
+		/// </summary>
+		void RenderImGui();
+
+	protected:
+		// The data we keep for each object, must match CulledObject in the shaders
+		struct ObjectData {
+			glm::mat4  Model;
+			// The columns of the normal matrix, padded out to vec4s
+			glm::vec4  NormalMatrix[3];
+			// The world space bounding sphere, with the radius in w
+			glm::vec4  Bounds;
+			glm::uvec4 LodIndexCounts;
+			glm::uvec4 LodFirstIndices;
+			int32_t    BaseVertex;
+			uint32_t   LodCount;
+			uint32_t   FirstCommand;
+			uint32_t   Group;
+		};
+		// Laid out the way glMultiDrawElementsIndirect expects
+		struct DrawCommand {
+			uint32_t Count;
+			uint32_t InstanceCount;
+			uint32_t FirstIndex;
+			int32_t  BaseVertex;
+			uint32_t BaseInstance;
+		};
+
+		std::vector<Group> _groups;
+		// The components we marked as GPU culled, so they can be un-marked when we clear
+		std::vector<std::weak_ptr<RenderComponent>> _culledComponents;
+		uint32_t _objectCount;
+
+		// Created on our first bake
+		Shader::Sptr _cullShader;
+		Shader::Sptr _pyramidShader;
+		// Whether glMultiDrawElementsIndirectCount is available (GL 4.6), if it isn't every
+		// command in a group is drawn, and the ones for hidden objects draw nothing
+		bool _hasDrawCount;
+
+		GLuint _objectBuffer;
+		GLuint _commandBuffer;
+		GLuint _countBuffer;
+		// Holds 0 to N-1, read with the command's base instance to tell the vertex shader which object it's drawing
+		GLuint _objectIndexBuffer;
+		// Draws from the geometry pool's index buffer, with the object index as the only attribute
+		GLuint _vao;
+
+		// A copy of the scene's depth, since the framebuffer we render to may not have a depth texture.
+		// Only the bottom left corner covered by the viewport is filled in
+		GLuint     _depthCopy;
+		GLuint     _depthFramebuffer;
+		glm::ivec2 _depthSize;
+		// The farthest depth of each texel, with the largest power of two below the depth size as level 0
+		GLuint     _pyramid;
+		glm::ivec2 _pyramidSize;
+		int        _pyramidLevels;
+		glm::mat4  _pyramidViewProjection;
+		// The fraction of each level that was built from the viewport, the rest is left over from larger viewports
+		glm::vec2  _pyramidUvScale;
+		bool       _hasPyramid;
+
+		// The group counts are copied here, and read back once the GPU is done with them
+		GLuint _readbackBuffer;
+		GLsync _readbackFence;
+		// Stats, written on the render thread and shown on the main thread
+		std::atomic<int> _visibleCount;
+		float _bakeTime;
+
+		// Creates our shaders and buffers that don't depend on the objects, must be called on the render thread
+		void _Initialize();
+		// Deletes the buffers that hold our objects, must be called on the render thread
+		void _DeleteObjectBuffers();
+		// Re-creates the depth copy and pyramid at a new size, must be called on the render thread.
+		// They only ever grow, so that dynamic resolution doesn't re-allocate them every time the scale changes
+		void _ResizePyramid(const glm::ivec2& size);
+	};
+}
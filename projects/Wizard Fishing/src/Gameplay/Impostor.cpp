@@ -0,0 +1,305 @@
+#include "Gameplay/Impostor.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+static constexpr UniformHandle U_VIEW_PROJECTION("u_ViewProjection");
+static constexpr UniformHandle U_CAM_POS("u_CamPos");
+static constexpr UniformHandle U_BOUNDS_CENTER("u_BoundsCenter");
+static constexpr UniformHandle U_BOUNDS_RADIUS("u_BoundsRadius");
+static constexpr UniformHandle U_FRAME_DIRECTION("u_FrameDirection");
+static constexpr UniformHandle U_FRAMES("u_Frames");
+static constexpr UniformHandle U_FIRST_INSTANCE("u_FirstInstance");
+static constexpr UniformHandle U_SHININESS("u_Shininess");
+
+static const uint32_t IMPOSTOR_CACHE_MAGIC = 0x504D4957; // "WIMP"
+static const uint32_t IMPOSTOR_CACHE_VERSION = 1;
+// Mips smaller than this many texels per frame mostly blend neighbouring frames together
+static const int IMPOSTOR_MIN_MIP_SIZE = 8;
+
+// The header at the start of an impostor cache, used to detect if the cache is stale
+struct ImpostorCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Frames;
+	uint32_t FrameSize;
+	uint64_t MeshSize;
+	int64_t  MeshWriteTime;
+	uint64_t TextureSize;
+	int64_t  TextureWriteTime;
+};
+
+// Reads the size and modification time of a source file, so we can tell when a cache is out of date
+static bool GetSourceStamp(const std::string& filename, uint64_t& size, int64_t& writeTime) {
+	std::error_code error;
+	size = std::filesystem::file_size(filename, error);
+	if (error) return false;
+	writeTime = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	return !error;
+}
+
+static bool MakeCacheHeader(const std::string& meshFile, const std::string& textureFile, ImpostorCacheHeader& header) {
+	header.Magic = IMPOSTOR_CACHE_MAGIC;
+	header.Version = IMPOSTOR_CACHE_VERSION;
+	header.Frames = Gameplay::Impostor::FRAMES;
+	header.FrameSize = Gameplay::Impostor::FRAME_SIZE;
+	return GetSourceStamp(meshFile, header.MeshSize, header.MeshWriteTime) &&
+		GetSourceStamp(textureFile, header.TextureSize, header.TextureWriteTime);
+}
+
+// Maps a point on the octahedral grid (0 to 1 on each axis) to a direction on the unit sphere,
+// this must match OctahedralToDirection in impostor_vert.glsl
+static glm::vec3 OctahedralToDirection(const glm::vec2& uv) {
+	glm::vec2 p = uv * 2.0f - 1.0f;
+	glm::vec3 dir = glm::vec3(p.x, p.y, 1.0f - glm::abs(p.x) - glm::abs(p.y));
+	// The bottom half of the sphere is folded over the corners of the grid
+	if (dir.z < 0.0f) {
+		glm::vec2 folded = (1.0f - glm::abs(glm::vec2(dir.y, dir.x))) * glm::sign(glm::vec2(dir.x, dir.y));
+		dir.x = folded.x;
+		dir.y = folded.y;
+	}
+	return glm::normalize(dir);
+}
+
+// Gets the axes of the image plane for a view from the given direction, must match GetFrameBasis in impostor_vert.glsl
+static void GetFrameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up) {
+	glm::vec3 reference = glm::abs(dir.z) > 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+	right = glm::normalize(glm::cross(reference, dir));
+	up = glm::cross(dir, right);
+}
+
+namespace Gameplay {
+	bool Impostor::Enabled = true;
+	float Impostor::SwitchDistance = 30.0f;
+
+	Impostor::Impostor() :
+		BoundsCenter(glm::vec3(0.0f)),
+		BoundsRadius(0.0f),
+		Shininess(0.0f),
+		_albedo(nullptr),
+		_normalDepth(nullptr)
+	{ }
+
+	Impostor::Sptr Impostor::Get(const MeshResource::Sptr& mesh, const Material::Sptr& material) {
+		if (mesh == nullptr || mesh->Mesh == nullptr || mesh->BoundsRadius <= 0.0f || material == nullptr || material->Texture == nullptr) {
+			return nullptr;
+		}
+
+		auto key = std::make_pair(mesh.get(), material.get());
+		auto it = __Impostors.find(key);
+		if (it != __Impostors.end()) {
+			return it->second;
+		}
+
+		Sptr result = std::make_shared<Impostor>();
+		result->BoundsCenter = mesh->BoundsCenter;
+		result->BoundsRadius = mesh->BoundsRadius;
+		result->Shininess = material->Shininess;
+
+		// The cache is named after the texture as well, since the same mesh may be drawn with different materials
+		std::string cachePath;
+		ImpostorCacheHeader header;
+		const std::string& textureFile = material->Texture->GetDescription().Filename;
+		if (!mesh->Filename.empty() && !textureFile.empty() && MakeCacheHeader(mesh->Filename, textureFile, header)) {
+			cachePath = mesh->Filename + "." + std::filesystem::path(textureFile).stem().string() + ".impostor";
+		}
+
+		// Read the cache here, so the render thread only has to upload it
+		size_t atlasBytes = (size_t)FRAMES * FRAME_SIZE * FRAMES * FRAME_SIZE * 4;
+		std::vector<uint8_t> albedo;
+		std::vector<uint8_t> normalDepth;
+		bool fromCache = false;
+		if (!cachePath.empty()) {
+			std::ifstream file(cachePath, std::ios::binary);
+			ImpostorCacheHeader cached;
+			if (file && file.read(reinterpret_cast<char*>(&cached), sizeof(ImpostorCacheHeader)) && memcmp(&cached, &header, sizeof(ImpostorCacheHeader)) == 0) {
+				albedo.resize(atlasBytes);
+				normalDepth.resize(atlasBytes);
+				file.read(reinterpret_cast<char*>(albedo.data()), atlasBytes);
+				file.read(reinterpret_cast<char*>(normalDepth.data()), atlasBytes);
+				fromCache = (bool)file;
+			}
+		}
+
+		RenderThread::Invoke([&]() {
+			if (__Shader == nullptr) {
+				__Shader = Shader::Create();
+				__Shader->LoadShaderPartFromFile("shaders/impostor_vert.glsl", ShaderPartType::Vertex);
+				__Shader->LoadShaderPartFromFile("shaders/impostor_frag.glsl", ShaderPartType::Fragment);
+				__Shader->Link();
+
+				__BakeShader = Shader::Create();
+				__BakeShader->LoadShaderPartFromFile("shaders/impostor_bake_vert.glsl", ShaderPartType::Vertex);
+				__BakeShader->LoadShaderPartFromFile("shaders/impostor_bake_frag.glsl", ShaderPartType::Fragment);
+				__BakeShader->Link();
+
+				__InstanceBuffer = ShaderStorageBuffer::Create();
+				glCreateVertexArrays(1, &__Vao);
+			}
+
+			result->_CreateTextures();
+			if (fromCache) {
+				int atlasSize = FRAMES * FRAME_SIZE;
+				result->_albedo->LoadData(atlasSize, atlasSize, PixelFormat::RGBA, PixelType::UByte, albedo.data());
+				result->_normalDepth->LoadData(atlasSize, atlasSize, PixelFormat::RGBA, PixelType::UByte, normalDepth.data());
+			} else {
+				result->_Bake(mesh, material);
+				if (!cachePath.empty()) {
+					albedo.resize(atlasBytes);
+					normalDepth.resize(atlasBytes);
+					glPixelStorei(GL_PACK_ALIGNMENT, 1);
+					glGetTextureImage(result->_albedo->GetHandle(), 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)atlasBytes, albedo.data());
+					glGetTextureImage(result->_normalDepth->GetHandle(), 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)atlasBytes, normalDepth.data());
+				}
+			}
+		});
+
+		if (!fromCache && !cachePath.empty()) {
+			std::ofstream file(cachePath, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(ImpostorCacheHeader));
+			file.write(reinterpret_cast<const char*>(albedo.data()), albedo.size());
+			file.write(reinterpret_cast<const char*>(normalDepth.data()), normalDepth.size());
+			if (!file) {
+				LOG_WARN("Failed to write impostor cache \"{}\"", cachePath);
+			}
+		}
+		LOG_INFO("{} impostor for \"{}\"", fromCache ? "Loaded" : "Baked", mesh->Filename.empty() ? "Generated" : mesh->Filename);
+
+		__Impostors[key] = result;
+		return result;
+	}
+
+	void Impostor::Uninitialize() {
+		RenderThread::Invoke([]() {
+			__Impostors.clear();
+			__Shader = nullptr;
+			__BakeShader = nullptr;
+			__InstanceBuffer = nullptr;
+			if (__Vao != 0) {
+				GlStateCache::OnVertexArrayDeleted(__Vao);
+				glDeleteVertexArrays(1, &__Vao);
+				__Vao = 0;
+			}
+		});
+	}
+
+	void Impostor::_CreateTextures() {
+		Texture2DDescription description;
+		description.Width = FRAMES * FRAME_SIZE;
+		description.Height = FRAMES * FRAME_SIZE;
+		description.Format = InternalFormat::RGBA8;
+		description.HorizontalWrap = WrapMode::ClampToEdge;
+		description.VerticalWrap = WrapMode::ClampToEdge;
+		description.MinificationFilter = MinFilter::LinearMipLinear;
+		description.MagnificationFilter = MagFilter::Linear;
+		description.MaxAnisotropic = 1.0f;
+		description.GenerateMipMaps = true;
+		_albedo = std::make_shared<Texture2D>(description);
+		_normalDepth = std::make_shared<Texture2D>(description);
+
+		int maxLevel = (int)glm::log2((float)(FRAME_SIZE / IMPOSTOR_MIN_MIP_SIZE));
+		glTextureParameteri(_albedo->GetHandle(), GL_TEXTURE_MAX_LEVEL, maxLevel);
+		glTextureParameteri(_normalDepth->GetHandle(), GL_TEXTURE_MAX_LEVEL, maxLevel);
+	}
+
+	void Impostor::_Bake(const MeshResource::Sptr& mesh, const Material::Sptr& material) {
+		int atlasSize = FRAMES * FRAME_SIZE;
+
+		GLuint framebuffer, depth;
+		glCreateFramebuffers(1, &framebuffer);
+		glCreateRenderbuffers(1, &depth);
+		glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, _albedo->GetHandle(), 0);
+		glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT1, _normalDepth->GetHandle(), 0);
+		glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+		const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glNamedFramebufferDrawBuffers(framebuffer, 2, drawBuffers);
+
+		// Empty texels have a flat normal and sit on the back of the bounds, but are fully transparent
+		const float clearAlbedo[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const float clearNormalDepth[] = { 0.5f, 0.5f, 1.0f, 0.0f };
+		const float clearDepth = 1.0f;
+		glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clearAlbedo);
+		glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, clearNormalDepth);
+		glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &clearDepth);
+
+		GLint previousFramebuffer = 0;
+		GLint previousViewport[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+
+		// Alpha goes straight into the atlas, and thin geometry (ex: leaves) should show from both sides
+		GlStateCache::SetBlendEnabled(false);
+		GlStateCache::SetCullEnabled(false);
+
+		__BakeShader->Bind();
+		__BakeShader->SetUniform(U_BOUNDS_CENTER, BoundsCenter);
+		__BakeShader->SetUniform(U_BOUNDS_RADIUS, BoundsRadius);
+		// The bake samples the texture at full size, so any levels that haven't been streamed in are loaded now
+		material->Texture->MakeResident();
+		material->Texture->Bind(1);
+
+		// Frames sit on the corners of the octahedral grid, so the outer rows land exactly on it's edges
+		float radius = BoundsRadius;
+		glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, radius * 3.0f);
+		for (int y = 0; y < FRAMES; y++) {
+			for (int x = 0; x < FRAMES; x++) {
+				glm::vec3 direction = OctahedralToDirection(glm::vec2(x, y) / (float)(FRAMES - 1));
+				glm::vec3 right, up;
+				GetFrameBasis(direction, right, up);
+				glm::mat4 view = glm::lookAt(BoundsCenter + direction * radius * 2.0f, BoundsCenter, up);
+
+				glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+				__BakeShader->SetUniformMatrix(U_VIEW_PROJECTION, projection * view);
+				__BakeShader->SetUniform(U_FRAME_DIRECTION, direction);
+				mesh->Mesh->Draw();
+			}
+		}
+
+		GlStateCache::SetBlendEnabled(true);
+		GlStateCache::SetCullEnabled(true);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &depth);
+
+		glGenerateTextureMipmap(_albedo->GetHandle());
+		glGenerateTextureMipmap(_normalDepth->GetHandle());
+	}
+
+	void Impostor::DrawBatches(const std::vector<Batch>& batches, const std::vector<glm::mat4>& instances,
+		const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+	{
+		if (batches.empty() || __Shader == nullptr) {
+			return;
+		}
+
+		__InstanceBuffer->LoadData(instances.data(), instances.size());
+		__InstanceBuffer->Bind(INSTANCE_SSBO_BINDING_SLOT);
+
+		int frames = FRAMES;
+		__Shader->Bind();
+		__Shader->SetUniformMatrix(U_VIEW_PROJECTION, viewProjection);
+		__Shader->SetUniform(U_CAM_POS, cameraPosition);
+		__Shader->SetUniform(U_FRAMES, frames);
+		GlStateCache::BindVertexArray(__Vao);
+
+		for (const Batch& batch : batches) {
+			int firstInstance = (int)batch.FirstInstance;
+			__Shader->SetUniform(U_BOUNDS_CENTER, batch.Source->BoundsCenter);
+			__Shader->SetUniform(U_BOUNDS_RADIUS, batch.Source->BoundsRadius);
+			__Shader->SetUniform(U_SHININESS, batch.Source->Shininess);
+			__Shader->SetUniform(U_FIRST_INSTANCE, firstInstance);
+			GlStateCache::BindTextureUnit(1, batch.Source->_albedo->GetHandle());
+			GlStateCache::BindTextureUnit(2, batch.Source->_normalDepth->GetHandle());
+			// Each impostor is a single quad, built from gl_VertexID in the vertex shader
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)batch.InstanceCount);
+		}
+	}
+}
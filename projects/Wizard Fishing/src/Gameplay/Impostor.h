@@ -0,0 +1,114 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <map>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/MeshResource.h"
+#include "Gameplay/Material.h"
+#include "Graphics/Texture2D.h"
+#include "Graphics/Shader.h"
+#include "Graphics/ShaderStorageBuffer.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// A pre-rendered stand in for a mesh, drawn as a single camera facing quad when the mesh is
+	/// far enough away that it's triangles would only cover a few pixels
+	///
+	/// The mesh is rendered with an orthographic camera from FRAMES x FRAMES directions spread
+	/// over a sphere with an octahedral mapping, into an atlas of albedo (with alpha) and of model
+	/// space normals (with depth in alpha). When drawing, the three frames closest to the view
+	/// direction are blended, and the depth is used to push the quad's pixels back out to the
+	/// mesh's surface so the impostor intersects the ground and lighting properly
+	///
+	/// Atlases are saved next to the mesh's file (as .impostor), and are re-baked when the mesh
+	/// changes. Impostors are shared between every object with the same mesh and material, see Get
+	/// </summary>
+	class Impostor {
+	public:
+		typedef std::shared_ptr<Impostor> Sptr;
+
+		// The number of views along each side of the atlas
+		static const int FRAMES = 8;
+		// The size of each view in the atlas, in pixels
+		static const int FRAME_SIZE = 128;
+		// The shader storage slot for the instance transforms, must match b_ImpostorInstances
+		static const int INSTANCE_SSBO_BINDING_SLOT = 5;
+
+		/// <summary>
+		/// Global toggle for impostors, when false objects always draw their meshes
+		/// </summary>
+		static bool Enabled;
+		/// <summary>
+		/// Objects further than this from the camera (in world units) draw their impostor instead
+		/// of their mesh
+		/// </summary>
+		static float SwitchDistance;
+
+		/// <summary>
+		/// A run of instances that all draw the same impostor
+		/// </summary>
+		struct Batch {
+			Sptr     Source;
+			uint32_t FirstInstance;
+			uint32_t InstanceCount;
+		};
+
+		/// <summary>
+		/// Gets the impostor for a mesh drawn with a material, loading or baking it the first time
+		/// the pair is used. Must be called from the main thread, the baking is done on the render thread
+		/// </summary>
+		/// <returns>The impostor, or nullptr if the mesh isn't loaded or the material has no texture</returns>
+		static Sptr Get(const MeshResource::Sptr& mesh, const Material::Sptr& material);
+		/// <summary>
+		/// Releases all of the impostors that are not in use, along with the shaders and buffers
+		/// used to draw them
+		/// </summary>
+		static void Uninitialize();
+
+		/// <summary>
+		/// Draws a list of impostor batches with depth testing, must be called from the render thread
+		/// </summary>
+		/// <param name="batches">The batches to draw</param>
+		/// <param name="instances">The model matrices that the batches refer to</param>
+		/// <param name="viewProjection">The camera's view projection matrix</param>
+		/// <param name="cameraPosition">The camera's position in world space</param>
+		static void DrawBatches(const std::vector<Batch>& batches, const std::vector<glm::mat4>& instances,
+			const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+		Impostor(const Impostor& other) = delete;
+		Impostor& operator=(const Impostor& other) = delete;
+
+		Impostor();
+
+		/// <summary>
+		/// The model space bounding sphere of the mesh, the quad is sized to fit it
+		/// </summary>
+		glm::vec3 BoundsCenter;
+		float     BoundsRadius;
+		/// <summary>
+		/// Copied from the material when the impostor is baked
+		/// </summary>
+		float     Shininess;
+
+		const Texture2D::Sptr& GetAlbedo() const { return _albedo; }
+		const Texture2D::Sptr& GetNormalDepth() const { return _normalDepth; }
+
+	protected:
+		Texture2D::Sptr _albedo;
+		Texture2D::Sptr _normalDepth;
+
+		// Creates our atlas textures, must be called on the render thread
+		void _CreateTextures();
+		// Renders the mesh into our atlases, must be called on the render thread
+		void _Bake(const MeshResource::Sptr& mesh, const Material::Sptr& material);
+
+		// Every impostor we've made, keyed by the mesh and material they were made from
+		inline static std::map<std::pair<MeshResource*, Material*>, Sptr> __Impostors;
+		inline static Shader::Sptr              __Shader = nullptr;
+		inline static Shader::Sptr              __BakeShader = nullptr;
+		inline static ShaderStorageBuffer::Sptr __InstanceBuffer = nullptr;
+		// An empty VAO, since the quads are built in the vertex shader
+		inline static GLuint                    __Vao = 0;
+	};
+}
@@ -1,20 +1,151 @@
 #include "Gameplay/Material.h"
 #include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/ImGuiHelper.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+#include <algorithm>
 
 namespace Gameplay {
+	// The texture slots that materials draw their textures from, these must match the
+	// sampler bindings in our shaders
+	static const int DIFFUSE_SLOT = 1;
+	static const int DIFFUSE_ATLAS_SLOT = 2;
+
+	bool Material::TextureArraysEnabled = true;
+
+	void Material::SubmitChanges() {
+		if (_ubo == nullptr) {
+			// This only happens the first time a material is drawn, so it's fine to wait on the render thread
+			RenderThread::Invoke([this]() {
+				_ubo = std::make_shared<UniformBuffer<MaterialUboStruct>>();
+			});
+			_isDirty = true;
+		}
+
+		// Only re-upload our parameters when they have been edited, most frames this is skipped entirely
+		bool useAtlas = TextureArraysEnabled && Atlas != nullptr;
+		if (_isDirty || useAtlas != _isUsingAtlas) {
+			// Keywords the renderer owns are left out, even if an older manifest saved them
+			_keywordMask = MatShader != nullptr ? MatShader->GetKeywordMask(Keywords) & ~MatShader->GetEngineKeywordMask() : 0;
+
+			MaterialUboStruct data;
+			data.Shininess = Shininess;
+			data.AtlasLayer = useAtlas ? AtlasLayer : -1;
+
+			// The render thread may still be drawing with the old values, so send a copy along
+			UniformBuffer<MaterialUboStruct>::Sptr ubo = _ubo;
+			RenderThread::Enqueue([ubo, data]() {
+				ubo->SetData(data);
+			});
+
+			_isDirty = false;
+			_isUsingAtlas = useAtlas;
+		}
+	}
+
 	void Material::Apply() {
-		// Material properties
-		MatShader->SetUniform("u_Material.Shininess", Shininess);
+		if (_ubo == nullptr) {
+			LOG_WARN("Material \"{}\" was applied before SubmitChanges was called", Name);
+			return;
+		}
+		_ubo->Bind(MATERIAL_UBO_BINDING_SLOT);
 
-		// For textures, we pass the *slot* that the texture sure draw from
-		MatShader->SetUniform("u_Material.Diffuse", 1);
+		// The UBO's copy of our data is only written on the render thread, so it tells us whether
+		// this frame was submitted using the texture array. If it was, the array stays bound
+		// between materials and the state cache will skip re-binding it
+		if (_ubo->GetData().AtlasLayer >= 0 && Atlas != nullptr) {
+			Atlas->Bind(DIFFUSE_ATLAS_SLOT);
+		} else if (Texture != nullptr) {
+			Texture->Bind(DIFFUSE_SLOT);
+		}
+	}
 
-		// Bind the texture
-		if (Texture != nullptr) { 
-			Texture->Bind(1);
+	void Material::RequestTextureSize(float screenSize) const {
+		if (Texture != nullptr && !(TextureArraysEnabled && Atlas != nullptr)) {
+			Texture->RequestScreenSize(screenSize);
 		}
 	}
 
+	void Material::RenderImGui() {
+		_isDirty |= LABEL_LEFT(ImGui::DragFloat, "Shininess", &Shininess, 0.1f, 0.0f, 1000.0f);
+		if (MatShader != nullptr) {
+			const std::vector<std::string>& keywords = MatShader->GetKeywords();
+			for (size_t ix = 0; ix < keywords.size(); ix++) {
+				// The renderer turns these on itself, so they aren't ours to toggle
+				if (MatShader->GetEngineKeywordMask() & (1u << (uint32_t)ix)) {
+					continue;
+				}
+				const std::string& keyword = keywords[ix];
+				auto it = std::find(Keywords.begin(), Keywords.end(), keyword);
+				bool enabled = it != Keywords.end();
+				if (ImGui::Checkbox(keyword.c_str(), &enabled)) {
+					if (enabled) {
+						Keywords.push_back(keyword);
+					} else {
+						Keywords.erase(it);
+					}
+					_isDirty = true;
+				}
+			}
+		}
+		if (Atlas != nullptr) {
+			ImGui::Text("Atlas Layer: %d / %d", AtlasLayer, Atlas->GetLayerCount());
+		}
+	}
+
+	int Material::BuildTextureArrays(const std::vector<Material::Sptr>& materials) {
+		// Find every unique texture, and forget about any arrays from a previous build
+		std::vector<Texture2D::Sptr> textures;
+		for (const Material::Sptr& material : materials) {
+			if (material == nullptr) continue;
+			material->Atlas = nullptr;
+			material->AtlasLayer = -1;
+			material->MarkDirty();
+			if (material->Texture != nullptr && std::find(textures.begin(), textures.end(), material->Texture) == textures.end()) {
+				textures.push_back(material->Texture);
+			}
+		}
+
+		// Sort the textures into groups that can share an array
+		std::vector<TextureArrayAtlas::Sptr> atlases;
+		for (const Texture2D::Sptr& texture : textures) {
+			bool added = false;
+			for (const TextureArrayAtlas::Sptr& atlas : atlases) {
+				if (atlas->AddTexture(texture) != -1) {
+					added = true;
+					break;
+				}
+			}
+			if (!added) {
+				TextureArrayAtlas::Sptr atlas = TextureArrayAtlas::Create();
+				if (atlas->AddTexture(texture) != -1) {
+					atlases.push_back(atlas);
+				}
+			}
+		}
+
+		int result = 0;
+		for (const TextureArrayAtlas::Sptr& atlas : atlases) {
+			// A lone texture doesn't save us any binds, so leave it as a regular texture
+			if (atlas->GetLayerCount() < 2 || !atlas->Build()) {
+				continue;
+			}
+			result++;
+
+			for (const Material::Sptr& material : materials) {
+				if (material == nullptr) continue;
+				int layer = atlas->GetLayer(material->Texture);
+				if (layer != -1) {
+					material->Atlas = atlas;
+					material->AtlasLayer = layer;
+					material->MarkDirty();
+				}
+			}
+		}
+		return result;
+	}
+
 	Material::Sptr Material::FromJson(const nlohmann::json& data) {
 		Material::Sptr result = std::make_shared<Material>();
 		result->OverrideGUID(Guid(data["guid"]));
@@ -24,10 +155,21 @@ namespace Gameplay {
 		// material specific parameters
 		result->Texture = ResourceManager::Get<Texture2D>(Guid(data["texture"]));
 		result->Shininess = data["shininess"].get<float>();
+		// Older manifests were saved before materials had keywords
+		if (data.contains("keywords")) {
+			result->Keywords = data["keywords"].get<std::vector<std::string>>();
+		}
 		return result;
 	}
 
 	nlohmann::json Material::ToJson() const { 
+		// Don't save keywords the renderer owns, so they drop out of manifests saved before they were
+		std::vector<std::string> keywords;
+		for (const std::string& keyword : Keywords) {
+			if (MatShader == nullptr || (MatShader->GetKeywordMask({ keyword }) & MatShader->GetEngineKeywordMask()) == 0) {
+				keywords.push_back(keyword);
+			}
+		}
 		return {
 			{ "guid", GetGUID().str() },
 			{ "name", Name },
@@ -35,6 +177,7 @@ namespace Gameplay {
 
 			{ "texture", Texture ? Texture->IResource::GetGUID().str() : "null" },
 			{ "shininess", Shininess },
+			{ "keywords", keywords },
 		};
 	}
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 #include <memory>
+#include <vector>
 #include "Graphics/Texture2D.h"
+#include "Graphics/TextureArrayAtlas.h"
 #include "Graphics/Shader.h"
+#include "Graphics/UniformBuffer.h"
+
+// The uniform buffer slot that the active material's parameters are bound to, must match the b_Material block
+const int MATERIAL_UBO_BINDING_SLOT = 1;
 
 namespace Gameplay {
 	/// <summary>
@@ -19,6 +25,11 @@ namespace Gameplay {
 		/// The shader that the material is using
 		/// </summary>
 		Shader::Sptr    MatShader;
+		/// <summary>
+		/// The shader keywords this material enables (ex: MORPH), which pick the variant of MatShader
+		/// that it draws with. Call MarkDirty after changing these on a material that has already been drawn
+		/// </summary>
+		std::vector<std::string> Keywords;
 
 		/// <summary>
 		/// Material shader parameters
@@ -26,15 +37,61 @@ namespace Gameplay {
 		Texture2D::Sptr Texture;
 		/// <summary>
 		/// How reflective the material is, between 0 and 256, controls specular power
+		/// Call MarkDirty after changing this on a material that has already been drawn
 		/// </summary>
 		float           Shininess;
 
 		/// <summary>
-		/// Handles applying this material's state to the OpenGL pipeline
-		/// Will bind the shader, update material uniforms, and bind textures
+		/// The texture array that Texture has been packed into, or nullptr if it has not been packed.
+		/// This is generated at load time by BuildTextureArrays, and is not saved
+		/// </summary>
+		TextureArrayAtlas::Sptr Atlas = nullptr;
+		/// <summary>
+		/// The layer within Atlas that holds our texture
+		/// </summary>
+		int             AtlasLayer = -1;
+
+		/// <summary>
+		/// When true, materials that have been packed into a texture array will sample from the array
+		/// instead of binding their own texture, so that switching between them only changes a uniform
+		/// </summary>
+		static bool TextureArraysEnabled;
+
+		/// <summary>
+		/// Sends this material's parameters to it's uniform buffer if they have changed. Call from
+		/// the main thread before the material is drawn, the upload itself happens on the render thread
+		/// </summary>
+		void SubmitChanges();
+
+		/// <summary>
+		/// Handles applying this material's state to the OpenGL pipeline by binding our uniform
+		/// buffer and textures. Must be called from the render thread, after SubmitChanges
 		/// </summary>
 		virtual void Apply();
 
+		/// <summary>
+		/// Tells the texture streamer how large something drawn with this material is on screen this
+		/// frame, so it can stream in enough of our texture. Does nothing while we are drawing from a
+		/// texture array, since the array has it's own copy. Safe to call from any thread
+		/// </summary>
+		/// <param name="screenSize">The fraction of the screen's height covered, see RenderComponent::GetScreenSize</param>
+		void RequestTextureSize(float screenSize) const;
+
+		/// <summary>
+		/// Flags the material's parameters as changed, so they will be re-uploaded on the next SubmitChanges
+		/// </summary>
+		void MarkDirty() { _isDirty = true; }
+
+		/// <summary>
+		/// Gets the mask for our keywords in MatShader, as of the last SubmitChanges
+		/// </summary>
+		uint32_t GetKeywordMask() const { return _keywordMask; }
+
+		/// <summary>
+		/// Draws the ImGui controls for editing this material's parameters
+		/// </summary>
+		void RenderImGui();
+
 		/// <summary>
 		/// Loads a material from a JSON blob
 		/// </summary>
@@ -44,5 +101,32 @@ namespace Gameplay {
 		/// Converts this material into it's JSON representation for storage
 		/// </summary>
 		nlohmann::json ToJson() const;
+
+		/// <summary>
+		/// Groups the textures of the given materials by size, format and sampler settings, and packs
+		/// every group with more than one texture into a texture array. Each material's Atlas and
+		/// AtlasLayer are updated to point at where their texture ended up
+		/// </summary>
+		/// <param name="materials">The materials to pack, materials without textures are skipped</param>
+		/// <returns>The number of texture arrays that were created</returns>
+		static int BuildTextureArrays(const std::vector<Material::Sptr>& materials);
+
+	protected:
+		/// <summary>
+		/// The layout of the b_Material block in our shaders (std140)
+		/// </summary>
+		struct MaterialUboStruct {
+			float Shininess;
+			// The layer in the diffuse texture array to sample, or -1 to use the regular texture
+			int   AtlasLayer;
+		};
+
+		// Created on our first SubmitChanges, so materials can be made before GL is ready
+		UniformBuffer<MaterialUboStruct>::Sptr _ubo = nullptr;
+		bool _isDirty = true;
+		// Looking the keywords up by name is too slow to do per draw, so it's done when we're dirty
+		uint32_t _keywordMask = 0;
+		// Whether the submitted data was using the texture array, lets us catch TextureArraysEnabled toggling
+		bool _isUsingAtlas = false;
 	};
 }
\ No newline at end of file
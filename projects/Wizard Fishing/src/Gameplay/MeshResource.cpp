@@ -1,7 +1,105 @@
 #include "MeshResource.h"
 #include <filesystem>
+#include <fstream>
+#include <limits>
+#include <GLFW/glfw3.h>
 
 #include "Utils/ObjLoader.h"
+#include "Utils/MeshSimplifier.h"
+#include "Utils/MeshOptimizer.h"
+#include "Graphics/GeometryPool.h"
+#include "Logging.h"
+
+// Identifies our binary LOD cache files, bump the version whenever the layout, the simplifier or the optimizer changes
+static const uint32_t LOD_CACHE_MAGIC = 0x444F4C57; // "WLOD"
+static const uint32_t LOD_CACHE_VERSION = 2;
+
+// Flags for how the cached mesh was processed, so changing a mesh's settings invalidates the cache
+static const uint32_t LOD_CACHE_HAS_LODS = 1 << 0;
+static const uint32_t LOD_CACHE_OPTIMIZED = 1 << 1;
+
+// The header at the start of a LOD cache, used to detect if the cache is stale
+struct LodCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Flags;
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+	uint32_t VertexCount;
+	uint32_t LodCount;
+};
+
+// Reads the size and modification time of the source mesh, so we can tell when a cache is out of date
+static bool GetSourceStamp(const std::string& filename, uint64_t& size, int64_t& writeTime) {
+	std::error_code error;
+	size = std::filesystem::file_size(filename, error);
+	if (error) return false;
+	writeTime = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	return !error;
+}
+
+static bool ReadLodCache(const std::string& filename, uint32_t flags, std::vector<VertexPosNormTexCol>& vertices, std::vector<std::vector<uint32_t>>& lods) {
+	uint64_t sourceSize; int64_t sourceTime;
+	if (!GetSourceStamp(filename, sourceSize, sourceTime)) {
+		return false;
+	}
+
+	std::ifstream file(filename + ".lodcache", std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	LodCacheHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(LodCacheHeader));
+	if (!file || header.Magic != LOD_CACHE_MAGIC || header.Version != LOD_CACHE_VERSION || header.Flags != flags ||
+		header.SourceSize != sourceSize || header.SourceWriteTime != sourceTime ||
+		header.LodCount == 0 || header.LodCount > Gameplay::MeshResource::MAX_LODS) {
+		return false;
+	}
+
+	vertices.resize(header.VertexCount);
+	file.read(reinterpret_cast<char*>(vertices.data()), sizeof(VertexPosNormTexCol) * vertices.size());
+	lods.resize(header.LodCount);
+	for (auto& lod : lods) {
+		uint32_t indexCount = 0;
+		file.read(reinterpret_cast<char*>(&indexCount), sizeof(uint32_t));
+		if (!file) return false;
+		lod.resize(indexCount);
+		file.read(reinterpret_cast<char*>(lod.data()), sizeof(uint32_t) * lod.size());
+	}
+	return (bool)file;
+}
+
+static void WriteLodCache(const std::string& filename, uint32_t flags, const std::vector<VertexPosNormTexCol>& vertices, const std::vector<std::vector<uint32_t>>& lods) {
+	LodCacheHeader header;
+	header.Magic = LOD_CACHE_MAGIC;
+	header.Version = LOD_CACHE_VERSION;
+	header.Flags = flags;
+	header.VertexCount = (uint32_t)vertices.size();
+	header.LodCount = (uint32_t)lods.size();
+	if (!GetSourceStamp(filename, header.SourceSize, header.SourceWriteTime)) {
+		return;
+	}
+
+	std::ofstream file(filename + ".lodcache", std::ios::binary | std::ios::trunc);
+	if (!file) {
+		LOG_WARN("Failed to write LOD cache for \"{}\"", filename);
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(LodCacheHeader));
+	file.write(reinterpret_cast<const char*>(vertices.data()), sizeof(VertexPosNormTexCol) * vertices.size());
+	for (const auto& lod : lods) {
+		uint32_t indexCount = (uint32_t)lod.size();
+		file.write(reinterpret_cast<const char*>(&indexCount), sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(lod.data()), sizeof(uint32_t) * lod.size());
+	}
+}
+
+// Keeps a copy of a generated mesh in the geometry pool, so it can also be drawn with vertex pulling
+static void AddBuiltMeshToPool(const VertexArrayObject::Sptr& vao, const MeshBuilder<VertexPosNormTexCol>& mesh) {
+	vao->SetPooledMesh(GeometryPool::Get().Add(mesh.GetVertexDataPtr(), mesh.GetVertexCount(),
+		mesh.GetIndexCount() > 0 ? mesh.GetIndexDataPtr() : nullptr, mesh.GetIndexCount()));
+}
 
 namespace Gameplay {
 	MeshResource::MeshResource() :
@@ -9,17 +107,35 @@ namespace Gameplay {
 		Filename(""),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Lods(std::vector<VertexArrayObject::Sptr>()),
+		UseLods(false),
+		Optimize(false),
+		BoundsCenter(glm::vec3(0.0f)),
+		BoundsRadius(0.0f),
+		BulletTriMesh(nullptr),
+		_occluderTriangles(std::vector<glm::vec3>()),
+		_hasOccluderTriangles(false)
 	{ }
 
-	MeshResource::MeshResource(const std::string& filename) :
+	MeshResource::MeshResource(const std::string& filename, bool generateLods, bool optimize) :
 		IResource(),
 		Filename(filename),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Lods(std::vector<VertexArrayObject::Sptr>()),
+		UseLods(generateLods),
+		Optimize(optimize),
+		BoundsCenter(glm::vec3(0.0f)),
+		BoundsRadius(0.0f),
+		BulletTriMesh(nullptr),
+		_occluderTriangles(std::vector<glm::vec3>()),
+		_hasOccluderTriangles(false)
 	{
-		Mesh = ObjLoader::LoadFromFile(filename);
+		if (UseLods || Optimize) {
+			_LoadProcessed();
+		} else {
+			_LoadFromFile();
+		}
 	}
 
 	MeshResource::~MeshResource() = default;
@@ -35,6 +151,8 @@ namespace Gameplay {
 			result["params"] = params;
 		} else {
 			result["filename"] = Filename.empty() ? "null" : Filename;
+			result["lods"] = UseLods;
+			result["optimize"] = Optimize;
 		}
 		return result;
 	}
@@ -51,15 +169,16 @@ namespace Gameplay {
 				MeshFactory::AddParameterized(mesh, p);
 			}
 			result->Mesh = mesh.Bake();
+			AddBuiltMeshToPool(result->Mesh, mesh);
+			result->_CalculateBounds(mesh.GetVertexDataPtr(), mesh.GetVertexCount());
 		} else {
 			result->Filename = JsonGet<std::string>(blob, "filename", "null");
-			if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
-				#ifdef OPTIMIZED_OBJ_LOADER
-				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename);
-				#else
-				result->Mesh = ObjLoader::LoadFromFile(result->Filename);
-				#endif
-
+			result->UseLods = JsonGet(blob, "lods", false);
+			result->Optimize = JsonGet(blob, "optimize", false);
+			if (result->Filename != "null" && std::filesystem::exists(result->Filename) && (result->UseLods || result->Optimize)) {
+				result->_LoadProcessed();
+			} else if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
+				result->_LoadFromFile();
 			}
 		}
 		return result;
@@ -71,9 +190,230 @@ namespace Gameplay {
 			MeshFactory::AddParameterized(mesh, param);
 		}
 		Mesh = mesh.Bake();
+		AddBuiltMeshToPool(Mesh, mesh);
+		_CalculateBounds(mesh.GetVertexDataPtr(), mesh.GetVertexCount());
+		_hasOccluderTriangles = false;
 	}
 
 	void MeshResource::AddParam(const MeshBuilderParam & param) {
 		MeshBuilderParams.push_back(param);
 	}
+
+	const VertexArrayObject::Sptr& MeshResource::GetLod(int lod) const {
+		if (lod <= 0 || Lods.empty()) {
+			return Mesh;
+		}
+		return Lods[glm::min(lod, (int)Lods.size()) - 1];
+	}
+
+	const std::vector<glm::vec3>& MeshResource::GetOccluderTriangles() {
+		if (_hasOccluderTriangles) {
+			return _occluderTriangles;
+		}
+		// Only try once, even if we fail, so a missing file doesn't get re-loaded every frame
+		_hasOccluderTriangles = true;
+		_occluderTriangles.clear();
+
+		// We don't keep vertex data around after it's uploaded, so we need to rebuild it
+		std::vector<glm::vec3> rawPositions;
+		if (!MeshBuilderParams.empty()) {
+			MeshBuilder<VertexPosNormTexCol> mesh;
+			for (auto& param : MeshBuilderParams) {
+				MeshFactory::AddParameterized(mesh, param);
+			}
+			const VertexPosNormTexCol* vertices = mesh.GetVertexDataPtr();
+			if (mesh.GetIndexCount() > 0) {
+				const uint32_t* indices = mesh.GetIndexDataPtr();
+				for (size_t ix = 0; ix < mesh.GetIndexCount(); ix++) {
+					rawPositions.push_back(vertices[indices[ix]].Position);
+				}
+			} else {
+				for (size_t ix = 0; ix < mesh.GetVertexCount(); ix++) {
+					rawPositions.push_back(vertices[ix].Position);
+				}
+			}
+		} else if (!Filename.empty()) {
+			std::vector<VertexPosNormTexCol> vertices;
+			if (ObjLoader::LoadVertices(Filename, vertices)) {
+				rawPositions.reserve(vertices.size());
+				for (const auto& vert : vertices) {
+					rawPositions.push_back(vert.Position);
+				}
+			}
+		}
+
+		// Only the shape matters for occlusion, so we weld on position alone. This gets rid of the
+		// UV and normal seams that would otherwise stop the simplifier from collapsing edges
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		MeshSimplifier::WeldVertices(rawPositions, positions, indices);
+		if (indices.size() > MAX_OCCLUDER_TRIANGLES * 3) {
+			std::vector<uint32_t> simplified = MeshSimplifier::Simplify(positions, indices, MAX_OCCLUDER_TRIANGLES * 3);
+			if (!simplified.empty()) {
+				indices = std::move(simplified);
+			}
+		}
+
+		_occluderTriangles.reserve(indices.size());
+		for (uint32_t index : indices) {
+			_occluderTriangles.push_back(positions[index]);
+		}
+		LOG_TRACE("Generated occluder for \"{}\" with {} triangles", Filename.empty() ? "Generated" : Filename, _occluderTriangles.size() / 3);
+		return _occluderTriangles;
+	}
+
+	bool MeshResource::LoadVertexData(std::vector<VertexPosNormTexCol>& outVertices, std::vector<uint32_t>& outIndices) const {
+		outVertices.clear();
+		outIndices.clear();
+
+		if (!MeshBuilderParams.empty()) {
+			MeshBuilder<VertexPosNormTexCol> mesh;
+			for (auto& param : MeshBuilderParams) {
+				MeshFactory::AddParameterized(mesh, param);
+			}
+			outVertices.assign(mesh.GetVertexDataPtr(), mesh.GetVertexDataPtr() + mesh.GetVertexCount());
+			if (mesh.GetIndexCount() > 0) {
+				outIndices.assign(mesh.GetIndexDataPtr(), mesh.GetIndexDataPtr() + mesh.GetIndexCount());
+			} else {
+				outIndices.reserve(outVertices.size());
+				for (uint32_t ix = 0; ix < (uint32_t)outVertices.size(); ix++) {
+					outIndices.push_back(ix);
+				}
+			}
+		} else if (!Filename.empty()) {
+			// Processed meshes are already welded in the LOD cache, which is much faster than the OBJ
+			uint32_t flags = (UseLods ? LOD_CACHE_HAS_LODS : 0) | (Optimize ? LOD_CACHE_OPTIMIZED : 0);
+			std::vector<std::vector<uint32_t>> lods;
+			if ((UseLods || Optimize) && ReadLodCache(Filename, flags, outVertices, lods) && !lods.empty()) {
+				outIndices = std::move(lods[0]);
+			} else {
+				std::vector<VertexPosNormTexCol> rawVertices;
+				if (!ObjLoader::LoadVertices(Filename, rawVertices)) {
+					return false;
+				}
+				MeshSimplifier::WeldVertices(rawVertices, outVertices, outIndices);
+			}
+		}
+		return !outVertices.empty() && !outIndices.empty();
+	}
+
+	void MeshResource::_LoadProcessed() {
+		float startTime = glfwGetTime();
+
+		uint32_t flags = (UseLods ? LOD_CACHE_HAS_LODS : 0) | (Optimize ? LOD_CACHE_OPTIMIZED : 0);
+		std::vector<VertexPosNormTexCol> vertices;
+		std::vector<std::vector<uint32_t>> lods;
+		bool fromCache = ReadLodCache(Filename, flags, vertices, lods);
+
+		if (!fromCache) {
+			std::vector<VertexPosNormTexCol> rawVertices;
+			if (!ObjLoader::LoadVertices(Filename, rawVertices)) {
+				return;
+			}
+
+			// The OBJ loader gives us a triangle soup, so we need to index it before we can find edges
+			lods.resize(1);
+			MeshSimplifier::WeldVertices(rawVertices, vertices, lods[0]);
+
+			std::vector<glm::vec3> positions;
+			positions.reserve(vertices.size());
+			for (const auto& vert : vertices) {
+				positions.push_back(vert.Position);
+			}
+
+			while (UseLods && lods.size() < MAX_LODS) {
+				const std::vector<uint32_t>& previous = lods.back();
+				size_t target = (size_t)(previous.size() / 3 * LOD_REDUCTION) * 3;
+				std::vector<uint32_t> simplified = MeshSimplifier::Simplify(positions, previous, target);
+
+				// If the simplifier got stuck (ex: most vertices are on seams), more LODs won't help
+				if (simplified.empty() || simplified.size() > previous.size() * 9 / 10) {
+					break;
+				}
+				lods.push_back(std::move(simplified));
+			}
+
+			// Reorder each LOD for the vertex cache and overdraw, then lay out the shared vertices
+			// in the order they're first used by the full detail mesh
+			if (Optimize) {
+				MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(lods[0], vertices.size());
+				for (auto& lod : lods) {
+					lod = MeshOptimizer::OptimizeVertexCache(lod, vertices.size());
+					lod = MeshOptimizer::OptimizeOverdraw(positions, lod);
+				}
+				MeshOptimizer::OptimizeVertexFetch(vertices, lods);
+				MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(lods[0], vertices.size());
+				LOG_INFO("Optimized \"{}\": ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", Filename, before.Acmr, after.Acmr, before.Atvr, after.Atvr);
+			}
+
+			WriteLodCache(Filename, flags, vertices, lods);
+		}
+
+		// All of our LODs share one vertex buffer, and only differ in which triangles they draw
+		VertexBuffer::Sptr vertexBuffer = VertexBuffer::Create();
+		vertexBuffer->LoadData(vertices.data(), vertices.size());
+		// The pool copy works the same way, the LODs share the vertices and each add their own indices
+		PooledMesh::Sptr pooledVertices = GeometryPool::Get().Add(vertices.data(), vertices.size(), nullptr, 0);
+
+		Lods.clear();
+		for (size_t ix = 0; ix < lods.size(); ix++) {
+			IndexBuffer::Sptr indexBuffer = IndexBuffer::Create();
+			indexBuffer->LoadData(lods[ix].data(), lods[ix].size());
+
+			VertexArrayObject::Sptr vao = VertexArrayObject::Create();
+			vao->AddVertexBuffer(vertexBuffer, VertexPosNormTexCol::V_DECL);
+			vao->SetIndexBuffer(indexBuffer);
+			vao->SetVDecl(VertexPosNormTexCol::V_DECL);
+			vao->SetPooledMesh(GeometryPool::Get().AddIndices(pooledVertices, lods[ix].data(), lods[ix].size()));
+
+			if (ix == 0) {
+				Mesh = vao;
+			} else {
+				Lods.push_back(vao);
+			}
+		}
+
+		_CalculateBounds(vertices.data(), vertices.size());
+
+		float endTime = glfwGetTime();
+		LOG_TRACE("Loaded \"{}\" with {} LODs in {} seconds ({}, {} triangles)", Filename, lods.size(), endTime - startTime,
+			fromCache ? "cached" : "generated", lods.empty() ? 0 : lods[0].size() / 3);
+	}
+
+	void MeshResource::_LoadFromFile() {
+		float startTime = glfwGetTime();
+
+		std::vector<VertexPosNormTexCol> vertices;
+		if (!ObjLoader::LoadVertices(Filename, vertices)) {
+			return;
+		}
+
+		VertexBuffer::Sptr vertexBuffer = VertexBuffer::Create();
+		vertexBuffer->LoadData(vertices.data(), vertices.size());
+
+		Mesh = VertexArrayObject::Create();
+		Mesh->AddVertexBuffer(vertexBuffer, VertexPosNormTexCol::V_DECL);
+		Mesh->SetVDecl(VertexPosNormTexCol::V_DECL);
+		Mesh->SetPooledMesh(GeometryPool::Get().Add(vertices.data(), vertices.size(), nullptr, 0));
+
+		_CalculateBounds(vertices.data(), vertices.size());
+
+		float endTime = glfwGetTime();
+		LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices)", Filename, endTime - startTime, vertices.size());
+	}
+
+	void MeshResource::_CalculateBounds(const VertexPosNormTexCol* vertices, size_t count) {
+		// Find a bounding sphere around the mesh, used to estimate how big the mesh is on screen
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+		for (size_t ix = 0; ix < count; ix++) {
+			min = glm::min(min, vertices[ix].Position);
+			max = glm::max(max, vertices[ix].Position);
+		}
+		BoundsCenter = count == 0 ? glm::vec3(0.0f) : (min + max) * 0.5f;
+		BoundsRadius = 0.0f;
+		for (size_t ix = 0; ix < count; ix++) {
+			BoundsRadius = glm::max(BoundsRadius, glm::distance(BoundsCenter, vertices[ix].Position));
+		}
+	}
 }
\ No newline at end of file
@@ -16,13 +16,22 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<MeshResource> Sptr;
 
+		// The maximum number of LODs we will generate, including the full detail mesh
+		static const int MAX_LODS = 4;
+		// Each LOD will try to have this fraction of the triangles of the LOD before it
+		static constexpr float LOD_REDUCTION = 0.5f;
+		// The most triangles we will keep when simplifying a mesh for use as an occluder
+		static const int MAX_OCCLUDER_TRIANGLES = 256;
+
 		// Default constructor
 		MeshResource();
 		/// <summary>
 		/// Constructor for loading from file
 		/// </summary>
 		/// <param name="filename"></param>
-		MeshResource(const std::string& filename);
+		/// <param name="generateLods">True to generate a chain of simplified LODs for this mesh</param>
+		/// <param name="optimize">True to reorder the mesh's triangles and vertices so it's faster to draw</param>
+		MeshResource(const std::string& filename, bool generateLods = false, bool optimize = false);
 
 		virtual ~MeshResource();
 
@@ -40,6 +49,25 @@ namespace Gameplay {
 		/// The VAO for rendering this mesh in OpenGL
 		/// </summary>
 		VertexArrayObject::Sptr         Mesh;
+		/// <summary>
+		/// Simplified versions of Mesh, from LOD 1 (most detailed) to the coarsest. These
+		/// share Mesh's vertex buffer. Empty unless LODs have been generated
+		/// </summary>
+		std::vector<VertexArrayObject::Sptr> Lods;
+		/// <summary>
+		/// Whether this mesh should have LODs generated when loading from a file
+		/// </summary>
+		bool                            UseLods;
+		/// <summary>
+		/// Whether this mesh should be re-ordered for the vertex cache and overdraw when loading
+		/// from a file. The optimized mesh is stored in the LOD cache next to the file
+		/// </summary>
+		bool                            Optimize;
+		/// <summary>
+		/// The model space bounding sphere of the mesh, or a radius of 0 if the mesh failed to load
+		/// </summary>
+		glm::vec3                       BoundsCenter;
+		float                           BoundsRadius;
 
 
 		/// <summary>
@@ -61,9 +89,51 @@ namespace Gameplay {
 		/// <param name="param">The parameter to add</param>
 		void AddParam(const MeshBuilderParam& param);
 
+		/// <summary>
+		/// Gets the VAO for the given level of detail, where 0 is the full detail mesh.
+		/// Will return the coarsest LOD available if lod is out of range
+		/// </summary>
+		const VertexArrayObject::Sptr& GetLod(int lod) const;
+
+		/// <summary>
+		/// Gets a heavily simplified, model space copy of the mesh for the occlusion culler, as a
+		/// list of triangles (3 positions per triangle). The first call re-loads and simplifies
+		/// the source data, so this should only be called from the main thread
+		/// </summary>
+		const std::vector<glm::vec3>& GetOccluderTriangles();
+		/// <summary>
+		/// Re-loads a model space, indexed copy of the full detail mesh. Vertex data isn't kept
+		/// after it's uploaded, so this rebuilds it from the builder params, LOD cache or file.
+		/// Doesn't need the GL context, but may be slow
+		/// </summary>
+		/// <param name="outVertices">Will be filled with the mesh's vertices</param>
+		/// <param name="outIndices">Will be filled with the mesh's triangle indices</param>
+		/// <returns>False if there was nothing to load</returns>
+		bool LoadVertexData(std::vector<VertexPosNormTexCol>& outVertices, std::vector<uint32_t>& outIndices) const;
+
 		// Inherited from IResource
 
 		virtual nlohmann::json ToJson() const override;
 		static MeshResource::Sptr FromJson(const nlohmann::json& blob);
+
+	protected:
+		/// <summary>
+		/// Loads the mesh from Filename as an indexed mesh, generating a chain of LODs and optimizing
+		/// it's layout if requested. Uses the binary LOD cache next to the file if it is up to date,
+		/// otherwise processes the mesh and writes a new cache
+		/// </summary>
+		void _LoadProcessed();
+		/// <summary>
+		/// Loads the mesh from Filename as a single VAO, without any LODs
+		/// </summary>
+		void _LoadFromFile();
+		/// <summary>
+		/// Fits BoundsCenter and BoundsRadius around the given vertices
+		/// </summary>
+		void _CalculateBounds(const VertexPosNormTexCol* vertices, size_t count);
+
+		// The CPU side triangles we hand to the occlusion culler, generated on first use
+		std::vector<glm::vec3> _occluderTriangles;
+		bool                   _hasOccluderTriangles;
 	};
 }
\ No newline at end of file
@@ -21,7 +21,9 @@ void BulletDebugDraw::drawLine(const btVector3& from, const btVector3& to, const
 
 void BulletDebugDraw::drawContactPoint(const btVector3& PointOnB, const btVector3& normalOnB, btScalar distance,
 									   int lifeTime, const btVector3& color) {
-
+	// Show the contact as a point, with a short line along the contact normal
+	DebugDrawer::Get().DrawPoint(ToGlm(PointOnB), ToGlm(color));
+	DebugDrawer::Get().DrawLine(ToGlm(PointOnB), ToGlm(PointOnB + normalOnB * distance), ToGlm(color));
 }
 
 void BulletDebugDraw::reportErrorWarning(const char* warningString) {
@@ -6,6 +6,7 @@
 #include "Gameplay/Components/RenderComponent.h"
 
 #include "Utils/GlmBulletConversions.h"
+#include "Graphics/RenderThread.h"
 
 namespace Gameplay::Physics {
 	ConvexMeshCollider::Sptr ConvexMeshCollider::Create() {
@@ -113,14 +114,19 @@ namespace Gameplay::Physics {
 
 				// Allocate some space to read data from OpenGL and read our buffer data back into CPU memory
 				uint8_t* vertexStore = reinterpret_cast<uint8_t*>(malloc(vertexBuff->GetTotalSize()));
-				glGetNamedBufferSubData(vertexBuff->GetHandle(), 0, vertexBuff->GetTotalSize(), vertexStore);
+				// Reading back needs the GL context, this happens when the collider is first set up
+				RenderThread::Invoke([&]() {
+					glGetNamedBufferSubData(vertexBuff->GetHandle(), 0, vertexBuff->GetTotalSize(), vertexStore);
+				});
 				_triMesh->preallocateVertices(vao->GetVertexCount());
 
 				// If our data is indexed, we use the index buffer to add our triangles
 				if (indexBuff != nullptr) {
 					// Allocate and read space for the indices
 					uint8_t* indexStore = reinterpret_cast<uint8_t*>(malloc(indexBuff->GetTotalSize()));
-					glGetNamedBufferSubData(indexBuff->GetHandle(), 0, indexBuff->GetTotalSize(), indexStore);
+					RenderThread::Invoke([&]() {
+						glGetNamedBufferSubData(indexBuff->GetHandle(), 0, indexBuff->GetTotalSize(), indexStore);
+					});
 
 					// Iterate over index triangles
 					for (int ix = 0; ix < indexBuff->GetElementCount(); ix+=3) {
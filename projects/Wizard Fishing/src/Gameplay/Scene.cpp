@@ -9,11 +9,15 @@
 #include "Gameplay/Physics/TriggerVolume.h"
 #include "Gameplay/MeshResource.h"
 
-#include "Graphics/DebugDraw.h"
 #include "Graphics/TextureCube.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
 
 namespace Gameplay {
+	static constexpr UniformHandle U_VIEW("u_View");
+	static constexpr UniformHandle U_ENVIRONMENT_ROTATION("u_EnvironmentRotation");
+
 	Scene::Scene() :
 		_objects(std::vector<GameObject::Sptr>()),
 		_deletionQueue(std::vector<std::weak_ptr<GameObject>>()),
@@ -29,10 +33,14 @@ namespace Gameplay {
 		_skyboxRotation(glm::mat3(1.0f)),
 		_gravity(glm::vec3(0.0f, 0.0f, -9.81f))
 	{
+		_lightClusters = ClusteredLighting::Create();
+		_staticBatcher = StaticBatcher::Create();
+		_gpuCuller = GpuCuller::Create();
 		_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>();
-		_lightingUbo->GetData().AmbientCol = glm::vec3(0.1f);
-		_lightingUbo->Update();
-		_lightingUbo->Bind(LIGHT_UBO_BINDING_SLOT);
+		_lightingData = LightingUboStruct();
+		_lightingData.AmbientCol = glm::vec3(0.1f);
+		_lightingData.Clusters = _lightClusters->GetGridParams();
+		_UploadLighting();
 
 		_InitPhysics();
 
@@ -65,8 +73,8 @@ namespace Gameplay {
 
 	void Scene::SetSkyboxRotation(const glm::mat3& value) {
 		_skyboxRotation = value;
-		_lightingUbo->GetData().EnvironmentRotation = value;
-		_lightingUbo->Update();
+		_lightingData.EnvironmentRotation = value;
+		_UploadLighting();
 	}
 
 	const glm::mat3& Scene::GetSkyboxRotation() const {
@@ -102,12 +110,12 @@ namespace Gameplay {
 	}
 
 	void Scene::SetAmbientLight(const glm::vec3& value) {
-		_lightingUbo->GetData().AmbientCol = glm::vec3(0.1f);
-		_lightingUbo->Update();
+		_lightingData.AmbientCol = glm::vec3(0.1f);
+		_UploadLighting();
 	}
 
 	const glm::vec3& Scene::GetAmbientLight() const { 
-		return _lightingUbo->GetData().AmbientCol;
+		return _lightingData.AmbientCol;
 	}
 
 	void Scene::Awake() {
@@ -121,13 +129,16 @@ namespace Gameplay {
 			_skyboxMesh = ResourceManager::CreateAsset<MeshResource>();
 			_skyboxMesh->AddParam(MeshBuilderParam::CreateCube(glm::vec3(0.0f), glm::vec3(1.0f)));
 			_skyboxMesh->AddParam(MeshBuilderParam::CreateInvert());
-			_skyboxMesh->GenerateMesh();
+			RenderThread::Invoke([this]() { _skyboxMesh->GenerateMesh(); });
 		}
 
 		// Call awake on all gameobjects
 		for (auto& obj : _objects) {
 			obj->Awake();
 		}
+		// Objects have their final transforms now, so we can merge everything that won't move
+		_staticBatcher->Bake(_objects);
+		_gpuCuller->Bake(_objects);
 		// Set up our lighting 
 		SetupShaderAndLights();
 
@@ -153,8 +164,8 @@ namespace Gameplay {
 				body->PhysicsPostStep(dt);
 			});
 			if (_bulletDebugDraw->getDebugMode() != btIDebugDraw::DBG_NoDebug) {
+				// This only collects the lines, they are drawn along with the rest of the frame
 				_physicsWorld->debugDrawWorld();
-				DebugDrawer::Get().FlushAll();
 			}
 		}
 	}
@@ -170,35 +181,57 @@ namespace Gameplay {
 	}
 
 	void Scene::SetShaderLight(int index, bool update /*= true*/) {
-		if (index >= 0 && index < Lights.size() && index < MAX_LIGHTS) {
-			// Get a reference to the light UBO data so we can update it
-			LightingUboStruct& data = _lightingUbo->GetData();
-			Light& light = Lights[index];
-
-			// Copy to the ubo data
-			data.Lights[index].Position = light.Position;
-			data.Lights[index].Color = light.Color;
-			data.Lights[index].Attenuation = 1.0f / (1.0f + light.Range);
-
-			// If requested, send the new data to the UBO
-			if (update)	_lightingUbo->Update();
+		// Lights are packed together in one SSBO, so re-send them all. The clusters
+		// will be rebuilt on the next call to UpdateLightClusters
+		if (index >= 0 && index < Lights.size() && index < MAX_LIGHTS && update) {
+			_lightClusters->SetLights(Lights);
 		}
 	}
 
 	void Scene::SetupShaderAndLights() {
-		// Get a reference to the light UBO data so we can update it
-		LightingUboStruct& data = _lightingUbo->GetData();
+		LightingUboStruct& data = _lightingData;
 		// Send in how many active lights we have and the global lighting settings
 		data.AmbientCol = glm::vec3(0.1f);
 		data.NumLights = Lights.size();
 
-		// Iterate over all lights that are enabled and configure them
-		for (int ix = 0; ix < Lights.size(); ix++) {
-			SetShaderLight(ix, false);
+		// Send all of our lights to the light clusterer
+		if (Lights.size() > MAX_LIGHTS) {
+			LOG_WARN("Scene has {} lights, only the first {} will be used", Lights.size(), (int)MAX_LIGHTS);
+			Lights.resize(MAX_LIGHTS);
 		}
+		_lightClusters->SetLights(Lights);
 
 		// Send updated data to OpenGL
-		_lightingUbo->Update();
+		_UploadLighting();
+	}
+
+	void Scene::UpdateLightClusters(const glm::ivec2& viewportSize) {
+		_lightClusters->Update(MainCamera, viewportSize);
+
+		// The grid parameters only change when the camera's projection or the viewport does
+		LightingUboStruct& data = _lightingData;
+		const ClusteredLighting::GridParams& params = _lightClusters->GetGridParams();
+		if (data.Clusters.GridSize != params.GridSize ||
+			data.Clusters.DepthParams != params.DepthParams ||
+			data.Clusters.TileSize != params.TileSize) {
+			data.Clusters = params;
+			_UploadLighting();
+		}
+	}
+
+	void Scene::BindLighting() const {
+		// These go through the state cache, so they are free if nothing else has bound over them
+		_lightingUbo->Bind(LIGHT_UBO_BINDING_SLOT);
+		_lightClusters->Bind();
+	}
+
+	void Scene::_UploadLighting() {
+		// Copy the data into the command, so we can keep editing ours while the render thread catches up
+		UniformBuffer<LightingUboStruct>::Sptr ubo = _lightingUbo;
+		LightingUboStruct data = _lightingData;
+		RenderThread::Enqueue([ubo, data]() {
+			ubo->SetData(data);
+		});
 	}
 
 	btDynamicsWorld* Scene::GetPhysicsWorld() const {
@@ -360,27 +393,26 @@ namespace Gameplay {
 		}
 	}
 
-	void Scene::DrawSkybox()
+	void Scene::DrawSkybox(const glm::mat4& view, const glm::mat4& projection)
 	{
 		if (_skyboxShader != nullptr &&
 			_skyboxMesh != nullptr &&
 			_skyboxMesh->Mesh != nullptr &&
-			_skyboxTexture != nullptr &&
-			MainCamera != nullptr) {
+			_skyboxTexture != nullptr) {
 			
-			glDepthMask(false);
-			glDisable(GL_CULL_FACE);
-			glDepthFunc(GL_LEQUAL);
+			GlStateCache::SetDepthWriteEnabled(false);
+			GlStateCache::SetCullEnabled(false);
+			GlStateCache::SetDepthFunc(GL_LEQUAL);
 
 			_skyboxShader->Bind();
-			_skyboxShader->SetUniformMatrix("u_View", MainCamera->GetProjection() * glm::mat4(glm::mat3(MainCamera->GetView())));
-			_skyboxShader->SetUniformMatrix("u_EnvironmentRotation", _skyboxRotation);
+			_skyboxShader->SetUniformMatrix(U_VIEW, projection * glm::mat4(glm::mat3(view)));
+			_skyboxShader->SetUniformMatrix(U_ENVIRONMENT_ROTATION, _skyboxRotation);
 			_skyboxTexture->Bind(0);
 			_skyboxMesh->Mesh->Draw();
 
-			glDepthFunc(GL_LESS);
-			glEnable(GL_CULL_FACE);
-			glDepthMask(true);
+			GlStateCache::SetDepthFunc(GL_LESS);
+			GlStateCache::SetCullEnabled(true);
+			GlStateCache::SetDepthWriteEnabled(true);
 
 		}
 	}
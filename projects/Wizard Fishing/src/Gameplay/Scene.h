@@ -5,6 +5,9 @@
 #include "Gameplay/Components/Camera.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Light.h"
+#include "Gameplay/ClusteredLighting.h"
+#include "Gameplay/StaticBatcher.h"
+#include "Gameplay/GpuCuller.h"
 
 #include "Physics/BulletDebugDraw.h"
 
@@ -34,7 +37,8 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<Scene> Sptr;
 
-		static const int MAX_LIGHTS = 8;
+		// Lights are culled per cluster, so this is just a sanity limit for the editor
+		static const int MAX_LIGHTS = 1024;
 
 		// Stores all the lights in our scene
 		std::vector<Light>         Lights;
@@ -149,13 +153,37 @@ namespace Gameplay {
 		/// Creates the shader and sets up all the lights
 		/// </summary>
 		void SetupShaderAndLights();
+		/// <summary>
+		/// Assigns the scene's lights to the clusters of the main camera's frustum, and
+		/// queues the results for upload. Should be called once per frame before rendering
+		/// </summary>
+		/// <param name="viewportSize">The size of the viewport being rendered to, in pixels</param>
+		void UpdateLightClusters(const glm::ivec2& viewportSize);
+		/// <summary>
+		/// Binds the lighting UBO and light cluster buffers, must be called from the render thread
+		/// </summary>
+		void BindLighting() const;
+
+		/// <summary>
+		/// Gets the batches that the scene's static objects were merged into when it woke up
+		/// </summary>
+		const StaticBatcher::Sptr& GetStaticBatcher() const { return _staticBatcher; }
+		/// <summary>
+		/// Gets the GPU culler that the scene's static objects were uploaded to when it woke up
+		/// </summary>
+		const GpuCuller::Sptr& GetGpuCuller() const { return _gpuCuller; }
 
 		/// <summary>
 		/// Draws ImGui stuff for all gameobjects in the scene
 		/// </summary>
 		void DrawAllGameObjectGUIs();
 
-		void DrawSkybox();
+		/// <summary>
+		/// Draws the skybox, must be called from the render thread
+		/// </summary>
+		/// <param name="view">The view matrix of the camera, only it's rotation is used</param>
+		/// <param name="projection">The projection matrix of the camera</param>
+		void DrawSkybox(const glm::mat4& view, const glm::mat4& projection);
 
 		/// <summary>
 		/// Gets the scene's Bullet physics world
@@ -227,28 +255,24 @@ namespace Gameplay {
 		/// thing for packing structures to sizeof(vec4)
 		/// </summary>
 		struct LightingUboStruct {
-			struct Light {
-				// This lets us continue to access Position as a vec3, but also allocates space for the
-				// pack at the end (since objects are vec4 aligned)
-				union {
-					glm::vec3 Position;
-					glm::vec4 Position4;
-				};
-				// Since these are tightly packed, will match the vec4 in light
-				glm::vec3 Color;
-				float     Attenuation;
-			};
-
 			// Since these are tightly packed, will match the vec4 in the UBO
 			glm::vec3 AmbientCol;
 			float     NumLights;
 
-			Light     Lights[MAX_LIGHTS];
+			// The lights themselves live in SSBOs, see ClusteredLighting
+			ClusteredLighting::GridParams Clusters;
 			// NOTE: our shaders expect a mat3, but due to the STD140 layout, each column of the
 			// vec3 needs to be padded to the size of a vec4, hence the use of a mat4 here
 			glm::mat4 EnvironmentRotation;
 		};
+		// The main thread edits _lightingData, and copies of it are sent to _lightingUbo on the render thread
+		LightingUboStruct                      _lightingData;
 		UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
+		ClusteredLighting::Sptr                _lightClusters;
+		// Merged meshes for all of our static render components
+		StaticBatcher::Sptr                    _staticBatcher;
+		// The same static render components, for culling and drawing on the GPU
+		GpuCuller::Sptr                        _gpuCuller;
 
 		bool                       _isAwake;
 
@@ -262,5 +286,7 @@ namespace Gameplay {
 		void _CleanupPhysics();
 
 		void _FlushDeleteQueue();
+		// Queues a copy of _lightingData to be uploaded to the lighting UBO
+		void _UploadLighting();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "Gameplay/StaticBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <unordered_map>
+#include <imgui.h>
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/MorphMeshRenderer.h"
+#include "Graphics/GeometryPool.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+namespace Gameplay {
+	StaticBatcher::StaticBatcher() :
+		Enabled(true),
+		_batches(std::vector<Batch>()),
+		_batchedComponents(std::vector<std::weak_ptr<RenderComponent>>()),
+		_batchedObjectCount(0),
+		_bakeTime(0.0f)
+	{ }
+
+	void StaticBatcher::Clear() {
+		for (auto& weakComponent : _batchedComponents) {
+			if (RenderComponent::Sptr component = weakComponent.lock()) {
+				component->SetBatched(false);
+			}
+		}
+		_batchedComponents.clear();
+		_batches.clear();
+		_batchedObjectCount = 0;
+	}
+
+	void StaticBatcher::Bake(const std::vector<GameObject::Sptr>& objects) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		Clear();
+
+		// A static object waiting to be merged, along with the grid cell it landed in
+		struct Entry {
+			RenderComponent::Sptr Component;
+			Material*             DrawMaterial;
+			glm::ivec3            Cell;
+			size_t                VertexCount;
+		};
+		// Model space copies of the meshes, since lots of objects will share them
+		struct MeshData {
+			std::vector<VertexPosNormTexCol> Vertices;
+			std::vector<uint32_t>            Indices;
+		};
+		std::unordered_map<MeshResource*, MeshData> meshData;
+		std::vector<Entry> entries;
+
+		for (const GameObject::Sptr& object : objects) {
+			RenderComponent::Sptr renderer = object->Get<RenderComponent>();
+			if (renderer == nullptr || !renderer->IsStatic() || renderer->GetMaterial() == nullptr) {
+				continue;
+			}
+			// Morphing objects change every frame, and objects with impostors pick what to draw by their
+			// own distance. Overridden VAOs don't match the mesh resource, which also means we don't get
+			// any bounds for them
+			glm::vec3 boundsCenter;
+			float boundsRadius;
+			if (object->Has<MorphMeshRenderer>() || renderer->GetImpostor() != nullptr || !renderer->GetWorldBounds(boundsCenter, boundsRadius)) {
+				continue;
+			}
+
+			MeshResource* mesh = renderer->GetMeshResource().get();
+			auto it = meshData.find(mesh);
+			if (it == meshData.end()) {
+				it = meshData.emplace(mesh, MeshData()).first;
+				if (!mesh->LoadVertexData(it->second.Vertices, it->second.Indices)) {
+					LOG_WARN("Could not reload \"{}\" for static batching, it will be drawn on it's own", mesh->Filename.empty() ? "Generated" : mesh->Filename);
+				}
+			}
+			if (it->second.Vertices.empty()) {
+				continue;
+			}
+
+			Entry entry;
+			entry.Component = renderer;
+			entry.DrawMaterial = renderer->GetMaterial().get();
+			entry.Cell = glm::ivec3(glm::floor(boundsCenter / CELL_SIZE));
+			entry.VertexCount = it->second.Vertices.size();
+			entries.push_back(entry);
+		}
+
+		// Sort so that everything that can share a batch is next to each other
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			if (a.DrawMaterial != b.DrawMaterial) return a.DrawMaterial < b.DrawMaterial;
+			if (a.Cell.x != b.Cell.x) return a.Cell.x < b.Cell.x;
+			if (a.Cell.y != b.Cell.y) return a.Cell.y < b.Cell.y;
+			return a.Cell.z < b.Cell.z;
+		});
+
+		// Transform each group into world space on this thread, the uploads all happen at the end
+		struct PendingBatch {
+			std::vector<VertexPosNormTexCol> Vertices;
+			std::vector<uint32_t>            Indices;
+			Batch                            Info;
+		};
+		std::vector<PendingBatch> pending;
+		for (size_t start = 0; start < entries.size(); ) {
+			// Find the end of the group, or the point where it gets too big for one batch. A single
+			// mesh that is bigger than the limit gets a batch of it's own
+			size_t end = start + 1;
+			size_t vertexCount = entries[start].VertexCount;
+			while (end < entries.size() && entries[end].DrawMaterial == entries[start].DrawMaterial && entries[end].Cell == entries[start].Cell &&
+				vertexCount + entries[end].VertexCount <= MAX_BATCH_VERTICES) {
+				vertexCount += entries[end].VertexCount;
+				end++;
+			}
+
+			PendingBatch batch;
+			batch.Vertices.reserve(vertexCount);
+			batch.Info.DrawMaterial = entries[start].Component->GetMaterial();
+			batch.Info.ObjectCount = (int)(end - start);
+			glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (size_t ix = start; ix < end; ix++) {
+				const RenderComponent::Sptr& component = entries[ix].Component;
+				const MeshData& source = meshData[component->GetMeshResource().get()];
+				const glm::mat4& model = component->GetGameObject()->GetTransform();
+				glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+				// Mirrored objects turn their triangles inside out, so we need to flip them back
+				bool flipWinding = glm::determinant(glm::mat3(model)) < 0.0f;
+
+				uint32_t baseVertex = (uint32_t)batch.Vertices.size();
+				for (const VertexPosNormTexCol& vertex : source.Vertices) {
+					VertexPosNormTexCol transformed = vertex;
+					transformed.Position = glm::vec3(model * glm::vec4(vertex.Position, 1.0f));
+					glm::vec3 normal = normalMatrix * vertex.Normal;
+					transformed.Normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+					boundsMin = glm::min(boundsMin, transformed.Position);
+					boundsMax = glm::max(boundsMax, transformed.Position);
+					batch.Vertices.push_back(transformed);
+				}
+				for (size_t tri = 0; tri + 2 < source.Indices.size(); tri += 3) {
+					batch.Indices.push_back(baseVertex + source.Indices[tri]);
+					batch.Indices.push_back(baseVertex + source.Indices[tri + (flipWinding ? 2 : 1)]);
+					batch.Indices.push_back(baseVertex + source.Indices[tri + (flipWinding ? 1 : 2)]);
+				}
+
+				component->SetBatched(true);
+				_batchedComponents.push_back(component);
+			}
+
+			batch.Info.BoundsCenter = (boundsMin + boundsMax) * 0.5f;
+			batch.Info.BoundsRadius = 0.0f;
+			for (const VertexPosNormTexCol& vertex : batch.Vertices) {
+				batch.Info.BoundsRadius = glm::max(batch.Info.BoundsRadius, glm::distance(vertex.Position, batch.Info.BoundsCenter));
+			}
+			batch.Info.TriangleCount = (int)(batch.Indices.size() / 3);
+			_batchedObjectCount += batch.Info.ObjectCount;
+			pending.push_back(std::move(batch));
+
+			start = end;
+		}
+
+		// Upload everything in one go, so we only have to wait on the render thread once
+		GeometryPool& pool = GeometryPool::Get();
+		RenderThread::Invoke([&]() {
+			for (PendingBatch& batch : pending) {
+				VertexBuffer::Sptr vbo = VertexBuffer::Create();
+				vbo->LoadData(batch.Vertices.data(), batch.Vertices.size());
+				IndexBuffer::Sptr ebo = IndexBuffer::Create();
+				ebo->LoadData(batch.Indices.data(), batch.Indices.size());
+
+				batch.Info.Mesh = VertexArrayObject::Create();
+				batch.Info.Mesh->AddVertexBuffer(vbo, VertexPosNormTexCol::V_DECL);
+				batch.Info.Mesh->SetIndexBuffer(ebo);
+				batch.Info.Mesh->SetVDecl(VertexPosNormTexCol::V_DECL);
+				batch.Info.Mesh->SetPooledMesh(pool.Add(batch.Vertices.data(), batch.Vertices.size(), batch.Indices.data(), batch.Indices.size()));
+			}
+		});
+
+		_batches.reserve(pending.size());
+		for (PendingBatch& batch : pending) {
+			_batches.push_back(std::move(batch.Info));
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		_bakeTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+		LOG_INFO("Merged {} static objects into {} batches in {:.2f} ms", _batchedObjectCount, _batches.size(), _bakeTime);
+	}
+
+	void StaticBatcher::RenderImGui() {
+		ImGui::Checkbox("Static Batching", &Enabled);
+		ImGui::Text("Static:     %d objects in %d batches (baked in %.2f ms)", _batchedObjectCount, (int)_batches.size(), _bakeTime);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/GameObject.h"
+#include "Gameplay/Material.h"
+#include "Graphics/VertexArrayObject.h"
+
+class RenderComponent;
+
+namespace Gameplay {
+	/// <summary>
+	/// Merges the meshes of static render components (see RenderComponent::SetStatic) into a
+	/// few large, world space meshes, so that the parts of the scene that never move can be
+	/// drawn in a handful of draw calls
+	///
+	/// Objects are grouped by material, and then by which cell of a coarse world space grid
+	/// the center of their bounds falls in, so each batch covers a limited area and can still
+	/// be hidden by the occlusion culler. Groups that get too large are split into more batches
+	///
+	/// Batches always draw the full detail meshes, since LODs are picked per object. Objects
+	/// that have been batched must not move, or change their mesh or material, until the next
+	/// bake
+	/// </summary>
+	class StaticBatcher {
+	public:
+		typedef std::shared_ptr<StaticBatcher> Sptr;
+
+		// The size of the grid cells that objects are grouped into, in world units
+		static constexpr float CELL_SIZE = 20.0f;
+		// The most vertices we will put in one batch before starting another
+		static const size_t MAX_BATCH_VERTICES = 1 << 16;
+
+		/// <summary>
+		/// A merged mesh, along with the world space bounding sphere of everything in it
+		/// </summary>
+		struct Batch {
+			VertexArrayObject::Sptr Mesh;
+			Material::Sptr          DrawMaterial;
+			glm::vec3               BoundsCenter;
+			float                   BoundsRadius;
+			int                     TriangleCount;
+			int                     ObjectCount;
+		};
+
+		static inline Sptr Create() {
+			return std::make_shared<StaticBatcher>();
+		}
+
+		StaticBatcher();
+
+		StaticBatcher(const StaticBatcher& other) = delete;
+		StaticBatcher& operator=(const StaticBatcher& other) = delete;
+
+		// When false, batched objects go back to drawing on their own. This can be toggled at any time
+		bool Enabled;
+
+		/// <summary>
+		/// Throws away any existing batches, and merges the static render components of the
+		/// given objects into new ones. Should be called from the main thread once the objects'
+		/// transforms are set, the meshes are uploaded on the render thread
+		/// </summary>
+		/// <param name="objects">The objects to search for static render components</param>
+		void Bake(const std::vector<GameObject::Sptr>& objects);
+		/// <summary>
+		/// Throws away all of our batches, and lets the objects that were in them draw on their own
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Gets the batches from the last bake
+		/// </summary>
+		const std::vector<Batch>& GetBatches() const { return _batches; }
+		/// <summary>
+		/// Gets the number of objects that were merged into batches by the last bake
+		/// </summary>
+		int GetBatchedObjectCount() const { return _batchedObjectCount; }
+
+		/// <summary>
+		/// Draws the ImGui controls for our settings, along with stats from the last bake
+		/// </summary>
+		void RenderImGui();
+
+	protected:
+		std::vector<Batch> _batches;
+		// The components we marked as batched, so they can be un-marked when we clear
+		std::vector<std::weak_ptr<RenderComponent>> _batchedComponents;
+		int   _batchedObjectCount;
+		float _bakeTime;
+	};
+}
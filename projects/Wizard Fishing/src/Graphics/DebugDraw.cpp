@@ -1,26 +1,43 @@
 #include "Graphics/DebugDraw.h"
+#include <algorithm>
+#include <cstring>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+
+static constexpr UniformHandle U_MVP("u_MVP");
 
 DebugDrawer::DebugDrawer() :
 	_colorStack(std::stack<glm::vec3>()),
 	_transformStack(std::stack<glm::mat4>()),
-	_viewProjection(glm::mat4(1.0f)),
-	_lineOffset(0),
-	_triangleOffset(0)
+	_isOverlay(false),
+	_pending(Batch()),
+	_ringData(nullptr),
+	_ringRegion(0),
+	_ringOffset(0)
 {
-	_linesVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_linesVBO->LoadData<VertexPosCol>(nullptr, LINE_BATCH_SIZE * 2);
-	_linesVAO = VertexArrayObject::Create();
-	_linesVAO->AddVertexBuffer(_linesVBO, VertexPosCol::V_DECL);
+	// One big buffer that stays mapped forever, so uploading is just a memcpy
+	_ringVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
+	_ringData = static_cast<VertexPosCol*>(_ringVBO->AllocatePersistent(sizeof(VertexPosCol), RING_VERTICES_PER_FRAME * RING_FRAME_COUNT));
+	_ringVAO = VertexArrayObject::Create();
+	_ringVAO->AddVertexBuffer(_ringVBO, VertexPosCol::V_DECL);
 
-	_trisVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_trisVBO->LoadData<VertexPosCol>(nullptr, TRI_BATCH_SIZE * 3);
-	_trisVAO = VertexArrayObject::Create();
-	_trisVAO->AddVertexBuffer(_trisVBO, VertexPosCol::V_DECL);
+	for (size_t ix = 0; ix < RING_FRAME_COUNT; ix++) {
+		_ringFences[ix] = nullptr;
+	}
 
 	_colorStack.push(glm::vec3(1.0f));
 	_transformStack.push(glm::mat4(1.0f));
 }
 
+DebugDrawer::~DebugDrawer() {
+	for (size_t ix = 0; ix < RING_FRAME_COUNT; ix++) {
+		if (_ringFences[ix] != nullptr) {
+			glDeleteSync(_ringFences[ix]);
+			_ringFences[ix] = nullptr;
+		}
+	}
+}
+
 void DebugDrawer::PushColor(const glm::vec3& color) {
 	_colorStack.push(color);
 }
@@ -33,15 +50,22 @@ glm::vec3 DebugDrawer::PopColor() {
 }
 
 void DebugDrawer::PushWorldMatrix(const glm::mat4& value) {
-	FlushAll();
 	_transformStack.push(value);
 }
 
 void DebugDrawer::PopWorldMatrix() {
 	LOG_ASSERT(_transformStack.size() > 1, "Attempting to pop more transforms than you are pushing! Check your code!");
-	FlushAll();
 	_transformStack.pop();
+}
 
+void DebugDrawer::SetOverlay(bool overlay) {
+	_isOverlay = overlay;
+}
+
+void DebugDrawer::_Append(Primitive primitive, const glm::vec3& position, const glm::vec3& color) {
+	// Transforms are baked in here, so that changing them doesn't force a flush
+	glm::vec3 worldPos = _transformStack.size() > 1 ? glm::vec3(_transformStack.top() * glm::vec4(position, 1.0f)) : position;
+	_pending.Streams[_isOverlay ? 1 : 0][(int)primitive].emplace_back(worldPos, glm::vec4(color, 1.0f));
 }
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2) {
@@ -54,34 +78,26 @@ void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color1, const glm::vec3& color2)
 {
-	_lineBuffer[_lineOffset + 0].Color = glm::vec4(color1, 1.0f);
-	_lineBuffer[_lineOffset + 0].Position = p1;
-	_lineBuffer[_lineOffset + 1].Color = glm::vec4(color2, 1.0f);
-	_lineBuffer[_lineOffset + 1].Position = p2;
-
-	_lineOffset += 2;
-	if (_lineOffset >= LINE_BATCH_SIZE) {
-		FlushLines();
-	}
+	_Append(Primitive::Lines, p1, color1);
+	_Append(Primitive::Lines, p2, color2);
 }
 
 void DebugDrawer::FlushLines()
 {
-	if (_lineOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_linesVBO->LoadData<VertexPosCol>(_lineBuffer, LINE_BATCH_SIZE * 2);
-		_linesVAO->Bind();
-		_linesVAO->Draw(DrawMode::LineList);
-		_linesVAO->Unbind();
-		_lineOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_FlushPending(Primitive::Lines);
+}
+
+void DebugDrawer::DrawPoint(const glm::vec3& p) {
+	DrawPoint(p, _colorStack.top());
+}
+
+void DebugDrawer::DrawPoint(const glm::vec3& p, const glm::vec3& color) {
+	_Append(Primitive::Points, p, color);
+}
+
+void DebugDrawer::FlushPoints()
+{
+	_FlushPending(Primitive::Points);
 }
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
@@ -95,79 +111,160 @@ void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::v
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3)
 {
-	_triBuffer[_triangleOffset + 0].Color = glm::vec4(c1, 1.0f);
-	_triBuffer[_triangleOffset + 0].Position = p1;
-	_triBuffer[_triangleOffset + 1].Color = glm::vec4(c2, 1.0f);
-	_triBuffer[_triangleOffset + 1].Position = p2;
-	_triBuffer[_triangleOffset + 2].Color = glm::vec4(c3, 1.0f);
-	_triBuffer[_triangleOffset + 2].Position = p3;
-
-	_triangleOffset += 3;
-	if (_triangleOffset >= TRI_BATCH_SIZE) {
-		FlushTris();
-	}
+	_Append(Primitive::Tris, p1, c1);
+	_Append(Primitive::Tris, p2, c2);
+	_Append(Primitive::Tris, p3, c3);
 }
 
 void DebugDrawer::FlushTris()
 {
-	if (_triangleOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_trisVBO->LoadData<VertexPosCol>(_triBuffer, TRI_BATCH_SIZE * 3);
-		_trisVAO->Bind();
-		_trisVAO->Draw(DrawMode::LineList);
-		_trisVAO->Unbind();
-		_triangleOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_FlushPending(Primitive::Tris);
 }
 
 void DebugDrawer::FlushAll()
 {
-	FlushLines();
+	if (!RenderThread::IsRenderThread()) {
+		return;
+	}
 	FlushTris();
+	FlushLines();
+	FlushPoints();
+	// Everything drawn from this region has been submitted, fence it off and move on
+	if (_ringOffset > 0) {
+		_AdvanceRing();
+	}
+}
+
+void DebugDrawer::TakeBatch(Batch& batch) {
+	batch.ViewProjection = _pending.ViewProjection;
+	for (int overlay = 0; overlay < 2; overlay++) {
+		for (int primitive = 0; primitive < PRIMITIVE_COUNT; primitive++) {
+			batch.Streams[overlay][primitive].clear();
+			batch.Streams[overlay][primitive].swap(_pending.Streams[overlay][primitive]);
+		}
+	}
+}
+
+void DebugDrawer::DrawBatch(const Batch& batch) {
+	_Flush(batch, Primitive::Tris);
+	_Flush(batch, Primitive::Lines);
+	_Flush(batch, Primitive::Points);
+	if (_ringOffset > 0) {
+		_AdvanceRing();
+	}
+}
+
+void DebugDrawer::_FlushPending(Primitive primitive) {
+	// Off the render thread we hold on to everything until it's taken with TakeBatch
+	if (!RenderThread::IsRenderThread()) {
+		return;
+	}
+	_Flush(_pending, primitive);
+	_pending.Streams[0][(int)primitive].clear();
+	_pending.Streams[1][(int)primitive].clear();
+}
+
+void DebugDrawer::_Flush(const Batch& batch, Primitive primitive) {
+	static const DrawMode modes[PRIMITIVE_COUNT] = { DrawMode::LineList, DrawMode::TriangleList, DrawMode::Points };
+	static const size_t primitiveSizes[PRIMITIVE_COUNT] = { 2, 3, 1 };
+	size_t primitiveSize = primitiveSizes[(int)primitive];
+
+	if (batch.Streams[0][(int)primitive].empty() && batch.Streams[1][(int)primitive].empty()) {
+		return;
+	}
+
+	__Shader->Bind();
+	// World transforms are applied when primitives are added, so we only need the camera here
+	__Shader->SetUniformMatrix(U_MVP, batch.ViewProjection);
+	_ringVAO->Bind();
+	if (primitive == Primitive::Points) {
+		glPointSize(POINT_SIZE);
+	}
+	bool depthTestWasEnabled = GlStateCache::IsDepthTestEnabled();
+
+	for (int overlay = 0; overlay < 2; overlay++) {
+		const std::vector<VertexPosCol>& stream = batch.Streams[overlay][(int)primitive];
+		GlStateCache::SetDepthTestEnabled(overlay == 0 ? depthTestWasEnabled : false);
+
+		// Normally this is a single copy and draw, but we split the stream up if it does not
+		// fit in what's left of the current region
+		size_t written = 0;
+		while (written < stream.size()) {
+			size_t space = ((RING_VERTICES_PER_FRAME - _ringOffset) / primitiveSize) * primitiveSize;
+			if (space == 0) {
+				_AdvanceRing();
+				continue;
+			}
+			size_t count = std::min(space, stream.size() - written);
+			size_t first = _ringRegion * RING_VERTICES_PER_FRAME + _ringOffset;
+			memcpy(_ringData + first, stream.data() + written, count * sizeof(VertexPosCol));
+			glDrawArrays((GLenum)modes[(int)primitive], (GLint)first, (GLsizei)count);
+
+			_ringOffset += count;
+			written += count;
+		}
+	}
+
+	GlStateCache::SetDepthTestEnabled(depthTestWasEnabled);
+}
+
+void DebugDrawer::_AdvanceRing() {
+	// Fence off the region we just finished, so we know when the GPU is done reading it
+	_ringFences[_ringRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_ringRegion = (_ringRegion + 1) % RING_FRAME_COUNT;
+	_ringOffset = 0;
+
+	// Before we write into the next region, make sure the GPU has finished with it. With a
+	// few frames of headroom this should almost never actually wait
+	GLsync fence = _ringFences[_ringRegion];
+	if (fence != nullptr) {
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fence);
+		_ringFences[_ringRegion] = nullptr;
+	}
 }
 
 void DebugDrawer::SetViewProjection(const glm::mat4& viewProjection)
 {
-	_viewProjection = viewProjection;
+	_pending.ViewProjection = viewProjection;
 }
 
 DebugDrawer& DebugDrawer::Get() {
 	if (__Instance == nullptr) {
-		__Instance = new DebugDrawer();
-
-		const char* vs_source = R"LIT(#version 450
-				layout (location = 0) in vec3 inPosition;
-				layout (location = 1) in vec4 inColor;
-
-				layout (location = 0) out vec4 outColor;
-
-				layout (location = 0) uniform mat4 u_MVP;
-
-				void main() {
-					gl_Position = u_MVP * vec4(inPosition, 1.0);
-					outColor = inColor;
-				}
-			)LIT";
-		const char* fs_source = R"LIT(#version 450
-				layout (location=0) in  vec4 inColor;
-				layout (location=0) out vec4 outColor;
-
-				void main() {
-					outColor = inColor;
-				}
-			)LIT";
-
-		__Shader = Shader::Create();
-		__Shader->LoadShaderPart(vs_source, ShaderPartType::Vertex);
-		__Shader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
-		__Shader->Link();
+		// Setting up our ring buffer and shader needs the GL context
+		RenderThread::Invoke([]() {
+			__Instance = new DebugDrawer();
+
+			const char* vs_source = R"LIT(#version 450
+					layout (location = 0) in vec3 inPosition;
+					layout (location = 1) in vec4 inColor;
+
+					layout (location = 0) out vec4 outColor;
+
+					layout (location = 0) uniform mat4 u_MVP;
+
+					void main() {
+						gl_Position = u_MVP * vec4(inPosition, 1.0);
+						outColor = inColor;
+					}
+				)LIT";
+			const char* fs_source = R"LIT(#version 450
+					layout (location=0) in  vec4 inColor;
+					layout (location=0) out vec4 outColor;
+
+					void main() {
+						outColor = inColor;
+					}
+				)LIT";
+
+			__Shader = Shader::Create();
+			__Shader->LoadShaderPart(vs_source, ShaderPartType::Vertex);
+			__Shader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
+			__Shader->Link();
+		});
 	}
 	return *__Instance;
 }
@@ -175,8 +272,10 @@ DebugDrawer& DebugDrawer::Get() {
 void DebugDrawer::Uninitialize()
 {
 	if (__Instance != nullptr) {
-		delete __Instance;
-		__Instance = nullptr;
-		__Shader = nullptr;
+		RenderThread::Invoke([]() {
+			delete __Instance;
+			__Instance = nullptr;
+			__Shader = nullptr;
+		});
 	}
 }
\ No newline at end of file
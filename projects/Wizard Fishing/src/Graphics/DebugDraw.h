@@ -1,20 +1,46 @@
 #pragma once
 #include <GLM/glm.hpp>
 #include <stack>
+#include <vector>
 #include "Graphics/VertexTypes.h"
+#include "Graphics/VertexArrayObject.h"
 #include "Graphics/Shader.h"
 
 /// <summary>
-/// Utility class for drawing lines and triangles in an immediate mode style
+/// Utility class for drawing lines, triangles and points in an immediate mode style
 /// 
 /// Includes a stack for transformations and color, to ease implementation of complex
 /// debuggers
+///
+/// Primitives are collected on the CPU into separate streams for each primitive type, and for
+/// depth tested vs overlay (always on top) drawing. When flushed, each stream is copied into a
+/// persistently mapped ring buffer and drawn with a single draw call. The ring is split into
+/// RING_FRAME_COUNT regions guarded by fences, so we never write over data the GPU is still using
+///
+/// Primitives can be added from the main thread while the render thread is running. In that
+/// case the Flush functions do nothing, and the main thread hands the collected primitives to
+/// the render thread each frame with TakeBatch, which then draws them with DrawBatch
 /// </summary>
 class DebugDrawer
 {
 public:
-	inline static const size_t LINE_BATCH_SIZE = 8192;
-	inline static const size_t TRI_BATCH_SIZE = 4096;
+	// The number of regions in our ring buffer, allowing this many flushes to be in flight at once
+	inline static const size_t RING_FRAME_COUNT = 3;
+	// The number of vertices that fit in a single region of the ring buffer
+	inline static const size_t RING_VERTICES_PER_FRAME = 1 << 18;
+	// The size in pixels of points drawn with DrawPoint
+	inline static const float  POINT_SIZE = 4.0f;
+	// The number of primitive types that we keep separate streams for
+	inline static const int    PRIMITIVE_COUNT = 3;
+
+	/// <summary>
+	/// All of the primitives collected over a frame, along with the camera they should be drawn with
+	/// </summary>
+	struct Batch {
+		glm::mat4 ViewProjection = glm::mat4(1.0f);
+		// Vertices waiting to be drawn, indexed by [overlay][primitive]
+		std::vector<VertexPosCol> Streams[2][PRIMITIVE_COUNT];
+	};
 
 	// Delete copy and mode
 
@@ -23,7 +49,7 @@ public:
 	DebugDrawer& operator =(const DebugDrawer& other) = delete;
 	DebugDrawer& operator =(DebugDrawer&& other) = delete;
 
-	virtual ~DebugDrawer() = default;
+	virtual ~DebugDrawer();
 
 	/// <summary>
 	/// Gets the singleton instance of the debug drawer
@@ -47,15 +73,27 @@ public:
 	glm::vec3 PopColor();
 
 	/// <summary>
-	/// Pushes a new transform to the stack, replacing the existing value and flushing all lines and tris
+	/// Pushes a new transform to the stack, replacing the existing value. Transforms are
+	/// applied as primitives are added, so this does not cause a flush
 	/// </summary>
 	/// <param name="world">The new world transform to use for drawing</param>
 	void PushWorldMatrix(const glm::mat4& world);
 	/// <summary>
-	/// Pops a transform from the stack, replacing the existing value and flushing all lines and tris
+	/// Pops a transform from the stack, replacing the existing value
 	/// </summary>
 	void PopWorldMatrix();
 
+	/// <summary>
+	/// Sets whether primitives added after this call are drawn on top of everything (overlay),
+	/// or are depth tested against the scene (the default)
+	/// </summary>
+	/// <param name="overlay">True to draw on top of the scene, false to depth test</param>
+	void SetOverlay(bool overlay);
+	/// <summary>
+	/// Gets whether primitives are currently being added to the overlay streams
+	/// </summary>
+	bool IsOverlay() const { return _isOverlay; }
+
 	/// <summary>
 	/// Draws a line between 2 points using the current debug color
 	/// </summary>
@@ -82,6 +120,22 @@ public:
 	/// </summary>
 	void FlushLines();
 
+	/// <summary>
+	/// Draws a single point using the current debug color
+	/// </summary>
+	/// <param name="p">The position of the point</param>
+	void DrawPoint(const glm::vec3& p);
+	/// <summary>
+	/// Draws a single point with the given color
+	/// </summary>
+	/// <param name="p">The position of the point</param>
+	/// <param name="color">Color for the point</param>
+	void DrawPoint(const glm::vec3& p, const glm::vec3& color);
+	/// <summary>
+	/// Flushes all points to the screen, resetting our point count to 0
+	/// </summary>
+	void FlushPoints();
+
 	/// <summary>
 	/// Draws a triangle between 3 points using the current debug color
 	/// Remember to keep winding order in mind!
@@ -116,7 +170,8 @@ public:
 	void FlushTris();
 
 	/// <summary>
-	/// Flushes any remaining triangles and lines, drawing them to the screen and resetting their counters
+	/// Flushes any remaining triangles, lines and points, drawing them to the screen and resetting their counters.
+	/// Ideally this is only called once per frame, so each primitive type is drawn with a single call
 	/// </summary>
 	void FlushAll();
 
@@ -125,23 +180,52 @@ public:
 	/// </summary>
 	void SetViewProjection(const glm::mat4& viewProjection);
 
+	/// <summary>
+	/// Moves all of the primitives that are waiting to be drawn into the given batch, leaving
+	/// our streams empty. The batch's vectors are swapped with ours, so passing the same batch
+	/// every frame avoids re-allocating
+	/// </summary>
+	/// <param name="batch">The batch to fill</param>
+	void TakeBatch(Batch& batch);
+	/// <summary>
+	/// Draws all of the primitives in a batch, must be called from the render thread
+	/// </summary>
+	/// <param name="batch">The batch to draw</param>
+	void DrawBatch(const Batch& batch);
+
 protected:
 	DebugDrawer();
 
+	// The types of primitive we keep separate streams for
+	enum class Primitive {
+		Lines = 0,
+		Tris = 1,
+		Points = 2
+	};
+
 	std::stack<glm::vec3> _colorStack;
 	std::stack<glm::mat4> _transformStack;
-	glm::mat4    _viewProjection;
-	glm::mat4    _worldMatrix;
-
-	size_t       _lineOffset;
-	VertexPosCol _lineBuffer[LINE_BATCH_SIZE * 2];
-	size_t       _triangleOffset;
-	VertexPosCol _triBuffer[TRI_BATCH_SIZE * 3];
-
-	VertexBuffer::Sptr _linesVBO;
-	VertexArrayObject::Sptr _linesVAO;
-	VertexBuffer::Sptr _trisVBO;
-	VertexArrayObject::Sptr _trisVAO;
+	bool         _isOverlay;
+
+	// The primitives waiting to be drawn, and the camera to draw them with
+	Batch        _pending;
+
+	VertexBuffer::Sptr      _ringVBO;
+	VertexArrayObject::Sptr _ringVAO;
+	VertexPosCol*           _ringData;
+	GLsync                  _ringFences[RING_FRAME_COUNT];
+	// The region of the ring we are writing to, and how many vertices we have written to it
+	size_t                  _ringRegion;
+	size_t                  _ringOffset;
+
+	// Adds a primitive to the current stream, applying our world transform
+	void _Append(Primitive primitive, const glm::vec3& position, const glm::vec3& color);
+	// Copies and draws all vertices in a batch for the given primitive type, in both the depth tested and overlay streams
+	void _Flush(const Batch& batch, Primitive primitive);
+	// Draws and clears our pending primitives of the given type, if we are on the render thread
+	void _FlushPending(Primitive primitive);
+	// Moves to the next region of the ring, waiting for the GPU if it is still using it
+	void _AdvanceRing();
 
 	inline static DebugDrawer* __Instance = nullptr;
 	inline static Shader::Sptr __Shader = nullptr;
@@ -0,0 +1,95 @@
+#include "DynamicResolution.h"
+
+#include <imgui.h>
+#include "GlStateCache.h"
+#include "GpuProfiler.h"
+
+static constexpr UniformHandle U_UV_SCALE("u_UvScale");
+static constexpr UniformHandle U_SHARPNESS("u_Sharpness");
+
+DynamicResolution::DynamicResolution() :
+	Enabled(true),
+	TargetFrameTime(16.0f),
+	MinScale(0.5f),
+	MaxScale(1.0f),
+	Sharpness(0.5f),
+	_scale(1.0f),
+	_smoothedTime(0.0f),
+	_lastResolvedFrame(0)
+{ }
+
+void DynamicResolution::Update() {
+	if (!Enabled) {
+		_scale = MaxScale;
+		return;
+	}
+
+	// The profiler only has something new for us every so often, don't count old results twice
+	uint64_t resolvedFrames = GpuProfiler::GetResolvedFrameCount();
+	if (resolvedFrames == _lastResolvedFrame) {
+		return;
+	}
+	_lastResolvedFrame = resolvedFrames;
+
+	float frameTime = GpuProfiler::GetLastFrameTime();
+	if (frameTime <= 0.0f) {
+		return;
+	}
+	_smoothedTime = _smoothedTime > 0.0f ? glm::mix(_smoothedTime, frameTime, SMOOTHING) : frameTime;
+
+	float ratio = TargetFrameTime / _smoothedTime;
+	if (glm::abs(1.0f - ratio) >= DEAD_ZONE) {
+		float ideal = _scale * glm::sqrt(ratio);
+		_scale = glm::mix(_scale, ideal, ADJUST_RATE);
+	}
+	_scale = glm::clamp(_scale, MinScale, MaxScale);
+}
+
+glm::ivec2 DynamicResolution::GetRenderSize(const glm::ivec2& outputSize) const {
+	glm::vec2 scaled = glm::vec2(outputSize) * _scale / (float)SIZE_ALIGNMENT;
+	glm::ivec2 result = glm::ivec2(glm::round(scaled)) * SIZE_ALIGNMENT;
+	return glm::clamp(result, glm::ivec2(SIZE_ALIGNMENT), glm::max(outputSize, glm::ivec2(1)));
+}
+
+void DynamicResolution::RenderImGui() {
+	ImGui::Checkbox("Dynamic Resolution", &Enabled);
+	ImGui::DragFloat("GPU Budget (ms)", &TargetFrameTime, 0.1f, 1.0f, 100.0f);
+	// Each slider is limited by the other, and typed in values can go past the limits, so the
+	// range is fixed up afterwards as well
+	ImGui::SliderFloat("Min Scale", &MinScale, 0.25f, MaxScale);
+	ImGui::SliderFloat("Max Scale", &MaxScale, MinScale, 1.0f);
+	MaxScale = glm::max(MaxScale, MinScale);
+	ImGui::SliderFloat("Sharpness", &Sharpness, 0.0f, 1.0f);
+	ImGui::Text("Render Scale: %.0f%% (GPU %.2f ms)", _scale * 100.0f, _smoothedTime);
+}
+
+Upscaler::Upscaler() :
+	_shader(nullptr),
+	_emptyVao(nullptr)
+{
+	_shader = Shader::Create();
+	_shader->LoadShaderPartFromFile("shaders/fullscreen_vert.glsl", ShaderPartType::Vertex);
+	_shader->LoadShaderPartFromFile("shaders/upscale_sharpen_frag.glsl", ShaderPartType::Fragment);
+	_shader->Link();
+
+	_emptyVao = VertexArrayObject::Create();
+}
+
+void Upscaler::Resolve(GLuint source, const glm::ivec2& sourceSize, const glm::ivec2& renderSize, float sharpness) {
+	if (source == 0) {
+		return;
+	}
+
+	// We cover every pixel, so there's no need to test or write depth
+	bool depthTestWasEnabled = GlStateCache::IsDepthTestEnabled();
+	GlStateCache::SetDepthTestEnabled(false);
+
+	_shader->Bind();
+	_shader->SetUniform(U_UV_SCALE, glm::vec2(renderSize) / glm::vec2(sourceSize));
+	_shader->SetUniform(U_SHARPNESS, sharpness);
+	GlStateCache::BindTextureUnit(0, source);
+	_emptyVao->Bind();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	GlStateCache::SetDepthTestEnabled(depthTestWasEnabled);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Shader.h"
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// Picks the resolution that the scene is rendered at each frame, so that the GPU time for
+/// a frame stays near a target budget
+///
+/// The controller reads the total frame time from the GpuProfiler, and scales the render
+/// resolution by the square root of how far over or under budget we are (since fragment
+/// cost goes with the pixel count). Results from the profiler are a few frames old, so
+/// we only move part of the way towards the new scale each time, and ignore small errors
+///
+/// This only does CPU work, and is updated from the main thread
+/// </summary>
+class DynamicResolution {
+public:
+	typedef std::shared_ptr<DynamicResolution> Sptr;
+
+	// How much of the gap to the ideal scale we close on each new GPU timing
+	static constexpr float ADJUST_RATE = 0.25f;
+	// How far (as a fraction of the budget) the frame time can be off before we react
+	static constexpr float DEAD_ZONE = 0.05f;
+	// How quickly our smoothed frame time follows the measured one
+	static constexpr float SMOOTHING = 0.3f;
+	// The render size is rounded to a multiple of this, so tiny scale changes don't resize anything
+	static constexpr int   SIZE_ALIGNMENT = 8;
+
+	static inline Sptr Create() {
+		return std::make_shared<DynamicResolution>();
+	}
+
+	DynamicResolution();
+	~DynamicResolution() = default;
+
+	// When false, the scene is always rendered at MaxScale
+	bool  Enabled;
+	// The GPU time we try to stay within, in milliseconds
+	float TargetFrameTime;
+	// The smallest and largest fraction of the window size we will render at
+	float MinScale;
+	float MaxScale;
+	// How strongly the upscaled image is sharpened, between 0 and 1
+	float Sharpness;
+
+	/// <summary>
+	/// Updates the render scale if a new GPU frame time is available, call once per frame
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// Gets the current fraction of the output size that the scene is rendered at
+	/// </summary>
+	float GetScale() const { return _scale; }
+	/// <summary>
+	/// Gets the size in pixels that the scene should be rendered at
+	/// </summary>
+	/// <param name="outputSize">The size of the final image, usually the window size</param>
+	glm::ivec2 GetRenderSize(const glm::ivec2& outputSize) const;
+
+	/// <summary>
+	/// Draws the ImGui controls for our settings, along with our current state
+	/// </summary>
+	void RenderImGui();
+
+protected:
+	float    _scale;
+	float    _smoothedTime;
+	uint64_t _lastResolvedFrame;
+};
+
+/// <summary>
+/// Scales the scene up to the final output with bilinear filtering followed by a sharpening pass
+///
+/// The scene is rendered into a texture allocated at the output size, and lower resolutions only
+/// use the bottom left corner of it, so changing the render scale never re-allocates anything.
+/// The texture itself belongs to the render graph
+///
+/// Must only be used from the render thread
+/// </summary>
+class Upscaler {
+public:
+	typedef std::shared_ptr<Upscaler> Sptr;
+
+	static inline Sptr Create() {
+		return std::make_shared<Upscaler>();
+	}
+
+	Upscaler();
+	~Upscaler() = default;
+
+	Upscaler(const Upscaler& other) = delete;
+	Upscaler& operator=(const Upscaler& other) = delete;
+
+	/// <summary>
+	/// Draws the scene into the currently bound framebuffer, which should have a viewport
+	/// covering the whole output
+	/// </summary>
+	/// <param name="source">The texture that the scene was rendered into</param>
+	/// <param name="sourceSize">The full size of the source texture</param>
+	/// <param name="renderSize">The size that the scene was rendered at, in the bottom left of the source</param>
+	/// <param name="sharpness">How strongly to sharpen the result, between 0 and 1</param>
+	void Resolve(GLuint source, const glm::ivec2& sourceSize, const glm::ivec2& renderSize, float sharpness);
+
+protected:
+	Shader::Sptr            _shader;
+	// Our fullscreen triangle is generated in the vertex shader, but GL still needs a VAO bound
+	VertexArrayObject::Sptr _emptyVao;
+};
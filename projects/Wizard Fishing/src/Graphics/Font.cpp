@@ -0,0 +1,112 @@
+#include "Graphics/Font.h"
+#include <Logging.h>
+#include "Graphics/RenderThread.h"
+#include "Utils/FileHelpers.h"
+
+Font::Font(const std::string& filename, float pixelSize) :
+	_filename(filename),
+	_pixelSize(pixelSize),
+	_fileData(std::vector<uint8_t>()),
+	_fontInfo(stbtt_fontinfo()),
+	_scale(0.0f),
+	_ascent(0.0f),
+	_lineHeight(0.0f),
+	_glyphs(),
+	_atlas(nullptr)
+{
+	std::string contents = FileHelpers::ReadFile(filename);
+	if (contents.empty()) {
+		return;
+	}
+	_fileData.assign(contents.begin(), contents.end());
+
+	if (!stbtt_InitFont(&_fontInfo, _fileData.data(), stbtt_GetFontOffsetForIndex(_fileData.data(), 0))) {
+		LOG_ERROR("Failed to read font \"{}\"", filename);
+		return;
+	}
+
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(&_fontInfo, &ascent, &descent, &lineGap);
+	_scale = stbtt_ScaleForPixelHeight(&_fontInfo, pixelSize);
+	_ascent = ascent * _scale;
+	_lineHeight = (ascent - descent + lineGap) * _scale;
+
+	// Keep doubling the atlas until every glyph fits. Glyphs are oversampled so that they stay
+	// sharp when they land between pixels
+	stbtt_packedchar packed[CHAR_COUNT];
+	std::vector<uint8_t> pixels;
+	int atlasSize = MIN_ATLAS_SIZE;
+	bool packedAll = false;
+	for (; atlasSize <= MAX_ATLAS_SIZE && !packedAll; atlasSize *= 2) {
+		pixels.assign((size_t)atlasSize * atlasSize, 0);
+		stbtt_pack_context context;
+		if (!stbtt_PackBegin(&context, pixels.data(), atlasSize, atlasSize, 0, GLYPH_PADDING, nullptr)) {
+			break;
+		}
+		stbtt_PackSetOversampling(&context, 2, 2);
+		packedAll = stbtt_PackFontRange(&context, _fileData.data(), 0, pixelSize, FIRST_CHAR, CHAR_COUNT, packed) != 0;
+		stbtt_PackEnd(&context);
+	}
+	if (!packedAll) {
+		LOG_ERROR("Could not fit font \"{}\" at {}px into a {}x{} atlas", filename, pixelSize, MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+		return;
+	}
+	atlasSize /= 2;
+
+	// Measure every glyph from a pen at the origin, so laying out text is just adding offsets
+	for (int ix = 0; ix < CHAR_COUNT; ix++) {
+		float x = 0.0f, y = 0.0f;
+		stbtt_aligned_quad quad;
+		stbtt_GetPackedQuad(packed, atlasSize, atlasSize, ix, &x, &y, &quad, 0);
+		_glyphs[ix].Min = glm::vec2(quad.x0, quad.y0);
+		_glyphs[ix].Max = glm::vec2(quad.x1, quad.y1);
+		_glyphs[ix].UvMin = glm::vec2(quad.s0, quad.t0);
+		_glyphs[ix].UvMax = glm::vec2(quad.s1, quad.t1);
+		_glyphs[ix].Advance = x;
+	}
+
+	// The rows go up in the same order that stb wrote them, so the glyph UVs can be used as-is
+	RenderThread::Invoke([&]() {
+		Texture2DDescription description;
+		description.Width = atlasSize;
+		description.Height = atlasSize;
+		description.Format = InternalFormat::R8;
+		description.HorizontalWrap = WrapMode::ClampToEdge;
+		description.VerticalWrap = WrapMode::ClampToEdge;
+		description.MinificationFilter = MinFilter::Linear;
+		description.MagnificationFilter = MagFilter::Linear;
+		description.MaxAnisotropic = 1.0f;
+		description.GenerateMipMaps = false;
+		_atlas = std::make_shared<Texture2D>(description);
+		_atlas->LoadData(atlasSize, atlasSize, PixelFormat::Red, PixelType::UByte, pixels.data());
+	});
+}
+
+Font::Sptr Font::Get(const std::string& filename, float pixelSize) {
+	std::string key = filename + "@" + std::to_string(pixelSize);
+	auto it = __LoadedFonts.find(key);
+	if (it != __LoadedFonts.end()) {
+		Sptr existing = it->second.lock();
+		if (existing != nullptr) {
+			return existing;
+		}
+	}
+
+	Sptr result = std::make_shared<Font>(filename, pixelSize);
+	if (!result->IsValid()) {
+		return nullptr;
+	}
+	__LoadedFonts[key] = result;
+	return result;
+}
+
+const Font::Glyph* Font::GetGlyph(int codePoint) const {
+	if (codePoint < FIRST_CHAR || codePoint >= FIRST_CHAR + CHAR_COUNT) {
+		return nullptr;
+	}
+	return &_glyphs[codePoint - FIRST_CHAR];
+}
+
+float Font::GetKerning(int first, int second) const {
+	return stbtt_GetCodepointKernAdvance(&_fontInfo, first, second) * _scale;
+}
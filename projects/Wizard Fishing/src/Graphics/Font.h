@@ -0,0 +1,113 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+#include <stb_truetype.h>
+#include "Graphics/Texture2D.h"
+
+/// <summary>
+/// A TrueType font rasterized at a single pixel size, with all of it's printable ASCII glyphs
+/// packed into one single channel atlas texture
+///
+/// Fonts are shared, use Font::Get to load a font or grab the one that is already loaded for
+/// that file and size
+/// </summary>
+class Font {
+public:
+	typedef std::shared_ptr<Font> Sptr;
+
+	// The range of characters that we pack into the atlas
+	inline static const int FIRST_CHAR = ' ';
+	inline static const int CHAR_COUNT = '~' - ' ' + 1;
+	// The atlas starts at this size, and doubles until all of the glyphs fit
+	inline static const int MIN_ATLAS_SIZE = 256;
+	inline static const int MAX_ATLAS_SIZE = 4096;
+	// Empty space between glyphs in the atlas, so filtering doesn't pick up the neighbours
+	inline static const int GLYPH_PADDING = 2;
+
+	/// <summary>
+	/// A single glyph, measured from the pen position on the baseline with y pointing down
+	/// </summary>
+	struct Glyph {
+		// The corners of the glyph's quad, in pixels from the pen position
+		glm::vec2 Min;
+		glm::vec2 Max;
+		// The glyph's region in the atlas, UvMin goes with the top left corner
+		glm::vec2 UvMin;
+		glm::vec2 UvMax;
+		// How far to move the pen after this glyph
+		float     Advance;
+	};
+
+	Font(const Font& other) = delete;
+	Font& operator=(const Font& other) = delete;
+
+	/// <summary>
+	/// Loads and packs a font file at the given size. Prefer Font::Get, which will share fonts
+	/// that are already loaded
+	/// </summary>
+	/// <param name="filename">The path to the .ttf file to load</param>
+	/// <param name="pixelSize">The height of a line of text, in pixels</param>
+	Font(const std::string& filename, float pixelSize);
+	~Font() = default;
+
+	/// <summary>
+	/// Gets the font for the given file and size, loading and packing it if this is the
+	/// first time it was requested
+	/// </summary>
+	/// <param name="filename">The path to the .ttf file to load</param>
+	/// <param name="pixelSize">The height of a line of text, in pixels</param>
+	/// <returns>The font, or nullptr if it failed to load</returns>
+	static Sptr Get(const std::string& filename, float pixelSize);
+
+	/// <summary>
+	/// Gets the glyph for a character, or nullptr if the character is not in our atlas
+	/// </summary>
+	const Glyph* GetGlyph(int codePoint) const;
+	/// <summary>
+	/// Gets the extra distance to move the pen between two characters, usually negative
+	/// </summary>
+	float GetKerning(int first, int second) const;
+
+	/// <summary>
+	/// Gets the distance in pixels between the baselines of two lines of text
+	/// </summary>
+	float GetLineHeight() const { return _lineHeight; }
+	/// <summary>
+	/// Gets the distance in pixels from the top of a line to it's baseline
+	/// </summary>
+	float GetAscent() const { return _ascent; }
+	/// <summary>
+	/// Gets the size that this font was rasterized at
+	/// </summary>
+	float GetPixelSize() const { return _pixelSize; }
+	/// <summary>
+	/// Gets the file that this font was loaded from
+	/// </summary>
+	const std::string& GetFilename() const { return _filename; }
+	/// <summary>
+	/// Gets the texture that the glyphs are packed into, glyph coverage is stored in the red channel
+	/// </summary>
+	const Texture2D::Sptr& GetAtlas() const { return _atlas; }
+
+	/// <summary>
+	/// Returns true if the font was loaded and packed successfully
+	/// </summary>
+	bool IsValid() const { return _atlas != nullptr; }
+
+protected:
+	std::string          _filename;
+	float                _pixelSize;
+	// stb_truetype reads straight from the file's data, so we need to keep it for kerning
+	std::vector<uint8_t> _fileData;
+	stbtt_fontinfo       _fontInfo;
+	float                _scale;
+	float                _ascent;
+	float                _lineHeight;
+	Glyph                _glyphs[CHAR_COUNT];
+	Texture2D::Sptr      _atlas;
+
+	inline static std::unordered_map<std::string, std::weak_ptr<Font>> __LoadedFonts;
+};
@@ -0,0 +1,305 @@
+#include "Graphics/FrameCapture.h"
+
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <imgui.h>
+#include <stb_image_write.h>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/GlDeleteList.h"
+#include "Logging.h"
+
+// How long we'll wait on a copy when the ring is full before giving up on it, in nanoseconds
+static const GLuint64 CAPTURE_WAIT_TIMEOUT = 1000000000;
+
+// Formats the current local time for use in file names, ex: 20240131_235959
+static std::string GetTimestamp() {
+	std::time_t now = std::time(nullptr);
+	std::tm local;
+#ifdef _WIN32
+	localtime_s(&local, &now);
+#else
+	localtime_r(&now, &local);
+#endif
+	char buffer[32];
+	std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", &local);
+	return buffer;
+}
+
+FrameCapture::FrameCapture() :
+	OutputDir("captures"),
+	RecordingFormat(Format::Raw),
+	BlockWhenFull(false),
+	_nextSlot(0),
+	_isScreenshotRequested(false),
+	_isRecording(false),
+	_recordingDir(""),
+	_recordingFrame(0),
+	_jobs(std::deque<EncodeJob>()),
+	_freePixels(std::vector<std::vector<uint8_t>>()),
+	_pendingFrames(0),
+	_stopRequested(false),
+	_encoders(std::vector<std::thread>())
+{
+	for (Slot& slot : _slots) {
+		slot.Buffer = 0;
+		slot.Capacity = 0;
+		slot.Fence = nullptr;
+		slot.Size = glm::ivec2(0);
+		slot.FileFormat = Format::Png;
+	}
+
+	// PNG compression is slow enough that one thread can't keep up with a full frame rate,
+	// but we leave most of the cores for the draw list builder and the render thread
+	int encoderCount = glm::clamp((int)std::thread::hardware_concurrency() / 4, 1, MAX_ENCODERS);
+	for (int ix = 0; ix < encoderCount; ix++) {
+		_encoders.emplace_back(&FrameCapture::_EncoderMain, this);
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	// The encoders finish whatever is already queued before they stop
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stopRequested = true;
+		_jobQueued.notify_all();
+	}
+	for (std::thread& encoder : _encoders) {
+		encoder.join();
+	}
+
+	GlDeleteList objects;
+	for (const Slot& slot : _slots) {
+		objects.Buffer(slot.Buffer).Fence(slot.Fence);
+	}
+	objects.DeleteLater();
+}
+
+void FrameCapture::SetRecording(bool isRecording) {
+	if (isRecording == _isRecording) {
+		return;
+	}
+	_isRecording = isRecording;
+	if (isRecording) {
+		_recordingDir = OutputDir + "/recording_" + GetTimestamp();
+		_recordingFrame = 0;
+		std::error_code error;
+		std::filesystem::create_directories(_recordingDir, error);
+		LOG_INFO("Recording to \"{}\"", _recordingDir);
+	} else {
+		LOG_INFO("Stopped recording after {} frames", _recordingFrame);
+	}
+}
+
+bool FrameCapture::TakeFrameRequest(std::string& outPath, Format& outFormat) {
+	if (_isRecording) {
+		char name[32];
+		snprintf(name, sizeof(name), "/frame_%05d", _recordingFrame++);
+		outPath = _recordingDir + name + (RecordingFormat == Format::Png ? ".png" : ".raw");
+		outFormat = RecordingFormat;
+		// A screenshot taken while recording would just be a copy of the recorded frame
+		_isScreenshotRequested = false;
+		return true;
+	}
+	if (_isScreenshotRequested) {
+		_isScreenshotRequested = false;
+		std::error_code error;
+		std::filesystem::create_directories(OutputDir, error);
+		outPath = OutputDir + "/screenshot_" + GetTimestamp() + "_" + std::to_string(_stats.Captured.load()) + ".png";
+		outFormat = Format::Png;
+		LOG_INFO("Saving screenshot to \"{}\"", outPath);
+		return true;
+	}
+	return false;
+}
+
+void FrameCapture::Capture(GLuint framebuffer, const glm::ivec2& size, const std::string& path, Format format) {
+	if (size.x <= 0 || size.y <= 0) {
+		return;
+	}
+
+	// If the encoders can't keep up, it's better to lose frames than to stall the game or run out of memory
+	{
+		std::unique_lock<std::mutex> guard(_lock);
+		if (_pendingFrames >= MAX_QUEUED_FRAMES) {
+			if (!BlockWhenFull) {
+				_stats.Dropped++;
+				return;
+			}
+			// At most RING_SIZE of the pending frames are still on the GPU, the rest are queued for
+			// the encoders, so this always finishes
+			_stats.Stalls++;
+			_jobDone.wait(guard, [&] { return _pendingFrames < MAX_QUEUED_FRAMES; });
+		}
+		_pendingFrames++;
+	}
+
+	// The next slot is the oldest one, so if it's still in use the GPU is a whole ring behind us
+	Slot& slot = _slots[_nextSlot];
+	if (slot.Fence != nullptr) {
+		_stats.Stalls++;
+		_Collect(slot, true);
+	}
+
+	size_t bytes = (size_t)size.x * size.y * 4;
+	if (slot.Capacity < bytes) {
+		if (slot.Buffer != 0) {
+			GlStateCache::OnBufferDeleted(slot.Buffer);
+			glDeleteBuffers(1, &slot.Buffer);
+		}
+		glCreateBuffers(1, &slot.Buffer);
+		glNamedBufferStorage(slot.Buffer, bytes, nullptr, GL_CLIENT_STORAGE_BIT);
+		slot.Capacity = bytes;
+	}
+
+	// With a pack buffer bound, glReadPixels only queues the copy instead of waiting for the frame to finish
+	GLint previousFramebuffer = 0;
+	GLint previousPackBuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPackBuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	if (framebuffer != 0) {
+		glNamedFramebufferReadBuffer(framebuffer, GL_COLOR_ATTACHMENT0);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+	// Rows are tightly packed, so make sure GL doesn't pad them out
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, previousPackBuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.Size = size;
+	slot.Path = path;
+	slot.FileFormat = format;
+	_nextSlot = (_nextSlot + 1) % RING_SIZE;
+	_stats.Captured++;
+}
+
+void FrameCapture::Poll() {
+	// The copies finish in the order they were made, so we can stop at the first one that isn't done
+	for (int ix = 0; ix < RING_SIZE; ix++) {
+		Slot& slot = _slots[(_nextSlot + ix) % RING_SIZE];
+		if (slot.Fence != nullptr && !_Collect(slot, false)) {
+			break;
+		}
+	}
+}
+
+void FrameCapture::Flush() {
+	for (int ix = 0; ix < RING_SIZE; ix++) {
+		Slot& slot = _slots[(_nextSlot + ix) % RING_SIZE];
+		if (slot.Fence != nullptr) {
+			_Collect(slot, true);
+		}
+	}
+
+	std::unique_lock<std::mutex> guard(_lock);
+	_jobDone.wait(guard, [&] { return _pendingFrames == 0; });
+}
+
+void FrameCapture::RenderImGui() {
+	if (ImGui::Button("Screenshot")) {
+		RequestScreenshot();
+	}
+	ImGui::SameLine();
+	bool isRecording = _isRecording;
+	if (ImGui::Checkbox("Record", &isRecording)) {
+		SetRecording(isRecording);
+	}
+	ImGui::SameLine();
+	bool isRaw = RecordingFormat == Format::Raw;
+	if (ImGui::Checkbox("Raw Frames", &isRaw)) {
+		RecordingFormat = isRaw ? Format::Raw : Format::Png;
+	}
+	ImGui::Text("Captures:   %d captured, %d written, %d dropped, %d stalls", (int)_stats.Captured.load(),
+		(int)_stats.Written.load(), (int)_stats.Dropped.load(), (int)_stats.Stalls.load());
+}
+
+bool FrameCapture::_Collect(Slot& slot, bool wait) {
+	GLenum status = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? CAPTURE_WAIT_TIMEOUT : 0);
+	if (status == GL_TIMEOUT_EXPIRED && !wait) {
+		return false;
+	}
+	glDeleteSync(slot.Fence);
+	slot.Fence = nullptr;
+
+	EncodeJob job;
+	job.Path = slot.Path;
+	job.FileFormat = slot.FileFormat;
+	job.Size = slot.Size;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		if (!_freePixels.empty()) {
+			job.Pixels = std::move(_freePixels.back());
+			_freePixels.pop_back();
+		}
+	}
+
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+		// The copy is done, so this doesn't wait on anything
+		job.Pixels.resize((size_t)slot.Size.x * slot.Size.y * 4);
+		glGetNamedBufferSubData(slot.Buffer, 0, job.Pixels.size(), job.Pixels.data());
+	} else {
+		LOG_WARN("Gave up waiting on the capture for \"{}\"", slot.Path);
+		job.Pixels.clear();
+	}
+
+	std::lock_guard<std::mutex> guard(_lock);
+	_jobs.push_back(std::move(job));
+	_jobQueued.notify_one();
+	return true;
+}
+
+void FrameCapture::_EncoderMain() {
+	while (true) {
+		EncodeJob job;
+		{
+			std::unique_lock<std::mutex> guard(_lock);
+			_jobQueued.wait(guard, [&] { return _stopRequested || !_jobs.empty(); });
+			if (_jobs.empty()) {
+				return;
+			}
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		bool written = !job.Pixels.empty() && _Encode(job);
+
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			if (written) {
+				_stats.Written++;
+			} else {
+				_stats.Dropped++;
+			}
+			_freePixels.push_back(std::move(job.Pixels));
+			_pendingFrames--;
+			_jobDone.notify_all();
+		}
+	}
+}
+
+bool FrameCapture::_Encode(const EncodeJob& job) {
+	// GL's rows are bottom to top, so we walk backwards from the last row to store the image top down
+	size_t rowBytes = (size_t)job.Size.x * 4;
+	const uint8_t* lastRow = job.Pixels.data() + rowBytes * (job.Size.y - 1);
+
+	if (job.FileFormat == Format::Png) {
+		if (stbi_write_png(job.Path.c_str(), job.Size.x, job.Size.y, 4, lastRow, -(int)rowBytes) == 0) {
+			LOG_WARN("Failed to write capture to \"{}\"", job.Path);
+			return false;
+		}
+		return true;
+	}
+
+	std::ofstream file(job.Path, std::ios::binary);
+	for (int row = 0; row < job.Size.y && file; row++) {
+		file.write(reinterpret_cast<const char*>(lastRow - rowBytes * row), rowBytes);
+	}
+	if (!file) {
+		LOG_WARN("Failed to write capture to \"{}\"", job.Path);
+		return false;
+	}
+	return true;
+}
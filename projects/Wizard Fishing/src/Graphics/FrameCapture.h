@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Saves frames to disk without waiting on the GPU, for screenshots, recordings and the
+/// headless regression captures
+///
+/// Capture copies the color of a framebuffer into the next of a ring of pixel pack buffers,
+/// which the GPU fills in whenever it gets to it. Poll checks each copy's fence, and once the
+/// copy is done the pixels are read back and handed to a pool of encoder threads, which write
+/// them out as PNGs or raw RGBA. The render thread only waits if every buffer in the ring is
+/// still being copied, which takes RING_SIZE frames of the GPU falling behind
+///
+/// Raw frames are tightly packed 8 bit RGBA rows from the top of the image down, with no header,
+/// so a recording can be turned into a video with something like:
+///   ffmpeg -f image2 -c:v rawvideo -pixel_format rgba -video_size [width]x[height] -i frame_%05d.raw out.mp4
+///
+/// Capture, Poll and Flush must be called from the render thread, everything else from the main thread
+/// </summary>
+class FrameCapture {
+public:
+	typedef std::shared_ptr<FrameCapture> Sptr;
+
+	// The number of copies that can be waiting on the GPU at once
+	static const int RING_SIZE = 4;
+	// The most frames that can be waiting to be written before new captures are dropped (or wait)
+	static const int MAX_QUEUED_FRAMES = 16;
+	// The most threads we'll spread the encoding over
+	static const int MAX_ENCODERS = 4;
+
+	/// <summary>
+	/// The file formats that frames can be written in
+	/// </summary>
+	enum class Format {
+		// Compressed, and much slower to write
+		Png,
+		// Uncompressed RGBA, fast enough to record every frame
+		Raw
+	};
+
+	/// <summary>
+	/// Counters for the stats display, safe to read from any thread
+	/// </summary>
+	struct Stats {
+		std::atomic<uint32_t> Captured { 0 };
+		std::atomic<uint32_t> Written { 0 };
+		// Frames that were skipped because the encoders had too many frames queued, or that failed to write
+		std::atomic<uint32_t> Dropped { 0 };
+		// Times the render thread had to wait, because the ring was full or the encoders were behind
+		std::atomic<uint32_t> Stalls { 0 };
+	};
+
+	static inline Sptr Create() {
+		return std::make_shared<FrameCapture>();
+	}
+
+	FrameCapture(const FrameCapture& other) = delete;
+	FrameCapture(FrameCapture&& other) = delete;
+	FrameCapture& operator=(const FrameCapture& other) = delete;
+	FrameCapture& operator=(FrameCapture&& other) = delete;
+
+	FrameCapture();
+	~FrameCapture();
+
+	/// <summary>
+	/// The folder that screenshots and recordings are saved in
+	/// </summary>
+	std::string OutputDir;
+	/// <summary>
+	/// The format that recordings are written in, screenshots are always PNGs
+	/// </summary>
+	Format      RecordingFormat;
+	/// <summary>
+	/// When set, Capture waits for the encoders to catch up instead of dropping frames. For runs
+	/// where every frame that's asked for has to be written, like the headless captures
+	/// </summary>
+	bool        BlockWhenFull;
+
+	/// <summary>
+	/// Asks for the next frame to be saved as a screenshot
+	/// </summary>
+	void RequestScreenshot() { _isScreenshotRequested = true; }
+	/// <summary>
+	/// Starts or stops saving every frame into a new folder under OutputDir
+	/// </summary>
+	void SetRecording(bool isRecording);
+	bool IsRecording() const { return _isRecording; }
+	/// <summary>
+	/// Works out whether the frame being built should be captured, and where it should go. Call
+	/// from the main thread once per frame
+	/// </summary>
+	/// <param name="outPath">Will store the file to write the frame to</param>
+	/// <param name="outFormat">Will store the format to write the frame in</param>
+	/// <returns>True if the frame should be captured</returns>
+	bool TakeFrameRequest(std::string& outPath, Format& outFormat);
+
+	/// <summary>
+	/// Starts copying the color buffer of a framebuffer, to be written to a file once the copy
+	/// is done. Call from the render thread once the frame has been drawn into the framebuffer
+	/// </summary>
+	/// <param name="framebuffer">The framebuffer to read from, or 0 for the window's back buffer</param>
+	/// <param name="size">The size of the area to read, from the bottom left corner</param>
+	/// <param name="path">The file to write the frame to</param>
+	/// <param name="format">The format to write the frame in</param>
+	void Capture(GLuint framebuffer, const glm::ivec2& size, const std::string& path, Format format);
+	/// <summary>
+	/// Hands any copies the GPU has finished to the encoders, without waiting on the rest. Call
+	/// from the render thread once per frame
+	/// </summary>
+	void Poll();
+	/// <summary>
+	/// Waits until every capture has been written to disk, must be called from the render thread
+	/// </summary>
+	void Flush();
+
+	/// <summary>
+	/// Gets our counters, which are updated as frames are captured and written
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+	/// <summary>
+	/// Draws the ImGui controls for taking screenshots and recording, along with our stats
+	/// </summary>
+	void RenderImGui();
+
+protected:
+	// One of the buffers in the ring, and the capture it holds
+	struct Slot {
+		GLuint      Buffer;
+		size_t      Capacity;
+		// Signalled once the copy into the buffer is done, or nullptr if the slot is free
+		GLsync      Fence;
+		glm::ivec2  Size;
+		std::string Path;
+		Format      FileFormat;
+	};
+	// A frame that has been read back, waiting to be written
+	struct EncodeJob {
+		std::string          Path;
+		Format               FileFormat;
+		glm::ivec2           Size;
+		// Bottom row first, as GL reads them
+		std::vector<uint8_t> Pixels;
+	};
+
+	Slot _slots[RING_SIZE];
+	// The slot the next capture goes in, which is also the oldest one in use
+	int  _nextSlot;
+
+	// Main thread state
+	bool        _isScreenshotRequested;
+	bool        _isRecording;
+	std::string _recordingDir;
+	int         _recordingFrame;
+
+	// Everything below is guarded by _lock
+	std::mutex                        _lock;
+	// Signalled when jobs are added, or when the encoders should stop
+	std::condition_variable           _jobQueued;
+	// Signalled when a job has been written
+	std::condition_variable           _jobDone;
+	std::deque<EncodeJob>             _jobs;
+	// Pixel storage that the encoders are done with, so we don't allocate a frame's worth every frame
+	std::vector<std::vector<uint8_t>> _freePixels;
+	// Frames that have been captured, but not written yet
+	int                               _pendingFrames;
+	bool                              _stopRequested;
+
+	std::vector<std::thread>          _encoders;
+	Stats                             _stats;
+
+	// Reads back a slot's pixels and queues them to be written, waiting for the copy if wait is set.
+	// Returns false if the copy isn't done yet
+	bool _Collect(Slot& slot, bool wait);
+	// Writes frames until we are destroyed
+	void _EncoderMain();
+	// Writes a single frame to disk
+	static bool _Encode(const EncodeJob& job);
+};
@@ -0,0 +1,104 @@
+#include "Framebuffer.h"
+#include "stb_image_write.h"
+#include "Logging.h"
+#include "GlDeleteList.h"
+#include "GlStateCache.h"
+#include <GLM/glm.hpp>
+
+Framebuffer::Framebuffer(int width, int height) :
+	_handle(0),
+	_colorHandle(0),
+	_depthHandle(0),
+	_width(width),
+	_height(height)
+{
+	glCreateFramebuffers(1, &_handle);
+	_Recreate();
+}
+
+Framebuffer::~Framebuffer() {
+	if (_handle != 0) {
+		GlDeleteList().Framebuffer(_handle).Texture(_colorHandle).Renderbuffer(_depthHandle).DeleteLater();
+		_handle = 0;
+	}
+}
+
+void Framebuffer::Resize(int width, int height) {
+	if (width == _width && height == _height) {
+		return;
+	}
+	_width = width;
+	_height = height;
+	_Recreate();
+}
+
+void Framebuffer::Bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _handle);
+	glViewport(0, 0, _width, _height);
+}
+
+void Framebuffer::Bind(int width, int height) {
+	glBindFramebuffer(GL_FRAMEBUFFER, _handle);
+	glViewport(0, 0, glm::clamp(width, 1, _width), glm::clamp(height, 1, _height));
+}
+
+void Framebuffer::Unbind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(std::vector<uint8_t>& outPixels) const {
+	outPixels.resize((size_t)_width * _height * 4);
+	// Rows are tightly packed, so make sure GL doesn't pad them out
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glNamedFramebufferReadBuffer(_handle, GL_COLOR_ATTACHMENT0);
+
+	GLint previous = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _handle);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, outPixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+}
+
+bool Framebuffer::SaveToPng(const std::string& filename) const {
+	std::vector<uint8_t> pixels;
+	ReadPixels(pixels);
+
+	// GL's origin is the bottom left, but images are stored top to bottom, so we start at the last
+	// row and walk backwards. stbi's flip flag is global, and FrameCapture writes PNGs on other threads
+	const uint8_t* lastRow = pixels.data() + (size_t)_width * 4 * (_height - 1);
+	if (stbi_write_png(filename.c_str(), _width, _height, 4, lastRow, -(_width * 4)) == 0) {
+		LOG_WARN("Failed to write framebuffer capture to \"{}\"", filename);
+		return false;
+	}
+	return true;
+}
+
+void Framebuffer::_Recreate() {
+	LOG_ASSERT(_width > 0 && _height > 0, "Framebuffer must have a non-zero size!");
+
+	// Renderbuffers can be re-allocated in place, so we only need to create them once
+	if (_depthHandle == 0) {
+		glCreateRenderbuffers(1, &_depthHandle);
+	}
+	glNamedRenderbufferStorage(_depthHandle, GL_DEPTH24_STENCIL8, _width, _height);
+
+	// Our color texture uses immutable storage, so it has to be replaced
+	if (_colorHandle != 0) {
+		GlStateCache::OnTextureDeleted(_colorHandle);
+		glDeleteTextures(1, &_colorHandle);
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &_colorHandle);
+	glTextureStorage2D(_colorHandle, 1, GL_RGBA8, _width, _height);
+	glTextureParameteri(_colorHandle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(_colorHandle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(_colorHandle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(_colorHandle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glNamedFramebufferTexture(_handle, GL_COLOR_ATTACHMENT0, _colorHandle, 0);
+	glNamedFramebufferRenderbuffer(_handle, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthHandle);
+
+	GLenum status = glCheckNamedFramebufferStatus(_handle, GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		LOG_ERROR("Framebuffer is incomplete (status 0x{:x})", status);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <glad/glad.h>
+
+/// <summary>
+/// A simple offscreen render target, with an RGBA8 color attachment and a
+/// 24 bit depth / 8 bit stencil attachment. Used when we need to render somewhere
+/// other than the window, for instance when running headless
+///
+/// The color attachment is a texture, so the contents can be sampled by a later pass
+/// </summary>
+class Framebuffer
+{
+public:
+	typedef std::shared_ptr<Framebuffer> Sptr;
+
+	static inline Sptr Create(int width, int height) {
+		return std::make_shared<Framebuffer>(width, height);
+	}
+
+	// Remove the copy and and assignment operators
+	Framebuffer(const Framebuffer& other) = delete;
+	Framebuffer(Framebuffer&& other) = delete;
+	Framebuffer& operator=(const Framebuffer& other) = delete;
+	Framebuffer& operator=(Framebuffer&& other) = delete;
+
+	/// <summary>
+	/// Creates a new framebuffer with the given size in pixels
+	/// </summary>
+	Framebuffer(int width, int height);
+	~Framebuffer();
+
+	/// <summary>
+	/// Resizes the framebuffer's attachments, discarding their contents
+	/// </summary>
+	void Resize(int width, int height);
+
+	/// <summary>
+	/// Binds this framebuffer for drawing and reading, and sets the viewport to cover it
+	/// </summary>
+	void Bind();
+	/// <summary>
+	/// Binds this framebuffer for drawing and reading, and sets the viewport to cover only the
+	/// bottom left corner of it. Used to render at a lower resolution without re-allocating
+	/// </summary>
+	/// <param name="width">The width of the viewport, clamped to our width</param>
+	/// <param name="height">The height of the viewport, clamped to our height</param>
+	void Bind(int width, int height);
+	/// <summary>
+	/// Re-binds the default framebuffer (the window)
+	/// </summary>
+	static void Unbind();
+
+	/// <summary>
+	/// Reads back the contents of the color attachment as tightly packed RGBA8 pixels,
+	/// with the bottom row first (as OpenGL stores them). Note that this will stall
+	/// until all rendering to the framebuffer has completed
+	/// </summary>
+	/// <param name="outPixels">The vector to store the pixels in</param>
+	void ReadPixels(std::vector<uint8_t>& outPixels) const;
+	/// <summary>
+	/// Reads back the color attachment and saves it as a PNG image
+	/// </summary>
+	/// <param name="filename">The path of the image to write</param>
+	/// <returns>True if the image was written, false if otherwise</returns>
+	bool SaveToPng(const std::string& filename) const;
+
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets the texture holding our color attachment, note that this changes when we are resized
+	/// </summary>
+	GLuint GetColorTexture() const { return _colorHandle; }
+
+protected:
+	GLuint _handle;
+	// A texture, since immutable storage can't be re-allocated it is re-created on resize
+	GLuint _colorHandle;
+	GLuint _depthHandle;
+	int    _width;
+	int    _height;
+
+	// Re-allocates the attachments to match our current size
+	void _Recreate();
+};
@@ -0,0 +1,206 @@
+#include "Graphics/GeometryPool.h"
+#include <iterator>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+bool GeometryPool::Enabled = false;
+
+PooledMesh::Range::~Range() {
+	if (Pool != nullptr) {
+		Pool->_Release(*this);
+	}
+}
+
+GeometryPool::GeometryPool() :
+	_vertexBuffer(0),
+	_indexBuffer(0),
+	_vao(0),
+	_freeVertices(std::map<uint32_t, uint32_t>()),
+	_freeIndices(std::map<uint32_t, uint32_t>())
+{
+	_stats.Meshes = 0;
+	_stats.UsedVertices = 0;
+	_stats.UsedIndices = 0;
+	_stats.FreeBlocks = 2;
+
+	// The storage is immutable, but we still need to be able to copy meshes into it
+	glCreateBuffers(1, &_vertexBuffer);
+	glNamedBufferStorage(_vertexBuffer, sizeof(VertexPosNormTexCol) * VERTEX_CAPACITY, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &_indexBuffer);
+	glNamedBufferStorage(_indexBuffer, sizeof(uint32_t) * INDEX_CAPACITY, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glCreateVertexArrays(1, &_vao);
+	glVertexArrayElementBuffer(_vao, _indexBuffer);
+
+	_freeVertices[0] = VERTEX_CAPACITY;
+	_freeIndices[0] = INDEX_CAPACITY;
+}
+
+GeometryPool::~GeometryPool() {
+	GlStateCache::OnVertexArrayDeleted(_vao);
+	GlStateCache::OnBufferDeleted(_vertexBuffer);
+	GlStateCache::OnBufferDeleted(_indexBuffer);
+	glDeleteVertexArrays(1, &_vao);
+	glDeleteBuffers(1, &_vertexBuffer);
+	glDeleteBuffers(1, &_indexBuffer);
+}
+
+GeometryPool& GeometryPool::Get() {
+	if (__Instance == nullptr) {
+		// Our buffers need the GL context
+		RenderThread::Invoke([]() {
+			__Instance = new GeometryPool();
+		});
+	}
+	return *__Instance;
+}
+
+PooledMesh::Sptr GeometryPool::Add(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	if (vertexCount == 0 || vertexCount > VERTEX_CAPACITY || indexCount > INDEX_CAPACITY) {
+		return nullptr;
+	}
+
+	uint32_t vertexOffset = 0;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		if (!_Allocate(_freeVertices, (uint32_t)vertexCount, vertexOffset)) {
+			LOG_WARN("Geometry pool is out of space for {} vertices, the mesh will use it's own buffers", vertexCount);
+			return nullptr;
+		}
+		_stats.Meshes++;
+		_stats.UsedVertices += (uint32_t)vertexCount;
+	}
+
+	PooledMesh::Range::Sptr vertexRange = std::make_shared<PooledMesh::Range>();
+	vertexRange->Pool = this;
+	vertexRange->IsIndices = false;
+	vertexRange->Offset = vertexOffset;
+	vertexRange->Count = (uint32_t)vertexCount;
+	glNamedBufferSubData(_vertexBuffer, sizeof(VertexPosNormTexCol) * vertexOffset, sizeof(VertexPosNormTexCol) * vertexCount, vertices);
+
+	PooledMesh::Sptr result = std::make_shared<PooledMesh>();
+	result->VertexRange = vertexRange;
+	result->IndexRange = nullptr;
+	result->MorphRange = nullptr;
+	result->BaseVertex = vertexOffset;
+	result->VertexCount = (uint32_t)vertexCount;
+	result->FirstIndex = 0;
+	result->IndexCount = 0;
+	result->MorphTargetOffset = 0;
+
+	if (indices != nullptr && indexCount > 0) {
+		// If the indices don't fit, the vertices are freed along with our result
+		return AddIndices(result, indices, indexCount);
+	}
+	return result;
+}
+
+PooledMesh::Sptr GeometryPool::AddIndices(const PooledMesh::Sptr& source, const uint32_t* indices, size_t indexCount) {
+	if (source == nullptr || indexCount == 0 || indexCount > INDEX_CAPACITY) {
+		return nullptr;
+	}
+
+	uint32_t indexOffset = 0;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		if (!_Allocate(_freeIndices, (uint32_t)indexCount, indexOffset)) {
+			LOG_WARN("Geometry pool is out of space for {} indices, the mesh will use it's own buffers", indexCount);
+			return nullptr;
+		}
+		_stats.UsedIndices += (uint32_t)indexCount;
+	}
+
+	PooledMesh::Range::Sptr indexRange = std::make_shared<PooledMesh::Range>();
+	indexRange->Pool = this;
+	indexRange->IsIndices = true;
+	indexRange->Offset = indexOffset;
+	indexRange->Count = (uint32_t)indexCount;
+	// Indices stay relative to the mesh, the base vertex is added when we draw
+	glNamedBufferSubData(_indexBuffer, sizeof(uint32_t) * indexOffset, sizeof(uint32_t) * indexCount, indices);
+
+	PooledMesh::Sptr result = std::make_shared<PooledMesh>(*source);
+	result->IndexRange = indexRange;
+	result->FirstIndex = indexOffset;
+	result->IndexCount = (uint32_t)indexCount;
+	return result;
+}
+
+PooledMesh::Sptr GeometryPool::MakeMorphPair(const PooledMesh::Sptr& from, const PooledMesh::Sptr& to) {
+	// Frames are blended vertex by vertex, so they need to line up exactly
+	if (from == nullptr || to == nullptr || from->VertexCount != to->VertexCount) {
+		return nullptr;
+	}
+	PooledMesh::Sptr result = std::make_shared<PooledMesh>(*from);
+	result->MorphRange = to->VertexRange;
+	result->MorphTargetOffset = (int32_t)to->BaseVertex - (int32_t)from->BaseVertex;
+	return result;
+}
+
+void GeometryPool::Draw(const PooledMesh& mesh) {
+	GlStateCache::BindStorageBuffer(VERTEX_SSBO_BINDING_SLOT, _vertexBuffer);
+	GlStateCache::BindVertexArray(_vao);
+	// gl_VertexID includes the base vertex, so the shader can index the pool with it directly
+	if (mesh.IndexCount > 0) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)mesh.IndexCount, GL_UNSIGNED_INT,
+			(const void*)(sizeof(uint32_t) * (size_t)mesh.FirstIndex), (GLint)mesh.BaseVertex);
+	} else {
+		glDrawArrays(GL_TRIANGLES, (GLint)mesh.BaseVertex, (GLsizei)mesh.VertexCount);
+	}
+}
+
+GeometryPool::Stats GeometryPool::GetStats() {
+	std::lock_guard<std::mutex> guard(_lock);
+	Stats result = _stats;
+	result.FreeBlocks = (uint32_t)(_freeVertices.size() + _freeIndices.size());
+	return result;
+}
+
+bool GeometryPool::_Allocate(std::map<uint32_t, uint32_t>& freeList, uint32_t count, uint32_t& outOffset) {
+	for (auto it = freeList.begin(); it != freeList.end(); it++) {
+		if (it->second >= count) {
+			outOffset = it->first;
+			uint32_t remaining = it->second - count;
+			freeList.erase(it);
+			if (remaining > 0) {
+				freeList[outOffset + count] = remaining;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void GeometryPool::_Free(std::map<uint32_t, uint32_t>& freeList, uint32_t offset, uint32_t count) {
+	auto next = freeList.lower_bound(offset);
+
+	// Merge with the block before us if it ends where we start
+	if (next != freeList.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			count += previous->second;
+			freeList.erase(previous);
+		}
+	}
+	// And with the block after us if it starts where we end
+	if (next != freeList.end() && offset + count == next->first) {
+		count += next->second;
+		freeList.erase(next);
+	}
+	freeList[offset] = count;
+}
+
+void GeometryPool::_Release(const PooledMesh::Range& range) {
+	// This only touches our free lists, so it's safe to do while the GPU is still drawing the
+	// mesh. Anything uploaded into the space later is ordered after those draws by the driver
+	std::lock_guard<std::mutex> guard(_lock);
+	if (range.IsIndices) {
+		_Free(_freeIndices, range.Offset, range.Count);
+		_stats.UsedIndices -= range.Count;
+	} else {
+		_Free(_freeVertices, range.Offset, range.Count);
+		_stats.UsedVertices -= range.Count;
+		_stats.Meshes--;
+	}
+}
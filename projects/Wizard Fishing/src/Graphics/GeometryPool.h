@@ -0,0 +1,163 @@
+#pragma once
+#include <memory>
+#include <map>
+#include <mutex>
+#include <cstdint>
+#include <glad/glad.h>
+
+#include "Graphics/VertexTypes.h"
+
+class GeometryPool;
+
+/// <summary>
+/// Where a mesh's data lives inside the geometry pool. Meshes that were added to the pool
+/// store one of these in their VAO, see VertexArrayObject::GetPooledMesh
+/// </summary>
+struct PooledMesh {
+	typedef std::shared_ptr<PooledMesh> Sptr;
+
+	/// <summary>
+	/// A block of vertices or indices in the pool, which is given back to the pool when the
+	/// last mesh using it is destroyed
+	/// </summary>
+	struct Range {
+		typedef std::shared_ptr<Range> Sptr;
+
+		GeometryPool* Pool;
+		bool          IsIndices;
+		uint32_t      Offset;
+		uint32_t      Count;
+
+		~Range();
+	};
+
+	// Shared with any other meshes drawing from the same vertices (ex: LODs)
+	Range::Sptr VertexRange;
+	// Null for meshes that are drawn without indices
+	Range::Sptr IndexRange;
+	// For morph pairs, the vertices of the frame we blend towards. Null otherwise
+	Range::Sptr MorphRange;
+
+	uint32_t BaseVertex;
+	uint32_t VertexCount;
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	// The number of vertices from our vertices to the matching vertex in the morph target
+	int32_t  MorphTargetOffset;
+};
+
+/// <summary>
+/// Holds the vertex and index data for all of our static meshes in one pair of large,
+/// fixed size buffers, so that any of them can be drawn without switching VAOs
+///
+/// Vertices are stored in a shader storage buffer, and fetched in the vertex shader with
+/// gl_VertexID (see the VERTEX_PULLING keyword in vertex_shader.glsl). Space is handed out
+/// with a first fit free list, and neighbouring free blocks are merged when a mesh is freed.
+/// Meshes that don't fit are simply left out, and keep drawing through their own VAO
+///
+/// Adding meshes needs the GL context, freeing them may be done from any thread
+/// </summary>
+class GeometryPool
+{
+public:
+	// The most vertices the pool can hold, at 48 bytes each
+	static const uint32_t VERTEX_CAPACITY = 1 << 19;
+	// The most indices the pool can hold, at 4 bytes each
+	static const uint32_t INDEX_CAPACITY = 1 << 21;
+	// The shader storage slot that the vertices are bound to, must match b_PulledVertices
+	static const int VERTEX_SSBO_BINDING_SLOT = 4;
+
+	/// <summary>
+	/// When true, meshes in the pool are drawn with vertex pulling instead of through their own VAOs.
+	/// Meshes are added to the pool when they load either way, so this can be toggled at any time
+	/// </summary>
+	static bool Enabled;
+
+	/// <summary>
+	/// Counters for how full the pool is, for the stats display
+	/// </summary>
+	struct Stats {
+		uint32_t Meshes;
+		uint32_t UsedVertices;
+		uint32_t UsedIndices;
+		// The number of separate free blocks, a rough measure of fragmentation
+		uint32_t FreeBlocks;
+	};
+
+	GeometryPool(const GeometryPool& other) = delete;
+	GeometryPool(GeometryPool&& other) = delete;
+	GeometryPool& operator =(const GeometryPool& other) = delete;
+	GeometryPool& operator =(GeometryPool&& other) = delete;
+
+	virtual ~GeometryPool();
+
+	/// <summary>
+	/// Gets the singleton instance of the geometry pool
+	/// </summary>
+	static GeometryPool& Get();
+
+	/// <summary>
+	/// Copies a mesh into the pool
+	/// </summary>
+	/// <param name="vertices">The mesh's vertices</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The mesh's triangle indices, or nullptr to draw the vertices in order</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <returns>The mesh's place in the pool, or nullptr if it doesn't fit</returns>
+	PooledMesh::Sptr Add(const VertexPosNormTexCol* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+	/// <summary>
+	/// Adds another set of indices that draw from a mesh's vertices (ex: a LOD of the mesh)
+	/// </summary>
+	/// <param name="source">The mesh whose vertices the indices refer to</param>
+	/// <param name="indices">The triangle indices</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <returns>The new mesh, or nullptr if it doesn't fit</returns>
+	PooledMesh::Sptr AddIndices(const PooledMesh::Sptr& source, const uint32_t* indices, size_t indexCount);
+	/// <summary>
+	/// Makes a mesh that draws like from, but blends towards the vertices of to. This doesn't
+	/// need any new space in the pool
+	/// </summary>
+	/// <returns>The pair, or nullptr if the meshes don't have matching vertices</returns>
+	static PooledMesh::Sptr MakeMorphPair(const PooledMesh::Sptr& from, const PooledMesh::Sptr& to);
+
+	/// <summary>
+	/// Draws a mesh from the pool with whatever shader is bound, which must fetch it's vertices
+	/// from the pool. Must be called from the render thread
+	/// </summary>
+	void Draw(const PooledMesh& mesh);
+
+	/// <summary>
+	/// Gets the GL buffers behind the pool, for drawing it's meshes in other ways (ex: indirect draws)
+	/// </summary>
+	GLuint GetVertexBuffer() const { return _vertexBuffer; }
+	GLuint GetIndexBuffer() const { return _indexBuffer; }
+
+	/// <summary>
+	/// Gets the current usage of the pool, may be called from any thread
+	/// </summary>
+	Stats GetStats();
+
+protected:
+	friend struct PooledMesh::Range;
+
+	GeometryPool();
+
+	GLuint _vertexBuffer;
+	GLuint _indexBuffer;
+	// An empty VAO with our index buffer attached, since the vertex shader doesn't need any attributes
+	GLuint _vao;
+
+	// Maps the start of each free block to it's size, for the vertices and indices
+	std::mutex _lock;
+	std::map<uint32_t, uint32_t> _freeVertices;
+	std::map<uint32_t, uint32_t> _freeIndices;
+	Stats _stats;
+
+	// Takes the first free block that fits, returns false if there isn't one
+	static bool _Allocate(std::map<uint32_t, uint32_t>& freeList, uint32_t count, uint32_t& outOffset);
+	// Returns a block to the free list, merging it with the blocks on either side
+	static void _Free(std::map<uint32_t, uint32_t>& freeList, uint32_t offset, uint32_t count);
+	void _Release(const PooledMesh::Range& range);
+
+	inline static GeometryPool* __Instance = nullptr;
+};
@@ -0,0 +1,75 @@
+#include "Graphics/GlDeleteList.h"
+
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+
+GlDeleteList& GlDeleteList::Buffer(GLuint handle) {
+	if (handle != 0) _buffers.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::Texture(GLuint handle) {
+	if (handle != 0) _textures.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::Renderbuffer(GLuint handle) {
+	if (handle != 0) _renderbuffers.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::VertexArray(GLuint handle) {
+	if (handle != 0) _vertexArrays.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::Framebuffer(GLuint handle) {
+	if (handle != 0) _framebuffers.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::Program(GLuint handle) {
+	if (handle != 0) _programs.push_back(handle);
+	return *this;
+}
+
+GlDeleteList& GlDeleteList::Fence(GLsync fence) {
+	if (fence != nullptr) _fences.push_back(fence);
+	return *this;
+}
+
+void GlDeleteList::DeleteLater() {
+	if (_buffers.empty() && _textures.empty() && _renderbuffers.empty() && _vertexArrays.empty() &&
+		_framebuffers.empty() && _programs.empty() && _fences.empty()) {
+		return;
+	}
+	RenderThread::Enqueue([list = std::move(*this)]() {
+		list._DeleteNow();
+	});
+	*this = GlDeleteList();
+}
+
+void GlDeleteList::_DeleteNow() const {
+	for (GLuint buffer : _buffers) {
+		GlStateCache::OnBufferDeleted(buffer);
+	}
+	for (GLuint texture : _textures) {
+		GlStateCache::OnTextureDeleted(texture);
+	}
+	for (GLuint vao : _vertexArrays) {
+		GlStateCache::OnVertexArrayDeleted(vao);
+	}
+	for (GLuint program : _programs) {
+		GlStateCache::OnProgramDeleted(program);
+		glDeleteProgram(program);
+	}
+	// Framebuffers are deleted before the textures and renderbuffers that may be attached to them
+	if (!_framebuffers.empty()) glDeleteFramebuffers((GLsizei)_framebuffers.size(), _framebuffers.data());
+	if (!_buffers.empty()) glDeleteBuffers((GLsizei)_buffers.size(), _buffers.data());
+	if (!_textures.empty()) glDeleteTextures((GLsizei)_textures.size(), _textures.data());
+	if (!_renderbuffers.empty()) glDeleteRenderbuffers((GLsizei)_renderbuffers.size(), _renderbuffers.data());
+	if (!_vertexArrays.empty()) glDeleteVertexArrays((GLsizei)_vertexArrays.size(), _vertexArrays.data());
+	for (GLsync fence : _fences) {
+		glDeleteSync(fence);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <glad/glad.h>
+
+/// <summary>
+/// A list of GL objects to delete together on the render thread, for the destructors of the
+/// classes that own them
+///
+/// The last reference to a GL wrapper may be dropped on any thread (usually the main thread),
+/// but only the render thread may make GL calls. DeleteLater sends the deletes to the render
+/// thread, and lets the GlStateCache know about each object, since the driver may hand the
+/// handles out again. Handles of 0 are skipped, so objects that were never created can be added
+///
+/// Ex: GlDeleteList().Buffer(_buffer).Texture(_texture).DeleteLater();
+/// </summary>
+class GlDeleteList {
+public:
+	GlDeleteList& Buffer(GLuint handle);
+	GlDeleteList& Texture(GLuint handle);
+	GlDeleteList& Renderbuffer(GLuint handle);
+	GlDeleteList& VertexArray(GLuint handle);
+	GlDeleteList& Framebuffer(GLuint handle);
+	GlDeleteList& Program(GLuint handle);
+	GlDeleteList& Fence(GLsync fence);
+
+	/// <summary>
+	/// Queues the deletes on the render thread, or runs them right away if called from the render
+	/// thread (or when there isn't one). Safe to call from any thread, empties the list
+	/// </summary>
+	void DeleteLater();
+
+protected:
+	std::vector<GLuint> _buffers;
+	std::vector<GLuint> _textures;
+	std::vector<GLuint> _renderbuffers;
+	std::vector<GLuint> _vertexArrays;
+	std::vector<GLuint> _framebuffers;
+	std::vector<GLuint> _programs;
+	std::vector<GLsync> _fences;
+
+	// Deletes everything in the list, must be called on the render thread
+	void _DeleteNow() const;
+};
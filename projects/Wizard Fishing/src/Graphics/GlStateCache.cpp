@@ -0,0 +1,283 @@
+#include "GlStateCache.h"
+#include "Logging.h"
+
+GLuint GlStateCache::_program = GlStateCache::UNKNOWN_HANDLE;
+GLuint GlStateCache::_vao = GlStateCache::UNKNOWN_HANDLE;
+GLuint GlStateCache::_textureUnits[GlStateCache::MAX_CACHED_TEXTURE_UNITS];
+GLuint GlStateCache::_uboSlots[GlStateCache::MAX_CACHED_UBO_SLOTS];
+GLuint GlStateCache::_ssboSlots[GlStateCache::MAX_CACHED_SSBO_SLOTS];
+
+int8_t GlStateCache::_blendEnabled = GlStateCache::UNKNOWN_FLAG;
+GLenum GlStateCache::_blendSrc = GL_NONE;
+GLenum GlStateCache::_blendDst = GL_NONE;
+int8_t GlStateCache::_depthTestEnabled = GlStateCache::UNKNOWN_FLAG;
+int8_t GlStateCache::_depthWriteEnabled = GlStateCache::UNKNOWN_FLAG;
+GLenum GlStateCache::_depthFunc = GL_NONE;
+int8_t GlStateCache::_cullEnabled = GlStateCache::UNKNOWN_FLAG;
+GLenum GlStateCache::_cullFace = GL_NONE;
+
+uint32_t GlStateCache::_skippedCalls = 0;
+
+// Static arrays can't be given a non-zero fill value in their definition, so we
+// kick off an invalidate during static init instead
+static const bool __stateCacheInit = (GlStateCache::Invalidate(), true);
+
+void GlStateCache::UseProgram(GLuint program) {
+	if (_program == program) {
+		_skippedCalls++;
+		return;
+	}
+	glUseProgram(program);
+	_program = program;
+}
+
+void GlStateCache::BindVertexArray(GLuint vao) {
+	if (_vao == vao) {
+		_skippedCalls++;
+		return;
+	}
+	glBindVertexArray(vao);
+	_vao = vao;
+}
+
+void GlStateCache::BindTextureUnit(int slot, GLuint texture) {
+	if (slot >= 0 && slot < MAX_CACHED_TEXTURE_UNITS) {
+		if (_textureUnits[slot] == texture) {
+			_skippedCalls++;
+			return;
+		}
+		_textureUnits[slot] = texture;
+	}
+	glBindTextureUnit(slot, texture);
+}
+
+void GlStateCache::BindUniformBuffer(int slot, GLuint buffer) {
+	if (slot >= 0 && slot < MAX_CACHED_UBO_SLOTS) {
+		if (_uboSlots[slot] == buffer) {
+			_skippedCalls++;
+			return;
+		}
+		_uboSlots[slot] = buffer;
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, slot, buffer);
+}
+
+void GlStateCache::BindStorageBuffer(int slot, GLuint buffer) {
+	if (slot >= 0 && slot < MAX_CACHED_SSBO_SLOTS) {
+		if (_ssboSlots[slot] == buffer) {
+			_skippedCalls++;
+			return;
+		}
+		_ssboSlots[slot] = buffer;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer);
+}
+
+void GlStateCache::SetBlendEnabled(bool enabled) {
+	_SetCapability(GL_BLEND, _blendEnabled, enabled);
+}
+
+void GlStateCache::SetBlendFunc(GLenum srcFactor, GLenum dstFactor) {
+	if (_blendSrc == srcFactor && _blendDst == dstFactor) {
+		_skippedCalls++;
+		return;
+	}
+	glBlendFunc(srcFactor, dstFactor);
+	_blendSrc = srcFactor;
+	_blendDst = dstFactor;
+}
+
+void GlStateCache::SetDepthTestEnabled(bool enabled) {
+	_SetCapability(GL_DEPTH_TEST, _depthTestEnabled, enabled);
+}
+
+void GlStateCache::SetDepthWriteEnabled(bool enabled) {
+	if (_depthWriteEnabled == (int8_t)enabled) {
+		_skippedCalls++;
+		return;
+	}
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	_depthWriteEnabled = enabled;
+}
+
+void GlStateCache::SetDepthFunc(GLenum func) {
+	if (_depthFunc == func) {
+		_skippedCalls++;
+		return;
+	}
+	glDepthFunc(func);
+	_depthFunc = func;
+}
+
+void GlStateCache::SetCullEnabled(bool enabled) {
+	_SetCapability(GL_CULL_FACE, _cullEnabled, enabled);
+}
+
+void GlStateCache::SetCullFace(GLenum face) {
+	if (_cullFace == face) {
+		_skippedCalls++;
+		return;
+	}
+	glCullFace(face);
+	_cullFace = face;
+}
+
+bool GlStateCache::IsDepthTestEnabled() {
+	// GL defaults to depth testing being off, so assume that if we don't know
+	return _depthTestEnabled == 1;
+}
+
+GLuint GlStateCache::GetBoundVertexArray() {
+	return _vao != UNKNOWN_HANDLE ? _vao : 0;
+}
+
+bool GlStateCache::IsDepthWriteEnabled() {
+	// GL defaults to depth writes being on, so assume that if we don't know
+	return _depthWriteEnabled != 0;
+}
+
+void GlStateCache::OnProgramDeleted(GLuint program) {
+	// A deleted program stays in use until another is bound, but the handle may be
+	// recycled, so we can't trust our cached value anymore
+	if (_program == program) {
+		_program = UNKNOWN_HANDLE;
+	}
+}
+
+void GlStateCache::OnVertexArrayDeleted(GLuint vao) {
+	if (_vao == vao) {
+		_vao = UNKNOWN_HANDLE;
+	}
+}
+
+void GlStateCache::OnTextureDeleted(GLuint texture) {
+	for (int ix = 0; ix < MAX_CACHED_TEXTURE_UNITS; ix++) {
+		if (_textureUnits[ix] == texture) {
+			_textureUnits[ix] = UNKNOWN_HANDLE;
+		}
+	}
+}
+
+void GlStateCache::OnBufferDeleted(GLuint buffer) {
+	for (int ix = 0; ix < MAX_CACHED_UBO_SLOTS; ix++) {
+		if (_uboSlots[ix] == buffer) {
+			_uboSlots[ix] = UNKNOWN_HANDLE;
+		}
+	}
+	for (int ix = 0; ix < MAX_CACHED_SSBO_SLOTS; ix++) {
+		if (_ssboSlots[ix] == buffer) {
+			_ssboSlots[ix] = UNKNOWN_HANDLE;
+		}
+	}
+}
+
+void GlStateCache::Invalidate() {
+	_program = UNKNOWN_HANDLE;
+	_vao = UNKNOWN_HANDLE;
+	for (int ix = 0; ix < MAX_CACHED_TEXTURE_UNITS; ix++) {
+		_textureUnits[ix] = UNKNOWN_HANDLE;
+	}
+	for (int ix = 0; ix < MAX_CACHED_UBO_SLOTS; ix++) {
+		_uboSlots[ix] = UNKNOWN_HANDLE;
+	}
+	for (int ix = 0; ix < MAX_CACHED_SSBO_SLOTS; ix++) {
+		_ssboSlots[ix] = UNKNOWN_HANDLE;
+	}
+	_blendEnabled = UNKNOWN_FLAG;
+	_blendSrc = GL_NONE;
+	_blendDst = GL_NONE;
+	_depthTestEnabled = UNKNOWN_FLAG;
+	_depthWriteEnabled = UNKNOWN_FLAG;
+	_depthFunc = GL_NONE;
+	_cullEnabled = UNKNOWN_FLAG;
+	_cullFace = GL_NONE;
+}
+
+bool GlStateCache::Validate() {
+	#ifdef GL_STATE_VALIDATION
+	bool result = true;
+	GLint value = 0;
+
+	// Helper to compare a single integer state value, ignoring anything we don't know about yet
+	auto check = [&](const char* name, GLint actual, GLuint cached, GLuint unknown) {
+		if (cached != unknown && (GLuint)actual != cached) {
+			LOG_WARN("GL state mismatch for {}: cached {}, actual {}", name, cached, actual);
+			result = false;
+		}
+	};
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+	check("GL_CURRENT_PROGRAM", value, _program, UNKNOWN_HANDLE);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+	check("GL_VERTEX_ARRAY_BINDING", value, _vao, UNKNOWN_HANDLE);
+
+	// Texture bindings are per-target, so we only check the targets our wrappers use
+	GLint activeUnit = 0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+	for (int ix = 0; ix < MAX_CACHED_TEXTURE_UNITS; ix++) {
+		if (_textureUnits[ix] == UNKNOWN_HANDLE) continue;
+		glActiveTexture(GL_TEXTURE0 + ix);
+		GLint tex2D = 0, texCube = 0, tex2DArray = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &tex2D);
+		glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &texCube);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &tex2DArray);
+		if ((GLuint)tex2D != _textureUnits[ix] && (GLuint)texCube != _textureUnits[ix] && (GLuint)tex2DArray != _textureUnits[ix]) {
+			LOG_WARN("GL state mismatch for texture unit {}: cached {}, actual 2D {} / cube {} / 2D array {}", ix, _textureUnits[ix], tex2D, texCube, tex2DArray);
+			result = false;
+		}
+	}
+	glActiveTexture(activeUnit);
+
+	for (int ix = 0; ix < MAX_CACHED_UBO_SLOTS; ix++) {
+		if (_uboSlots[ix] == UNKNOWN_HANDLE) continue;
+		glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, ix, &value);
+		if ((GLuint)value != _uboSlots[ix]) {
+			LOG_WARN("GL state mismatch for uniform buffer slot {}: cached {}, actual {}", ix, _uboSlots[ix], value);
+			result = false;
+		}
+	}
+
+	for (int ix = 0; ix < MAX_CACHED_SSBO_SLOTS; ix++) {
+		if (_ssboSlots[ix] == UNKNOWN_HANDLE) continue;
+		glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, ix, &value);
+		if ((GLuint)value != _ssboSlots[ix]) {
+			LOG_WARN("GL state mismatch for shader storage slot {}: cached {}, actual {}", ix, _ssboSlots[ix], value);
+			result = false;
+		}
+	}
+
+	check("GL_BLEND", glIsEnabled(GL_BLEND), _blendEnabled, (GLuint)UNKNOWN_FLAG);
+	check("GL_DEPTH_TEST", glIsEnabled(GL_DEPTH_TEST), _depthTestEnabled, (GLuint)UNKNOWN_FLAG);
+	check("GL_CULL_FACE", glIsEnabled(GL_CULL_FACE), _cullEnabled, (GLuint)UNKNOWN_FLAG);
+
+	GLboolean depthMask = GL_TRUE;
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+	check("GL_DEPTH_WRITEMASK", depthMask, _depthWriteEnabled, (GLuint)UNKNOWN_FLAG);
+
+	glGetIntegerv(GL_BLEND_SRC_RGB, &value);
+	check("GL_BLEND_SRC_RGB", value, _blendSrc, GL_NONE);
+	glGetIntegerv(GL_BLEND_DST_RGB, &value);
+	check("GL_BLEND_DST_RGB", value, _blendDst, GL_NONE);
+	glGetIntegerv(GL_DEPTH_FUNC, &value);
+	check("GL_DEPTH_FUNC", value, _depthFunc, GL_NONE);
+	glGetIntegerv(GL_CULL_FACE_MODE, &value);
+	check("GL_CULL_FACE_MODE", value, _cullFace, GL_NONE);
+
+	return result;
+	#else
+	return true;
+	#endif
+}
+
+void GlStateCache::_SetCapability(GLenum cap, int8_t& cached, bool enabled) {
+	if (cached == (int8_t)enabled) {
+		_skippedCalls++;
+		return;
+	}
+	if (enabled) {
+		glEnable(cap);
+	} else {
+		glDisable(cap);
+	}
+	cached = enabled;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+// When defined, GlStateCache::Validate will read back the real OpenGL state and
+// compare it against our shadow copy. This stalls the pipeline, so we only turn
+// it on by default for debug builds
+#if defined(_DEBUG) && !defined(GL_STATE_VALIDATION)
+#define GL_STATE_VALIDATION
+#endif
+
+/// <summary>
+/// A thin layer that shadows the OpenGL state that our wrapper classes touch, so that
+/// redundant binds and state changes can be skipped before they ever reach the driver
+///
+/// Any code that changes this state behind the cache's back (ex: third party libraries)
+/// should call Invalidate afterwards so that the next request always goes through
+/// </summary>
+class GlStateCache {
+public:
+	// Texture units and uniform buffer slots above these will always go straight to OpenGL
+	static constexpr int MAX_CACHED_TEXTURE_UNITS = 32;
+	static constexpr int MAX_CACHED_UBO_SLOTS = 16;
+	static constexpr int MAX_CACHED_SSBO_SLOTS = 16;
+
+	/// <summary>
+	/// Sets the shader program to use for draw calls, equivalent to glUseProgram
+	/// </summary>
+	static void UseProgram(GLuint program);
+	/// <summary>
+	/// Binds a vertex array object, equivalent to glBindVertexArray
+	/// </summary>
+	static void BindVertexArray(GLuint vao);
+	/// <summary>
+	/// Binds a texture to a texture unit, equivalent to glBindTextureUnit
+	/// </summary>
+	static void BindTextureUnit(int slot, GLuint texture);
+	/// <summary>
+	/// Binds a buffer to an indexed uniform buffer slot, equivalent to
+	/// glBindBufferBase(GL_UNIFORM_BUFFER, slot, buffer)
+	/// </summary>
+	static void BindUniformBuffer(int slot, GLuint buffer);
+	/// <summary>
+	/// Binds a buffer to an indexed shader storage buffer slot, equivalent to
+	/// glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer)
+	/// </summary>
+	static void BindStorageBuffer(int slot, GLuint buffer);
+
+	static void SetBlendEnabled(bool enabled);
+	static void SetBlendFunc(GLenum srcFactor, GLenum dstFactor);
+	static void SetDepthTestEnabled(bool enabled);
+	static void SetDepthWriteEnabled(bool enabled);
+	static void SetDepthFunc(GLenum func);
+	static void SetCullEnabled(bool enabled);
+	static void SetCullFace(GLenum face);
+
+	/// <summary>
+	/// Gets the currently bound VAO, without needing to query OpenGL
+	/// Will return 0 if the binding is unknown
+	/// </summary>
+	static GLuint GetBoundVertexArray();
+	static bool IsDepthWriteEnabled();
+	static bool IsDepthTestEnabled();
+
+	// These should be invoked by the wrapper classes when they delete their
+	// GL objects, since handles may be recycled by the driver
+	static void OnProgramDeleted(GLuint program);
+	static void OnVertexArrayDeleted(GLuint vao);
+	static void OnTextureDeleted(GLuint texture);
+	static void OnBufferDeleted(GLuint buffer);
+
+	/// <summary>
+	/// Forgets all shadowed state, so that the next request for each piece of
+	/// state will always be sent to OpenGL
+	/// </summary>
+	static void Invalidate();
+
+	/// <summary>
+	/// Compares the shadowed state against the actual OpenGL state, logging a warning
+	/// for each mismatch. Does nothing unless GL_STATE_VALIDATION is defined
+	/// </summary>
+	/// <returns>True if no mismatches were found</returns>
+	static bool Validate();
+
+	/// <summary>
+	/// Gets the number of GL calls that the cache has skipped since the last reset
+	/// </summary>
+	static uint32_t GetSkippedCallCount() { return _skippedCalls; }
+	static void ResetStats() { _skippedCalls = 0; }
+
+protected:
+	GlStateCache() = default;
+
+	// Marker for state that we do not know the value of
+	static constexpr GLuint UNKNOWN_HANDLE = ~0u;
+	static constexpr int8_t UNKNOWN_FLAG = -1;
+
+	static GLuint _program;
+	static GLuint _vao;
+	static GLuint _textureUnits[MAX_CACHED_TEXTURE_UNITS];
+	static GLuint _uboSlots[MAX_CACHED_UBO_SLOTS];
+	static GLuint _ssboSlots[MAX_CACHED_SSBO_SLOTS];
+
+	static int8_t _blendEnabled;
+	static GLenum _blendSrc;
+	static GLenum _blendDst;
+	static int8_t _depthTestEnabled;
+	static int8_t _depthWriteEnabled;
+	static GLenum _depthFunc;
+	static int8_t _cullEnabled;
+	static GLenum _cullFace;
+
+	static uint32_t _skippedCalls;
+
+	static void _SetCapability(GLenum cap, int8_t& cached, bool enabled);
+};
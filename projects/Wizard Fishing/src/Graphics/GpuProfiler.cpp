@@ -0,0 +1,235 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <imgui.h>
+#include "Logging.h"
+#include "RenderThread.h"
+
+std::vector<GLuint> GpuProfiler::_queryPool;
+std::vector<GpuProfiler::PendingScope> GpuProfiler::_frames[GpuProfiler::FRAME_LATENCY];
+std::vector<int> GpuProfiler::_scopeStack;
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::_stats;
+std::unordered_map<std::string, int> GpuProfiler::_statLookup;
+std::mutex GpuProfiler::_statsLock;
+
+int GpuProfiler::_currentFrame = 0;
+uint64_t GpuProfiler::_resolvedFrames = 0;
+uint64_t GpuProfiler::_droppedFrames = 0;
+
+void GpuProfiler::BeginFrame() {
+	// Queries can only be made once we have a context, so we create them on first use
+	if (_queryPool.empty()) {
+		_queryPool.resize(FRAME_LATENCY * MAX_SCOPES_PER_FRAME * 2);
+		glCreateQueries(GL_TIMESTAMP, (GLsizei)_queryPool.size(), _queryPool.data());
+	}
+
+	if (!_scopeStack.empty()) {
+		LOG_WARN("GPU profiler scope was not ended before the end of the frame");
+		_scopeStack.clear();
+	}
+
+	// Move to the oldest slot in our ring, and read it back before we re-use its queries
+	_currentFrame = (_currentFrame + 1) % FRAME_LATENCY;
+	_Resolve(_currentFrame);
+	_frames[_currentFrame].clear();
+}
+
+void GpuProfiler::BeginScope(const char* name) {
+	if (!RenderThread::IsRenderThread()) {
+		return;
+	}
+
+	std::vector<PendingScope>& frame = _frames[_currentFrame];
+	if (_queryPool.empty() || frame.size() >= MAX_SCOPES_PER_FRAME) {
+		// Still track the scope so that EndScope stays balanced
+		_scopeStack.push_back(-1);
+		return;
+	}
+
+	std::unique_lock<std::mutex> guard(_statsLock);
+	auto it = _statLookup.find(name);
+	if (it == _statLookup.end()) {
+		ScopeStats stats;
+		stats.Name = name;
+		stats.Depth = (int)_scopeStack.size();
+		std::fill(std::begin(stats.History), std::end(stats.History), 0.0f);
+		stats.Last = 0.0f;
+		stats.Average = 0.0f;
+		it = _statLookup.emplace(name, (int)_stats.size()).first;
+		_stats.push_back(stats);
+	}
+	int statIndex = it->second;
+	guard.unlock();
+
+	size_t queryIndex = (_currentFrame * MAX_SCOPES_PER_FRAME + frame.size()) * 2;
+	PendingScope scope;
+	scope.StatIndex = statIndex;
+	scope.BeginQuery = _queryPool[queryIndex];
+	scope.EndQuery = _queryPool[queryIndex + 1];
+	scope.HasEnded = false;
+	glQueryCounter(scope.BeginQuery, GL_TIMESTAMP);
+
+	_scopeStack.push_back((int)frame.size());
+	frame.push_back(scope);
+}
+
+void GpuProfiler::EndScope() {
+	if (!RenderThread::IsRenderThread()) {
+		return;
+	}
+	if (_scopeStack.empty()) {
+		LOG_WARN("GpuProfiler::EndScope called without a matching BeginScope");
+		return;
+	}
+	int index = _scopeStack.back();
+	_scopeStack.pop_back();
+	if (index >= 0) {
+		PendingScope& scope = _frames[_currentFrame][index];
+		glQueryCounter(scope.EndQuery, GL_TIMESTAMP);
+		scope.HasEnded = true;
+	}
+}
+
+void GpuProfiler::_Resolve(int frameIx) {
+	std::vector<PendingScope>& frame = _frames[frameIx];
+	if (frame.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(_statsLock);
+
+	// With nested scopes the last end query issued doesn't belong to the last scope begun, so we
+	// check all of them. Reading a result that isn't ready would stall until the GPU catches up
+	for (const PendingScope& scope : frame) {
+		if (!scope.HasEnded) {
+			continue;
+		}
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(scope.EndQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE) {
+			_droppedFrames++;
+			return;
+		}
+	}
+
+	std::vector<float> times(_stats.size(), 0.0f);
+	for (const PendingScope& scope : frame) {
+		// Scopes left open at the end of the frame have no end time to read
+		if (!scope.HasEnded) {
+			continue;
+		}
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(scope.BeginQuery, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(scope.EndQuery, GL_QUERY_RESULT, &end);
+		times[scope.StatIndex] += (float)((double)(end - begin) / 1000000.0);
+	}
+
+	// Scopes that weren't hit this frame record 0, so averages reflect how often they run
+	size_t historyIx = _resolvedFrames % HISTORY_SIZE;
+	_resolvedFrames++;
+	int sampleCount = (int)std::min<uint64_t>(_resolvedFrames, HISTORY_SIZE);
+	for (size_t ix = 0; ix < _stats.size(); ix++) {
+		ScopeStats& stats = _stats[ix];
+		stats.History[historyIx] = times[ix];
+		stats.Last = times[ix];
+
+		float total = 0.0f;
+		for (int sample = 0; sample < sampleCount; sample++) {
+			total += stats.History[sample];
+		}
+		stats.Average = total / (float)sampleCount;
+	}
+}
+
+void GpuProfiler::RenderImGui() {
+	if (ImGui::Begin("GPU Profiler")) {
+		std::unique_lock<std::mutex> guard(_statsLock);
+		float total = 0.0f;
+		for (const ScopeStats& stats : _stats) {
+			if (stats.Depth == 0) {
+				total += stats.Average;
+			}
+		}
+		ImGui::Text("Total: %.3f ms (averaged over %d frames)", total, HISTORY_SIZE);
+		ImGui::Text("Dropped frames: %llu", (unsigned long long)_droppedFrames);
+		ImGui::Separator();
+
+		for (const ScopeStats& stats : _stats) {
+			// Nested scopes are indented under their parents
+			if (stats.Depth > 0) ImGui::Indent(16.0f * stats.Depth);
+			ImGui::Text("%-20s %7.3f ms (last %7.3f ms)", stats.Name.c_str(), stats.Average, stats.Last);
+			if (stats.Depth > 0) ImGui::Unindent(16.0f * stats.Depth);
+		}
+
+		guard.unlock();
+
+		ImGui::Separator();
+		if (ImGui::Button("Export CSV")) {
+			ExportCsv("gpu_profile.csv");
+		}
+	}
+	ImGui::End();
+}
+
+bool GpuProfiler::ExportCsv(const std::string& filename) {
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file) {
+		LOG_WARN("Failed to open \"{}\" for writing GPU profile", filename);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(_statsLock);
+	file << "frame";
+	for (const ScopeStats& stats : _stats) {
+		file << "," << stats.Name;
+	}
+	file << std::endl;
+
+	// Walk the history ring from oldest to newest
+	uint64_t sampleCount = std::min<uint64_t>(_resolvedFrames, HISTORY_SIZE);
+	uint64_t firstFrame = _resolvedFrames - sampleCount;
+	for (uint64_t frame = firstFrame; frame < _resolvedFrames; frame++) {
+		file << frame;
+		for (const ScopeStats& stats : _stats) {
+			file << "," << stats.History[frame % HISTORY_SIZE];
+		}
+		file << std::endl;
+	}
+
+	LOG_INFO("Exported {} frames of GPU timings to \"{}\"", sampleCount, filename);
+	return true;
+}
+
+float GpuProfiler::GetAverageTime(const std::string& name) {
+	std::lock_guard<std::mutex> guard(_statsLock);
+	auto it = _statLookup.find(name);
+	return it != _statLookup.end() ? _stats[it->second].Average : 0.0f;
+}
+
+float GpuProfiler::GetLastFrameTime() {
+	std::lock_guard<std::mutex> guard(_statsLock);
+	float total = 0.0f;
+	for (const ScopeStats& stats : _stats) {
+		if (stats.Depth == 0) {
+			total += stats.Last;
+		}
+	}
+	return total;
+}
+
+uint64_t GpuProfiler::GetResolvedFrameCount() {
+	std::lock_guard<std::mutex> guard(_statsLock);
+	return _resolvedFrames;
+}
+
+void GpuProfiler::Cleanup() {
+	if (!_queryPool.empty()) {
+		glDeleteQueries((GLsizei)_queryPool.size(), _queryPool.data());
+		_queryPool.clear();
+	}
+	for (auto& frame : _frames) {
+		frame.clear();
+	}
+	_scopeStack.clear();
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/// <summary>
+/// Measures how long the GPU spends on named sections of a frame, using timestamp queries
+///
+/// Query results are read back FRAME_LATENCY frames after they are issued, so reading them
+/// never forces the CPU to wait on the GPU. If a frame's results still aren't ready by the
+/// time its queries need to be re-used, that frame is dropped from the statistics instead
+///
+/// Scopes can be nested, and a scope that is hit multiple times in a frame is summed
+///
+/// Queries are only issued from the thread that owns the GL context, scopes opened on any
+/// other thread are ignored. The results may be read from any thread
+/// </summary>
+class GpuProfiler {
+public:
+	// How many frames of queries we keep in flight before reading them back
+	static constexpr int FRAME_LATENCY = 4;
+	// The maximum number of scopes that can be recorded in a single frame
+	static constexpr int MAX_SCOPES_PER_FRAME = 64;
+	// The number of frames that we average results over, and keep around for exporting
+	static constexpr int HISTORY_SIZE = 120;
+
+	/// <summary>
+	/// Helper for profiling a section of code, which begins a GPU scope when created and ends
+	/// it when it goes out of scope
+	/// </summary>
+	class Scope {
+	public:
+		Scope(const char* name) { GpuProfiler::BeginScope(name); }
+		~Scope() { GpuProfiler::EndScope(); }
+
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+	};
+
+	/// <summary>
+	/// Marks the start of a new frame, and reads back any results that have become available.
+	/// Should be called once per frame, before any scopes are started
+	/// </summary>
+	static void BeginFrame();
+
+	/// <summary>
+	/// Begins a named GPU timing scope, must be matched by a call to EndScope
+	/// </summary>
+	/// <param name="name">The name of the scope, scopes with the same name are summed together</param>
+	static void BeginScope(const char* name);
+	/// <summary>
+	/// Ends the most recently started GPU timing scope
+	/// </summary>
+	static void EndScope();
+
+	/// <summary>
+	/// Draws an ImGui window showing the rolling average GPU time for every scope
+	/// </summary>
+	static void RenderImGui();
+
+	/// <summary>
+	/// Writes the per-frame timings for all scopes in our history to a CSV file, with one
+	/// row per frame (oldest first) and one column per scope, in milliseconds
+	/// </summary>
+	/// <param name="filename">The path of the file to write</param>
+	/// <returns>True if the file was written, false if otherwise</returns>
+	static bool ExportCsv(const std::string& filename);
+
+	/// <summary>
+	/// Gets the rolling average time in milliseconds for the scope with the given name,
+	/// or 0 if no such scope has been recorded
+	/// </summary>
+	static float GetAverageTime(const std::string& name);
+
+	/// <summary>
+	/// Gets the total time in milliseconds of all top level scopes in the most recently resolved
+	/// frame, this is FRAME_LATENCY frames behind the frame currently being recorded
+	/// </summary>
+	static float GetLastFrameTime();
+	/// <summary>
+	/// Gets the number of frames that have been read back so far, useful to tell when
+	/// GetLastFrameTime has a new value
+	/// </summary>
+	static uint64_t GetResolvedFrameCount();
+
+	/// <summary>
+	/// Releases all of our query objects, should be called before the GL context is destroyed
+	/// </summary>
+	static void Cleanup();
+
+protected:
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+
+	// A single scope that has been issued to the GPU, but not yet read back
+	struct PendingScope {
+		int    StatIndex;
+		GLuint BeginQuery;
+		GLuint EndQuery;
+		// False if the scope was never ended, in which case its end query was never issued
+		bool   HasEnded;
+	};
+
+	// The timing results for a single named scope
+	struct ScopeStats {
+		std::string Name;
+		int         Depth;
+		float       History[HISTORY_SIZE];
+		float       Last;
+		float       Average;
+	};
+
+	static std::vector<GLuint>                _queryPool;
+	static std::vector<PendingScope>          _frames[FRAME_LATENCY];
+	static std::vector<int>                   _scopeStack;
+	static std::vector<ScopeStats>            _stats;
+	static std::unordered_map<std::string, int> _statLookup;
+	// Guards _stats and _statLookup, which the UI reads on the main thread while the render thread resolves queries
+	static std::mutex                         _statsLock;
+
+	static int      _currentFrame;
+	static uint64_t _resolvedFrames;
+	static uint64_t _droppedFrames;
+
+	// Reads back the results for the given frame slot, if they are ready
+	static void _Resolve(int frame);
+};
+
+// Profiles the GPU time for the rest of the enclosing block under the given name
+#define GPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define GPU_PROFILE_CONCAT(a, b) GPU_PROFILE_CONCAT_INNER(a, b)
+#define GPU_PROFILE_SCOPE(name) GpuProfiler::Scope GPU_PROFILE_CONCAT(__gpuProfileScope, __LINE__)(name)
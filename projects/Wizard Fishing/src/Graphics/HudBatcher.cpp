@@ -0,0 +1,268 @@
+#include "Graphics/HudBatcher.h"
+#include <algorithm>
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+
+static constexpr UniformHandle U_PROJECTION("u_Projection");
+static constexpr UniformHandle U_SCREEN_SIZE("u_ScreenSize");
+static constexpr UniformHandle U_SCALE("u_Scale");
+
+static HudBatcher::Vertex* HV = nullptr;
+
+const std::vector<BufferAttribute> HudBatcher::Vertex::V_DECL = {
+	BufferAttribute(0, 4, AttributeType::Float, sizeof(HudBatcher::Vertex), (size_t)&HV->Position, AttribUsage::Position),
+	BufferAttribute(1, 2, AttributeType::Float, sizeof(HudBatcher::Vertex), (size_t)&HV->UV, AttribUsage::Texture),
+	BufferAttribute(2, 4, AttributeType::Float, sizeof(HudBatcher::Vertex), (size_t)&HV->Color, AttribUsage::Color),
+};
+
+HudBatcher::HudBatcher() :
+	_sprites(std::vector<Sprite>()),
+	_pending(std::vector<Quad>()),
+	_atlas(nullptr),
+	_atlasDirty(false)
+{
+	// Every quad uses the same 6 indices, so the index buffer never changes
+	std::vector<uint16_t> indices;
+	indices.reserve(MAX_QUADS * 6);
+	for (size_t ix = 0; ix < MAX_QUADS; ix++) {
+		uint16_t base = (uint16_t)(ix * 4);
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+	_ibo = IndexBuffer::Create();
+	_ibo->LoadData(indices.data(), indices.size());
+
+	_vbo = VertexBuffer::Create(BufferUsage::DynamicDraw);
+	_vao = VertexArrayObject::Create();
+	_vao->AddVertexBuffer(_vbo, Vertex::V_DECL);
+	_vao->SetIndexBuffer(_ibo);
+}
+
+void HudBatcher::DrawSprite(const Texture2D::Sptr& texture, const glm::vec4& uvRect, const glm::vec2& anchor, const glm::vec2& offset,
+	const glm::vec2& size, const glm::vec2& pivot, const glm::vec4& color, float fill, bool flipX)
+{
+	if (texture == nullptr || texture->GetWidth() == 0 || texture->GetHeight() == 0 || fill <= 0.0f) {
+		return;
+	}
+
+	// We copy whole texels into the atlas, so round the region outwards
+	glm::vec2 textureSize = glm::vec2(texture->GetWidth(), texture->GetHeight());
+	glm::ivec2 sourceMin = glm::clamp(glm::ivec2(glm::floor(glm::vec2(uvRect.x, uvRect.y) * textureSize)), glm::ivec2(0), glm::ivec2(textureSize));
+	glm::ivec2 sourceMax = glm::clamp(glm::ivec2(glm::ceil(glm::vec2(uvRect.z, uvRect.w) * textureSize)), glm::ivec2(0), glm::ivec2(textureSize));
+	if (sourceMax.x <= sourceMin.x || sourceMax.y <= sourceMin.y) {
+		return;
+	}
+
+	fill = glm::min(fill, 1.0f);
+	Quad quad;
+	quad.SpriteIndex = _FindOrAddSprite(texture, glm::ivec4(sourceMin, sourceMax - sourceMin));
+	quad.Anchor = anchor;
+	quad.Min = offset - pivot * size;
+	quad.Max = glm::vec2(quad.Min.x + size.x * fill, quad.Min.y + size.y);
+	quad.Color = color;
+
+	// Fill crops off the right side of the quad, whichever way the sprite is facing
+	float leftU = flipX ? uvRect.z : uvRect.x;
+	float rightU = flipX ? uvRect.x : uvRect.z;
+	quad.UvRect = glm::vec4(leftU, uvRect.y, glm::mix(leftU, rightU, fill), uvRect.w);
+
+	_pending.push_back(quad);
+}
+
+size_t HudBatcher::_FindOrAddSprite(const Texture2D::Sptr& texture, const glm::ivec4& sourceRect) {
+	for (size_t ix = 0; ix < _sprites.size(); ix++) {
+		if (_sprites[ix].Source == texture && _sprites[ix].SourceRect == sourceRect) {
+			return ix;
+		}
+	}
+
+	Sprite sprite;
+	sprite.Source = texture;
+	sprite.SourceRect = sourceRect;
+	sprite.AtlasPosition = glm::ivec2(0);
+	_sprites.push_back(sprite);
+	_atlasDirty = true;
+	return _sprites.size() - 1;
+}
+
+void HudBatcher::TakeBatch(Batch& batch) {
+	// New sprites can move the old ones around, so only pack once all of this frame's sprites are known
+	if (_atlasDirty) {
+		_RebuildAtlas();
+		_atlasDirty = false;
+	}
+
+	batch.SpriteAtlas = _atlas;
+	batch.Vertices.clear();
+	if (_atlas == nullptr) {
+		_pending.clear();
+		return;
+	}
+
+	if (_pending.size() > MAX_QUADS) {
+		LOG_WARN("Dropping {} HUD sprites, only {} can be drawn per frame", _pending.size() - MAX_QUADS, MAX_QUADS);
+		_pending.resize(MAX_QUADS);
+	}
+
+	glm::vec2 atlasSize = glm::vec2(_atlas->Size);
+	batch.Vertices.reserve(_pending.size() * 4);
+	for (const Quad& quad : _pending) {
+		const Sprite& sprite = _sprites[quad.SpriteIndex];
+
+		// Move the UVs from the source texture into the sprite's spot in the atlas
+		glm::vec2 sourceSize = glm::vec2(sprite.Source->GetWidth(), sprite.Source->GetHeight());
+		glm::vec2 shift = glm::vec2(sprite.AtlasPosition - glm::ivec2(sprite.SourceRect.x, sprite.SourceRect.y));
+		glm::vec2 uvMin = (glm::vec2(quad.UvRect.x, quad.UvRect.y) * sourceSize + shift) / atlasSize;
+		glm::vec2 uvMax = (glm::vec2(quad.UvRect.z, quad.UvRect.w) * sourceSize + shift) / atlasSize;
+
+		// Screen y points down, so the top of the quad uses the top of the sprite (max v)
+		glm::vec2 anchor = quad.Anchor;
+		batch.Vertices.push_back({ glm::vec4(anchor, quad.Min.x, quad.Max.y), glm::vec2(uvMin.x, uvMin.y), quad.Color });
+		batch.Vertices.push_back({ glm::vec4(anchor, quad.Max.x, quad.Max.y), glm::vec2(uvMax.x, uvMin.y), quad.Color });
+		batch.Vertices.push_back({ glm::vec4(anchor, quad.Max.x, quad.Min.y), glm::vec2(uvMax.x, uvMax.y), quad.Color });
+		batch.Vertices.push_back({ glm::vec4(anchor, quad.Min.x, quad.Min.y), glm::vec2(uvMin.x, uvMax.y), quad.Color });
+	}
+	_pending.clear();
+}
+
+void HudBatcher::_RebuildAtlas() {
+	// Shelf packing, tallest sprites first. Each sprite takes up it's padding on every side
+	std::vector<size_t> order(_sprites.size());
+	for (size_t ix = 0; ix < order.size(); ix++) {
+		order[ix] = ix;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return _sprites[a].SourceRect.w > _sprites[b].SourceRect.w;
+	});
+
+	int atlasSize = MIN_ATLAS_SIZE;
+	bool fits = false;
+	while (!fits && atlasSize <= MAX_ATLAS_SIZE) {
+		fits = true;
+		glm::ivec2 cursor = glm::ivec2(0);
+		int shelfHeight = 0;
+		for (size_t index : order) {
+			Sprite& sprite = _sprites[index];
+			glm::ivec2 cellSize = glm::ivec2(sprite.SourceRect.z, sprite.SourceRect.w) + SPRITE_PADDING * 2;
+			if (cursor.x + cellSize.x > atlasSize) {
+				cursor = glm::ivec2(0, cursor.y + shelfHeight);
+				shelfHeight = 0;
+			}
+			if (cursor.x + cellSize.x > atlasSize || cursor.y + cellSize.y > atlasSize) {
+				fits = false;
+				break;
+			}
+			sprite.AtlasPosition = cursor + SPRITE_PADDING;
+			cursor.x += cellSize.x;
+			shelfHeight = glm::max(shelfHeight, cellSize.y);
+		}
+		if (!fits) {
+			atlasSize *= 2;
+		}
+	}
+
+	if (!fits) {
+		LOG_WARN("HUD sprites do not fit in a {}x{} atlas, the HUD will not be drawn", MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+		_atlas = nullptr;
+		return;
+	}
+
+	// Batches already in flight hold on to the old atlas, so we always start a new one
+	Atlas::Sptr atlas = std::make_shared<Atlas>();
+	atlas->Size = glm::ivec2(atlasSize);
+	_atlas = atlas;
+
+	// The sprites are copied out of their full size images, which may not have been streamed in yet
+	for (const Sprite& sprite : _sprites) {
+		sprite.Source->MakeResident();
+	}
+
+	std::vector<Sprite> sprites = _sprites;
+	RenderThread::Enqueue([atlas, sprites]() {
+		Texture2DDescription description;
+		description.Width = atlas->Size.x;
+		description.Height = atlas->Size.y;
+		description.Format = InternalFormat::RGBA8;
+		description.HorizontalWrap = WrapMode::ClampToEdge;
+		description.VerticalWrap = WrapMode::ClampToEdge;
+		description.MinificationFilter = MinFilter::LinearMipLinear;
+		description.MagnificationFilter = MagFilter::Linear;
+		description.MaxAnisotropic = 1.0f;
+		description.GenerateMipMaps = true;
+		atlas->Texture = std::make_shared<Texture2D>(description);
+		atlas->Texture->Clear(glm::vec4(0.0f));
+
+		// Blitting converts between formats for us, so sprites can come from any kind of color texture
+		GLuint framebuffers[2];
+		glCreateFramebuffers(2, framebuffers);
+		glNamedFramebufferTexture(framebuffers[1], GL_COLOR_ATTACHMENT0, atlas->Texture->GetHandle(), 0);
+		for (const Sprite& sprite : sprites) {
+			glm::ivec2 sourceSize = glm::ivec2(sprite.Source->GetWidth(), sprite.Source->GetHeight());
+			glm::ivec2 sourceMin = glm::max(glm::ivec2(sprite.SourceRect.x, sprite.SourceRect.y) - SPRITE_PADDING, glm::ivec2(0));
+			glm::ivec2 sourceMax = glm::min(glm::ivec2(sprite.SourceRect.x + sprite.SourceRect.z, sprite.SourceRect.y + sprite.SourceRect.w) + SPRITE_PADDING, sourceSize);
+			glm::ivec2 destMin = sprite.AtlasPosition + (sourceMin - glm::ivec2(sprite.SourceRect.x, sprite.SourceRect.y));
+
+			glNamedFramebufferTexture(framebuffers[0], GL_COLOR_ATTACHMENT0, sprite.Source->GetHandle(), 0);
+			glBlitNamedFramebuffer(framebuffers[0], framebuffers[1],
+				sourceMin.x, sourceMin.y, sourceMax.x, sourceMax.y,
+				destMin.x, destMin.y, destMin.x + (sourceMax.x - sourceMin.x), destMin.y + (sourceMax.y - sourceMin.y),
+				GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+		glDeleteFramebuffers(2, framebuffers);
+		glGenerateTextureMipmap(atlas->Texture->GetHandle());
+	});
+}
+
+void HudBatcher::DrawBatch(const Batch& batch, const glm::ivec2& screenSize) {
+	if (batch.SpriteAtlas == nullptr || batch.SpriteAtlas->Texture == nullptr || batch.Vertices.empty() || screenSize.x <= 0 || screenSize.y <= 0) {
+		return;
+	}
+
+	// Uploading with glNamedBufferData orphans last frame's storage, so we never wait on the GPU
+	_vbo->LoadData(batch.Vertices.data(), batch.Vertices.size());
+
+	// The HUD always goes on top of the scene
+	bool depthTestWasEnabled = GlStateCache::IsDepthTestEnabled();
+	GlStateCache::SetDepthTestEnabled(false);
+
+	__Shader->Bind();
+	__Shader->SetUniformMatrix(U_PROJECTION, glm::ortho(0.0f, (float)screenSize.x, (float)screenSize.y, 0.0f));
+	__Shader->SetUniform(U_SCREEN_SIZE, glm::vec2(screenSize));
+	__Shader->SetUniform(U_SCALE, screenSize.y / REFERENCE_HEIGHT);
+	GlStateCache::BindTextureUnit(0, batch.SpriteAtlas->Texture->GetHandle());
+	_vao->Bind();
+	glDrawElements(GL_TRIANGLES, (GLsizei)(batch.Vertices.size() / 4 * 6), GL_UNSIGNED_SHORT, nullptr);
+
+	GlStateCache::SetDepthTestEnabled(depthTestWasEnabled);
+}
+
+HudBatcher& HudBatcher::Get() {
+	if (__Instance == nullptr) {
+		// Our buffers and shader need the GL context
+		RenderThread::Invoke([]() {
+			__Instance = new HudBatcher();
+
+			__Shader = Shader::Create();
+			__Shader->LoadShaderPartFromFile("shaders/hud_vert.glsl", ShaderPartType::Vertex);
+			__Shader->LoadShaderPartFromFile("shaders/hud_frag.glsl", ShaderPartType::Fragment);
+			__Shader->Link();
+		});
+	}
+	return *__Instance;
+}
+
+void HudBatcher::Uninitialize()
+{
+	if (__Instance != nullptr) {
+		RenderThread::Invoke([]() {
+			delete __Instance;
+			__Instance = nullptr;
+			__Shader = nullptr;
+		});
+	}
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/Shader.h"
+#include "Graphics/Texture2D.h"
+
+/// <summary>
+/// Draws the 2D HUD (mana bar, minigame widgets, etc...) on top of the scene
+///
+/// Sprites are given in a reference resolution REFERENCE_HEIGHT pixels tall, relative to an
+/// anchor point on the screen, so the HUD keeps it's layout at any window size. Every sprite
+/// is copied out of it's source texture into a single atlas, so that the whole HUD is one
+/// vertex buffer upload and one draw call with an orthographic projection
+///
+/// Like the DebugDrawer, sprites are collected on the main thread, handed to the render
+/// thread each frame with TakeBatch, and drawn there with DrawBatch
+/// </summary>
+class HudBatcher
+{
+public:
+	// The height of the screen that sprite offsets and sizes are measured against
+	inline static const float  REFERENCE_HEIGHT = 1080.0f;
+	// The atlas starts at this size, and doubles until all of our sprites fit
+	inline static const int    MIN_ATLAS_SIZE = 512;
+	inline static const int    MAX_ATLAS_SIZE = 4096;
+	// The number of texels copied from around each sprite, so that filtering and mip maps
+	// blend with the sprite's own surroundings instead of it's neighbours in the atlas
+	inline static const int    SPRITE_PADDING = 8;
+	// The most quads we can draw in a frame, anything past this is dropped
+	inline static const size_t MAX_QUADS = 1024;
+
+	/// <summary>
+	/// A single HUD vertex, positioned relative to the screen so it can be built without
+	/// knowing the window size
+	/// </summary>
+	struct Vertex {
+		// xy is the anchor as a fraction of the screen, from the top left. zw is the offset
+		// from the anchor in reference pixels
+		glm::vec4 Position;
+		glm::vec2 UV;
+		glm::vec4 Color;
+
+		static const std::vector<BufferAttribute> V_DECL;
+	};
+
+	/// <summary>
+	/// The texture that sprites are copied into. Atlases are re-built from scratch when new
+	/// sprites are added, so batches keep the atlas they were built for alive until drawn
+	/// </summary>
+	struct Atlas {
+		typedef std::shared_ptr<Atlas> Sptr;
+		// Created on the render thread, before any batch using the atlas is drawn
+		Texture2D::Sptr Texture;
+		glm::ivec2      Size;
+	};
+
+	/// <summary>
+	/// All of the sprites collected over a frame
+	/// </summary>
+	struct Batch {
+		Atlas::Sptr         SpriteAtlas;
+		// 4 vertices per quad, in the order they were drawn
+		std::vector<Vertex> Vertices;
+	};
+
+	HudBatcher(const HudBatcher& other) = delete;
+	HudBatcher(HudBatcher&& other) = delete;
+	HudBatcher& operator =(const HudBatcher& other) = delete;
+	HudBatcher& operator =(HudBatcher&& other) = delete;
+
+	virtual ~HudBatcher() = default;
+
+	/// <summary>
+	/// Gets the singleton instance of the HUD batcher
+	/// </summary>
+	static HudBatcher& Get();
+	/// <summary>
+	/// Disposes of all resources used by the HUD batcher
+	/// </summary>
+	static void Uninitialize();
+
+	/// <summary>
+	/// Adds a sprite to be drawn this frame. Call from the main thread
+	/// </summary>
+	/// <param name="texture">The texture that the sprite is cut from</param>
+	/// <param name="uvRect">The region of the texture to draw, as (min u, min v, max u, max v)</param>
+	/// <param name="anchor">The point on the screen that the sprite is placed relative to, (0, 0) is the top left</param>
+	/// <param name="offset">The offset from the anchor to the sprite's pivot, in reference pixels</param>
+	/// <param name="size">The size of the sprite, in reference pixels</param>
+	/// <param name="pivot">The point on the sprite that is placed at the offset, (0, 0) is the top left</param>
+	/// <param name="color">A color to multiply the sprite by</param>
+	/// <param name="fill">How much of the sprite to draw from left to right, the rest is cropped off</param>
+	/// <param name="flipX">True to mirror the sprite horizontally</param>
+	void DrawSprite(const Texture2D::Sptr& texture, const glm::vec4& uvRect, const glm::vec2& anchor, const glm::vec2& offset,
+		const glm::vec2& size, const glm::vec2& pivot = glm::vec2(0.5f), const glm::vec4& color = glm::vec4(1.0f), float fill = 1.0f, bool flipX = false);
+
+	/// <summary>
+	/// Moves all of the sprites drawn since the last call into the given batch, packing any new
+	/// sprites into the atlas first. Call from the main thread
+	/// </summary>
+	/// <param name="batch">The batch to fill</param>
+	void TakeBatch(Batch& batch);
+	/// <summary>
+	/// Draws all of the sprites in a batch over whatever is in the current framebuffer, must be
+	/// called from the render thread
+	/// </summary>
+	/// <param name="batch">The batch to draw</param>
+	/// <param name="screenSize">The size of the framebuffer's viewport in pixels</param>
+	void DrawBatch(const Batch& batch, const glm::ivec2& screenSize);
+
+protected:
+	HudBatcher();
+
+	// A region of a source texture that we have copied into the atlas
+	struct Sprite {
+		Texture2D::Sptr Source;
+		// The region of the source texture, in texels as (x, y, width, height), y up
+		glm::ivec4      SourceRect;
+		// Where the bottom left of the region is in the atlas, in texels
+		glm::ivec2      AtlasPosition;
+	};
+	// A sprite waiting for TakeBatch, which will turn it into vertices once the atlas is packed
+	struct Quad {
+		size_t    SpriteIndex;
+		// The UVs in the source texture at the (left, bottom, right, top) of the quad, with
+		// flipping and fill already applied
+		glm::vec4 UvRect;
+		glm::vec2 Anchor;
+		// The top left and bottom right corners, in reference pixels from the anchor
+		glm::vec2 Min;
+		glm::vec2 Max;
+		glm::vec4 Color;
+	};
+
+	std::vector<Sprite> _sprites;
+	std::vector<Quad>   _pending;
+	Atlas::Sptr         _atlas;
+	bool                _atlasDirty;
+
+	VertexBuffer::Sptr      _vbo;
+	IndexBuffer::Sptr       _ibo;
+	VertexArrayObject::Sptr _vao;
+
+	// Finds the sprite for the given region of a texture, adding it if it's new
+	size_t _FindOrAddSprite(const Texture2D::Sptr& texture, const glm::ivec4& sourceRect);
+	// Packs all of our sprites into a new atlas, and queues copying them into it on the render thread
+	void _RebuildAtlas();
+
+	inline static HudBatcher* __Instance = nullptr;
+	inline static Shader::Sptr __Shader = nullptr;
+};
@@ -1,9 +1,13 @@
 #include "IBuffer.h"
+#include "GlStateCache.h"
+#include "GlDeleteList.h"
+#include "Logging.h"
 
 IBuffer::IBuffer(BufferType type, BufferUsage usage) :
 	_elementCount(0),
 	_elementSize(0),
-	_handle(0)
+	_handle(0),
+	_mappedData(nullptr)
 {
 	_type = type;
 	_usage = usage;
@@ -12,7 +16,7 @@ IBuffer::IBuffer(BufferType type, BufferUsage usage) :
 
 IBuffer::~IBuffer() {
 	if (_handle != 0) {
-		glDeleteBuffers(1, &_handle);
+		GlDeleteList().Buffer(_handle).DeleteLater();
 		_handle = 0;
 	}
 }
@@ -25,6 +29,18 @@ void IBuffer::LoadData(const void* data, size_t elementSize, size_t elementCount
 	_elementSize = elementSize;
 }
 
+void* IBuffer::AllocatePersistent(size_t elementSize, size_t elementCount) {
+	LOG_ASSERT(_mappedData == nullptr, "Buffer storage has already been allocated!");
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glNamedBufferStorage(_handle, elementSize * elementCount, nullptr, flags);
+	_mappedData = glMapNamedBufferRange(_handle, 0, elementSize * elementCount, flags);
+
+	_elementCount = elementCount;
+	_elementSize = elementSize;
+	return _mappedData;
+}
+
 void IBuffer::Bind() const {
 	glBindBuffer((GLenum)_type, _handle);
 }
@@ -34,5 +50,13 @@ void IBuffer::UnBind(BufferType type) {
 }
 
 void IBuffer::UnBind(BufferType type, int slot) {
+	if (type == BufferType::Uniform) {
+		GlStateCache::BindUniformBuffer(slot, 0);
+		return;
+	}
+	if (type == BufferType::ShaderStorage) {
+		GlStateCache::BindStorageBuffer(slot, 0);
+		return;
+	}
 	glBindBufferBase((GLenum)type, slot, 0);
 }
@@ -8,7 +8,8 @@
 enum class BufferType {
 	Vertex = GL_ARRAY_BUFFER,
 	Index = GL_ELEMENT_ARRAY_BUFFER,
-	Uniform = GL_UNIFORM_BUFFER
+	Uniform = GL_UNIFORM_BUFFER,
+	ShaderStorage = GL_SHADER_STORAGE_BUFFER
 };
 
 /// <summary>
@@ -74,6 +75,23 @@ public:
 		IBuffer::LoadData((const void*)(data), sizeof(T), count);
 	}
 
+	/// <summary>
+	/// Allocates immutable storage for this buffer that stays mapped for writing for the buffer's
+	/// whole lifetime (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT). Writes through the returned pointer
+	/// are visible to the GPU without any extra calls, but the caller must use fences to avoid
+	/// writing to regions that the GPU is still reading from.
+	/// Note that LoadData cannot be used on the buffer after this has been called
+	/// </summary>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to allocate space for</param>
+	/// <returns>A pointer to the start of the mapped buffer</returns>
+	void* AllocatePersistent(size_t elementSize, size_t elementCount);
+	/// <summary>
+	/// Returns the persistently mapped pointer for this buffer, or nullptr if AllocatePersistent
+	/// has not been called
+	/// </summary>
+	void* GetMappedPointer() const { return _mappedData; }
+
 	/// <summary>
 	/// Returns the number of elements that are loaded into this buffer
 	/// </summary>
@@ -127,6 +145,7 @@ protected:
 	size_t _elementSize; // The size or stride of our elements
 	size_t _elementCount; // The number of elements in the buffer
 	GLuint _handle; // The OpenGL handle for the underlying buffer
+	void* _mappedData; // The persistently mapped pointer to our storage, if any
 	BufferUsage _usage; // The buffer usage mode (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
 	BufferType _type; // The buffer type (ex GL_ARRAY_BUFFER, GL_ARRAY_ELEMENT_BUFFER)
 };
@@ -1,4 +1,6 @@
 #include "ITexture.h"
+#include "GlStateCache.h"
+#include "GlDeleteList.h"
 
 ITexture::Limits ITexture::__limits = ITexture::Limits();
 bool ITexture::__isStaticInit = false;
@@ -20,8 +22,8 @@ void ITexture::_Recreate()
 }
 
 ITexture::~ITexture() {
-	if (glIsTexture(_handle)) {
-		glDeleteTextures(1, &_handle);
+	if (_handle != 0) {
+		GlDeleteList().Texture(_handle).DeleteLater();
 		_handle = 0;
 	}
 }
@@ -29,12 +31,13 @@ ITexture::~ITexture() {
 void ITexture::Bind(int slot) {
 	if (_handle != 0) {
 		// Instead of glActiveTexture + glBindTexture, we can one line it now :D
-		glBindTextureUnit(slot, _handle); 
+		// The state cache will skip this if the texture is already in the slot
+		GlStateCache::BindTextureUnit(slot, _handle);
 	}
 }
 
 void ITexture::Unbind(int slot) {
-	glBindTextureUnit(slot, 0);
+	GlStateCache::BindTextureUnit(slot, 0);
 }
 
 void ITexture::Clear(const glm::vec4& color) {
@@ -53,6 +53,11 @@ public:
 	/// <param name="color">The color to clear to</param>
 	void Clear(const glm::vec4& color);
 
+	/// <summary>
+	/// Gets the underlying OpenGL handle for this texture
+	/// </summary>
+	GLuint GetHandle() const { return _handle; }
+
 protected:
 	ITexture(TextureType type);
 
@@ -0,0 +1,317 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <emmintrin.h>
+#include <imgui.h>
+
+OcclusionCuller::OcclusionCuller() :
+	Enabled(true),
+	_viewProjection(glm::mat4(1.0f)),
+	_triangles(std::vector<ScreenTriangle>()),
+	_hasOccluders(false),
+	_testedCount(0),
+	_culledCount(0),
+	_rasterTime(0.0f),
+	_workers(std::vector<std::thread>()),
+	_generation(0),
+	_workersBusy(0),
+	_stopRequested(false),
+	_nextTile(0)
+{
+	for (int ix = 0; ix < LEVEL_COUNT; ix++) {
+		_levels[ix].resize((WIDTH >> ix) * (HEIGHT >> ix), 1.0f);
+	}
+
+	// Leave a core for the render thread, hardware_concurrency may also return 0 if it doesn't know
+	int workerCount = glm::clamp((int)std::thread::hardware_concurrency() - 2, 0, MAX_WORKERS);
+	for (int ix = 0; ix < workerCount; ix++) {
+		_workers.emplace_back(&OcclusionCuller::_WorkerMain, this);
+	}
+}
+
+OcclusionCuller::~OcclusionCuller() {
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stopRequested = true;
+		_workQueued.notify_all();
+	}
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection) {
+	_viewProjection = viewProjection;
+	_triangles.clear();
+	_hasOccluders = false;
+	_testedCount = 0;
+	_culledCount = 0;
+	std::fill(_levels[0].begin(), _levels[0].end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& model) {
+	glm::mat4 mvp = _viewProjection * model;
+	for (size_t ix = 0; ix + 2 < triangles.size(); ix += 3) {
+		glm::vec4 input[3] = {
+			mvp * glm::vec4(triangles[ix], 1.0f),
+			mvp * glm::vec4(triangles[ix + 1], 1.0f),
+			mvp * glm::vec4(triangles[ix + 2], 1.0f)
+		};
+
+		// Clip against the near plane (z >= -w), which can turn the triangle into a quad
+		glm::vec4 clipped[4];
+		int count = 0;
+		for (int iy = 0; iy < 3; iy++) {
+			const glm::vec4& current = input[iy];
+			const glm::vec4& next = input[(iy + 1) % 3];
+			float currentDist = current.z + current.w;
+			float nextDist = next.z + next.w;
+			if (currentDist >= 0.0f) {
+				clipped[count++] = current;
+			}
+			if ((currentDist >= 0.0f) != (nextDist >= 0.0f)) {
+				clipped[count++] = glm::mix(current, next, currentDist / (currentDist - nextDist));
+			}
+		}
+
+		for (int iy = 2; iy < count; iy++) {
+			_AddTriangle(clipped[0], clipped[iy - 1], clipped[iy]);
+		}
+	}
+}
+
+void OcclusionCuller::_AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+	if (a.w <= 0.0f || b.w <= 0.0f || c.w <= 0.0f) {
+		return;
+	}
+
+	// Project into depth buffer space, with depth going from 0 at the near plane to 1 at the far plane
+	glm::vec3 points[3];
+	const glm::vec4* clip[3] = { &a, &b, &c };
+	for (int ix = 0; ix < 3; ix++) {
+		glm::vec3 ndc = glm::vec3(*clip[ix]) / clip[ix]->w;
+		points[ix] = glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(WIDTH, HEIGHT), ndc.z * 0.5f + 0.5f);
+	}
+
+	// Make sure we're wound counter-clockwise so our edge functions are positive inside, occluders
+	// are usually closed so we don't need to worry about which way they are facing
+	float area = (points[1].x - points[0].x) * (points[2].y - points[0].y) - (points[1].y - points[0].y) * (points[2].x - points[0].x);
+	if (glm::abs(area) < 1e-6f) {
+		return;
+	}
+	if (area < 0.0f) {
+		std::swap(points[1], points[2]);
+	}
+
+	ScreenTriangle tri;
+	glm::vec2 min = glm::min(glm::min(glm::vec2(points[0]), glm::vec2(points[1])), glm::vec2(points[2]));
+	glm::vec2 max = glm::max(glm::max(glm::vec2(points[0]), glm::vec2(points[1])), glm::vec2(points[2]));
+	tri.Min = glm::max(glm::ivec2(glm::floor(min)), glm::ivec2(0));
+	tri.Max = glm::min(glm::ivec2(glm::floor(max)), glm::ivec2(WIDTH - 1, HEIGHT - 1));
+	if (tri.Min.x > tri.Max.x || tri.Min.y > tri.Max.y) {
+		return;
+	}
+
+	for (int ix = 0; ix < 3; ix++) {
+		const glm::vec3& from = points[ix];
+		const glm::vec3& to = points[(ix + 1) % 3];
+		tri.Edges[ix] = glm::vec3(from.y - to.y, to.x - from.x, (to.y - from.y) * from.x - (to.x - from.x) * from.y);
+	}
+	tri.Depth = glm::min(glm::max(glm::max(points[0].z, points[1].z), points[2].z), 1.0f);
+	_triangles.push_back(tri);
+}
+
+void OcclusionCuller::Rasterize() {
+	if (_triangles.empty()) {
+		_rasterTime = 0.0f;
+		return;
+	}
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Sort our triangles into the tiles they touch, so each tile can be drawn without locking
+	for (auto& bin : _tileBins) {
+		bin.clear();
+	}
+	for (uint32_t ix = 0; ix < (uint32_t)_triangles.size(); ix++) {
+		const ScreenTriangle& tri = _triangles[ix];
+		for (int ty = tri.Min.y / TILE_HEIGHT; ty <= tri.Max.y / TILE_HEIGHT; ty++) {
+			for (int tx = tri.Min.x / TILE_WIDTH; tx <= tri.Max.x / TILE_WIDTH; tx++) {
+				_tileBins[ty * TILES_X + tx].push_back(ix);
+			}
+		}
+	}
+
+	// Wake up the workers, and help them out until all the tiles have been taken
+	_nextTile = 0;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_generation++;
+		_workersBusy = (int)_workers.size();
+		_workQueued.notify_all();
+	}
+	_RasterizeTiles();
+	{
+		std::unique_lock<std::mutex> guard(_lock);
+		_workDone.wait(guard, [&] { return _workersBusy == 0; });
+	}
+
+	_BuildHierarchy();
+	_hasOccluders = true;
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+	_rasterTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+void OcclusionCuller::_WorkerMain() {
+	uint64_t lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(_lock);
+			_workQueued.wait(guard, [&] { return _stopRequested || _generation != lastGeneration; });
+			if (_stopRequested) {
+				return;
+			}
+			lastGeneration = _generation;
+		}
+
+		_RasterizeTiles();
+
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_workersBusy--;
+			_workDone.notify_all();
+		}
+	}
+}
+
+void OcclusionCuller::_RasterizeTiles() {
+	int tile;
+	while ((tile = _nextTile.fetch_add(1)) < TILE_COUNT) {
+		_RasterizeTile(tile);
+	}
+}
+
+void OcclusionCuller::_RasterizeTile(int tile) {
+	glm::ivec2 tileMin = glm::ivec2(tile % TILES_X * TILE_WIDTH, tile / TILES_X * TILE_HEIGHT);
+	glm::ivec2 tileMax = tileMin + glm::ivec2(TILE_WIDTH - 1, TILE_HEIGHT - 1);
+
+	float* depth = _levels[0].data();
+	const __m128 zero = _mm_setzero_ps();
+	// We sample at pixel centers
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (uint32_t index : _tileBins[tile]) {
+		const ScreenTriangle& tri = _triangles[index];
+		// Start on a multiple of 4 so we never write past the edge of the tile
+		int minX = glm::max(tri.Min.x, tileMin.x) & ~3;
+		int maxX = glm::min(tri.Max.x, tileMax.x);
+		int minY = glm::max(tri.Min.y, tileMin.y);
+		int maxY = glm::min(tri.Max.y, tileMax.y);
+
+		const __m128 triDepth = _mm_set1_ps(tri.Depth);
+		const __m128 stepX0 = _mm_set1_ps(tri.Edges[0].x);
+		const __m128 stepX1 = _mm_set1_ps(tri.Edges[1].x);
+		const __m128 stepX2 = _mm_set1_ps(tri.Edges[2].x);
+
+		for (int y = minY; y <= maxY; y++) {
+			float py = (float)y + 0.5f;
+			const __m128 row0 = _mm_set1_ps(tri.Edges[0].y * py + tri.Edges[0].z);
+			const __m128 row1 = _mm_set1_ps(tri.Edges[1].y * py + tri.Edges[1].z);
+			const __m128 row2 = _mm_set1_ps(tri.Edges[2].y * py + tri.Edges[2].z);
+			float* row = depth + y * WIDTH;
+
+			for (int x = minX; x <= maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+				__m128 edge0 = _mm_add_ps(_mm_mul_ps(stepX0, px), row0);
+				__m128 edge1 = _mm_add_ps(_mm_mul_ps(stepX1, px), row1);
+				__m128 edge2 = _mm_add_ps(_mm_mul_ps(stepX2, px), row2);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+
+				// Keep the nearest depth, but only for the pixels that are inside the triangle
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 written = _mm_min_ps(current, triDepth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, written), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::_BuildHierarchy() {
+	for (int level = 1; level < LEVEL_COUNT; level++) {
+		const std::vector<float>& source = _levels[level - 1];
+		std::vector<float>& dest = _levels[level];
+		int sourceWidth = WIDTH >> (level - 1);
+		int width = WIDTH >> level;
+		int height = HEIGHT >> level;
+		for (int y = 0; y < height; y++) {
+			const float* top = source.data() + (y * 2) * sourceWidth;
+			const float* bottom = top + sourceWidth;
+			for (int x = 0; x < width; x++) {
+				dest[y * width + x] = glm::max(glm::max(top[x * 2], top[x * 2 + 1]), glm::max(bottom[x * 2], bottom[x * 2 + 1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& center, float radius) const {
+	if (!_hasOccluders) {
+		return true;
+	}
+
+	// Project the box around the sphere, and find the rectangle and nearest depth it covers
+	glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 max = glm::vec2(std::numeric_limits<float>::lowest());
+	float nearest = std::numeric_limits<float>::max();
+	for (int ix = 0; ix < 8; ix++) {
+		glm::vec3 corner = center + radius * glm::vec3(ix & 1 ? 1.0f : -1.0f, ix & 2 ? 1.0f : -1.0f, ix & 4 ? 1.0f : -1.0f);
+		glm::vec4 clip = _viewProjection * glm::vec4(corner, 1.0f);
+		// Anything crossing the near plane could cover the whole screen, so we just let it through
+		if (clip.w <= 0.0f || clip.z < -clip.w) {
+			return true;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(WIDTH, HEIGHT);
+		min = glm::min(min, screen);
+		max = glm::max(max, screen);
+		nearest = glm::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	glm::ivec2 lo = glm::max(glm::ivec2(glm::floor(min)), glm::ivec2(0));
+	glm::ivec2 hi = glm::min(glm::ivec2(glm::floor(max)), glm::ivec2(WIDTH - 1, HEIGHT - 1));
+	// Off screen objects are left for the GPU to clip
+	if (lo.x > hi.x || lo.y > hi.y) {
+		return true;
+	}
+
+	// Find the first level where the rectangle covers at most 2x2 texels
+	int level = 0;
+	while (level < LEVEL_COUNT - 1 && ((hi.x >> level) - (lo.x >> level) > 1 || (hi.y >> level) - (lo.y >> level) > 1)) {
+		level++;
+	}
+
+	// If any texel has something farther away than our nearest point, we might be visible
+	const std::vector<float>& depth = _levels[level];
+	int levelWidth = WIDTH >> level;
+	for (int y = lo.y >> level; y <= hi.y >> level; y++) {
+		for (int x = lo.x >> level; x <= hi.x >> level; x++) {
+			if (depth[y * levelWidth + x] >= nearest) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionCuller::RecordResults(int tested, int culled) {
+	_testedCount += tested;
+	_culledCount += culled;
+}
+
+void OcclusionCuller::RenderImGui() {
+	ImGui::Checkbox("Occlusion Culling", &Enabled);
+	ImGui::Text("Occluded:   %d / %d objects", _culledCount, _testedCount);
+	ImGui::Text("Occluders:  %d triangles in %.2f ms (%d threads)", (int)_triangles.size(), _rasterTime, (int)_workers.size() + 1);
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Hides objects that are behind large occluders before they are ever sent to the GPU
+///
+/// Each frame, the occluders (simplified proxy meshes) are drawn into a small depth buffer
+/// on the CPU. Every triangle is written at it's farthest depth, so the buffer never claims
+/// something is closer than it really is. The screen is split into tiles which are rasterized
+/// in parallel, 4 pixels at a time with SSE. We then build a hierarchy of max depths from it,
+/// so that objects can be tested by checking a handful of texels that cover their bounds
+///
+/// This only does CPU work, and should be used from the main thread
+/// </summary>
+class OcclusionCuller {
+public:
+	typedef std::shared_ptr<OcclusionCuller> Sptr;
+
+	// The size of our depth buffer, much smaller than the screen since occluders are big
+	static const int WIDTH = 256;
+	static const int HEIGHT = 128;
+	// The size of the tiles we split the screen into, the width must be a multiple of 4 for SSE
+	static const int TILE_WIDTH = 64;
+	static const int TILE_HEIGHT = 32;
+	static const int TILES_X = WIDTH / TILE_WIDTH;
+	static const int TILES_Y = HEIGHT / TILE_HEIGHT;
+	static const int TILE_COUNT = TILES_X * TILES_Y;
+	// The number of levels in our depth hierarchy, the last one is 2x1
+	static const int LEVEL_COUNT = 8;
+	// The most worker threads we will start, the main thread rasterizes tiles as well
+	static const int MAX_WORKERS = 3;
+
+	static inline Sptr Create() {
+		return std::make_shared<OcclusionCuller>();
+	}
+
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller& other) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller& other) = delete;
+
+	// When false, nothing is rasterized and every object is visible
+	bool Enabled;
+
+	/// <summary>
+	/// Clears the depth buffer, and sets the camera that occluders and objects will be projected with
+	/// </summary>
+	/// <param name="viewProjection">The camera's view projection matrix</param>
+	void BeginFrame(const glm::mat4& viewProjection);
+	/// <summary>
+	/// Adds an occluder to be drawn by the next call to Rasterize
+	/// </summary>
+	/// <param name="triangles">The model space triangles to draw, 3 positions per triangle</param>
+	/// <param name="model">The transform of the object that the triangles belong to</param>
+	void AddOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& model);
+	/// <summary>
+	/// Draws all the occluders added since BeginFrame, and builds the depth hierarchy from them
+	/// </summary>
+	void Rasterize();
+
+	/// <summary>
+	/// Tests a world space bounding sphere against the occluders, must be called after Rasterize.
+	/// This only reads the depth hierarchy, so it can be called from many threads at once
+	/// </summary>
+	/// <param name="center">The center of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <returns>False if the sphere is definitely hidden behind occluders</returns>
+	bool IsVisible(const glm::vec3& center, float radius) const;
+	/// <summary>
+	/// Adds to the stats shown in the debug UI, since IsVisible doesn't count it's own tests
+	/// </summary>
+	/// <param name="tested">The number of objects that were tested</param>
+	/// <param name="culled">How many of them were hidden</param>
+	void RecordResults(int tested, int culled);
+
+	/// <summary>
+	/// Draws the ImGui controls for our settings, along with stats from the last frame
+	/// </summary>
+	void RenderImGui();
+
+protected:
+	// A triangle in depth buffer space, set up for rasterizing
+	struct ScreenTriangle {
+		// The edge functions are Edges[n].x * x + Edges[n].y * y + Edges[n].z, and are positive inside
+		glm::vec3 Edges[3];
+		// The farthest depth of the triangle, between 0 and 1
+		float     Depth;
+		// The pixels covered by the triangle, inclusive
+		glm::ivec2 Min;
+		glm::ivec2 Max;
+	};
+
+	glm::mat4 _viewProjection;
+	std::vector<ScreenTriangle> _triangles;
+	// The triangles touching each tile, as indices into _triangles
+	std::vector<uint32_t> _tileBins[TILE_COUNT];
+	// Level 0 is the depth buffer itself, every level after is half the size of the one before
+	std::vector<float> _levels[LEVEL_COUNT];
+	bool _hasOccluders;
+
+	// Stats from the current frame
+	int   _testedCount;
+	int   _culledCount;
+	float _rasterTime;
+
+	// Our workers sleep until the generation changes, and then help us rasterize tiles
+	std::vector<std::thread> _workers;
+	std::mutex _lock;
+	std::condition_variable _workQueued;
+	std::condition_variable _workDone;
+	uint64_t _generation;
+	int _workersBusy;
+	bool _stopRequested;
+	std::atomic<int> _nextTile;
+
+	void _AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	void _WorkerMain();
+	void _RasterizeTiles();
+	void _RasterizeTile(int tile);
+	void _BuildHierarchy();
+};
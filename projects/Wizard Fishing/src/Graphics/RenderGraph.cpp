@@ -0,0 +1,480 @@
+#include "Graphics/RenderGraph.h"
+#include <algorithm>
+#include <imgui.h>
+#include <Logging.h>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/GlDeleteList.h"
+
+// Returns true if the format goes in a depth attachment instead of a color attachment
+static bool IsDepthFormat(GLenum format) {
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F ||
+		format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+// Rough size of a texel, only used for the memory stats
+static size_t BytesPerPixel(GLenum format) {
+	switch (format) {
+		case GL_R8:                 return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_DEPTH_COMPONENT16:  return 2;
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:  return 8;
+		case GL_RGBA32F:            return 16;
+		default:                    return 4;
+	}
+}
+
+GLuint RenderGraph::PassContext::GetTexture(ResourceHandle resource) const {
+	int physical = _graph->_compiledPhysical[resource];
+	return physical >= 0 ? _graph->_textures[physical].Handle : 0;
+}
+
+glm::ivec2 RenderGraph::PassContext::GetSize(ResourceHandle resource) const {
+	return _graph->_resources[resource].Description.Size;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadTexture(ResourceHandle resource) {
+	_graph->_passes[_pass].Accesses.push_back({ resource, AccessType::Texture, LoadOp::Load });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadImage(ResourceHandle resource) {
+	_graph->_passes[_pass].Accesses.push_back({ resource, AccessType::ImageRead, LoadOp::Load });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteImage(ResourceHandle resource, LoadOp load) {
+	LOG_ASSERT(!_graph->_resources[resource].Imported, "Imported framebuffers can't be written with image stores");
+	_graph->_passes[_pass].Accesses.push_back({ resource, AccessType::ImageWrite, load });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteColor(ResourceHandle resource, LoadOp load) {
+	_graph->_passes[_pass].Accesses.push_back({ resource, AccessType::Color, load });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteDepth(ResourceHandle resource, LoadOp load) {
+	LOG_ASSERT(IsDepthFormat(_graph->_resources[resource].Description.Format), "Depth attachments need a depth format");
+	_graph->_passes[_pass].Accesses.push_back({ resource, AccessType::Depth, load });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetViewport(const glm::ivec2& size) {
+	_graph->_passes[_pass].Viewport = size;
+	_graph->_passes[_pass].HasViewport = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffects() {
+	_graph->_passes[_pass].HasSideEffects = true;
+	return *this;
+}
+
+RenderGraph::RenderGraph() :
+	_resources(std::vector<Resource>()),
+	_passes(std::vector<Pass>()),
+	_shape(std::vector<uint64_t>()),
+	_compiledShape(std::vector<uint64_t>()),
+	_compiledPasses(std::vector<CompiledPass>()),
+	_compiledPhysical(std::vector<int>()),
+	_textures(std::vector<PhysicalTexture>()),
+	_framebuffers(std::vector<CompiledFramebuffer>()),
+	_statsLock(),
+	_stats({ 0, 0, 0, 0, 0, 0, 0, 0, 0 }),
+	_passSummary()
+{ }
+
+RenderGraph::~RenderGraph() {
+	GlDeleteList objects;
+	for (const PhysicalTexture& texture : _textures) {
+		objects.Texture(texture.Handle);
+	}
+	for (const CompiledFramebuffer& framebuffer : _framebuffers) {
+		if (!framebuffer.Imported) {
+			objects.Framebuffer(framebuffer.Handle);
+		}
+	}
+	objects.DeleteLater();
+}
+
+void RenderGraph::Reset() {
+	// Clearing keeps the vectors' storage, so declaring a frame doesn't allocate once they've grown
+	_resources.clear();
+	_passes.clear();
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportFramebuffer(const std::string& name, GLuint framebuffer, const glm::ivec2& size) {
+	Resource resource;
+	resource.Name = name;
+	resource.Imported = true;
+	resource.ImportedFramebuffer = framebuffer;
+	resource.Description = { size, GL_RGBA8 };
+	_resources.push_back(resource);
+	return (ResourceHandle)_resources.size() - 1;
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateTexture(const std::string& name, const TextureDescription& description) {
+	LOG_ASSERT(description.Size.x > 0 && description.Size.y > 0, "Transient texture \"{}\" must have a non-zero size", name);
+	Resource resource;
+	resource.Name = name;
+	resource.Imported = false;
+	resource.ImportedFramebuffer = 0;
+	resource.Description = description;
+	_resources.push_back(resource);
+	return (ResourceHandle)_resources.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& name, const ExecuteFunc& execute) {
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	pass.Viewport = glm::ivec2(0);
+	pass.HasViewport = false;
+	pass.HasSideEffects = false;
+	_passes.push_back(pass);
+	return PassBuilder(this, _passes.size() - 1);
+}
+
+void RenderGraph::_BuildShape() {
+	_shape.clear();
+	_shape.push_back(_resources.size());
+	for (const Resource& resource : _resources) {
+		_shape.push_back(resource.Imported);
+		_shape.push_back(resource.ImportedFramebuffer);
+		_shape.push_back((uint64_t)resource.Description.Size.x << 32 | (uint32_t)resource.Description.Size.y);
+		_shape.push_back(resource.Description.Format);
+	}
+	_shape.push_back(_passes.size());
+	for (const Pass& pass : _passes) {
+		_shape.push_back(pass.HasSideEffects);
+		_shape.push_back(pass.Accesses.size());
+		for (const Access& access : pass.Accesses) {
+			_shape.push_back((uint64_t)access.Resource << 16 | (uint64_t)access.Type << 8 | (uint64_t)access.Load);
+		}
+	}
+}
+
+void RenderGraph::_Compile() {
+	size_t resourceCount = _resources.size();
+	size_t passCount = _passes.size();
+	_compiledPasses.assign(passCount, { true, -1, glm::ivec2(0), 0 });
+
+	// Walk backwards from the imported framebuffers, keeping a pass only if something after it
+	// needs what it writes. needed[r] is true while the current contents of r will be used
+	std::vector<bool> needed(resourceCount, false);
+	for (size_t ix = 0; ix < resourceCount; ix++) {
+		needed[ix] = _resources[ix].Imported;
+	}
+	for (size_t ix = passCount; ix-- > 0;) {
+		const Pass& pass = _passes[ix];
+		bool alive = pass.HasSideEffects;
+		for (const Access& access : pass.Accesses) {
+			if (access.Type != AccessType::Texture && access.Type != AccessType::ImageRead && needed[access.Resource]) {
+				alive = true;
+			}
+		}
+		if (!alive) {
+			continue;
+		}
+
+		_compiledPasses[ix].Culled = false;
+		// Writes that discard make the earlier contents useless, unless this same pass reads them
+		for (const Access& access : pass.Accesses) {
+			if (access.Type == AccessType::ImageWrite || access.Type == AccessType::Color || access.Type == AccessType::Depth) {
+				needed[access.Resource] = access.Load == LoadOp::Load;
+			}
+		}
+		for (const Access& access : pass.Accesses) {
+			if (access.Type == AccessType::Texture || access.Type == AccessType::ImageRead) {
+				needed[access.Resource] = true;
+			}
+		}
+	}
+
+	// Find the first and last pass that uses each transient texture
+	std::vector<int> firstUse(resourceCount, -1);
+	std::vector<int> lastUse(resourceCount, -1);
+	for (size_t ix = 0; ix < passCount; ix++) {
+		if (_compiledPasses[ix].Culled) {
+			continue;
+		}
+		for (const Access& access : _passes[ix].Accesses) {
+			if (firstUse[access.Resource] < 0) {
+				firstUse[access.Resource] = (int)ix;
+			}
+			lastUse[access.Resource] = (int)ix;
+		}
+	}
+
+	// Place the transient textures in our pool in the order they're first used. A physical texture
+	// is free once the last transient placed in it has had it's last use
+	std::vector<size_t> order;
+	for (size_t ix = 0; ix < resourceCount; ix++) {
+		if (!_resources[ix].Imported && firstUse[ix] >= 0) {
+			order.push_back(ix);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return firstUse[a] < firstUse[b];
+	});
+
+	for (PhysicalTexture& texture : _textures) {
+		texture.LastUse = -2;
+	}
+	_compiledPhysical.assign(resourceCount, -1);
+	size_t unaliasedBytes = 0;
+	for (size_t resourceIx : order) {
+		const TextureDescription& description = _resources[resourceIx].Description;
+		unaliasedBytes += (size_t)description.Size.x * description.Size.y * BytesPerPixel(description.Format);
+
+		int physical = -1;
+		for (size_t ix = 0; ix < _textures.size(); ix++) {
+			const PhysicalTexture& texture = _textures[ix];
+			if (texture.LastUse < firstUse[resourceIx] && texture.Description.Size == description.Size && texture.Description.Format == description.Format) {
+				physical = (int)ix;
+				break;
+			}
+		}
+		if (physical < 0) {
+			PhysicalTexture texture;
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture.Handle);
+			glTextureStorage2D(texture.Handle, 1, description.Format, description.Size.x, description.Size.y);
+			glTextureParameteri(texture.Handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(texture.Handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(texture.Handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture.Handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			texture.Description = description;
+			_textures.push_back(texture);
+			physical = (int)_textures.size() - 1;
+		}
+		_textures[physical].LastUse = lastUse[resourceIx];
+		_compiledPhysical[resourceIx] = physical;
+	}
+
+	// Framebuffers point at specific textures, so they're all rebuilt after the textures move around
+	_ReleaseFramebuffers();
+
+	// Textures that this graph no longer uses are freed, so memory only grows with the current frame's needs
+	std::vector<int> remap(_textures.size(), -1);
+	std::vector<PhysicalTexture> kept;
+	for (size_t ix = 0; ix < _textures.size(); ix++) {
+		if (_textures[ix].LastUse == -2) {
+			GlStateCache::OnTextureDeleted(_textures[ix].Handle);
+			glDeleteTextures(1, &_textures[ix].Handle);
+		} else {
+			remap[ix] = (int)kept.size();
+			kept.push_back(_textures[ix]);
+		}
+	}
+	_textures.swap(kept);
+	for (int& physical : _compiledPhysical) {
+		physical = physical >= 0 ? remap[physical] : -1;
+	}
+
+	// Build the framebuffers for each pass, and work out which barriers it needs. Pending image
+	// stores are tracked per physical texture, since aliased textures share the same memory
+	std::vector<bool> pendingStores(_textures.size(), false);
+	for (size_t ix = 0; ix < passCount; ix++) {
+		CompiledPass& compiled = _compiledPasses[ix];
+		if (compiled.Culled) {
+			continue;
+		}
+
+		std::vector<int> colors;
+		int depth = -1;
+		ResourceHandle imported = INVALID_RESOURCE;
+		for (const Access& access : _passes[ix].Accesses) {
+			int physical = _compiledPhysical[access.Resource];
+			if (access.Type == AccessType::Color || access.Type == AccessType::Depth) {
+				if (_resources[access.Resource].Imported) {
+					imported = access.Resource;
+				} else if (access.Type == AccessType::Color) {
+					colors.push_back(physical);
+				} else {
+					depth = physical;
+				}
+				// The viewport defaults to the size of the first attachment
+				if (compiled.AttachmentSize == glm::ivec2(0)) {
+					compiled.AttachmentSize = _resources[access.Resource].Description.Size;
+				}
+			}
+
+			if (physical >= 0 && pendingStores[physical]) {
+				switch (access.Type) {
+					case AccessType::Texture:    compiled.Barriers |= GL_TEXTURE_FETCH_BARRIER_BIT; break;
+					case AccessType::ImageRead:
+					case AccessType::ImageWrite: compiled.Barriers |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT; break;
+					default:                     compiled.Barriers |= GL_FRAMEBUFFER_BARRIER_BIT; break;
+				}
+				pendingStores[physical] = false;
+			}
+		}
+		for (const Access& access : _passes[ix].Accesses) {
+			int physical = _compiledPhysical[access.Resource];
+			if (access.Type == AccessType::ImageWrite && physical >= 0) {
+				pendingStores[physical] = true;
+			}
+		}
+
+		if (imported != INVALID_RESOURCE) {
+			LOG_ASSERT(colors.empty() && depth < 0, "Pass \"{}\" mixes an imported framebuffer with other attachments", _passes[ix].Name);
+			compiled.Framebuffer = _GetImportedFramebuffer(_resources[imported].ImportedFramebuffer);
+		} else if (!colors.empty() || depth >= 0) {
+			colors.push_back(depth);
+			compiled.Framebuffer = _GetTextureFramebuffer(colors);
+		}
+
+		// Sampling from a texture we're rendering into is undefined
+		for (const Access& access : _passes[ix].Accesses) {
+			if (access.Type == AccessType::Texture && compiled.Framebuffer >= 0 && _compiledPhysical[access.Resource] >= 0) {
+				const std::vector<int>& attachments = _framebuffers[compiled.Framebuffer].Attachments;
+				LOG_ASSERT(std::find(attachments.begin(), attachments.end(), _compiledPhysical[access.Resource]) == attachments.end(),
+					"Pass \"{}\" samples \"{}\" while rendering into it", _passes[ix].Name, _resources[access.Resource].Name);
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(_statsLock);
+	_stats.Compiles++;
+	_stats.Passes = (int)passCount;
+	_stats.CulledPasses = 0;
+	_passSummary.clear();
+	for (size_t ix = 0; ix < passCount; ix++) {
+		_stats.CulledPasses += _compiledPasses[ix].Culled ? 1 : 0;
+		_passSummary.push_back({ _passes[ix].Name, _compiledPasses[ix].Culled });
+	}
+	_stats.TransientTextures = (int)order.size();
+	_stats.PhysicalTextures = (int)_textures.size();
+	_stats.TransientBytes = 0;
+	for (const PhysicalTexture& texture : _textures) {
+		_stats.TransientBytes += (size_t)texture.Description.Size.x * texture.Description.Size.y * BytesPerPixel(texture.Description.Format);
+	}
+	_stats.UnaliasedBytes = unaliasedBytes;
+}
+
+int RenderGraph::_GetTextureFramebuffer(const std::vector<int>& attachments) {
+	for (size_t ix = 0; ix < _framebuffers.size(); ix++) {
+		if (!_framebuffers[ix].Imported && _framebuffers[ix].Attachments == attachments) {
+			return (int)ix;
+		}
+	}
+
+	CompiledFramebuffer framebuffer;
+	framebuffer.Imported = false;
+	framebuffer.Attachments = attachments;
+	glCreateFramebuffers(1, &framebuffer.Handle);
+
+	std::vector<GLenum> drawBuffers;
+	for (size_t ix = 0; ix + 1 < attachments.size(); ix++) {
+		GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)ix;
+		glNamedFramebufferTexture(framebuffer.Handle, attachment, _textures[attachments[ix]].Handle, 0);
+		drawBuffers.push_back(attachment);
+	}
+	int depth = attachments.back();
+	if (depth >= 0) {
+		GLenum format = _textures[depth].Description.Format;
+		GLenum attachment = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		glNamedFramebufferTexture(framebuffer.Handle, attachment, _textures[depth].Handle, 0);
+	}
+	if (drawBuffers.empty()) {
+		glNamedFramebufferDrawBuffer(framebuffer.Handle, GL_NONE);
+	} else {
+		glNamedFramebufferDrawBuffers(framebuffer.Handle, (GLsizei)drawBuffers.size(), drawBuffers.data());
+	}
+
+	GLenum status = glCheckNamedFramebufferStatus(framebuffer.Handle, GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		LOG_ERROR("Render graph framebuffer is incomplete (status 0x{:x})", status);
+	}
+
+	_framebuffers.push_back(framebuffer);
+	return (int)_framebuffers.size() - 1;
+}
+
+int RenderGraph::_GetImportedFramebuffer(GLuint handle) {
+	for (size_t ix = 0; ix < _framebuffers.size(); ix++) {
+		if (_framebuffers[ix].Imported && _framebuffers[ix].Handle == handle) {
+			return (int)ix;
+		}
+	}
+
+	CompiledFramebuffer framebuffer;
+	framebuffer.Handle = handle;
+	framebuffer.Imported = true;
+	_framebuffers.push_back(framebuffer);
+	return (int)_framebuffers.size() - 1;
+}
+
+void RenderGraph::_ReleaseFramebuffers() {
+	for (const CompiledFramebuffer& framebuffer : _framebuffers) {
+		if (!framebuffer.Imported) {
+			glDeleteFramebuffers(1, &framebuffer.Handle);
+		}
+	}
+	_framebuffers.clear();
+}
+
+void RenderGraph::Execute() {
+	_BuildShape();
+	if (_shape != _compiledShape) {
+		_Compile();
+		_compiledShape = _shape;
+	}
+
+	// We don't know what was bound before the graph, so the first pass always binds
+	int boundFramebuffer = -1;
+	int framebufferBinds = 0;
+	int barriers = 0;
+	PassContext context(this);
+	for (size_t ix = 0; ix < _passes.size(); ix++) {
+		const CompiledPass& compiled = _compiledPasses[ix];
+		if (compiled.Culled) {
+			continue;
+		}
+		const Pass& pass = _passes[ix];
+
+		if (compiled.Barriers != 0) {
+			glMemoryBarrier(compiled.Barriers);
+			barriers++;
+		}
+		if (compiled.Framebuffer >= 0) {
+			if (compiled.Framebuffer != boundFramebuffer) {
+				glBindFramebuffer(GL_FRAMEBUFFER, _framebuffers[compiled.Framebuffer].Handle);
+				boundFramebuffer = compiled.Framebuffer;
+				framebufferBinds++;
+			}
+			// Passes are allowed to change the viewport, so it's always set
+			glm::ivec2 viewport = pass.HasViewport ? glm::clamp(pass.Viewport, glm::ivec2(1), compiled.AttachmentSize) : compiled.AttachmentSize;
+			glViewport(0, 0, viewport.x, viewport.y);
+		}
+
+		pass.Execute(context);
+	}
+
+	std::lock_guard<std::mutex> guard(_statsLock);
+	_stats.FramebufferBinds = framebufferBinds;
+	_stats.Barriers = barriers;
+}
+
+RenderGraph::Stats RenderGraph::GetStats() const {
+	std::lock_guard<std::mutex> guard(_statsLock);
+	return _stats;
+}
+
+void RenderGraph::RenderImGui() const {
+	std::lock_guard<std::mutex> guard(_statsLock);
+	ImGui::Text("Passes:     %d (%d culled), compiled %d times", _stats.Passes, _stats.CulledPasses, _stats.Compiles);
+	ImGui::Text("Transients: %d textures in %d (%.1f MB, %.1f MB unaliased)", _stats.TransientTextures, _stats.PhysicalTextures,
+		_stats.TransientBytes / (1024.0f * 1024.0f), _stats.UnaliasedBytes / (1024.0f * 1024.0f));
+	ImGui::Text("Per frame:  %d framebuffer binds, %d barriers", _stats.FramebufferBinds, _stats.Barriers);
+	for (const auto& [name, culled] : _passSummary) {
+		if (culled) {
+			ImGui::TextDisabled("  %s (culled)", name.c_str());
+		} else {
+			ImGui::Text("  %s", name.c_str());
+		}
+	}
+}
@@ -0,0 +1,275 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Describes a frame as a list of passes, and the textures and framebuffers that each of them
+/// reads and writes. The graph works out everything that was previously done by hand:
+///   - Passes whose results never reach an imported target (ex: the window) are culled
+///   - Transient textures are allocated from a pool, and textures whose lifetimes don't
+///     overlap share the same memory
+///   - Framebuffers are built for each set of attachments, and only re-bound when they change
+///   - glMemoryBarrier is only issued when a pass reads something written with image stores
+///
+/// The graph is declared again every frame (Reset, then Import/Create/AddPass, then Execute),
+/// which keeps the per-frame data the passes need as plain lambda captures. Compiling is only
+/// done when the shape of the graph changes, which in practice means when the resolution changes
+///
+/// Passes run in the order they were added. Must only be used from the render thread
+/// </summary>
+class RenderGraph {
+public:
+	typedef std::shared_ptr<RenderGraph> Sptr;
+
+	// Refers to a texture or framebuffer in the graph, only valid until the next Reset
+	typedef int ResourceHandle;
+	static constexpr ResourceHandle INVALID_RESOURCE = -1;
+
+	static inline Sptr Create() {
+		return std::make_shared<RenderGraph>();
+	}
+
+	/// <summary>
+	/// What a pass needs from the previous contents of an attachment that it writes to
+	/// </summary>
+	enum class LoadOp {
+		// The pass draws over what is already there
+		Load,
+		// The pass overwrites every pixel that matters (ex: by clearing), so earlier writers
+		// are not needed for this pass
+		Discard
+	};
+
+	/// <summary>
+	/// The layout of a transient texture
+	/// </summary>
+	struct TextureDescription {
+		glm::ivec2 Size;
+		// A sized internal format, ex: GL_RGBA8 or GL_DEPTH24_STENCIL8
+		GLenum     Format;
+	};
+
+	/// <summary>
+	/// Handed to each pass when it executes, for looking up the GL objects behind its resources
+	/// </summary>
+	class PassContext {
+	public:
+		/// <summary>
+		/// Gets the GL texture behind a transient texture, or 0 for an imported framebuffer
+		/// </summary>
+		GLuint GetTexture(ResourceHandle resource) const;
+		/// <summary>
+		/// Gets the size of a resource in pixels
+		/// </summary>
+		glm::ivec2 GetSize(ResourceHandle resource) const;
+
+	protected:
+		friend class RenderGraph;
+		PassContext(const RenderGraph* graph) : _graph(graph) { }
+		const RenderGraph* _graph;
+	};
+
+	typedef std::function<void(const PassContext&)> ExecuteFunc;
+
+	/// <summary>
+	/// Used to declare what a pass reads and writes, returned by AddPass
+	/// </summary>
+	class PassBuilder {
+	public:
+		/// <summary>
+		/// The pass samples from the resource
+		/// </summary>
+		PassBuilder& ReadTexture(ResourceHandle resource);
+		/// <summary>
+		/// The pass reads the resource with image loads
+		/// </summary>
+		PassBuilder& ReadImage(ResourceHandle resource);
+		/// <summary>
+		/// The pass writes the resource with image stores. Later passes reading it will get a
+		/// memory barrier first
+		/// </summary>
+		PassBuilder& WriteImage(ResourceHandle resource, LoadOp load = LoadOp::Load);
+		/// <summary>
+		/// The pass renders into the resource as a color attachment. An imported framebuffer
+		/// brings it's own depth buffer along, and can't be mixed with other attachments
+		/// </summary>
+		PassBuilder& WriteColor(ResourceHandle resource, LoadOp load = LoadOp::Load);
+		/// <summary>
+		/// The pass renders into the resource as it's depth (and stencil) attachment
+		/// </summary>
+		PassBuilder& WriteDepth(ResourceHandle resource, LoadOp load = LoadOp::Load);
+		/// <summary>
+		/// Sets the viewport for the pass, by default it covers the pass's attachments. The
+		/// viewport is not part of the graph's shape, so it can change every frame for free
+		/// </summary>
+		PassBuilder& SetViewport(const glm::ivec2& size);
+		/// <summary>
+		/// Marks the pass as doing something outside of the graph (ex: reading back pixels),
+		/// so it is never culled
+		/// </summary>
+		PassBuilder& SetSideEffects();
+
+	protected:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph* graph, size_t pass) : _graph(graph), _pass(pass) { }
+		RenderGraph* _graph;
+		size_t       _pass;
+	};
+
+	/// <summary>
+	/// Counters from the last compile and execute, for the debug UI
+	/// </summary>
+	struct Stats {
+		int    Compiles;
+		int    Passes;
+		int    CulledPasses;
+		int    TransientTextures;
+		// The textures actually allocated for them, after aliasing
+		int    PhysicalTextures;
+		size_t TransientBytes;
+		// What the transient textures would use without aliasing
+		size_t UnaliasedBytes;
+		int    FramebufferBinds;
+		int    Barriers;
+	};
+
+	RenderGraph();
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph& other) = delete;
+	RenderGraph& operator=(const RenderGraph& other) = delete;
+
+	/// <summary>
+	/// Removes all passes and resources, ready to declare the next frame. The compiled graph and
+	/// our textures are kept around, so that a frame with the same shape can re-use them
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Adds an existing framebuffer to the graph. Imported framebuffers are the graph's outputs,
+	/// so any pass that writes to one is kept
+	/// </summary>
+	/// <param name="name">A name to show in the debug UI</param>
+	/// <param name="framebuffer">The framebuffer's handle, 0 for the window</param>
+	/// <param name="size">The size of the framebuffer in pixels</param>
+	ResourceHandle ImportFramebuffer(const std::string& name, GLuint framebuffer, const glm::ivec2& size);
+	/// <summary>
+	/// Declares a texture that only lives for part of the frame. The graph owns it, and may
+	/// share it's memory with other transient textures that are not in use at the same time
+	/// </summary>
+	/// <param name="name">A name to show in the debug UI</param>
+	/// <param name="description">The size and format of the texture</param>
+	ResourceHandle CreateTexture(const std::string& name, const TextureDescription& description);
+
+	/// <summary>
+	/// Adds a pass to the end of the frame
+	/// </summary>
+	/// <param name="name">A name to show in the debug UI</param>
+	/// <param name="execute">Does the pass's rendering, the graph has already bound it's framebuffer and viewport</param>
+	/// <returns>A builder to declare the pass's resources with</returns>
+	PassBuilder AddPass(const std::string& name, const ExecuteFunc& execute);
+
+	/// <summary>
+	/// Compiles the graph if it's shape has changed since the last frame, and runs all of the
+	/// passes that were not culled
+	/// </summary>
+	void Execute();
+
+	/// <summary>
+	/// Gets the counters from the last frame, may be called from any thread
+	/// </summary>
+	Stats GetStats() const;
+	/// <summary>
+	/// Draws the graph's counters and passes with ImGui, may be called from any thread
+	/// </summary>
+	void RenderImGui() const;
+
+protected:
+	enum class AccessType {
+		Texture,
+		ImageRead,
+		ImageWrite,
+		Color,
+		Depth
+	};
+
+	struct Access {
+		ResourceHandle Resource;
+		AccessType     Type;
+		LoadOp         Load;
+	};
+
+	struct Resource {
+		std::string        Name;
+		bool               Imported;
+		GLuint             ImportedFramebuffer;
+		TextureDescription Description;
+	};
+
+	struct Pass {
+		std::string         Name;
+		ExecuteFunc         Execute;
+		std::vector<Access> Accesses;
+		glm::ivec2          Viewport;
+		bool                HasViewport;
+		bool                HasSideEffects;
+	};
+
+	// The result of compiling a pass
+	struct CompiledPass {
+		bool       Culled;
+		// The framebuffer to bind, or -1 if the pass has no attachments
+		int        Framebuffer;
+		glm::ivec2 AttachmentSize;
+		GLbitfield Barriers;
+	};
+
+	// A texture in our pool, which one or more transient textures are placed in
+	struct PhysicalTexture {
+		GLuint             Handle;
+		TextureDescription Description;
+		// The last pass using the texture in the current compile, for aliasing
+		int                LastUse;
+	};
+
+	// A framebuffer built for one set of attachments
+	struct CompiledFramebuffer {
+		GLuint           Handle;
+		// Imported framebuffers belong to someone else, so we don't delete them
+		bool             Imported;
+		// Physical texture indices, with the depth attachment (or -1) last
+		std::vector<int> Attachments;
+	};
+
+	std::vector<Resource>     _resources;
+	std::vector<Pass>         _passes;
+
+	// Everything that affects compiling, flattened into numbers so it can be compared cheaply
+	std::vector<uint64_t>     _shape;
+	std::vector<uint64_t>     _compiledShape;
+	std::vector<CompiledPass> _compiledPasses;
+	// The physical texture for each resource, or -1 for imported and unused ones
+	std::vector<int>          _compiledPhysical;
+
+	std::vector<PhysicalTexture>     _textures;
+	std::vector<CompiledFramebuffer> _framebuffers;
+
+	mutable std::mutex _statsLock;
+	Stats              _stats;
+	// The names of the passes and whether they were culled, for the debug UI
+	std::vector<std::pair<std::string, bool>> _passSummary;
+
+	void _BuildShape();
+	void _Compile();
+	// Finds or creates a framebuffer for the given physical textures, with the depth texture (or -1) last
+	int _GetTextureFramebuffer(const std::vector<int>& attachments);
+	// Finds or adds the entry for an imported framebuffer
+	int _GetImportedFramebuffer(GLuint handle);
+	void _ReleaseFramebuffers();
+};
@@ -0,0 +1,139 @@
+#include "RenderThread.h"
+
+#include <GLFW/glfw3.h>
+#include "Logging.h"
+
+std::thread RenderThread::_thread;
+std::thread::id RenderThread::_threadId;
+std::atomic<bool> RenderThread::_isRunning(false);
+GLFWwindow* RenderThread::_window = nullptr;
+
+std::mutex RenderThread::_lock;
+std::condition_variable RenderThread::_workQueued;
+std::condition_variable RenderThread::_workDone;
+std::vector<RenderThread::Command> RenderThread::_queue;
+int RenderThread::_framesInFlight = 0;
+bool RenderThread::_isReady = false;
+bool RenderThread::_stopRequested = false;
+
+void RenderThread::Start(GLFWwindow* window) {
+	LOG_ASSERT(!_isRunning, "The render thread has already been started!");
+	_window = window;
+	_isReady = false;
+	_stopRequested = false;
+	_framesInFlight = 0;
+
+	// A context can only be current on one thread at a time, so we have to let go of it first
+	glfwMakeContextCurrent(nullptr);
+	_thread = std::thread(_ThreadMain);
+
+	// Wait until the thread owns the context, so nothing can be queued before IsRenderThread works
+	std::unique_lock<std::mutex> guard(_lock);
+	_workDone.wait(guard, [] { return _isReady; });
+	_isRunning = true;
+	LOG_INFO("Started render thread");
+}
+
+void RenderThread::Stop() {
+	if (!_isRunning) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stopRequested = true;
+		_workQueued.notify_one();
+	}
+	_thread.join();
+	_isRunning = false;
+
+	// Hand the context back so that cleanup can happen on this thread
+	glfwMakeContextCurrent(_window);
+	LOG_INFO("Stopped render thread");
+}
+
+bool RenderThread::IsRenderThread() {
+	return !_isRunning || std::this_thread::get_id() == _threadId;
+}
+
+void RenderThread::Enqueue(Command command) {
+	if (IsRenderThread()) {
+		command();
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(_lock);
+	_queue.push_back(std::move(command));
+	_workQueued.notify_one();
+}
+
+void RenderThread::Invoke(const Command& command) {
+	if (IsRenderThread()) {
+		command();
+		return;
+	}
+
+	// The command is only ever run while we are waiting here, so it's safe to capture by reference
+	bool isDone = false;
+	std::unique_lock<std::mutex> guard(_lock);
+	_queue.push_back([&]() {
+		command();
+		std::lock_guard<std::mutex> innerGuard(_lock);
+		isDone = true;
+		_workDone.notify_all();
+	});
+	_workQueued.notify_one();
+	_workDone.wait(guard, [&] { return isDone; });
+}
+
+void RenderThread::SubmitFrame(Command frame) {
+	if (IsRenderThread()) {
+		frame();
+		return;
+	}
+
+	std::unique_lock<std::mutex> guard(_lock);
+	// This is where the main thread waits if the GPU side is the bottleneck
+	_workDone.wait(guard, [] { return _framesInFlight < MAX_FRAMES_IN_FLIGHT; });
+	_framesInFlight++;
+	_queue.push_back([frame = std::move(frame)]() {
+		frame();
+		std::lock_guard<std::mutex> innerGuard(_lock);
+		_framesInFlight--;
+		_workDone.notify_all();
+	});
+	_workQueued.notify_one();
+}
+
+void RenderThread::_ThreadMain() {
+	glfwMakeContextCurrent(_window);
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_threadId = std::this_thread::get_id();
+		_isReady = true;
+		_workDone.notify_all();
+	}
+
+	// We swap the whole queue out, so commands can be queued while we are running the last batch
+	std::vector<Command> commands;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(_lock);
+			_workQueued.wait(guard, [] { return !_queue.empty() || _stopRequested; });
+			if (_queue.empty()) {
+				break;
+			}
+			commands.swap(_queue);
+		}
+
+		for (Command& command : commands) {
+			command();
+			// Commands may hold the last reference to GL objects (or a whole scene), so release
+			// them right away, before any later command (like an Invoke) lets the main thread go
+			command = nullptr;
+		}
+		commands.clear();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+
+/// <summary>
+/// Owns the OpenGL context on a dedicated thread, so that the main thread can simulate the
+/// next frame while the current one is being submitted to the GPU
+///
+/// All GL work is sent to the render thread as commands, which run in the order they were
+/// queued. Frames are submitted the same way, and at most MAX_FRAMES_IN_FLIGHT frames can be
+/// waiting on the render thread before SubmitFrame blocks, so the main thread never gets
+/// more than a frame ahead.
+///
+/// When the render thread is not running, commands run immediately on the calling thread, so
+/// code using this class works the same in single threaded mode
+/// </summary>
+class RenderThread {
+public:
+	typedef std::function<void()> Command;
+
+	// How many frames the main thread can queue before it has to wait for the render thread,
+	// with 1 frame N renders while frame N+1 is being simulated
+	static constexpr int MAX_FRAMES_IN_FLIGHT = 1;
+
+	/// <summary>
+	/// Moves the window's GL context from the calling thread onto a new render thread
+	/// </summary>
+	/// <param name="window">The window whose context we will render with</param>
+	static void Start(GLFWwindow* window);
+	/// <summary>
+	/// Finishes all queued work, stops the render thread, and makes the context current on
+	/// the calling thread again
+	/// </summary>
+	static void Stop();
+
+	/// <summary>
+	/// Returns true if a render thread has been started
+	/// </summary>
+	static bool IsRunning() { return _isRunning; }
+	/// <summary>
+	/// Returns true if the calling thread is allowed to make GL calls, meaning it's either the
+	/// render thread, or there is no render thread running
+	/// </summary>
+	static bool IsRenderThread();
+
+	/// <summary>
+	/// Queues a command to run on the render thread. If called from the render thread (or when
+	/// there isn't one), the command runs right away instead
+	/// </summary>
+	/// <param name="command">The command to run, anything it captures must be safe to use from the render thread</param>
+	static void Enqueue(Command command);
+	/// <summary>
+	/// Runs a command on the render thread, and waits for it to finish. Use this for work that
+	/// needs the GL context and whose results are needed immediately, such as loading resources
+	/// </summary>
+	/// <param name="command">The command to run</param>
+	static void Invoke(const Command& command);
+	/// <summary>
+	/// Queues the rendering for a whole frame, waiting first if the render thread is too far behind
+	/// </summary>
+	/// <param name="frame">The command that renders and presents the frame</param>
+	static void SubmitFrame(Command frame);
+
+protected:
+	RenderThread() = default;
+	~RenderThread() = default;
+
+	static std::thread             _thread;
+	static std::thread::id         _threadId;
+	static std::atomic<bool>       _isRunning;
+	static GLFWwindow*             _window;
+
+	// Everything below is guarded by _lock
+	static std::mutex              _lock;
+	// Signalled when commands are queued, or when we want the thread to stop
+	static std::condition_variable _workQueued;
+	// Signalled when the render thread finishes a frame or an invoked command
+	static std::condition_variable _workDone;
+	static std::vector<Command>    _queue;
+	static int                     _framesInFlight;
+	static bool                    _isReady;
+	static bool                    _stopRequested;
+
+	static void _ThreadMain();
+};
@@ -1,22 +1,59 @@
 #include "Shader.h"
 #include "Logging.h"
+#include "Graphics/GlDeleteList.h"
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <cstdio>
 
 #include "Utils/FileHelpers.h"
+#include "Graphics/GlStateCache.h"
+
+std::string Shader::BinaryCacheFolder = "shader_cache";
+
+// Written at the start of every file in the binary cache
+struct ProgramBinaryHeader {
+	uint32_t Magic;
+	// The hash and length of the sources the binary was built from, to catch edited shaders
+	uint32_t SourceHash;
+	uint32_t SourceLength;
+	GLenum   Format;
+	uint32_t BinaryLength;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42534657; // "WFSB"
+
+// The order that stages are added to the cache key in, so that the key doesn't depend on map ordering
+static const ShaderPartType VARIANT_STAGE_ORDER[] = {
+	ShaderPartType::Vertex,
+	ShaderPartType::TessControl,
+	ShaderPartType::TessEval,
+	ShaderPartType::Geometry,
+	ShaderPartType::Fragment
+};
+
+// Some drivers don't support any binary formats, in which case we always compile
+static bool SupportsProgramBinaries() {
+	static int formatCount = -1;
+	if (formatCount == -1) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	}
+	return formatCount > 0;
+}
 
 Shader::Shader() : 
 	IResource(),
 	// We zero out all of our members so we don't have garbage data in our class
-	_handle(0)
+	_handle(0),
+	_engineKeywordMask(0)
 {
 	_handle = glCreateProgram();
 }
 
 Shader::Shader(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IResource(),
-	_handle(0)
+	_handle(0),
+	_engineKeywordMask(0)
 {
 	_handle = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
@@ -27,12 +64,27 @@ Shader::Shader(const std::unordered_map<ShaderPartType, std::string>& filePaths)
 
 Shader::~Shader() {
 	if (_handle != 0) {
-		glDeleteProgram(_handle);
+		GlDeleteList().Program(_handle).DeleteLater();
 		_handle = 0;
 	}
 }
 
 bool Shader::LoadShaderPart(const char* source, ShaderPartType type) {
+	// The part we compile now is the variant with all of it's keywords disabled
+	std::string stripped = _ParseKeywords(source);
+	if (!_CompilePart(stripped.c_str(), type)) {
+		return false;
+	}
+	_variantSources[type] = stripped;
+
+	// Store info about where we got this data from
+	_fileSourceMap[type].IsFilePath = false;
+	_fileSourceMap[type].Source = source;
+
+	return true;
+}
+
+bool Shader::_CompilePart(const char* source, ShaderPartType type) {
 	// Creates a new shader part (VS, FS, GS, etc...)
 	GLuint handle = glCreateShader((GLenum)type);
 
@@ -75,13 +127,65 @@ bool Shader::LoadShaderPart(const char* source, ShaderPartType type) {
 	}
 	_handles[type] = handle;
 
-	// Store info about where we got this data from
-	_fileSourceMap[type].IsFilePath = false;
-	_fileSourceMap[type].Source = source;
-
 	return status != GL_FALSE;
 }
 
+std::string Shader::_ParseKeywords(const std::string& source) {
+	std::string result = source;
+
+	// The token we're looking for, and it's length. The engine pragma starts with the same token
+	const char* pragmaToken = "#pragma multi_compile";
+	const size_t pragmaTokenLen = const_strlen(pragmaToken);
+	const char* engineSuffix = "_engine";
+	const size_t engineSuffixLen = const_strlen(engineSuffix);
+
+	size_t seek = result.find(pragmaToken, 0);
+	while (seek != std::string::npos) {
+		size_t eol = result.find_first_of("\r\n", seek);
+		if (eol == std::string::npos) {
+			eol = result.length();
+		}
+
+		size_t start = seek + pragmaTokenLen;
+		bool isEngine = result.compare(start, engineSuffixLen, engineSuffix) == 0;
+		if (isEngine) {
+			start += engineSuffixLen;
+		}
+
+		// Every word after the token is a keyword
+		std::stringstream keywords(result.substr(start, eol - start));
+		std::string keyword;
+		while (keywords >> keyword) {
+			// Unity uses _ for "no keyword", we allow it so sources can be shared
+			if (keyword == "_") {
+				continue;
+			}
+			auto it = std::find(_keywords.begin(), _keywords.end(), keyword);
+			if (it != _keywords.end()) {
+				// Once any stage says the renderer owns a keyword, materials can't set it
+				if (isEngine) {
+					_engineKeywordMask |= 1u << (uint32_t)(it - _keywords.begin());
+				}
+				continue;
+			}
+			if (_keywords.size() >= MAX_KEYWORDS) {
+				LOG_WARN("Shader declares more than {} keywords, ignoring \"{}\"", MAX_KEYWORDS, keyword);
+				continue;
+			}
+			if (isEngine) {
+				_engineKeywordMask |= 1u << (uint32_t)_keywords.size();
+			}
+			_keywords.push_back(keyword);
+		}
+
+		// Comment the pragma out instead of removing it, so compile errors still point at the right line
+		result.insert(seek, "//");
+		seek = result.find(pragmaToken, eol + 2);
+	}
+
+	return result;
+}
+
 bool Shader::LoadShaderPartFromFile(const char* path, ShaderPartType type) {
 	// Make sure that the file exists before we try reading
 	if (std::filesystem::exists(path)) {
@@ -154,13 +258,13 @@ bool Shader::Link() {
 }
 
 void Shader::Bind() {
-	// Simply calls glUseProgram with our shader handle
-	glUseProgram(_handle);
+	// Goes through the state cache, so binding an already active shader is free
+	GlStateCache::UseProgram(_handle);
 }
 
 void Shader::Unbind() {
 	// We unbind a shader program by using the default program (0)
-	glUseProgram(0);
+	GlStateCache::UseProgram(0);
 }
 
 void Shader::SetUniformMatrix(int location, const glm::mat3* value, int count, bool transposed) {
@@ -213,11 +317,176 @@ void Shader::SetUniform(int location, const glm::bvec4* value, int count) {
 	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
 }
 
-int Shader::__GetUniformLocation(const std::string& name) {
-	// Since the default constructor for UniformInfo sets location to -1,
-	// we can simply index the map and if it doesn't exist, the default
-	// will be used
-	return _uniforms[name].Location;
+int Shader::GetUniformLocation(const UniformHandle& handle) {
+	// Lookups only hash integers, and never insert new entries for unknown names
+	auto it = _uniformLocations.find(handle.Hash);
+	if (it != _uniformLocations.end()) {
+		return it->second;
+	}
+	// Only warn the first time we see a missing uniform, otherwise we'd spam the log every frame
+	if (_warnedUniforms.insert(handle.Hash).second) {
+		LOG_WARN("Ignoring uniform \"{}\"", handle.Name);
+	}
+	return -1;
+}
+
+uint32_t Shader::GetKeywordMask(const std::vector<std::string>& keywords) const {
+	uint32_t result = 0;
+	for (const std::string& keyword : keywords) {
+		auto it = std::find(_keywords.begin(), _keywords.end(), keyword);
+		if (it != _keywords.end()) {
+			result |= 1u << (uint32_t)(it - _keywords.begin());
+		}
+	}
+	return result;
+}
+
+Shader* Shader::GetVariant(uint32_t keywordMask) {
+	// Bits for keywords we don't declare would only give us duplicates of other variants
+	if (_keywords.size() < MAX_KEYWORDS) {
+		keywordMask &= (1u << (uint32_t)_keywords.size()) - 1;
+	}
+	if (keywordMask == 0) {
+		return this;
+	}
+
+	auto it = _variants.find(keywordMask);
+	if (it != _variants.end()) {
+		return it->second.get();
+	}
+
+	// Variants that fail to build are still stored, so we only log their errors once
+	Shader::Sptr variant = _CompileVariant(keywordMask);
+	_variants[keywordMask] = variant;
+	return variant.get();
+}
+
+Shader::VariantStats Shader::GetVariantStats() {
+	VariantStats result;
+	result.Compiled = __VariantsCompiled;
+	result.LoadedFromCache = __VariantsLoaded;
+	return result;
+}
+
+Shader::Sptr Shader::_CompileVariant(uint32_t keywordMask) {
+	std::string defines;
+	std::string names;
+	for (size_t ix = 0; ix < _keywords.size(); ix++) {
+		if (keywordMask & (1u << (uint32_t)ix)) {
+			defines += "#define " + _keywords[ix] + "\n";
+			names += (names.empty() ? "" : " ") + _keywords[ix];
+		}
+	}
+
+	// The defines have to go after the #version line, since it must come before anything else. The
+	// cache key starts with the driver, since binaries can't be shared between drivers
+	std::unordered_map<ShaderPartType, std::string> sources;
+	std::string cacheKey = std::string((const char*)glGetString(GL_VENDOR)) + (const char*)glGetString(GL_RENDERER) + (const char*)glGetString(GL_VERSION);
+	for (ShaderPartType type : VARIANT_STAGE_ORDER) {
+		auto it = _variantSources.find(type);
+		if (it == _variantSources.end()) {
+			continue;
+		}
+		std::string source = it->second;
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos) {
+			size_t eol = source.find('\n', version);
+			insertAt = eol == std::string::npos ? source.length() : eol + 1;
+		}
+		source.insert(insertAt, defines);
+
+		cacheKey += std::to_string((GLint)type) + source;
+		sources[type] = source;
+	}
+
+	uint32_t sourceHash = const_hash_fnv1a(cacheKey.c_str());
+	uint32_t sourceLength = (uint32_t)cacheKey.length();
+	std::string cachePath;
+	if (!BinaryCacheFolder.empty() && SupportsProgramBinaries()) {
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "%08x.bin", sourceHash);
+		cachePath = (std::filesystem::path(BinaryCacheFolder) / fileName).string();
+
+		Shader::Sptr cached = Shader::Create();
+		if (cached->_LoadBinary(cachePath, sourceHash, sourceLength)) {
+			__VariantsLoaded++;
+			LOG_TRACE("Loaded shader variant [{}] from \"{}\"", names, cachePath);
+			return cached;
+		}
+	}
+
+	Shader::Sptr result = Shader::Create();
+	for (auto& [type, source] : sources) {
+		result->LoadShaderPart(source.c_str(), type);
+	}
+	if (!cachePath.empty()) {
+		glProgramParameteri(result->_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	bool linked = result->Link();
+	__VariantsCompiled++;
+	LOG_INFO("Compiled shader variant [{}]", names);
+
+	if (linked && !cachePath.empty()) {
+		result->_SaveBinary(cachePath, sourceHash, sourceLength);
+	}
+	return result;
+}
+
+bool Shader::_LoadBinary(const std::string& path, uint32_t sourceHash, uint32_t sourceLength) {
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	// Make sure the binary is for the sources we have now, in case the shader has been edited
+	ProgramBinaryHeader header;
+	in.read((char*)&header, sizeof(ProgramBinaryHeader));
+	if (!in || header.Magic != PROGRAM_BINARY_MAGIC || header.SourceHash != sourceHash || header.SourceLength != sourceLength) {
+		return false;
+	}
+	std::vector<char> binary(header.BinaryLength);
+	in.read(binary.data(), header.BinaryLength);
+	if (!in) {
+		return false;
+	}
+
+	// The driver can reject binaries that it made itself (ex: after an update), so this may fail
+	glProgramBinary(_handle, header.Format, binary.data(), (GLsizei)header.BinaryLength);
+	GLint status = 0;
+	glGetProgramiv(_handle, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		return false;
+	}
+
+	_Introspect();
+	return true;
+}
+
+void Shader::_SaveBinary(const std::string& path, uint32_t sourceHash, uint32_t sourceLength) {
+	GLint length = 0;
+	glGetProgramiv(_handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	header.Magic = PROGRAM_BINARY_MAGIC;
+	header.SourceHash = sourceHash;
+	header.SourceLength = sourceLength;
+	header.BinaryLength = (uint32_t)length;
+	std::vector<char> binary(length);
+	glGetProgramBinary(_handle, length, nullptr, &header.Format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(BinaryCacheFolder, error);
+	std::ofstream out(path, std::ios::out | std::ios::binary);
+	if (!out) {
+		LOG_WARN("Could not write shader binary to \"{}\"", path);
+		return;
+	}
+	out.write((const char*)&header, sizeof(ProgramBinaryHeader));
+	out.write(binary.data(), length);
 }
 
 nlohmann::json Shader::ToJson() const {
@@ -257,6 +526,10 @@ void Shader::_Introspect() {
 }
 
 void Shader::_IntrospectUniforms() {
+	// Clear any locations from a previous link
+	_uniformLocations.clear();
+	_warnedUniforms.clear();
+
 	// Query the program for how many active uniforms we have
 	int numInputs = 0;
 	glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numInputs);
@@ -302,6 +575,13 @@ void Shader::_IntrospectUniforms() {
 
 		// Store the uniform info
 		_uniforms[e.Name] = e;
+
+		// Resolve the hashed name to the location, so handles can skip the string lookup
+		uint32_t hash = const_hash_fnv1a(e.Name.c_str());
+		if (_uniformLocations.count(hash) != 0) {
+			LOG_WARN("Uniform \"{}\" has a hash collision with another uniform!", e.Name);
+		}
+		_uniformLocations[hash] = e.Location;
 	}
 }
 
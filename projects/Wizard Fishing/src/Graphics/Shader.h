@@ -3,11 +3,15 @@
 #include <memory>
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <unordered_set>        // for std::unordered_set
+#include <vector>               // for std::vector
+#include <atomic>               // for std::atomic
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include <Logging.h>            // for the logging functions
 #include <EnumToString.h>
 #include "Utils/ResourceManager/IResource.h"
+#include "Utils/StringUtils.h"
 #include "Graphics/GlEnums.h"
 
 // We can use an enum to make our code more readable and restrict
@@ -18,11 +22,40 @@ ENUM(ShaderPartType, GLint,
 	 TessControl  = GL_TESS_CONTROL_SHADER,
 	 TessEval     = GL_TESS_EVALUATION_SHADER,
 	 Geometry     = GL_GEOMETRY_SHADER,
+	 Compute      = GL_COMPUTE_SHADER,
 	 Unknown      = GL_NONE // Usually good practice to have an "unknown" or "none" state for enums
 );
 
+/// <summary>
+/// A pre-hashed uniform name, lets us look up uniform locations without
+/// creating or hashing an std::string every time we set a uniform
+/// 
+/// Declare handles as static constexpr to have the hash calculated at compile time:
+/// static constexpr UniformHandle U_MODEL("u_Model");
+/// </summary>
+struct UniformHandle {
+	// The FNV-1a hash of the uniform's name
+	uint32_t    Hash;
+	// The name of the uniform, only used for logging, not owned by the handle
+	const char* Name;
+
+	constexpr UniformHandle(const char* name) : Hash(const_hash_fnv1a(name)), Name(name) {}
+	UniformHandle(const std::string& name) : Hash(const_hash_fnv1a(name.c_str())), Name(name.c_str()) {}
+};
+
 /// <summary>
 /// This class will wrap around an OpenGL shader program
+///
+/// Shader sources may declare keywords with a line like:
+/// #pragma multi_compile MORPH REFLECTIVE
+/// Each keyword is an independent toggle, that the source can test with #ifdef. The shader
+/// itself is the variant with no keywords enabled, every other combination is compiled the first
+/// time it is asked for with GetVariant, and kept for the lifetime of the shader. Compiled
+/// variants are also saved to BinaryCacheFolder, so that later runs can skip compiling them
+///
+/// Keywords that the renderer turns on itself, rather than materials, are declared with
+/// #pragma multi_compile_engine VERTEX_PULLING
+/// They work the same way, but materials can't enable them (see GetEngineKeywordMask)
 /// </summary>
 class Shader final : public IResource
 {
@@ -118,6 +151,53 @@ public:
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
 
+	// The most keywords a shader can declare, since variants are looked up with a 32 bit mask
+	static const int MAX_KEYWORDS = 32;
+
+	/// <summary>
+	/// Counters for the variants compiled so far, for the stats display
+	/// </summary>
+	struct VariantStats {
+		int Compiled;
+		// Variants that were loaded from the binary cache instead of being compiled
+		int LoadedFromCache;
+	};
+
+	/// <summary>
+	/// The folder that compiled variants are saved to and loaded from, relative to the working
+	/// directory. Set to an empty string to disable the binary cache
+	/// </summary>
+	static std::string BinaryCacheFolder;
+
+	/// <summary>
+	/// Gets the keywords declared by this shader's sources, in the order of their bits
+	/// </summary>
+	const std::vector<std::string>& GetKeywords() const { return _keywords; }
+	/// <summary>
+	/// Gets the mask of the keywords from multi_compile_engine pragmas, which only the renderer
+	/// may enable. Enabling them from a material would read buffers that aren't bound
+	/// </summary>
+	uint32_t GetEngineKeywordMask() const { return _engineKeywordMask; }
+	/// <summary>
+	/// Gets the keyword mask for a set of keywords. Keywords that this shader does not declare
+	/// are ignored, so materials can be shared with shaders that don't support all of them
+	/// </summary>
+	/// <param name="keywords">The names of the keywords to enable</param>
+	uint32_t GetKeywordMask(const std::vector<std::string>& keywords) const;
+
+	/// <summary>
+	/// Gets the program with the given keywords enabled, compiling it if this is the first time
+	/// it has been used. Must be called from the render thread
+	/// </summary>
+	/// <param name="keywordMask">The keywords to enable, from GetKeywordMask</param>
+	/// <returns>The variant, which is owned by this shader. A mask of 0 returns this shader</returns>
+	Shader* GetVariant(uint32_t keywordMask);
+
+	/// <summary>
+	/// Gets the number of variants compiled so far, across all shaders. May be called from any thread
+	/// </summary>
+	static VariantStats GetVariantStats();
+
 	virtual nlohmann::json ToJson() const override;
 	static Shader::Sptr FromJson(const nlohmann::json& data);
 
@@ -137,33 +217,62 @@ public:
 	void SetUniform(int location, const glm::bvec3* value, int count = 1);
 	void SetUniform(int location, const glm::bvec4* value, int count = 1);
 
+	/// <summary>
+	/// Gets the location of the uniform with the given handle, or -1 if the uniform
+	/// does not exist in this shader. Missing uniforms will only be logged once
+	/// </summary>
+	/// <param name="handle">The handle of the uniform to look up</param>
+	int GetUniformLocation(const UniformHandle& handle);
+
 	template <typename T>
-	void SetUniform(const std::string& name, const T& value) {
-		int location = __GetUniformLocation(name);
+	void SetUniform(const UniformHandle& handle, const T& value) {
+		int location = GetUniformLocation(handle);
 		if (location != -1) {
 			SetUniform(location, &value, 1);
-		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
 		}
 	}
 	template <typename T>
-	void SetUniform(const std::string& name, const T* values, int count = 1) {
-		int location = __GetUniformLocation(name);
+	void SetUniform(const UniformHandle& handle, const T* values, int count = 1) {
+		int location = GetUniformLocation(handle);
 		if (location != -1) {
-			SetUniform(location, &values, count);
-		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
+			SetUniform(location, values, count);
 		}
 	}
 	template <typename T>
-	void SetUniformMatrix(const std::string& name, const T& value, bool transposed = false) {
-		int location = __GetUniformLocation(name);
+	void SetUniformMatrix(const UniformHandle& handle, const T& value, bool transposed = false) {
+		int location = GetUniformLocation(handle);
 		if (location != -1) {
 			SetUniformMatrix(location, &value, 1, transposed);
-		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
 		}
 	}
+
+	// String overloads, these forward to the handle versions above. The const char* versions
+	// let string literals skip creating a temporary std::string
+
+	template <typename T>
+	void SetUniform(const char* name, const T& value) {
+		SetUniform(UniformHandle(name), value);
+	}
+	template <typename T>
+	void SetUniform(const char* name, const T* values, int count = 1) {
+		SetUniform(UniformHandle(name), values, count);
+	}
+	template <typename T>
+	void SetUniformMatrix(const char* name, const T& value, bool transposed = false) {
+		SetUniformMatrix(UniformHandle(name), value, transposed);
+	}
+	template <typename T>
+	void SetUniform(const std::string& name, const T& value) {
+		SetUniform(UniformHandle(name), value);
+	}
+	template <typename T>
+	void SetUniform(const std::string& name, const T* values, int count = 1) {
+		SetUniform(UniformHandle(name), values, count);
+	}
+	template <typename T>
+	void SetUniformMatrix(const std::string& name, const T& value, bool transposed = false) {
+		SetUniformMatrix(UniformHandle(name), value, transposed);
+	}
 	
 	void BindUniformBlockToSlot(const std::string& name, int uboSlot);
 
@@ -178,6 +287,10 @@ protected:
 	// Map access to look up uniform locations and blocks
 	std::unordered_map<std::string, UniformInfo> _uniforms;
 	std::unordered_map<std::string, UniformBlockInfo> _uniformBlocks;
+	// Maps the hashed uniform names to their locations, filled during introspection
+	std::unordered_map<uint32_t, int> _uniformLocations;
+	// Stores the hashes of uniforms we've already warned about, so that we only log misses once
+	std::unordered_set<uint32_t> _warnedUniforms;
 
 	// Stores information about the source of our shader parts
 	// EX: if a VS shader is loaded from a file, will contain
@@ -188,6 +301,42 @@ protected:
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
 
+	// The keywords from our multi_compile pragmas, a keyword's bit in a mask is 1 << it's index
+	std::vector<std::string> _keywords;
+	// The bits of the keywords that came from multi_compile_engine pragmas
+	uint32_t                 _engineKeywordMask;
+	// The source of each stage with includes resolved and the pragmas removed, kept so that
+	// variants can be compiled later on
+	std::unordered_map<ShaderPartType, std::string> _variantSources;
+	// The variants compiled so far, by keyword mask. Mask 0 is this shader, so it's never stored
+	std::unordered_map<uint32_t, Shader::Sptr> _variants;
+
+	inline static std::atomic<int> __VariantsCompiled = 0;
+	inline static std::atomic<int> __VariantsLoaded = 0;
+
+	/// <summary>
+	/// Compiles a single stage from source, and stores it for the next Link
+	/// </summary>
+	bool _CompilePart(const char* source, ShaderPartType type);
+	/// <summary>
+	/// Finds the multi_compile(_engine) pragmas in a stage's source, adding their keywords to our list.
+	/// Returns the source with the pragmas commented out, so the line numbers stay the same
+	/// </summary>
+	std::string _ParseKeywords(const std::string& source);
+	/// <summary>
+	/// Builds a new program from our stage sources, with the given keywords defined
+	/// </summary>
+	Shader::Sptr _CompileVariant(uint32_t keywordMask);
+	/// <summary>
+	/// Tries to load a program binary that was saved for the given sources, returns false if
+	/// there isn't one or the driver no longer accepts it
+	/// </summary>
+	bool _LoadBinary(const std::string& path, uint32_t sourceHash, uint32_t sourceLength);
+	/// <summary>
+	/// Saves our linked program to the binary cache
+	/// </summary>
+	void _SaveBinary(const std::string& path, uint32_t sourceHash, uint32_t sourceLength);
+
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
 	/// the program contains
@@ -202,6 +351,4 @@ protected:
 	/// fed data from a uniform buffer
 	/// </summary>
 	void _IntrospectUnifromBlocks();
-
-	int __GetUniformLocation(const std::string& name);
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "ShaderStorageBuffer.h"
+#include "GlStateCache.h"
+
+ShaderStorageBuffer::ShaderStorageBuffer(BufferUsage usage) :
+	IBuffer(BufferType::ShaderStorage, usage),
+	_capacity(0)
+{ }
+
+void ShaderStorageBuffer::LoadData(const void* data, size_t elementSize, size_t elementCount) {
+	size_t size = elementSize * elementCount;
+	if (size > _capacity) {
+		// Grow by at least half again so that slowly growing data doesn't re-allocate every time
+		_capacity = size > _capacity + _capacity / 2 ? size : _capacity + _capacity / 2;
+		glNamedBufferData(_handle, _capacity, nullptr, (GLenum)_usage);
+	}
+	if (size > 0) {
+		glNamedBufferSubData(_handle, 0, size, data);
+	}
+
+	_elementCount = elementCount;
+	_elementSize = elementSize;
+}
+
+void ShaderStorageBuffer::Bind(int slot) const {
+	GlStateCache::BindStorageBuffer(slot, _handle);
+}
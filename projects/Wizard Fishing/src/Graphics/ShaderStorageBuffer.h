@@ -0,0 +1,57 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A shader storage buffer (SSBO), used for feeding large or variable length
+/// arrays of data to shaders. Unlike the other buffers, the storage is only
+/// re-allocated when it needs to grow, so it can be refilled every frame cheaply
+/// </summary>
+class ShaderStorageBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<ShaderStorageBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::DynamicDraw) {
+		return std::make_shared<ShaderStorageBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new shader storage buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	ShaderStorageBuffer(BufferUsage usage = BufferUsage::DynamicDraw);
+
+	/// <summary>
+	/// Loads data into this buffer, only re-allocating the GPU storage if the data will not fit
+	/// </summary>
+	/// <param name="data">The data that you want to load into the buffer</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to upload</param>
+	virtual void LoadData(const void* data, size_t elementSize, size_t elementCount) override;
+
+	/// <summary>
+	/// Loads an array of data into this buffer
+	/// </summary>
+	/// <typeparam name="T">The type of data you are uploading</typeparam>
+	/// <param name="data">A pointer to the first element in the array</param>
+	/// <param name="count">The number of elements in the array to upload</param>
+	template <typename T>
+	void LoadData(const T* data, size_t count) {
+		LoadData((const void*)(data), sizeof(T), count);
+	}
+
+	/// <summary>
+	/// Binds this SSBO to the specified binding slot
+	/// </summary>
+	/// <param name="slot">The buffer binding slot to bind to</param>
+	void Bind(int slot) const;
+
+	/// <summary>
+	/// Returns the number of bytes currently allocated on the GPU for this buffer
+	/// </summary>
+	size_t GetCapacity() const { return _capacity; }
+
+protected:
+	size_t _capacity;
+};
@@ -0,0 +1,207 @@
+#include "Graphics/TextRenderer.h"
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Graphics/GlStateCache.h"
+#include "Graphics/RenderThread.h"
+
+static constexpr UniformHandle U_PROJECTION("u_Projection");
+static constexpr UniformHandle U_SCREEN_SIZE("u_ScreenSize");
+static constexpr UniformHandle U_SCALE("u_Scale");
+
+TextRenderer::Run::Run() :
+	_font(nullptr),
+	_text(""),
+	_anchor(glm::vec2(0.0f)),
+	_offset(glm::vec2(0.0f)),
+	_pivot(glm::vec2(0.0f)),
+	_scale(1.0f),
+	_color(glm::vec4(1.0f)),
+	_size(glm::vec2(0.0f)),
+	_vertices(std::vector<HudBatcher::Vertex>())
+{ }
+
+bool TextRenderer::Run::Update(const Font::Sptr& font, const std::string& text, const glm::vec2& anchor, const glm::vec2& offset,
+	const glm::vec2& pivot, float scale, const glm::vec4& color)
+{
+	if (font == _font && text == _text && anchor == _anchor && offset == _offset && pivot == _pivot && scale == _scale && color == _color) {
+		return false;
+	}
+
+	_font = font;
+	_text = text;
+	_anchor = anchor;
+	_offset = offset;
+	_pivot = pivot;
+	_scale = scale;
+	_color = color;
+	_Rebuild();
+	return true;
+}
+
+void TextRenderer::Run::_Rebuild() {
+	_vertices.clear();
+	_size = glm::vec2(0.0f);
+	if (_font == nullptr || _text.empty()) {
+		return;
+	}
+
+	// Lay the glyphs out in font pixels from the top left of the text, while measuring it's bounds
+	glm::vec2 pen = glm::vec2(0.0f, _font->GetAscent());
+	float width = 0.0f;
+	int lineCount = 1;
+	int previous = 0;
+	_vertices.reserve(_text.size() * 4);
+	for (char c : _text) {
+		int codePoint = (unsigned char)c;
+		if (codePoint == '\n') {
+			width = glm::max(width, pen.x);
+			pen = glm::vec2(0.0f, pen.y + _font->GetLineHeight());
+			lineCount++;
+			previous = 0;
+			continue;
+		}
+
+		const Font::Glyph* glyph = _font->GetGlyph(codePoint);
+		if (glyph == nullptr) {
+			glyph = _font->GetGlyph('?');
+			codePoint = '?';
+		}
+		if (previous != 0) {
+			pen.x += _font->GetKerning(previous, codePoint);
+		}
+		previous = codePoint;
+
+		// Spaces and other blank glyphs only move the pen
+		if (glyph->Max.x > glyph->Min.x && glyph->Max.y > glyph->Min.y) {
+			glm::vec2 min = pen + glyph->Min;
+			glm::vec2 max = pen + glyph->Max;
+			_vertices.push_back({ glm::vec4(_anchor, min.x, max.y), glm::vec2(glyph->UvMin.x, glyph->UvMax.y), _color });
+			_vertices.push_back({ glm::vec4(_anchor, max.x, max.y), glm::vec2(glyph->UvMax.x, glyph->UvMax.y), _color });
+			_vertices.push_back({ glm::vec4(_anchor, max.x, min.y), glm::vec2(glyph->UvMax.x, glyph->UvMin.y), _color });
+			_vertices.push_back({ glm::vec4(_anchor, min.x, min.y), glm::vec2(glyph->UvMin.x, glyph->UvMin.y), _color });
+		}
+		pen.x += glyph->Advance;
+	}
+	width = glm::max(width, pen.x);
+	_size = glm::vec2(width, lineCount * _font->GetLineHeight()) * _scale;
+
+	// Now that we know how big the text is, we can move it into place around the pivot
+	glm::vec2 topLeft = _offset - _pivot * _size;
+	for (HudBatcher::Vertex& vertex : _vertices) {
+		vertex.Position.z = topLeft.x + vertex.Position.z * _scale;
+		vertex.Position.w = topLeft.y + vertex.Position.w * _scale;
+	}
+}
+
+TextRenderer::TextRenderer() :
+	_pending(Batch()),
+	_pendingStats({ 0, 0, 0, 0 }),
+	_stats({ 0, 0, 0, 0 })
+{
+	// Every quad uses the same 6 indices, each draw call picks it's quads with a base vertex
+	std::vector<uint16_t> indices;
+	indices.reserve(QUADS_PER_DRAW * 6);
+	for (size_t ix = 0; ix < QUADS_PER_DRAW; ix++) {
+		uint16_t base = (uint16_t)(ix * 4);
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+	_ibo = IndexBuffer::Create();
+	_ibo->LoadData(indices.data(), indices.size());
+
+	_vbo = VertexBuffer::Create(BufferUsage::DynamicDraw);
+	_vao = VertexArrayObject::Create();
+	_vao->AddVertexBuffer(_vbo, HudBatcher::Vertex::V_DECL);
+	_vao->SetIndexBuffer(_ibo);
+}
+
+void TextRenderer::DrawRun(const Run& run, bool rebuilt) {
+	_pendingStats.Runs++;
+	_pendingStats.RebuiltRuns += rebuilt ? 1 : 0;
+
+	const std::vector<HudBatcher::Vertex>& vertices = run.GetVertices();
+	if (run.GetFont() == nullptr || vertices.empty()) {
+		return;
+	}
+
+	// Runs that follow each other with the same font share a range, so they go in the same draw call
+	size_t firstQuad = _pending.Vertices.size() / 4;
+	size_t quadCount = vertices.size() / 4;
+	if (!_pending.Ranges.empty() && _pending.Ranges.back().TextFont == run.GetFont()) {
+		_pending.Ranges.back().QuadCount += quadCount;
+	} else {
+		_pending.Ranges.push_back({ run.GetFont(), firstQuad, quadCount });
+	}
+	_pending.Vertices.insert(_pending.Vertices.end(), vertices.begin(), vertices.end());
+}
+
+void TextRenderer::TakeBatch(Batch& batch) {
+	_pendingStats.Glyphs = _pending.Vertices.size() / 4;
+	_pendingStats.DrawCalls = 0;
+	for (const Batch::Range& range : _pending.Ranges) {
+		_pendingStats.DrawCalls += (range.QuadCount + QUADS_PER_DRAW - 1) / QUADS_PER_DRAW;
+	}
+	_stats = _pendingStats;
+	_pendingStats = { 0, 0, 0, 0 };
+
+	// Swapping hands the frame's glyphs over without copying them again
+	batch.Vertices.clear();
+	batch.Ranges.clear();
+	std::swap(batch, _pending);
+}
+
+void TextRenderer::DrawBatch(const Batch& batch, const glm::ivec2& screenSize) {
+	if (batch.Vertices.empty() || screenSize.x <= 0 || screenSize.y <= 0) {
+		return;
+	}
+
+	// All of the frame's text goes up in one upload, which orphans last frame's storage
+	_vbo->LoadData(batch.Vertices.data(), batch.Vertices.size());
+
+	bool depthTestWasEnabled = GlStateCache::IsDepthTestEnabled();
+	GlStateCache::SetDepthTestEnabled(false);
+
+	__Shader->Bind();
+	__Shader->SetUniformMatrix(U_PROJECTION, glm::ortho(0.0f, (float)screenSize.x, (float)screenSize.y, 0.0f));
+	__Shader->SetUniform(U_SCREEN_SIZE, glm::vec2(screenSize));
+	__Shader->SetUniform(U_SCALE, screenSize.y / HudBatcher::REFERENCE_HEIGHT);
+	_vao->Bind();
+	for (const Batch::Range& range : batch.Ranges) {
+		GlStateCache::BindTextureUnit(0, range.TextFont->GetAtlas()->GetHandle());
+		for (size_t drawn = 0; drawn < range.QuadCount; drawn += QUADS_PER_DRAW) {
+			size_t count = glm::min(range.QuadCount - drawn, QUADS_PER_DRAW);
+			glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(count * 6), GL_UNSIGNED_SHORT, nullptr, (GLint)((range.FirstQuad + drawn) * 4));
+		}
+	}
+
+	GlStateCache::SetDepthTestEnabled(depthTestWasEnabled);
+}
+
+TextRenderer& TextRenderer::Get() {
+	if (__Instance == nullptr) {
+		// Our buffers and shader need the GL context
+		RenderThread::Invoke([]() {
+			__Instance = new TextRenderer();
+
+			__Shader = Shader::Create();
+			__Shader->LoadShaderPartFromFile("shaders/hud_vert.glsl", ShaderPartType::Vertex);
+			__Shader->LoadShaderPartFromFile("shaders/text_frag.glsl", ShaderPartType::Fragment);
+			__Shader->Link();
+		});
+	}
+	return *__Instance;
+}
+
+void TextRenderer::Uninitialize()
+{
+	if (__Instance != nullptr) {
+		RenderThread::Invoke([]() {
+			delete __Instance;
+			__Instance = nullptr;
+			__Shader = nullptr;
+		});
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+#include "Graphics/Font.h"
+#include "Graphics/HudBatcher.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/Shader.h"
+
+/// <summary>
+/// Draws HUD text over the top of the scene
+///
+/// Text is laid out into runs of glyph quads, which are cached and only rebuilt when their
+/// string, font or layout changes. Every frame the runs are copied into a single vertex buffer,
+/// and drawn with one draw call per font atlas (split up only when there are more glyphs
+/// than our 16 bit indices can reach)
+///
+/// Text uses the same screen space layout as the HudBatcher, and like it, runs are collected
+/// on the main thread, handed to the render thread with TakeBatch and drawn there with DrawBatch
+/// </summary>
+class TextRenderer
+{
+public:
+	// The most glyphs drawn by a single draw call, 4 vertices each must fit in a 16 bit index
+	inline static const size_t QUADS_PER_DRAW = 16384;
+
+	/// <summary>
+	/// A piece of text that has been laid out into glyph quads. Keep one of these around for
+	/// each label, so that it only has to be laid out again when it changes
+	/// </summary>
+	class Run {
+	public:
+		Run();
+
+		/// <summary>
+		/// Sets the text and layout of the run, only rebuilding the glyphs if anything changed
+		/// </summary>
+		/// <param name="font">The font to draw the text with</param>
+		/// <param name="text">The text to draw, may contain newlines</param>
+		/// <param name="anchor">The point on the screen that the text is placed relative to, (0, 0) is the top left</param>
+		/// <param name="offset">The offset from the anchor to the text's pivot, in reference pixels</param>
+		/// <param name="pivot">The point on the text's bounds that is placed at the offset, (0, 0) is the top left</param>
+		/// <param name="scale">The number of reference pixels per font pixel</param>
+		/// <param name="color">The color of the text</param>
+		/// <returns>True if the glyphs were rebuilt</returns>
+		bool Update(const Font::Sptr& font, const std::string& text, const glm::vec2& anchor, const glm::vec2& offset,
+			const glm::vec2& pivot, float scale, const glm::vec4& color);
+
+		/// <summary>
+		/// Gets the font that the run was built with
+		/// </summary>
+		const Font::Sptr& GetFont() const { return _font; }
+		/// <summary>
+		/// Gets the size of the text's bounds, in reference pixels
+		/// </summary>
+		const glm::vec2& GetSize() const { return _size; }
+		/// <summary>
+		/// Gets the glyph quads, 4 vertices each
+		/// </summary>
+		const std::vector<HudBatcher::Vertex>& GetVertices() const { return _vertices; }
+
+	protected:
+		Font::Sptr  _font;
+		std::string _text;
+		glm::vec2   _anchor;
+		glm::vec2   _offset;
+		glm::vec2   _pivot;
+		float       _scale;
+		glm::vec4   _color;
+
+		glm::vec2   _size;
+		std::vector<HudBatcher::Vertex> _vertices;
+
+		void _Rebuild();
+	};
+
+	/// <summary>
+	/// All of the text collected over a frame
+	/// </summary>
+	struct Batch {
+		// A set of glyphs that come from the same atlas
+		struct Range {
+			// Keeps the atlas alive until the batch is drawn, even if the font is released
+			Font::Sptr TextFont;
+			size_t     FirstQuad;
+			size_t     QuadCount;
+		};
+
+		// 4 vertices per glyph, for every run in the order they were drawn
+		std::vector<HudBatcher::Vertex> Vertices;
+		std::vector<Range>              Ranges;
+	};
+
+	/// <summary>
+	/// Counters for the last batch that was taken, for the stats display
+	/// </summary>
+	struct Stats {
+		size_t Runs;
+		// The number of runs that had to be laid out again
+		size_t RebuiltRuns;
+		size_t Glyphs;
+		size_t DrawCalls;
+	};
+
+	TextRenderer(const TextRenderer& other) = delete;
+	TextRenderer(TextRenderer&& other) = delete;
+	TextRenderer& operator =(const TextRenderer& other) = delete;
+	TextRenderer& operator =(TextRenderer&& other) = delete;
+
+	virtual ~TextRenderer() = default;
+
+	/// <summary>
+	/// Gets the singleton instance of the text renderer
+	/// </summary>
+	static TextRenderer& Get();
+	/// <summary>
+	/// Disposes of all resources used by the text renderer
+	/// </summary>
+	static void Uninitialize();
+
+	/// <summary>
+	/// Adds a run to be drawn this frame. Call from the main thread
+	/// </summary>
+	/// <param name="run">The run to draw</param>
+	/// <param name="rebuilt">True if the run was rebuilt this frame, only used for stats</param>
+	void DrawRun(const Run& run, bool rebuilt = false);
+
+	/// <summary>
+	/// Moves all of the text drawn since the last call into the given batch. Call from the main thread
+	/// </summary>
+	/// <param name="batch">The batch to fill</param>
+	void TakeBatch(Batch& batch);
+	/// <summary>
+	/// Draws all of the text in a batch over whatever is in the current framebuffer, must be
+	/// called from the render thread
+	/// </summary>
+	/// <param name="batch">The batch to draw</param>
+	/// <param name="screenSize">The size of the framebuffer's viewport in pixels</param>
+	void DrawBatch(const Batch& batch, const glm::ivec2& screenSize);
+
+	/// <summary>
+	/// Gets the counters for the last batch that was taken
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	TextRenderer();
+
+	Batch _pending;
+	Stats _pendingStats;
+	Stats _stats;
+
+	VertexBuffer::Sptr      _vbo;
+	IndexBuffer::Sptr       _ibo;
+	VertexArrayObject::Sptr _vao;
+
+	inline static TextRenderer* __Instance = nullptr;
+	inline static Shader::Sptr __Shader = nullptr;
+};
@@ -1,6 +1,7 @@
 #include "Texture2D.h"
 #include <stb_image.h>
 #include <Logging.h>
+#include "TextureStreamer.h"
 #include "GLM/glm.hpp"
 #include "Utils/JsonGlmHelpers.h"
 
@@ -39,18 +40,46 @@ Texture2D::Sptr Texture2D::FromJson(const nlohmann::json& data)
 	return std::make_shared<Texture2D>(descr);
 }
 
-Texture2D::Texture2D(const Texture2DDescription& description) : ITexture(TextureType::_2D) {
+Texture2D::Texture2D(const Texture2DDescription& description) :
+	ITexture(TextureType::_2D),
+	_streamId(0),
+	_requestedScreenSize(0.0f)
+{
 	_description = description;
 	_SetTextureParams();
 	_LoadDataFromFile();
 }
 
-Texture2D::Texture2D(const std::string& filePath) : ITexture(TextureType::_2D) {
+Texture2D::Texture2D(const std::string& filePath) :
+	ITexture(TextureType::_2D),
+	_streamId(0),
+	_requestedScreenSize(0.0f)
+{
 	_description.Filename = filePath;
 	_SetTextureParams();
 	_LoadDataFromFile();
 }
 
+Texture2D::~Texture2D() {
+	if (_streamId != 0) {
+		TextureStreamer::RemoveTexture(this);
+	}
+}
+
+void Texture2D::RequestScreenSize(float screenSize) {
+	if (_streamId != 0) {
+		// Keep the largest request, other threads may be recording requests at the same time
+		float current = _requestedScreenSize.load(std::memory_order_relaxed);
+		while (screenSize > current && !_requestedScreenSize.compare_exchange_weak(current, screenSize, std::memory_order_relaxed)) { }
+	}
+}
+
+void Texture2D::MakeResident() {
+	if (_streamId != 0) {
+		TextureStreamer::Get().MakeResident(this);
+	}
+}
+
 void Texture2D::SetMinFilter(MinFilter value) {
 	_description.MinificationFilter = value;
 	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, *_description.MinificationFilter);
@@ -92,9 +121,15 @@ void Texture2D::LoadData(uint32_t width, uint32_t height, PixelFormat format, Pi
 }
 
 void Texture2D::_LoadDataFromFile() {
-	LOG_ASSERT(_description.Width + _description.Height == 0, "This texture has already been configured with a size! Cannot re-allocate memory!");
-
+	// Textures with no file are allocated from their description, and filled in by the caller
 	if (!_description.Filename.empty()) {
+		LOG_ASSERT(_description.Width + _description.Height == 0, "This texture has already been configured with a size! Cannot re-allocate memory!");
+
+		// Mip mapped textures can start out with just their smallest levels, and have the rest streamed in
+		if (TextureStreamer::Enabled && _description.GenerateMipMaps && TextureStreamer::Get().LoadTexture(this)) {
+			return;
+		}
+
 		// Variables that will store properties about our image
 		int width, height, numChannels;
 		const int targetChannels = GetTexelComponentCount(_description.FormatHint);
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "ITexture.h"
 
 /// <summary>
@@ -81,7 +82,7 @@ public:
 	Texture2D& operator=(Texture2D&& other) = delete;
 
 	// Make sure we mark our destructor as virtual so base class is called
-	virtual ~Texture2D() = default;
+	virtual ~Texture2D();
 
 public:
 	Texture2D(const std::string& filePath);
@@ -136,6 +137,24 @@ public:
 	/// <param name="offsetY">The y edge of the destination rectangle in the texture, bottom->top</param>
 	void LoadData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* data, uint32_t offsetX = 0, uint32_t offsetY = 0);
 
+	/// <summary>
+	/// Returns true if our mip levels are streamed in by the TextureStreamer, in which case only
+	/// the levels it has loaded can be sampled
+	/// </summary>
+	bool IsStreamed() const { return _streamId != 0; }
+	/// <summary>
+	/// Records how much of the screen's height something drawing with this texture covered this
+	/// frame, the streamer keeps the largest request and loads enough levels for it. Safe to call
+	/// from any thread, does nothing if we are not streamed
+	/// </summary>
+	/// <param name="screenSize">The fraction of the screen's height that was covered</param>
+	void RequestScreenSize(float screenSize);
+	/// <summary>
+	/// Loads all of our mip levels right away, for when the full image is about to be read
+	/// directly (ex: copied into an atlas). Does nothing if we are not streamed
+	/// </summary>
+	void MakeResident();
+
 	/// <summary>
 	/// Gets this texture's description, which contains basic information about the
 	/// texture's dimensions and creation parameters
@@ -148,6 +167,14 @@ public:
 protected:
 	Texture2DDescription _description;
 
+	// Our ID in the texture streamer, or 0 if we were loaded in full
+	uint32_t           _streamId;
+	// The largest screen size requested since the streamer last checked
+	std::atomic<float> _requestedScreenSize;
+
+	// Sets up our storage and streaming state when the streamer loads us
+	friend class TextureStreamer;
+
 	/// <summary>
 	/// Loads this texture from the file specified in the description
 	/// Will overwrite description size
@@ -0,0 +1,119 @@
+#include "TextureArrayAtlas.h"
+#include "Logging.h"
+
+TextureArrayAtlas::TextureArrayAtlas() :
+	ITexture(TextureType::_2DArray),
+	_layers(std::vector<Texture2D::Sptr>()),
+	_isBuilt(false)
+{ }
+
+bool TextureArrayAtlas::IsCompatible(const Texture2D::Sptr& texture) const {
+	if (texture == nullptr || texture->GetWidth() * texture->GetHeight() == 0) {
+		return false;
+	}
+	if (_layers.empty()) {
+		return true;
+	}
+
+	// The whole array shares one set of storage and sampler parameters, so everything needs to match
+	const Texture2DDescription& a = _layers[0]->GetDescription();
+	const Texture2DDescription& b = texture->GetDescription();
+	return
+		a.Width               == b.Width &&
+		a.Height              == b.Height &&
+		a.Format              == b.Format &&
+		a.GenerateMipMaps     == b.GenerateMipMaps &&
+		a.HorizontalWrap      == b.HorizontalWrap &&
+		a.VerticalWrap        == b.VerticalWrap &&
+		a.MinificationFilter  == b.MinificationFilter &&
+		a.MagnificationFilter == b.MagnificationFilter &&
+		a.MaxAnisotropic      == b.MaxAnisotropic;
+}
+
+int TextureArrayAtlas::AddTexture(const Texture2D::Sptr& texture) {
+	int existing = GetLayer(texture);
+	if (existing != -1) {
+		return existing;
+	}
+	if (_isBuilt) {
+		LOG_WARN("Cannot add textures to an atlas that has already been built");
+		return -1;
+	}
+	if (!IsCompatible(texture)) {
+		return -1;
+	}
+
+	_layers.push_back(texture);
+	return (int)_layers.size() - 1;
+}
+
+int TextureArrayAtlas::GetLayer(const Texture2D::Sptr& texture) const {
+	for (size_t ix = 0; ix < _layers.size(); ix++) {
+		if (_layers[ix] == texture) {
+			return (int)ix;
+		}
+	}
+	return -1;
+}
+
+bool TextureArrayAtlas::Build() {
+	if (_isBuilt) {
+		return true;
+	}
+	if (_layers.empty()) {
+		LOG_WARN("Cannot build an empty texture atlas");
+		return false;
+	}
+
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if ((GLint)_layers.size() > maxLayers) {
+		LOG_WARN("Texture atlas has {} layers, but the renderer only supports {}", _layers.size(), maxLayers);
+		return false;
+	}
+
+	const Texture2DDescription& desc = _layers[0]->GetDescription();
+
+	// Match the mip chain that the source textures allocated, so that every level can be copied over
+	GLint levels = 1;
+	glGetTextureParameteriv(_layers[0]->GetHandle(), GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+	levels = glm::max(levels, 1);
+
+	glTextureStorage3D(_handle, levels, (GLenum)desc.Format, desc.Width, desc.Height, (GLsizei)_layers.size());
+
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)desc.HorizontalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)desc.VerticalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)desc.MinificationFilter);
+	glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)desc.MagnificationFilter);
+	glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, desc.MaxAnisotropic);
+
+	// Copy the images over on the GPU, this avoids having to keep the source pixels around on the CPU.
+	// Streamed textures may only have their smallest levels loaded, so they're filled in first
+	for (size_t layer = 0; layer < _layers.size(); layer++) {
+		_layers[layer]->MakeResident();
+		GLuint source = _layers[layer]->GetHandle();
+		for (GLint level = 0; level < levels; level++) {
+			GLsizei width = glm::max((GLsizei)desc.Width >> level, 1);
+			GLsizei height = glm::max((GLsizei)desc.Height >> level, 1);
+			glCopyImageSubData(
+				source, GL_TEXTURE_2D, level, 0, 0, 0,
+				_handle, GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer,
+				width, height, 1
+			);
+		}
+	}
+
+	_isBuilt = true;
+	LOG_INFO("Built {}x{} texture atlas with {} layers", desc.Width, desc.Height, _layers.size());
+	return true;
+}
+
+nlohmann::json TextureArrayAtlas::ToJson() const {
+	nlohmann::json layers = nlohmann::json::array();
+	for (const Texture2D::Sptr& texture : _layers) {
+		layers.push_back(texture->IResource::GetGUID().str());
+	}
+	return {
+		{ "layers", layers }
+	};
+}
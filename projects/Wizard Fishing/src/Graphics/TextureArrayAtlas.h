@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include "Graphics/Texture2D.h"
+
+/// <summary>
+/// Packs a set of identically sized and formatted 2D textures into the layers of a single
+/// GL_TEXTURE_2D_ARRAY, so that materials using any of those textures can share one texture
+/// binding and only differ by which layer they sample from
+///
+/// Textures are added with AddTexture, and copied into the array (including all of their
+/// mip levels) on the GPU when Build is called. The source textures are left untouched
+/// </summary>
+class TextureArrayAtlas : public ITexture {
+public:
+	typedef std::shared_ptr<TextureArrayAtlas> Sptr;
+
+	// Remove the copy and and assignment operators
+	TextureArrayAtlas(const TextureArrayAtlas& other) = delete;
+	TextureArrayAtlas(TextureArrayAtlas&& other) = delete;
+	TextureArrayAtlas& operator=(const TextureArrayAtlas& other) = delete;
+	TextureArrayAtlas& operator=(TextureArrayAtlas&& other) = delete;
+
+	static inline Sptr Create() {
+		return std::make_shared<TextureArrayAtlas>();
+	}
+
+	TextureArrayAtlas();
+	virtual ~TextureArrayAtlas() = default;
+
+	/// <summary>
+	/// Returns true if the given texture could be stored in this atlas, meaning it has the
+	/// same size, format and sampler settings as the textures already added
+	/// </summary>
+	/// <param name="texture">The texture to check</param>
+	bool IsCompatible(const Texture2D::Sptr& texture) const;
+
+	/// <summary>
+	/// Adds a texture to the atlas, if the texture has already been added it's existing layer
+	/// is returned. Textures can only be added before the atlas is built
+	/// </summary>
+	/// <param name="texture">The texture to add</param>
+	/// <returns>The layer that the texture will be stored in, or -1 if it could not be added</returns>
+	int AddTexture(const Texture2D::Sptr& texture);
+
+	/// <summary>
+	/// Gets the layer that the given texture is stored in, or -1 if it is not in this atlas
+	/// </summary>
+	int GetLayer(const Texture2D::Sptr& texture) const;
+
+	/// <summary>
+	/// Allocates the texture array and copies every added texture into it's layer
+	/// </summary>
+	/// <returns>True if the atlas was built, false if it is empty or the layer limit was exceeded</returns>
+	bool Build();
+
+	/// <summary>
+	/// Gets the number of layers in this atlas
+	/// </summary>
+	int GetLayerCount() const { return (int)_layers.size(); }
+	/// <summary>
+	/// Returns true once Build has successfully been called
+	/// </summary>
+	bool IsBuilt() const { return _isBuilt; }
+
+	// The atlas is generated at load time from other textures, so we only output what it contains
+	virtual nlohmann::json ToJson() const override;
+
+protected:
+	std::vector<Texture2D::Sptr> _layers;
+	bool _isBuilt;
+};
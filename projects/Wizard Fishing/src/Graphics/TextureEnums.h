@@ -14,6 +14,7 @@ ENUM(TextureType, GLenum,
 	_2D = GL_TEXTURE_2D,
 	_3D = GL_TEXTURE_3D,
 	Cubemap = GL_TEXTURE_CUBE_MAP,
+	_2DArray = GL_TEXTURE_2D_ARRAY,
 	_2DMultisample = GL_TEXTURE_2D_MULTISAMPLE
 );
 
@@ -0,0 +1,529 @@
+#include "Graphics/TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <imgui.h>
+#include <stb_image.h>
+#include <GLM/glm.hpp>
+#include "Graphics/Texture2D.h"
+#include "Graphics/RenderThread.h"
+#include "Logging.h"
+
+static const uint32_t MIP_CACHE_MAGIC = 0x50494D57; // "WMIP"
+static const uint32_t MIP_CACHE_VERSION = 1;
+
+// The header at the start of a .mips file, followed by each level from largest to smallest
+struct MipCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Channels;
+	uint32_t Levels;
+	uint64_t SourceSize;
+	int64_t  SourceWriteTime;
+};
+
+// Reads the size and modification time of a source file, so we can tell when a cache is out of date
+static bool GetSourceStamp(const std::string& filename, uint64_t& size, int64_t& writeTime) {
+	std::error_code error;
+	size = std::filesystem::file_size(filename, error);
+	if (error) return false;
+	writeTime = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	return !error;
+}
+
+// The number of levels in a full mip chain, this must match the levels Texture2D allocates
+static int CountMipLevels(uint32_t width, uint32_t height) {
+	int levels = 1;
+	for (uint32_t size = glm::max(width, height); size > 1; size >>= 1) {
+		levels++;
+	}
+	return levels;
+}
+
+// Halves an image with a box filter, the last row or column is repeated for odd sizes
+static void Downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, uint32_t channels, std::vector<uint8_t>& result) {
+	uint32_t resultWidth = glm::max(width >> 1, 1u);
+	uint32_t resultHeight = glm::max(height >> 1, 1u);
+	result.resize((size_t)resultWidth * resultHeight * channels);
+	for (uint32_t y = 0; y < resultHeight; y++) {
+		uint32_t y0 = glm::min(y * 2, height - 1);
+		uint32_t y1 = glm::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < resultWidth; x++) {
+			uint32_t x0 = glm::min(x * 2, width - 1);
+			uint32_t x1 = glm::min(x * 2 + 1, width - 1);
+			for (uint32_t channel = 0; channel < channels; channel++) {
+				uint32_t sum =
+					source[((size_t)y0 * width + x0) * channels + channel] +
+					source[((size_t)y0 * width + x1) * channels + channel] +
+					source[((size_t)y1 * width + x0) * channels + channel] +
+					source[((size_t)y1 * width + x1) * channels + channel];
+				result[((size_t)y * resultWidth + x) * channels + channel] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+bool TextureStreamer::Enabled = true;
+
+TextureStreamer::TextureStreamer() :
+	BudgetMB(256),
+	LevelBias(0),
+	_records(std::unordered_map<uint32_t, Record>()),
+	_jobs(std::deque<LoadJob>()),
+	_results(std::vector<LoadResult>()),
+	_uploads(std::vector<Upload>()),
+	_isUploadQueued(false),
+	_nextId(1),
+	_residentBytes(0),
+	_loadingBytes(0),
+	_loadsInFlight(0),
+	_levelsLoaded(0),
+	_levelsEvicted(0),
+	_stopRequested(false),
+	_frame(0),
+	_viewportHeight(0),
+	_stats(Stats())
+{
+	_worker = std::thread(&TextureStreamer::_WorkerMain, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stopRequested = true;
+		_jobQueued.notify_all();
+	}
+	_worker.join();
+}
+
+TextureStreamer& TextureStreamer::Get() {
+	if (__Instance == nullptr) {
+		__Instance = new TextureStreamer();
+	}
+	return *__Instance;
+}
+
+void TextureStreamer::Uninitialize() {
+	if (__Instance != nullptr) {
+		delete __Instance;
+		__Instance = nullptr;
+	}
+}
+
+bool TextureStreamer::LoadTexture(Texture2D* texture) {
+	Texture2DDescription& description = texture->_description;
+
+	// Images that are already as small as a tail have nothing to stream, so we check the size
+	// before making a cache for them
+	int width, height, fileChannels;
+	if (!stbi_info(description.Filename.c_str(), &width, &height, &fileChannels) || (uint32_t)glm::max(width, height) <= TAIL_SIZE) {
+		return false;
+	}
+
+	MipCache cache;
+	if (!_OpenCache(description.Filename, GetTexelComponentCount(description.FormatHint), cache)) {
+		return false;
+	}
+
+	// The tail is every level that fits in TAIL_SIZE
+	int tailLevel = 0;
+	while (tailLevel < cache.Levels - 1 && glm::max(cache.Width >> tailLevel, cache.Height >> tailLevel) > TAIL_SIZE) {
+		tailLevel++;
+	}
+
+	std::vector<uint8_t> data;
+	if (!_ReadLevels(cache, tailLevel, cache.Levels, data)) {
+		LOG_WARN("Could not read the mip cache for \"{}\", it will be loaded in full", description.Filename);
+		return false;
+	}
+
+	// Allocate the whole chain, the sampler is kept off of the levels we haven't loaded
+	description.Format = GetInternalFormatForChannels8(cache.Channels);
+	description.Width = cache.Width;
+	description.Height = cache.Height;
+	texture->_SetTextureParams();
+
+	const uint8_t* cursor = data.data();
+	for (int level = tailLevel; level < cache.Levels; level++) {
+		_UploadLevel(texture->GetHandle(), cache, level, cursor);
+		cursor += cache.Sizes[level];
+	}
+	glTextureParameteri(texture->GetHandle(), GL_TEXTURE_BASE_LEVEL, tailLevel);
+
+	std::lock_guard<std::mutex> guard(_lock);
+	Record record;
+	record.Id = _nextId++;
+	record.Texture = texture;
+	record.Cache = std::move(cache);
+	record.TailLevel = tailLevel;
+	record.ResidentLevel = tailLevel;
+	record.WantedLevel = tailLevel;
+	record.LoadingLevel = -1;
+	record.ScreenSize = 0.0f;
+	record.LastRequestFrame = _frame;
+	record.HasFailed = false;
+	texture->_streamId = record.Id;
+	_records.emplace(record.Id, std::move(record));
+	return true;
+}
+
+void TextureStreamer::RemoveTexture(Texture2D* texture) {
+	if (__Instance == nullptr) {
+		return;
+	}
+	TextureStreamer& streamer = *__Instance;
+	std::lock_guard<std::mutex> guard(streamer._lock);
+	auto it = streamer._records.find(texture->_streamId);
+	if (it != streamer._records.end()) {
+		// Any of it's levels that are still being read are thrown away when they finish
+		streamer._residentBytes -= _GetBytesAbove(it->second, it->second.ResidentLevel);
+		streamer._CancelUploads(it->first);
+		streamer._records.erase(it);
+	}
+}
+
+void TextureStreamer::MakeResident(Texture2D* texture) {
+	std::vector<uint8_t> data;
+	MipCache cache;
+	int tailLevel;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		auto it = _records.find(texture->_streamId);
+		if (it == _records.end()) {
+			return;
+		}
+		Record& record = it->second;
+		bool hasUploads = std::any_of(_uploads.begin(), _uploads.end(), [&](const Upload& upload) { return upload.Id == record.Id; });
+		if (record.ResidentLevel == 0 && !hasUploads) {
+			return;
+		}
+
+		// Levels that were waiting for the render thread are read again with the rest, so that
+		// everything lands in one go
+		if (!_ReadLevels(record.Cache, 0, record.TailLevel, data)) {
+			LOG_WARN("Could not read the mip cache for \"{}\"", record.Cache.Path);
+			return;
+		}
+		_CancelUploads(record.Id);
+		_residentBytes += _GetBytesAbove(record, 0) - _GetBytesAbove(record, record.ResidentLevel);
+		record.ResidentLevel = 0;
+		// If a level is being read, it's thrown away when it arrives
+		record.LoadingLevel = -1;
+		cache = record.Cache;
+		tailLevel = record.TailLevel;
+	}
+
+	// The caller is about to read from the texture, so we have to wait for the upload
+	RenderThread::Invoke([&]() {
+		const uint8_t* cursor = data.data();
+		for (int level = 0; level < tailLevel; level++) {
+			_UploadLevel(texture->GetHandle(), cache, level, cursor);
+			cursor += cache.Sizes[level];
+		}
+		glTextureParameteri(texture->GetHandle(), GL_TEXTURE_BASE_LEVEL, 0);
+	});
+}
+
+void TextureStreamer::Update() {
+	bool queueUpload = false;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_frame++;
+
+		// Hand the levels that have been read over to the render thread
+		for (LoadResult& result : _results) {
+			_loadsInFlight--;
+			_loadingBytes -= result.Size;
+
+			auto it = _records.find(result.Id);
+			if (it == _records.end() || it->second.LoadingLevel != result.Level) {
+				continue;
+			}
+			Record& record = it->second;
+			record.LoadingLevel = -1;
+			if (!result.Success) {
+				LOG_WARN("Could not read level {} of \"{}\", it will stay at level {}", result.Level, record.Cache.Path, record.ResidentLevel);
+				record.HasFailed = true;
+				continue;
+			}
+
+			record.ResidentLevel = result.Level;
+			_residentBytes += result.Size;
+			_uploads.push_back({ record.Id, result.Level, result.Level, std::move(result.Data) });
+			_levelsLoaded++;
+		}
+		_results.clear();
+
+		// Turn this frame's requests into the level that each texture wants
+		uint64_t wantedBytes = 0;
+		uint32_t fullyResident = 0;
+		for (auto& [id, record] : _records) {
+			float request = record.Texture->_requestedScreenSize.exchange(0.0f, std::memory_order_relaxed);
+			if (request > 0.0f) {
+				record.ScreenSize = request;
+				record.LastRequestFrame = _frame;
+			} else if (_frame - record.LastRequestFrame > REQUEST_FRAMES) {
+				record.ScreenSize = 0.0f;
+			}
+			record.WantedLevel = _PickLevel(record);
+			wantedBytes += _GetBytesAbove(record, record.WantedLevel);
+			fullyResident += record.ResidentLevel == 0 ? 1 : 0;
+		}
+
+		// The budget may have been lowered since the last frame
+		_MakeRoom(0);
+
+		// Load the textures that are furthest from what they want first, so that everything on
+		// screen sharpens up together
+		std::vector<Record*> candidates;
+		for (auto& [id, record] : _records) {
+			if (record.ResidentLevel > record.WantedLevel && record.LoadingLevel == -1 && !record.HasFailed) {
+				candidates.push_back(&record);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Record* a, const Record* b) {
+			int aMissing = a->ResidentLevel - a->WantedLevel;
+			int bMissing = b->ResidentLevel - b->WantedLevel;
+			if (aMissing != bMissing) return aMissing > bMissing;
+			return a->ScreenSize > b->ScreenSize;
+		});
+		for (Record* record : candidates) {
+			if (_loadsInFlight >= MAX_LOADS_IN_FLIGHT) {
+				break;
+			}
+			int level = record->ResidentLevel - 1;
+			size_t size = record->Cache.Sizes[level];
+			if (!_MakeRoom(size)) {
+				break;
+			}
+			_jobs.push_back({ record->Id, level, record->Cache.Path, record->Cache.Offsets[level], size });
+			record->LoadingLevel = level;
+			_loadingBytes += size;
+			_loadsInFlight++;
+		}
+		if (!_jobs.empty()) {
+			_jobQueued.notify_one();
+		}
+
+		if (!_uploads.empty() && !_isUploadQueued) {
+			_isUploadQueued = true;
+			queueUpload = true;
+		}
+
+		_stats.Textures = (uint32_t)_records.size();
+		_stats.FullyResident = fullyResident;
+		_stats.ResidentBytes = _residentBytes;
+		_stats.WantedBytes = wantedBytes;
+		_stats.LoadsInFlight = (uint32_t)_loadsInFlight;
+		_stats.LevelsLoaded = _levelsLoaded;
+		_stats.LevelsEvicted = _levelsEvicted;
+	}
+
+	// Without a render thread the upload runs right away, and needs the lock for itself
+	if (queueUpload) {
+		RenderThread::Enqueue([this]() {
+			_UploadPending();
+		});
+	}
+}
+
+void TextureStreamer::RenderImGui() {
+	ImGui::SliderInt("Texture Budget (MB)", &BudgetMB, 16, 2048);
+	ImGui::SliderInt("Texture Mip Bias", &LevelBias, -2, 4);
+	ImGui::Text("Streaming:  %d textures (%d full), %.1f MB resident, %.1f MB wanted, %d loading",
+		(int)_stats.Textures, (int)_stats.FullyResident, _stats.ResidentBytes / (1024.0f * 1024.0f),
+		_stats.WantedBytes / (1024.0f * 1024.0f), (int)_stats.LoadsInFlight);
+	ImGui::Text("            %d levels loaded, %d levels evicted", (int)_stats.LevelsLoaded, (int)_stats.LevelsEvicted);
+}
+
+void TextureStreamer::_WorkerMain() {
+	while (true) {
+		LoadJob job;
+		{
+			std::unique_lock<std::mutex> guard(_lock);
+			_jobQueued.wait(guard, [&] { return _stopRequested || !_jobs.empty(); });
+			if (_stopRequested) {
+				return;
+			}
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		LoadResult result;
+		result.Id = job.Id;
+		result.Level = job.Level;
+		result.Size = job.Size;
+		result.Data.resize(job.Size);
+		std::ifstream file(job.Path, std::ios::binary);
+		result.Success = file && file.seekg(job.Offset) && file.read(reinterpret_cast<char*>(result.Data.data()), job.Size);
+
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_results.push_back(std::move(result));
+		}
+	}
+}
+
+void TextureStreamer::_UploadPending() {
+	// We hold the lock while uploading so that none of the textures can be destroyed under us
+	std::lock_guard<std::mutex> guard(_lock);
+	_isUploadQueued = false;
+	for (const Upload& upload : _uploads) {
+		auto it = _records.find(upload.Id);
+		if (it == _records.end()) {
+			continue;
+		}
+		GLuint handle = it->second.Texture->GetHandle();
+		if (!upload.Data.empty()) {
+			_UploadLevel(handle, it->second.Cache, upload.Level, upload.Data.data());
+		}
+		glTextureParameteri(handle, GL_TEXTURE_BASE_LEVEL, upload.BaseLevel);
+	}
+	_uploads.clear();
+}
+
+int TextureStreamer::_PickLevel(const Record& record) const {
+	if (record.ScreenSize <= 0.0f || _viewportHeight <= 0) {
+		return record.TailLevel;
+	}
+
+	// Pick the smallest level that still has a texel for every pixel the object covers
+	float pixels = glm::max(record.ScreenSize * (float)_viewportHeight, 1.0f);
+	float size = (float)glm::max(record.Cache.Width, record.Cache.Height);
+	int level = (int)glm::floor(glm::log2(glm::max(size / pixels, 1.0f))) + LevelBias;
+	return glm::clamp(level, 0, record.TailLevel);
+}
+
+bool TextureStreamer::_MakeRoom(uint64_t bytes) {
+	uint64_t budget = (uint64_t)glm::max(BudgetMB, 0) * 1024 * 1024;
+	while (_residentBytes + _loadingBytes + bytes > budget) {
+		// Only levels that a texture doesn't want are dropped, the least recently wanted first
+		Record* victim = nullptr;
+		for (auto& [id, record] : _records) {
+			if (record.ResidentLevel < record.WantedLevel && record.LoadingLevel == -1 &&
+				(victim == nullptr || record.LastRequestFrame < victim->LastRequestFrame)) {
+				victim = &record;
+			}
+		}
+		if (victim == nullptr) {
+			return false;
+		}
+
+		_residentBytes -= _GetBytesAbove(*victim, victim->ResidentLevel) - _GetBytesAbove(*victim, victim->WantedLevel);
+		_levelsEvicted += victim->WantedLevel - victim->ResidentLevel;
+		victim->ResidentLevel = victim->WantedLevel;
+		_uploads.push_back({ victim->Id, victim->WantedLevel, victim->WantedLevel, std::vector<uint8_t>() });
+	}
+	return true;
+}
+
+void TextureStreamer::_CancelUploads(uint32_t id) {
+	_uploads.erase(std::remove_if(_uploads.begin(), _uploads.end(), [id](const Upload& upload) {
+		return upload.Id == id;
+	}), _uploads.end());
+}
+
+uint64_t TextureStreamer::_GetBytesAbove(const Record& record, int level) {
+	uint64_t result = 0;
+	for (int ix = level; ix < record.TailLevel; ix++) {
+		result += record.Cache.Sizes[ix];
+	}
+	return result;
+}
+
+bool TextureStreamer::_OpenCache(const std::string& image, int channels, MipCache& cache) {
+	MipCacheHeader expected;
+	memset(&expected, 0, sizeof(MipCacheHeader));
+	expected.Magic = MIP_CACHE_MAGIC;
+	expected.Version = MIP_CACHE_VERSION;
+	if (!GetSourceStamp(image, expected.SourceSize, expected.SourceWriteTime)) {
+		return false;
+	}
+	cache.Path = image + ".mips";
+
+	// Use the existing cache if it was made from this version of the image
+	MipCacheHeader header;
+	std::ifstream file(cache.Path, std::ios::binary);
+	bool isValid = file && file.read(reinterpret_cast<char*>(&header), sizeof(MipCacheHeader)) &&
+		header.Magic == expected.Magic && header.Version == expected.Version &&
+		header.SourceSize == expected.SourceSize && header.SourceWriteTime == expected.SourceWriteTime &&
+		(channels == 0 || header.Channels == (uint32_t)channels);
+	file.close();
+
+	std::vector<std::vector<uint8_t>> levels;
+	if (!isValid) {
+		// Decode the image and filter the whole chain now, so later runs only read what they need
+		int width, height, numChannels;
+		stbi_set_flip_vertically_on_load(true);
+		uint8_t* pixels = stbi_load(image.c_str(), &width, &height, &numChannels, channels);
+		if (pixels == nullptr) {
+			return false;
+		}
+		if (channels != 0) {
+			numChannels = channels;
+		}
+
+		header = expected;
+		header.Width = width;
+		header.Height = height;
+		header.Channels = numChannels;
+		header.Levels = CountMipLevels(width, height);
+		levels.resize(header.Levels);
+		levels[0].assign(pixels, pixels + (size_t)width * height * numChannels);
+		stbi_image_free(pixels);
+		for (uint32_t level = 1; level < header.Levels; level++) {
+			Downsample(levels[level - 1], glm::max(header.Width >> (level - 1), 1u), glm::max(header.Height >> (level - 1), 1u), header.Channels, levels[level]);
+		}
+	}
+
+	cache.Width = header.Width;
+	cache.Height = header.Height;
+	cache.Channels = header.Channels;
+	cache.Levels = (int)header.Levels;
+	cache.Offsets.resize(cache.Levels);
+	cache.Sizes.resize(cache.Levels);
+	size_t offset = sizeof(MipCacheHeader);
+	for (int level = 0; level < cache.Levels; level++) {
+		cache.Offsets[level] = offset;
+		cache.Sizes[level] = (size_t)glm::max(cache.Width >> level, 1u) * glm::max(cache.Height >> level, 1u) * cache.Channels;
+		offset += cache.Sizes[level];
+	}
+
+	if (!isValid) {
+		std::ofstream output(cache.Path, std::ios::binary);
+		output.write(reinterpret_cast<const char*>(&header), sizeof(MipCacheHeader));
+		for (const std::vector<uint8_t>& level : levels) {
+			output.write(reinterpret_cast<const char*>(level.data()), level.size());
+		}
+		if (!output) {
+			LOG_WARN("Could not write mip cache \"{}\", the image will be loaded in full", cache.Path);
+			return false;
+		}
+		LOG_INFO("Wrote mip cache \"{}\" ({} levels)", cache.Path, cache.Levels);
+	}
+	return true;
+}
+
+bool TextureStreamer::_ReadLevels(const MipCache& cache, int first, int last, std::vector<uint8_t>& data) {
+	if (first >= last) {
+		data.clear();
+		return true;
+	}
+	size_t start = cache.Offsets[first];
+	size_t end = cache.Offsets[last - 1] + cache.Sizes[last - 1];
+	data.resize(end - start);
+	std::ifstream file(cache.Path, std::ios::binary);
+	return file && file.seekg(start) && file.read(reinterpret_cast<char*>(data.data()), data.size());
+}
+
+void TextureStreamer::_UploadLevel(GLuint handle, const MipCache& cache, int level, const uint8_t* data) {
+	// Small levels of images that aren't RGBA won't have rows that line up to 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage2D(handle, level, 0, 0, glm::max(cache.Width >> level, 1u), glm::max(cache.Height >> level, 1u),
+		(GLenum)GetPixelFormatForChannels(cache.Channels), GL_UNSIGNED_BYTE, data);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
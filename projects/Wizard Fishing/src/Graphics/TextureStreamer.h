@@ -0,0 +1,232 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+class Texture2D;
+
+/// <summary>
+/// Streams the mip levels of file textures in as they are needed, so that a texture which only
+/// ever covers a few pixels never has to load or upload it's full size image
+///
+/// When a texture loads, only the levels no bigger than TAIL_SIZE are read, and the rest are
+/// hidden from the sampler with GL_TEXTURE_BASE_LEVEL. Every frame the draw lists record how
+/// much of the screen each texture's objects cover (see Texture2D::RequestScreenSize), and
+/// Update turns that into the level each texture wants. Missing levels are read from disk on a
+/// background thread, one level at a time from the coarsest up, and uploaded on the render
+/// thread. The streamed levels are kept under BudgetMB, by dropping the extra levels of the
+/// textures that have gone the longest without being drawn up close
+///
+/// The levels are read from a .mips file next to the image, which holds every level already
+/// filtered. It's written the first time an image is streamed, and again whenever the image changes.
+/// The full mip chain is still allocated up front, so the budget limits how much we read and
+/// upload rather than how much memory the driver reserves
+/// </summary>
+class TextureStreamer {
+public:
+	// Levels no bigger than this along either side are always loaded
+	static const uint32_t TAIL_SIZE = 64;
+	// How many frames a texture remembers the size it was last drawn at, so objects popping
+	// in and out of view don't keep dropping and re-loading their levels
+	static const int REQUEST_FRAMES = 120;
+	// The most levels we will be reading from disk at once
+	static const int MAX_LOADS_IN_FLIGHT = 4;
+
+	/// <summary>
+	/// When false, textures are loaded in full like any other texture. Only affects textures
+	/// that are loaded after it is changed
+	/// </summary>
+	static bool Enabled;
+
+	/// <summary>
+	/// Counters for the stats display
+	/// </summary>
+	struct Stats {
+		uint32_t Textures;
+		// Textures with every level loaded
+		uint32_t FullyResident;
+		// The size of the levels above the tails that are loaded, or being uploaded
+		uint64_t ResidentBytes;
+		// The size of the levels above the tails that the textures want this frame
+		uint64_t WantedBytes;
+		uint32_t LoadsInFlight;
+		uint32_t LevelsLoaded;
+		uint32_t LevelsEvicted;
+	};
+
+	TextureStreamer(const TextureStreamer& other) = delete;
+	TextureStreamer(TextureStreamer&& other) = delete;
+	TextureStreamer& operator =(const TextureStreamer& other) = delete;
+	TextureStreamer& operator =(TextureStreamer&& other) = delete;
+
+	virtual ~TextureStreamer();
+
+	/// <summary>
+	/// Gets the singleton instance of the texture streamer
+	/// </summary>
+	static TextureStreamer& Get();
+	/// <summary>
+	/// Stops the loading thread and releases the streamer. Textures that are still alive will
+	/// keep whatever levels they have loaded
+	/// </summary>
+	static void Uninitialize();
+
+	/// <summary>
+	/// The most memory the levels above the textures' tails may use, in megabytes
+	/// </summary>
+	int BudgetMB;
+	/// <summary>
+	/// Added to the level that each texture asks for, positive values trade sharpness for memory
+	/// </summary>
+	int LevelBias;
+
+	/// <summary>
+	/// Sets the height of the image the scene is rendered at, which screen sizes are measured against
+	/// </summary>
+	void SetViewportHeight(int height) { _viewportHeight = height; }
+
+	/// <summary>
+	/// Collects this frame's requests, hands any levels that have finished loading to the render
+	/// thread, and starts loading the levels that are needed next. Call from the main thread once
+	/// per frame, after the frame's draw lists have been built
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// Loads all of a texture's levels right away, for when the full image is about to be read
+	/// (ex: copied into an atlas). May be called from the main thread or the render thread
+	/// </summary>
+	/// <param name="texture">The texture to load, which must be streamed</param>
+	void MakeResident(Texture2D* texture);
+
+	/// <summary>
+	/// Gets our counters as of the last Update
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+	/// <summary>
+	/// Draws the ImGui controls for our settings, along with our stats
+	/// </summary>
+	void RenderImGui();
+
+	/// <summary>
+	/// Allocates a texture, and loads the tail of the image in it's description. Called by
+	/// Texture2D while it's loading, must be called with the GL context
+	/// </summary>
+	/// <param name="texture">The texture to load</param>
+	/// <returns>False if the image can't be streamed, and should be loaded in full instead</returns>
+	bool LoadTexture(Texture2D* texture);
+	/// <summary>
+	/// Forgets about a texture, called by Texture2D when it's destroyed. Safe to call from any
+	/// thread, even after the streamer is uninitialized
+	/// </summary>
+	static void RemoveTexture(Texture2D* texture);
+
+protected:
+	TextureStreamer();
+
+	// Where each level of an image is stored in it's .mips file
+	struct MipCache {
+		std::string         Path;
+		uint32_t            Width;
+		uint32_t            Height;
+		uint32_t            Channels;
+		int                 Levels;
+		std::vector<size_t> Offsets;
+		std::vector<size_t> Sizes;
+	};
+	// What we know about each streamed texture
+	struct Record {
+		uint32_t   Id;
+		Texture2D* Texture;
+		MipCache   Cache;
+		// The first level that is always loaded
+		int        TailLevel;
+		// The finest level we have loaded, and the texture's base level
+		int        ResidentLevel;
+		// The finest level that the texture needs for the size it was last drawn at
+		int        WantedLevel;
+		// The level being read from disk, or -1 if we aren't reading anything
+		int        LoadingLevel;
+		float      ScreenSize;
+		uint64_t   LastRequestFrame;
+		// Set if a read fails, so that we don't keep retrying it
+		bool       HasFailed;
+	};
+	// A level for the worker to read
+	struct LoadJob {
+		uint32_t    Id;
+		int         Level;
+		std::string Path;
+		size_t      Offset;
+		size_t      Size;
+	};
+	// A level that the worker has read
+	struct LoadResult {
+		uint32_t             Id;
+		int                  Level;
+		size_t               Size;
+		bool                 Success;
+		std::vector<uint8_t> Data;
+	};
+	// Work for the render thread, uploads a level (if there is any data) and then moves the base level
+	struct Upload {
+		uint32_t             Id;
+		int                  Level;
+		int                  BaseLevel;
+		std::vector<uint8_t> Data;
+	};
+
+	// Everything below is guarded by _lock
+	std::mutex                           _lock;
+	// Signalled when jobs are added, or when the worker should stop
+	std::condition_variable              _jobQueued;
+	std::unordered_map<uint32_t, Record> _records;
+	std::deque<LoadJob>                  _jobs;
+	std::vector<LoadResult>              _results;
+	std::vector<Upload>                  _uploads;
+	// Whether there is already a command on the render thread that will upload _uploads
+	bool                                 _isUploadQueued;
+	uint32_t                             _nextId;
+	uint64_t                             _residentBytes;
+	uint64_t                             _loadingBytes;
+	int                                  _loadsInFlight;
+	uint32_t                             _levelsLoaded;
+	uint32_t                             _levelsEvicted;
+	bool                                 _stopRequested;
+
+	// Only touched from the main thread
+	uint64_t                             _frame;
+	int                                  _viewportHeight;
+	Stats                                _stats;
+
+	std::thread                          _worker;
+
+	// Reads the levels from a file in the background, until we are destroyed
+	void _WorkerMain();
+	// Uploads everything in _uploads, must be called on the render thread
+	void _UploadPending();
+	// Picks the level that a texture wants for the size it was last drawn at
+	int _PickLevel(const Record& record) const;
+	// Drops the extra levels of the least recently needed textures, until the given number of
+	// bytes will fit under the budget. Returns false if they can't be made to fit
+	bool _MakeRoom(uint64_t bytes);
+	// Removes any uploads for a texture that haven't been sent to the render thread yet
+	void _CancelUploads(uint32_t id);
+
+	// Gets the size of the levels from the given level up to the tail
+	static uint64_t _GetBytesAbove(const Record& record, int level);
+	// Finds the .mips file for an image, writing it first if it's missing or out of date
+	static bool _OpenCache(const std::string& image, int channels, MipCache& cache);
+	// Reads the levels from first up to (but not including) last into data, in order
+	static bool _ReadLevels(const MipCache& cache, int first, int last, std::vector<uint8_t>& data);
+	// Uploads one level to a texture, must be called with the GL context
+	static void _UploadLevel(GLuint handle, const MipCache& cache, int level, const uint8_t* data);
+
+	inline static TextureStreamer* __Instance = nullptr;
+};
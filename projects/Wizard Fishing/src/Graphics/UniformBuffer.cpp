@@ -1,4 +1,5 @@
 #include "UniformBuffer.h"
+#include "GlStateCache.h"
 #include "Logging.h"
 
 AbstractUniformBuffer::~AbstractUniformBuffer() {
@@ -25,11 +26,11 @@ void AbstractUniformBuffer::LoadData(const void* data, size_t elementSize, size_
 }
 
 void AbstractUniformBuffer::Bind() const {
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, _handle);
+	GlStateCache::BindUniformBuffer(0, _handle);
 }
 
 void AbstractUniformBuffer::Bind(int slot) const
 {
-	glBindBufferBase(GL_UNIFORM_BUFFER, slot, _handle);
+	GlStateCache::BindUniformBuffer(slot, _handle);
 }
 
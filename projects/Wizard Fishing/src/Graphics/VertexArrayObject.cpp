@@ -1,6 +1,8 @@
 #include "VertexArrayObject.h"
 #include "IndexBuffer.h"
 #include "VertexBuffer.h"
+#include "GlStateCache.h"
+#include "GlDeleteList.h"
 #include "Logging.h"
 
 VertexArrayObject::VertexArrayObject() :
@@ -8,7 +10,8 @@ VertexArrayObject::VertexArrayObject() :
 	_handle(0),
 	_vertexCount(0),
 	_elementCount(0),
-	_vertexBuffers(std::vector<VertexBufferBinding>())
+	_vertexBuffers(std::vector<VertexBufferBinding>()),
+	_pooledMesh(nullptr)
 {
 	glCreateVertexArrays(1, &_handle);
 }
@@ -16,7 +19,7 @@ VertexArrayObject::VertexArrayObject() :
 VertexArrayObject::~VertexArrayObject()
 {
 	if (_handle != 0) {
-		glDeleteVertexArrays(1, &_handle);
+		GlDeleteList().VertexArray(_handle).DeleteLater();
 		_handle = 0;
 	}
 }
@@ -24,16 +27,15 @@ VertexArrayObject::~VertexArrayObject()
 void VertexArrayObject::SetIndexBuffer(const IndexBuffer::Sptr& ibo) {
 	// TODO: What if we already have a buffer? should we delete it? who owns the buffer?
 	_indexBuffer = ibo;
-	Bind();
+	// Attach via DSA so that we don't disturb whatever VAO is currently bound
 	if (_indexBuffer != nullptr) {
-		_indexBuffer->Bind();
+		glVertexArrayElementBuffer(_handle, _indexBuffer->GetHandle());
 		_elementCount = _indexBuffer->GetElementCount();
 	}
 	else {
-		IndexBuffer::Unbind();
+		glVertexArrayElementBuffer(_handle, 0);
 		_elementCount = _vertexCount;
 	}
-	Unbind();
 }
 
 void VertexArrayObject::AddVertexBuffer(const VertexBuffer::Sptr& buffer, const std::vector<BufferAttribute>& attributes) {
@@ -51,15 +53,14 @@ void VertexArrayObject::AddVertexBuffer(const VertexBuffer::Sptr& buffer, const
 	binding.Attributes = attributes;
 	_vertexBuffers.push_back(binding);
 
-
-	Bind();
-	buffer->Bind();
+	// Each attribute gets its own buffer binding point (matching its slot), which
+	// mirrors what glVertexAttribPointer does but without needing to bind the VAO
 	for (const BufferAttribute& attrib : attributes) {
 		glEnableVertexArrayAttrib(_handle, attrib.Slot);
-		glVertexAttribPointer(attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, attrib.Stride,
-							  (void*)attrib.Offset);
+		glVertexArrayVertexBuffer(_handle, attrib.Slot, buffer->GetHandle(), attrib.Offset, attrib.Stride);
+		glVertexArrayAttribFormat(_handle, attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, 0);
+		glVertexArrayAttribBinding(_handle, attrib.Slot, attrib.Slot);
 	}
-	Unbind();
 }
 
 void VertexArrayObject::Draw(DrawMode mode) {
@@ -69,15 +70,15 @@ void VertexArrayObject::Draw(DrawMode mode) {
 	} else {
 		glDrawElements((GLenum)mode, _elementCount, (GLenum)_indexBuffer->GetElementType(), nullptr);
 	}
-	Unbind();
+	// We leave the VAO bound, the state cache will skip the rebind if we draw it again
 }
 
 void VertexArrayObject::Bind() {
-	glBindVertexArray(_handle);
+	GlStateCache::BindVertexArray(_handle);
 }
 
 void VertexArrayObject::Unbind() {
-	glBindVertexArray(0);
+	GlStateCache::BindVertexArray(0);
 }
 
 void VertexArrayObject::SetVDecl(const VertexDeclaration& vDecl) {
@@ -8,6 +8,9 @@
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 
+// Defined in GeometryPool.h
+struct PooledMesh;
+
 /// <summary>
 /// We'll use this just to make it more clear what the intended usage of an attribute is in our code!
 /// </summary>
@@ -159,6 +162,10 @@ public:
 	/// <param name="usage">The attribute usage hint to search for</param>
 	/// <returns>A const pointer to the binding, or nullptr if none is found</returns>
 	const VertexBufferBinding* GetBufferBinding(AttribUsage usage);
+	/// <summary>
+	/// Gets all the vertex buffers that have been added to this VAO, along with their attributes
+	/// </summary>
+	const std::vector<VertexBufferBinding>& GetVertexBuffers() const { return _vertexBuffers; }
 
 	void Draw(DrawMode mode = DrawMode::TriangleList);
 
@@ -179,6 +186,16 @@ public:
 	void SetVDecl(const VertexDeclaration& vDecl);
 	const VertexDeclaration& GetVDecl();
 
+	/// <summary>
+	/// Records where a copy of this mesh lives in the geometry pool, so that it can be drawn
+	/// with vertex pulling instead of through this VAO
+	/// </summary>
+	void SetPooledMesh(const std::shared_ptr<PooledMesh>& mesh) { _pooledMesh = mesh; }
+	/// <summary>
+	/// Gets this mesh's place in the geometry pool, or nullptr if it was not added to the pool
+	/// </summary>
+	const std::shared_ptr<PooledMesh>& GetPooledMesh() const { return _pooledMesh; }
+
 protected:
 	
 	// The index buffer bound to this VAO
@@ -193,6 +210,8 @@ protected:
 	uint32_t _vertexCount;
 	uint32_t _elementCount;
 
+	std::shared_ptr<PooledMesh> _pooledMesh;
+
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
 };
@@ -15,11 +15,23 @@
 #include <GLM/glm.hpp>
 
 GLFWwindow* ImGuiHelper::_window = nullptr;
+bool ImGuiHelper::_isHeadless = false;
+bool ImGuiHelper::_isRenderThread = false;
 
-void ImGuiHelper::Init(GLFWwindow* window) {
+ImGuiHelper::DrawData::~DrawData() {
+	for (ImDrawList* list : Lists) {
+		IM_DELETE(list);
+	}
+	Lists.clear();
+	Data.Clear();
+}
+
+void ImGuiHelper::Init(GLFWwindow* window, bool headless, bool renderThread) {
 	LOG_ASSERT(_window == nullptr, "Init has already been called! Should only be called once per application");
 	// Store the window
 	_window = window;
+	_isHeadless = headless;
+	_isRenderThread = renderThread;
 
 	// Creates a new ImGUI context
 	ImGui::CreateContext();
@@ -29,14 +41,32 @@ void ImGuiHelper::Init(GLFWwindow* window) {
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 	// Allow docking to our window
 	io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-	// Allow multiple viewports (so we can drag ImGui off our window)
-	io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
-	// Allow our viewports to use transparent backbuffers
-	io.ConfigFlags |= ImGuiConfigFlags_TransparentBackbuffers;
 
-	// Set up the ImGui implementation for OpenGL
-	ImGui_ImplGlfw_InitForOpenGL(window, true);
-	ImGui_ImplOpenGL3_Init("#version 410");
+	if (headless) {
+		// Without the platform backends, we need to build the font atlas ourselves so
+		// that widgets can still be laid out
+		unsigned char* pixels = nullptr;
+		int width = 0, height = 0;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+		io.IniFilename = nullptr;
+	} else {
+		// Extra viewports are windows with their own contexts that need to be updated from the
+		// main thread, so we can only use them when we're rendering on the main thread
+		if (!renderThread) {
+			// Allow multiple viewports (so we can drag ImGui off our window)
+			io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+			// Allow our viewports to use transparent backbuffers
+			io.ConfigFlags |= ImGuiConfigFlags_TransparentBackbuffers;
+		}
+
+		// Set up the ImGui implementation for OpenGL
+		ImGui_ImplGlfw_InitForOpenGL(window, true);
+		ImGui_ImplOpenGL3_Init("#version 410");
+		if (renderThread) {
+			// This creates the font texture and shaders, so do it now while we still have the context
+			ImGui_ImplOpenGL3_NewFrame();
+		}
+	}
 
 	// Dark mode FTW
 	ImGui::StyleColorsDark();
@@ -53,8 +83,10 @@ void ImGuiHelper::Init(GLFWwindow* window) {
 void ImGuiHelper::Cleanup() {
 	if (_window != nullptr) {
 		// Cleanup the ImGui implementation
-		ImGui_ImplOpenGL3_Shutdown();
-		ImGui_ImplGlfw_Shutdown();
+		if (!_isHeadless) {
+			ImGui_ImplOpenGL3_Shutdown();
+			ImGui_ImplGlfw_Shutdown();
+		}
 		// Destroy our ImGui context
 		ImGui::DestroyContext();
 
@@ -78,13 +110,25 @@ void ImGuiHelper::StartFrame() {
 	LOG_ASSERT(_window != nullptr, "You must initialize ImGuiHelper before use!");
 
 	// Implementation new frame
-	ImGui_ImplOpenGL3_NewFrame();
-	ImGui_ImplGlfw_NewFrame();
+	if (_isHeadless) {
+		// The GLFW backend normally fills these in for us
+		ImGuiIO& io = ImGui::GetIO();
+		int width{ 0 }, height{ 0 };
+		glfwGetWindowSize(_window, &width, &height);
+		io.DisplaySize = ImVec2((float)glm::max(width, 1), (float)glm::max(height, 1));
+		io.DeltaTime = 1.0f / 60.0f;
+	} else {
+		// This only needs the GL context the first time, and Init already handled that if we're using a render thread
+		if (!_isRenderThread) {
+			ImGui_ImplOpenGL3_NewFrame();
+		}
+		ImGui_ImplGlfw_NewFrame();
+	}
 	// ImGui context new frame
 	ImGui::NewFrame();
 }
 
-void ImGuiHelper::EndFrame() {
+ImGuiHelper::DrawData::Sptr ImGuiHelper::EndFrame() {
 	LOG_ASSERT(_window != nullptr, "You must initialize ImGuiHelper before use!");
 
 	// Make sure ImGui knows how big our window is
@@ -95,9 +139,31 @@ void ImGuiHelper::EndFrame() {
 
 	// Render all of our ImGui elements
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	if (_isHeadless) {
+		return nullptr;
+	}
+
+	// The draw lists belong to ImGui and get reset on the next NewFrame, so we need our own copies
+	ImDrawData* source = ImGui::GetDrawData();
+	DrawData::Sptr result = std::make_shared<DrawData>();
+	result->Lists.reserve(source->CmdListsCount);
+	for (int ix = 0; ix < source->CmdListsCount; ix++) {
+		result->Lists.push_back(source->CmdLists[ix]->CloneOutput());
+	}
+	result->Data = *source;
+	result->Data.CmdLists = result->Lists.data();
+	result->Data.OwnerViewport = nullptr;
+	return result;
+}
+
+void ImGuiHelper::RenderDrawData(const DrawData::Sptr& data) {
+	if (data == nullptr) {
+		return;
+	}
+	ImGui_ImplOpenGL3_RenderDrawData(&data->Data);
 
 	// If we have multiple viewports enabled (can drag into a new window)
+	ImGuiIO& io = ImGui::GetIO();
 	if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
 		// Update the windows that ImGui is using
 		ImGui::UpdatePlatformWindows();
@@ -106,4 +172,3 @@ void ImGuiHelper::EndFrame() {
 		glfwMakeContextCurrent(_window);
 	}
 }
-
@@ -1,6 +1,8 @@
 #pragma once
 // Include ImGui so it will be visible when we include this file
 #include <imgui.h>
+#include <memory>
+#include <vector>
 
 // Will be included in the CPP to avoid header bloat
 struct GLFWwindow;
@@ -10,10 +12,30 @@ struct GLFWwindow;
 /// </summary>
 class ImGuiHelper {
 public:
+	/// <summary>
+	/// A copy of ImGui's draw data for a frame. ImGui re-uses it's draw lists every frame, so
+	/// this lets the render thread draw a frame while the main thread builds the next one
+	/// </summary>
+	struct DrawData {
+		typedef std::shared_ptr<DrawData> Sptr;
+
+		ImDrawData                Data;
+		std::vector<ImDrawList*>  Lists;
+
+		DrawData() = default;
+		~DrawData();
+
+		DrawData(const DrawData& other) = delete;
+		DrawData& operator=(const DrawData& other) = delete;
+	};
+
 	/// <summary>
 	/// Initializes the ImGui helper, should be called before doing any ImGui stuff
 	/// </summary>
-	static void Init(GLFWwindow* window);
+	/// <param name="window">The window that ImGui will draw into and take input from</param>
+	/// <param name="headless">If true, ImGui will still process widgets, but will never draw or read input</param>
+	/// <param name="renderThread">If true, ImGui will be drawn from a separate render thread, which disables multiple viewports</param>
+	static void Init(GLFWwindow* window, bool headless = false, bool renderThread = false);
 	/// <summary>
 	/// Cleans up the ImGui helper, should be called before closing the application
 	/// </summary>
@@ -34,15 +56,24 @@ public:
 	static void StartFrame();
 
 	/// <summary>
-	/// Notifies ImGui that a frame has ended and should be rendered
-	/// Call at end of render loop before glfwSwapBuffers
+	/// Notifies ImGui that a frame has ended, and copies out everything needed to render it
+	/// Call at end of the main loop, the result should be passed to RenderDrawData
+	/// </summary>
+	/// <returns>The draw data for this frame, or nullptr if running headless</returns>
+	static DrawData::Sptr EndFrame();
+	/// <summary>
+	/// Renders the draw data from a call to EndFrame, must be called on the thread that owns the GL context
+	/// Call before glfwSwapBuffers
 	/// </summary>
-	static void EndFrame();
+	/// <param name="data">The draw data to render, nothing is rendered if this is nullptr</param>
+	static void RenderDrawData(const DrawData::Sptr& data);
 
 protected:
 	ImGuiHelper() = default;
 
 	static GLFWwindow* _window;
+	static bool        _isHeadless;
+	static bool        _isRenderThread;
 };
 
 // Allows for an ImGui command to have a left aligned label instead of right aligned
@@ -0,0 +1,35 @@
+#include "InputEngine.h"
+#include <GLFW/glfw3.h>
+
+bool InputEngine::_isEnabled = true;
+
+void InputEngine::SetEnabled(bool enabled) {
+	_isEnabled = enabled;
+}
+
+bool InputEngine::IsEnabled() {
+	return _isEnabled;
+}
+
+int InputEngine::GetKey(GLFWwindow* window, int key) {
+	if (!_isEnabled || window == nullptr) {
+		return GLFW_RELEASE;
+	}
+	return glfwGetKey(window, key);
+}
+
+int InputEngine::GetMouseButton(GLFWwindow* window, int button) {
+	if (!_isEnabled || window == nullptr) {
+		return GLFW_RELEASE;
+	}
+	return glfwGetMouseButton(window, button);
+}
+
+void InputEngine::GetCursorPos(GLFWwindow* window, double* x, double* y) {
+	if (!_isEnabled || window == nullptr) {
+		if (x != nullptr) *x = 0.0;
+		if (y != nullptr) *y = 0.0;
+		return;
+	}
+	glfwGetCursorPos(window, x, y);
+}
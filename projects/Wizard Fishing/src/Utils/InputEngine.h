@@ -0,0 +1,50 @@
+#pragma once
+
+// Will be included in the CPP to avoid header bloat
+struct GLFWwindow;
+
+/// <summary>
+/// Thin wrapper around GLFW's input polling, which gameplay components should use
+/// instead of calling GLFW directly. This lets us switch input off entirely, for
+/// instance when running headless where there is no user to read input from
+/// </summary>
+class InputEngine {
+public:
+	/// <summary>
+	/// Enables or disables input polling. When disabled, every key and mouse button
+	/// reads as released, and the cursor stays at the origin
+	/// </summary>
+	static void SetEnabled(bool enabled);
+	/// <summary>
+	/// Gets whether input polling is currently enabled
+	/// </summary>
+	static bool IsEnabled();
+
+	/// <summary>
+	/// Gets the state of a key in the given window, as per glfwGetKey
+	/// </summary>
+	/// <param name="window">The window to poll</param>
+	/// <param name="key">The GLFW key code to check (ex: GLFW_KEY_W)</param>
+	/// <returns>GLFW_PRESS or GLFW_RELEASE</returns>
+	static int GetKey(GLFWwindow* window, int key);
+	/// <summary>
+	/// Gets the state of a mouse button in the given window, as per glfwGetMouseButton
+	/// </summary>
+	/// <param name="window">The window to poll</param>
+	/// <param name="button">The GLFW mouse button to check (ex: GLFW_MOUSE_BUTTON_LEFT)</param>
+	/// <returns>GLFW_PRESS or GLFW_RELEASE</returns>
+	static int GetMouseButton(GLFWwindow* window, int button);
+	/// <summary>
+	/// Gets the position of the cursor in the given window, as per glfwGetCursorPos
+	/// </summary>
+	/// <param name="window">The window to poll</param>
+	/// <param name="x">Will be filled with the cursor's x position</param>
+	/// <param name="y">Will be filled with the cursor's y position</param>
+	static void GetCursorPos(GLFWwindow* window, double* x, double* y);
+
+protected:
+	InputEngine() = default;
+	~InputEngine() = default;
+
+	static bool _isEnabled;
+};
@@ -0,0 +1,275 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Tuning values for the vertex scores, from Forsyth's paper
+static const int   SCORE_CACHE_SIZE    = 32;
+static const float CACHE_DECAY_POWER   = 1.5f;
+static const float LAST_TRI_SCORE      = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// Scores how much we want to use a vertex next, based on where it is in our cache and how
+// many triangles still need it (so we finish off vertices instead of leaving lone triangles)
+static float VertexScore(int cachePosition, uint32_t remainingTriangles) {
+	if (remainingTriangles == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The vertices of the last triangle get a fixed score, so we don't favour one of them
+		if (cachePosition < 3) {
+			score = LAST_TRI_SCORE;
+		} else {
+			score = std::pow(1.0f - (float)(cachePosition - 3) / (SCORE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+	}
+	score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+	return score;
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+	VertexCacheStats result = { 0.0f, 0.0f };
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return result;
+	}
+
+	// Rather than storing the FIFO, we stamp each vertex when it's added. A vertex is still cached
+	// if fewer than cacheSize vertices have been added after it
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+	for (uint32_t index : indices) {
+		if (timestamp - timestamps[index] > (uint32_t)cacheSize) {
+			timestamps[index] = timestamp++;
+			misses++;
+		}
+		if (!used[index]) {
+			used[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	result.Acmr = (float)misses / triangleCount;
+	result.Atvr = (float)misses / uniqueVertices;
+	return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	if (triangleCount == 0) {
+		return result;
+	}
+
+	// Build the list of triangles that use each vertex, as one big array. The first remaining[v]
+	// entries of a vertex's list are the triangles that haven't been added yet
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		remaining[indices[ix]]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		offsets[ix + 1] = offsets[ix] + remaining[ix];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		adjacency[fill[indices[ix]]++] = (uint32_t)(ix / 3);
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScores[ix] = VertexScore(-1, remaining[ix]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		triangleScores[ix] = vertexScores[indices[ix * 3]] + vertexScores[indices[ix * 3 + 1]] + vertexScores[indices[ix * 3 + 2]];
+	}
+	std::vector<bool> added(triangleCount, false);
+
+	// Our cache can hold 3 more vertices than the scores consider, for the ones that were just pushed out
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(SCORE_CACHE_SIZE + 3);
+	nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+	size_t scanPosition = 0;
+	int64_t bestTriangle = -1;
+	for (size_t count = 0; count < triangleCount; count++) {
+		// If nothing in the cache has triangles left, carry on with the next triangle in the original order
+		if (bestTriangle < 0) {
+			while (added[scanPosition]) {
+				scanPosition++;
+			}
+			bestTriangle = (int64_t)scanPosition;
+		}
+
+		uint32_t triangle = (uint32_t)bestTriangle;
+		const uint32_t* corners = &indices[triangle * 3];
+		added[triangle] = true;
+
+		nextCache.clear();
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = corners[corner];
+			result.push_back(vertex);
+			nextCache.push_back(vertex);
+
+			// Swap the triangle to the end of the vertex's list, and shrink the list past it
+			uint32_t* begin = &adjacency[offsets[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			uint32_t* it = std::find(begin, end, triangle);
+			std::swap(*it, *(end - 1));
+			remaining[vertex]--;
+		}
+		for (uint32_t vertex : cache) {
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+		cache.swap(nextCache);
+
+		// Re-score everything in the cache (including anything that just fell out), and pass the
+		// change on to their triangles
+		for (size_t ix = 0; ix < cache.size(); ix++) {
+			uint32_t vertex = cache[ix];
+			cachePositions[vertex] = ix < SCORE_CACHE_SIZE ? (int)ix : -1;
+			float score = VertexScore(cachePositions[vertex], remaining[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			for (uint32_t iy = offsets[vertex]; iy < offsets[vertex] + remaining[vertex]; iy++) {
+				triangleScores[adjacency[iy]] += delta;
+			}
+		}
+
+		// Only triangles touching the cache have changed, so the best one must be among them
+		bestTriangle = -1;
+		float bestScore = std::numeric_limits<float>::lowest();
+		cache.resize(glm::min(cache.size(), (size_t)SCORE_CACHE_SIZE));
+		for (uint32_t vertex : cache) {
+			for (uint32_t iy = offsets[vertex]; iy < offsets[vertex] + remaining[vertex]; iy++) {
+				uint32_t candidate = adjacency[iy];
+				if (triangleScores[candidate] > bestScore) {
+					bestScore = triangleScores[candidate];
+					bestTriangle = candidate;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, float threshold) {
+	size_t triangleCount = indices.size() / 3;
+	size_t vertexCount = positions.size();
+	if (triangleCount == 0) {
+		return indices;
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t timestamp = FIFO_CACHE_SIZE + 1;
+	auto countMisses = [&](size_t triangle) {
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t index = indices[triangle * 3 + corner];
+			if (timestamp - timestamps[index] > (uint32_t)FIFO_CACHE_SIZE) {
+				timestamps[index] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// Triangles that miss on every vertex start with a cold cache anyways, so moving the triangles
+	// between them around costs us nothing
+	std::vector<size_t> hardBoundaries;
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		if (countMisses(ix) == 3 || ix == 0) {
+			hardBoundaries.push_back(ix);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Big runs are split further, as soon as the run so far is almost as cache friendly as the
+	// whole mesh. Each split starts with a cold cache, since we don't know what will draw before it
+	float meshAcmr = AnalyzeVertexCache(indices, vertexCount).Acmr;
+	std::vector<size_t> clusterStarts;
+	for (size_t ix = 0; ix + 1 < hardBoundaries.size(); ix++) {
+		size_t end = hardBoundaries[ix + 1];
+		size_t clusterStart = hardBoundaries[ix];
+		int clusterMisses = 0;
+		clusterStarts.push_back(clusterStart);
+		timestamp += FIFO_CACHE_SIZE + 1;
+		for (size_t triangle = clusterStart; triangle < end; triangle++) {
+			clusterMisses += countMisses(triangle);
+			size_t clusterSize = triangle - clusterStart + 1;
+			if (triangle + 1 < end && clusterMisses <= threshold * meshAcmr * clusterSize) {
+				clusterStart = triangle + 1;
+				clusterMisses = 0;
+				clusterStarts.push_back(clusterStart);
+				timestamp += FIFO_CACHE_SIZE + 1;
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Find the area weighted center and normal of the mesh and each cluster
+	struct Cluster {
+		size_t    Start;
+		size_t    End;
+		glm::vec3 Center;
+		glm::vec3 Normal;
+		float     SortKey;
+	};
+	std::vector<Cluster> clusters(clusterStarts.size() - 1);
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t ix = 0; ix < clusters.size(); ix++) {
+		Cluster& cluster = clusters[ix];
+		cluster.Start = clusterStarts[ix];
+		cluster.End = clusterStarts[ix + 1];
+		cluster.Center = glm::vec3(0.0f);
+		cluster.Normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = cluster.Start; triangle < cluster.End; triangle++) {
+			const glm::vec3& p0 = positions[indices[triangle * 3]];
+			const glm::vec3& p1 = positions[indices[triangle * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[triangle * 3 + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(normal);
+			cluster.Center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			cluster.Normal += normal;
+			area += triangleArea;
+		}
+		meshCenter += cluster.Center;
+		meshArea += area;
+		cluster.Center = area > 0.0f ? cluster.Center / area : positions[indices[cluster.Start * 3]];
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+	// Clusters that are far out from the center and facing away from it are likely to cover the
+	// rest of the mesh, no matter which way it's viewed from
+	for (Cluster& cluster : clusters) {
+		float normalLength = glm::length(cluster.Normal);
+		cluster.SortKey = normalLength > 0.0f ? glm::dot(cluster.Center - meshCenter, cluster.Normal / normalLength) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.SortKey > b.SortKey;
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : clusters) {
+		result.insert(result.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+	}
+	return result;
+}
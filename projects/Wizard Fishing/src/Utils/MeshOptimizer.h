@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Utilities for reordering indexed meshes so they are cheaper for the GPU to draw, without
+/// changing how they look. Used at import time, the results are cached with the mesh
+///
+/// The passes should be run in order:
+///   - OptimizeVertexCache, so that triangles re-use recently transformed vertices (Forsyth's
+///     "Linear-Speed Vertex Cache Optimisation")
+///   - OptimizeOverdraw, which moves whole runs of triangles around so that outward facing parts
+///     of the mesh tend to draw first, without undoing much of the cache optimization
+///   - OptimizeVertexFetch, so that vertices are stored in the order they are first used
+/// </summary>
+class MeshOptimizer
+{
+public:
+	/// <summary>
+	/// Statistics from simulating a FIFO post-transform vertex cache
+	/// </summary>
+	struct VertexCacheStats {
+		// Average cache miss ratio, the number of vertices transformed per triangle (0.5 to 3)
+		float Acmr;
+		// Average transform to vertex ratio, the number of times each vertex is transformed (1 is ideal)
+		float Atvr;
+	};
+
+	// The size of the FIFO cache we simulate when measuring, and when looking for places to split the mesh
+	static const int FIFO_CACHE_SIZE = 16;
+	// How much worse (as a fraction of the mesh's ACMR) the overdraw pass may make a part of the mesh
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	/// <summary>
+	/// Measures how well an index buffer uses the post-transform vertex cache
+	/// </summary>
+	/// <param name="indices">The triangle list to measure</param>
+	/// <param name="vertexCount">The number of vertices that the indices refer to</param>
+	/// <param name="cacheSize">The number of vertices in the simulated FIFO cache</param>
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = FIFO_CACHE_SIZE);
+
+	/// <summary>
+	/// Reorders triangles so that they re-use vertices that are likely still in the vertex cache
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder</param>
+	/// <param name="vertexCount">The number of vertices that the indices refer to</param>
+	/// <returns>The same triangles in a new order</returns>
+	static std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Reorders clusters of triangles so that parts of the mesh facing away from it's center draw
+	/// first, which tends to be front to back from any direction. Clusters are split where the
+	/// cache would be cold anyways, so indices should already be optimized for the vertex cache
+	/// </summary>
+	/// <param name="positions">The position of each vertex in the mesh</param>
+	/// <param name="indices">The triangle list to reorder</param>
+	/// <param name="threshold">How much worse the ACMR of a cluster may get in exchange for a finer split</param>
+	/// <returns>The same triangles in a new order</returns>
+	static std::vector<uint32_t> OptimizeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, float threshold = OVERDRAW_THRESHOLD);
+
+	/// <summary>
+	/// Reorders vertices so they are stored in the order that they are first used, and removes
+	/// any unused vertices. All of the index lists share the vertex buffer (ex: a chain of LODs),
+	/// and are remapped to the new order
+	/// </summary>
+	/// <typeparam name="VertType">The type of vertex stored in the buffer</typeparam>
+	/// <param name="vertices">The vertices to reorder</param>
+	/// <param name="indexLists">The triangle lists using the vertices, the first list decides most of the order</param>
+	template <typename VertType>
+	static void OptimizeVertexFetch(std::vector<VertType>& vertices, std::vector<std::vector<uint32_t>>& indexLists) {
+		const uint32_t unused = ~0u;
+		std::vector<uint32_t> remap(vertices.size(), unused);
+		std::vector<VertType> result;
+		result.reserve(vertices.size());
+
+		for (auto& indices : indexLists) {
+			for (uint32_t& index : indices) {
+				if (remap[index] == unused) {
+					remap[index] = static_cast<uint32_t>(result.size());
+					result.push_back(vertices[index]);
+				}
+				index = remap[index];
+			}
+		}
+		vertices = std::move(result);
+	}
+
+protected:
+	MeshOptimizer() = default;
+	~MeshOptimizer() = default;
+};
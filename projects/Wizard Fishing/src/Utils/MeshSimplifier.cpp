@@ -0,0 +1,193 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <GLM/gtx/hash.hpp>
+
+// Represents a single candidate half-edge collapse, moving From onto To
+struct EdgeCollapse {
+	uint32_t From;
+	uint32_t To;
+	double   Cost;
+};
+
+// Returns a key for an undirected edge between two position IDs
+inline uint64_t EdgeKey(uint32_t a, uint32_t b) {
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, size_t targetIndexCount)
+{
+	std::vector<uint32_t> result = indices;
+	size_t vertexCount = positions.size();
+	if (targetIndexCount >= indices.size() || vertexCount == 0) {
+		return result;
+	}
+
+	// Vertices are split along UV and normal seams, so we need to find which vertices share a
+	// position to know how the surface is actually connected
+	std::vector<uint32_t> positionIds(vertexCount);
+	std::vector<uint32_t> wedgeCounts;
+	std::unordered_map<glm::vec3, uint32_t> positionLookup;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		auto it = positionLookup.find(positions[ix]);
+		if (it == positionLookup.end()) {
+			it = positionLookup.emplace(positions[ix], (uint32_t)wedgeCounts.size()).first;
+			wedgeCounts.push_back(0);
+		}
+		positionIds[ix] = it->second;
+		wedgeCounts[it->second]++;
+	}
+	size_t positionCount = wedgeCounts.size();
+
+	// Each position accumulates the area weighted plane quadrics of the triangles around it
+	std::vector<glm::dmat4> quadrics(positionCount, glm::dmat4(0.0));
+	std::unordered_map<uint64_t, int> edgeUses;
+	for (size_t ix = 0; ix + 2 < result.size(); ix += 3) {
+		glm::dvec3 p0 = positions[result[ix + 0]];
+		glm::dvec3 p1 = positions[result[ix + 1]];
+		glm::dvec3 p2 = positions[result[ix + 2]];
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(normal);
+		if (area > 0.0) {
+			normal /= area;
+			glm::dvec4 plane = glm::dvec4(normal, -glm::dot(normal, p0));
+			glm::dmat4 quadric = glm::outerProduct(plane, plane) * (area * 0.5);
+			for (int corner = 0; corner < 3; corner++) {
+				quadrics[positionIds[result[ix + corner]]] += quadric;
+			}
+		}
+		for (int corner = 0; corner < 3; corner++) {
+			edgeUses[EdgeKey(positionIds[result[ix + corner]], positionIds[result[ix + (corner + 1) % 3]])]++;
+		}
+	}
+
+	// Lock seam vertices and open borders, moving these would tear or shrink the mesh
+	std::vector<bool> locked(positionCount, false);
+	for (size_t ix = 0; ix < positionCount; ix++) {
+		locked[ix] = wedgeCounts[ix] > 1;
+	}
+	for (const auto& [key, uses] : edgeUses) {
+		if (uses == 1) {
+			locked[(uint32_t)(key >> 32)] = true;
+			locked[(uint32_t)(key & 0xFFFFFFFF)] = true;
+		}
+	}
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<EdgeCollapse> candidates;
+
+	size_t triCount = result.size() / 3;
+	size_t targetTriCount = targetIndexCount / 3;
+
+	// We work in passes, each pass collapses the cheapest set of edges that don't
+	// share any triangles, then rebuilds the triangle list
+	while (triCount > targetTriCount) {
+		// Build the vertex -> triangle adjacency for this pass
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result) {
+			adjacencyOffsets[index + 1]++;
+		}
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			adjacencyOffsets[ix + 1] += adjacencyOffsets[ix];
+		}
+		adjacency.resize(result.size());
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t ix = 0; ix < result.size(); ix++) {
+			adjacency[cursor[result[ix]]++] = (uint32_t)(ix / 3);
+		}
+
+		// Find the cost of moving every unlocked vertex onto each of its neighbours
+		candidates.clear();
+		for (size_t ix = 0; ix < result.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = result[ix + corner];
+				uint32_t b = result[ix + (corner + 1) % 3];
+				for (int dir = 0; dir < 2; dir++) {
+					uint32_t from = dir == 0 ? a : b;
+					uint32_t to = dir == 0 ? b : a;
+					if (locked[positionIds[from]]) continue;
+
+					glm::dmat4 quadric = quadrics[positionIds[from]] + quadrics[positionIds[to]];
+					glm::dvec4 target = glm::dvec4(glm::dvec3(positions[to]), 1.0);
+					candidates.push_back({ from, to, glm::dot(target, quadric * target) });
+				}
+			}
+		}
+		if (candidates.empty()) {
+			break;
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const EdgeCollapse& l, const EdgeCollapse& r) {
+			return l.Cost < r.Cost;
+		});
+
+		// Every collapse removes about 2 triangles, so don't overshoot our target
+		size_t collapseLimit = std::max((triCount - targetTriCount) / 2, (size_t)1);
+		size_t collapses = 0;
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			remap[ix] = (uint32_t)ix;
+			touched[ix] = false;
+		}
+
+		for (const EdgeCollapse& collapse : candidates) {
+			if (collapses >= collapseLimit) break;
+			if (touched[collapse.From] || touched[collapse.To]) continue;
+
+			// Make sure none of the triangles around the vertex will flip over
+			glm::vec3 newPos = positions[collapse.To];
+			bool flips = false;
+			for (uint32_t adj = adjacencyOffsets[collapse.From]; adj < adjacencyOffsets[collapse.From + 1] && !flips; adj++) {
+				const uint32_t* tri = &result[adjacency[adj] * 3];
+				if (tri[0] == collapse.To || tri[1] == collapse.To || tri[2] == collapse.To) {
+					continue; // This triangle collapses entirely
+				}
+				glm::vec3 oldCorners[3], newCorners[3];
+				for (int corner = 0; corner < 3; corner++) {
+					oldCorners[corner] = positions[tri[corner]];
+					newCorners[corner] = tri[corner] == collapse.From ? newPos : oldCorners[corner];
+				}
+				glm::vec3 oldNormal = glm::cross(oldCorners[1] - oldCorners[0], oldCorners[2] - oldCorners[0]);
+				glm::vec3 newNormal = glm::cross(newCorners[1] - newCorners[0], newCorners[2] - newCorners[0]);
+				// Also reject collapses that rotate a triangle too far, these tend to make slivers that flip later
+				flips = glm::dot(oldNormal, newNormal) <= 0.25f * glm::length(oldNormal) * glm::length(newNormal);
+			}
+			if (flips) continue;
+
+			remap[collapse.From] = collapse.To;
+			quadrics[positionIds[collapse.To]] += quadrics[positionIds[collapse.From]];
+
+			// Lock down the whole neighbourhood for the rest of this pass, so that
+			// our adjacency and flip checks stay valid
+			for (uint32_t adj = adjacencyOffsets[collapse.From]; adj < adjacencyOffsets[collapse.From + 1]; adj++) {
+				const uint32_t* tri = &result[adjacency[adj] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+			touched[collapse.To] = true;
+			collapses++;
+		}
+		if (collapses == 0) {
+			break;
+		}
+
+		// Apply the collapses, and remove any triangles that have become degenerate
+		size_t write = 0;
+		for (size_t ix = 0; ix < result.size(); ix += 3) {
+			uint32_t a = remap[result[ix + 0]];
+			uint32_t b = remap[result[ix + 1]];
+			uint32_t c = remap[result[ix + 2]];
+			if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[a] == positionIds[c]) {
+				continue;
+			}
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+		triCount = write / 3;
+	}
+
+	return result;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Utilities for reducing the triangle count of indexed meshes, used for generating
+/// level of detail (LOD) chains at import time
+///
+/// Simplification uses quadric error metrics (Garland & Heckbert) with half-edge collapses,
+/// meaning vertices are only ever merged into other existing vertices. This lets every LOD
+/// share the same vertex buffer, with only the index buffers differing between them
+/// </summary>
+class MeshSimplifier
+{
+public:
+	/// <summary>
+	/// Merges vertices that are exactly identical, producing an indexed mesh
+	/// </summary>
+	/// <typeparam name="VertType">The type of vertex, must not contain padding bytes</typeparam>
+	/// <param name="vertices">The non-indexed vertices to weld (ex: from the ObjLoader)</param>
+	/// <param name="outVertices">Will be filled with the unique vertices</param>
+	/// <param name="outIndices">Will be filled with the indices into outVertices</param>
+	template <typename VertType>
+	static void WeldVertices(const std::vector<VertType>& vertices, std::vector<VertType>& outVertices, std::vector<uint32_t>& outIndices) {
+		// Hash and compare vertices as raw bytes, so we don't require VertType to provide operators
+		struct VertexKey {
+			const VertType* Vertex;
+			bool operator ==(const VertexKey& other) const {
+				return memcmp(Vertex, other.Vertex, sizeof(VertType)) == 0;
+			}
+		};
+		struct VertexKeyHash {
+			size_t operator()(const VertexKey& key) const {
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(key.Vertex);
+				uint32_t hash = 2166136261u;
+				for (size_t ix = 0; ix < sizeof(VertType); ix++) {
+					hash = (hash ^ bytes[ix]) * 16777619u;
+				}
+				return hash;
+			}
+		};
+
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> lookup;
+		lookup.reserve(vertices.size());
+		outVertices.clear();
+		outVertices.reserve(vertices.size());
+		outIndices.clear();
+		outIndices.reserve(vertices.size());
+
+		for (const VertType& vertex : vertices) {
+			auto it = lookup.find(VertexKey{ &vertex });
+			if (it == lookup.end()) {
+				uint32_t index = static_cast<uint32_t>(outVertices.size());
+				outVertices.push_back(vertex);
+				lookup[VertexKey{ &vertex }] = index;
+				outIndices.push_back(index);
+			} else {
+				outIndices.push_back(it->second);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Simplifies an indexed triangle mesh until it has at most targetIndexCount indices,
+	/// or until no more edges can be collapsed without damaging the mesh
+	///
+	/// Vertices on UV/normal seams and open borders are never moved, so texture seams and
+	/// the silhouettes of open meshes are preserved
+	/// </summary>
+	/// <param name="positions">The position of each vertex in the mesh</param>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="targetIndexCount">The number of indices we want to end up with</param>
+	/// <returns>The simplified triangle list, indexing into the same vertices</returns>
+	static std::vector<uint32_t> Simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, size_t targetIndexCount);
+
+protected:
+	MeshSimplifier() = default;
+	~MeshSimplifier() = default;
+};
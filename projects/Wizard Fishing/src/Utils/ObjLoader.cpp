@@ -10,10 +10,37 @@
 #include "Utils/StringUtils.h"
 
 VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
+{
+	float startTime = glfwGetTime();
+
+	std::vector<VertexPosNormTexCol> vertexData;
+	if (!LoadVertices(filename, vertexData)) {
+		return nullptr;
+	}
+
+	// Create a vertex buffer and load all our vertex data
+	VertexBuffer::Sptr vertexBuffer = VertexBuffer::Create();
+	vertexBuffer->LoadData(vertexData.data(), vertexData.size());
+
+	// Create the VAO, and add the vertices
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	result->AddVertexBuffer(vertexBuffer, VertexPosNormTexCol::V_DECL);
+
+	result->SetVDecl(VertexPosNormTexCol::V_DECL);
+	
+	// Calculate and trace out how long it took us to load
+	float endTime = glfwGetTime();
+	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, vertexData.size(), 0);
+
+	return result;
+	//return VertexArrayObject::Create();
+}
+
+bool ObjLoader::LoadVertices(const std::string& filename, std::vector<VertexPosNormTexCol>& outVertices)
 {
 	if (!std::filesystem::exists(filename)) {
 		LOG_WARN("Failed to find OBJ file: \"{}\"", filename);
-		return nullptr;
+		return false;
 	}
 
 	// Open our file in binary mode
@@ -36,8 +63,6 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 	glm::vec3 vecData;
 	glm::ivec3 vertexIndices;
 
-	float startTime = glfwGetTime();
-
 	// Read and process the entire file
 	while (file.peek() != EOF) {
 		// Read in the first part of the line (ex: f, v, vn, etc...)
@@ -102,7 +127,9 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 	}
 
 	// TODO: Generate mesh from the data we loaded
-	std::vector<VertexPosNormTexCol> vertexData;
+	std::vector<VertexPosNormTexCol>& vertexData = outVertices;
+	vertexData.clear();
+	vertexData.reserve(vertices.size());
 
 	for (int ix = 0; ix < vertices.size(); ix++) {
 		glm::ivec3 attribs = vertices[ix];
@@ -117,20 +144,5 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename)
 		vertexData.push_back(VertexPosNormTexCol(position, normal, uv, color));
 	}
 
-	// Create a vertex buffer and load all our vertex data
-	VertexBuffer::Sptr vertexBuffer = VertexBuffer::Create();
-	vertexBuffer->LoadData(vertexData.data(), vertexData.size());
-
-	// Create the VAO, and add the vertices
-	VertexArrayObject::Sptr result = VertexArrayObject::Create();
-	result->AddVertexBuffer(vertexBuffer, VertexPosNormTexCol::V_DECL);
-
-	result->SetVDecl(VertexPosNormTexCol::V_DECL);
-	
-	// Calculate and trace out how long it took us to load
-	float endTime = glfwGetTime();
-	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, vertexData.size(), 0);
-
-	return result;
-	//return VertexArrayObject::Create();
+	return true;
 }
@@ -7,6 +7,14 @@ class ObjLoader
 {
 public:
 	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename);
+	/// <summary>
+	/// Loads the vertices from an OBJ file without uploading them to OpenGL, useful
+	/// if the mesh needs processing first. Note that the vertices are not indexed
+	/// </summary>
+	/// <param name="filename">The path to the OBJ file to load</param>
+	/// <param name="outVertices">The vector to store the loaded triangle list in</param>
+	/// <returns>True if the file was loaded, false if otherwise</returns>
+	static bool LoadVertices(const std::string& filename, std::vector<VertexPosNormTexCol>& outVertices);
 
 protected:
 	ObjLoader() = default;
@@ -60,6 +60,27 @@ public:
 		return std::dynamic_pointer_cast<T>(_resources[std::type_index(typeid(T))][id]);
 	}
 
+	/// <summary>
+	/// Gets all loaded resources of the given type
+	/// </summary>
+	/// <typeparam name="T">The type of resource to retreive</typeparam>
+	/// <returns>A list of every resource of type T, ordered by GUID</returns>
+	template<typename T, typename = std::enable_if<is_valid_resource<T>()>::type>
+	static std::vector<std::shared_ptr<T>> GetAll() {
+		std::vector<std::shared_ptr<T>> result;
+		auto it = _resources.find(std::type_index(typeid(T)));
+		if (it != _resources.end()) {
+			result.reserve(it->second.size());
+			for (auto& [id, resource] : it->second) {
+				std::shared_ptr<T> typed = std::dynamic_pointer_cast<T>(resource);
+				if (typed != nullptr) {
+					result.push_back(typed);
+				}
+			}
+		}
+		return result;
+	}
+
 	/// <summary>
 	/// Registers a resource type with the resource manager, only types that have been registered
 	/// can be loaded from JSON manifest files!
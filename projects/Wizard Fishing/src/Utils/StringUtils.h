@@ -2,12 +2,23 @@
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <cstdint>
 
 // Borrowed from https://stackoverflow.com/questions/216823/whats-the-best-way-to-trim-stdstring
 int constexpr const_strlen(const char* str) {
 	return *str ? 1 + const_strlen(str + 1) : 0;
 }
 
+// 32 bit FNV-1a hash, can be evaluated at compile time for string literals
+// See http://www.isthe.com/chongo/tech/comp/fnv/index.html
+uint32_t constexpr const_hash_fnv1a(const char* str) {
+	uint32_t hash = 2166136261u;
+	while (*str) {
+		hash = (hash ^ static_cast<uint8_t>(*str++)) * 16777619u;
+	}
+	return hash;
+}
+
 /// <summary>
 /// Provides helper functions for working with std::string
 /// </summary>
@@ -11,11 +11,13 @@
 #include <typeindex>
 #include <optional>
 #include <string>
+#include <random>
 
 // GLM math library
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/type_ptr.hpp>
+#include <GLM/gtc/constants.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <GLM/gtx/common.hpp> // for fmod (floating modulus) 
 
@@ -27,6 +29,17 @@
 #include "Graphics/Texture2D.h"
 #include "Graphics/TextureCube.h"
 #include "Graphics/VertexTypes.h"
+#include "Graphics/GlStateCache.h"
+#include "Graphics/Framebuffer.h"
+#include "Graphics/GpuProfiler.h"
+#include "Graphics/RenderThread.h"
+#include "Graphics/DynamicResolution.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Graphics/TextRenderer.h"
+#include "Graphics/RenderGraph.h"
+#include "Graphics/GeometryPool.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/FrameCapture.h"
 
 // Utilities
 #include "Utils/MeshBuilder.h"
@@ -38,11 +51,13 @@
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/StringUtils.h"
 #include "Utils/GlmDefines.h"
+#include "Utils/InputEngine.h"
 
 // Gameplay
 #include "Gameplay/Material.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
+#include "Gameplay/FramePacket.h"
 
 // Components
 #include "Gameplay/Components/IComponent.h"
@@ -62,6 +77,10 @@
 #include "Gameplay/Components/ManabarOutline.h"
 #include "Gameplay/Components/MinigameTargetL.h"
 #include "Gameplay/Components/MinigameTargetR.h"
+#include "Gameplay/Components/HudSprite.h"
+#include "Gameplay/Components/HudText.h"
+#include "Gameplay/DrawListBuilder.h"
+#include "Gameplay/Impostor.h"
 #include "Gameplay/Components/StaffBehaviour.h"
 #include "Gameplay/Components/MorphAnimator.h"
 #include "Gameplay/Components/MorphMeshRenderer.h"
@@ -118,6 +137,34 @@ glm::ivec2 windowSize = glm::ivec2(800, 800);
 // The title of our GLFW window
 std::string windowTitle = "Wizard Fishing";
 
+/// <summary>
+/// Settings for running without a visible window, used for automated performance
+/// runs on machines without a display. Filled in from the command line
+/// </summary>
+struct HeadlessSettings {
+	// True if we should render offscreen instead of to a visible window
+	bool        Enabled = false;
+	// The number of frames to render before exiting
+	int         FrameCount = 600;
+	// Save a PNG of every Nth frame, or 0 to disable captures
+	int         CaptureInterval = 0;
+	// The GLFW context creation API, OSMesa will work anywhere Mesa (ex: llvmpipe) is available
+	int         ContextApi = GLFW_OSMESA_CONTEXT_API;
+	// The saved scene to load, or empty to generate the default scene
+	std::string ScenePath = "";
+	// The folder that frame times and captures are written to
+	std::string OutputDir = "perf";
+};
+HeadlessSettings headless;
+// When true, all GL work happens on a separate render thread, so the next frame can be simulated while the last one draws
+bool useRenderThread = false;
+// The number of HUD labels to fill the screen with, for benchmarking the text renderer
+int textBenchCount = 0;
+// The number of extra objects to add to the scene, for benchmarking draw list building
+int drawBenchCount = 0;
+// The number of trees to scatter around the scene, for benchmarking impostors
+int forestBenchCount = 0;
+
 // using namespace should generally be avoided, and if used, make sure it's ONLY in cpp files
 using namespace Gameplay;
 using namespace Gameplay::Physics;
@@ -126,13 +173,92 @@ using namespace Gameplay::Physics;
 Scene::Sptr scene = nullptr;
 
 void GlfwWindowResizedCallback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	RenderThread::Enqueue([width, height]() { glViewport(0, 0, width, height); });
 	windowSize = glm::ivec2(width, height);
 	if (windowSize.x * windowSize.y > 0) {
 		scene->MainCamera->ResizeWindow(width, height);
 	}
 }
 
+/// <summary>
+/// Parses the command line arguments into our headless and threading settings
+///   --headless              Render offscreen instead of to a window
+///   --frames [count]        The number of frames to render in headless mode
+///   --capture-interval [n]  Save a PNG of every nth frame in headless mode
+///   --context [api]         The context API to use in headless mode (osmesa, egl or native)
+///   --scene [path]          A saved scene to load instead of generating the default scene
+///   --output [folder]       Where to write headless frame times and captures
+///   --size [width] [height] The size of the window or offscreen target
+///   --render-thread         Submit GL work from a dedicated render thread
+///   --text-bench [count]    Cover the screen in count HUD labels, to benchmark text rendering
+///   --draw-bench [count]    Add count copies of a scene object, to benchmark building draw lists
+///   --forest-bench [count]  Scatter count trees around the scene, to benchmark impostors
+///   --no-texture-streaming  Load every texture's full mip chain up front
+/// </summary>
+/// <returns>True if the arguments were valid, false if otherwise</returns>
+bool parseCommandLine(int argc, char** argv) {
+	for (int ix = 1; ix < argc; ix++) {
+		std::string arg = argv[ix];
+		// Helper to make sure an argument has enough values following it
+		auto hasValues = [&](int count) {
+			if (ix + count >= argc) {
+				LOG_ERROR("Missing value for command line argument {}", arg);
+				return false;
+			}
+			return true;
+		};
+
+		if (arg == "--headless") {
+			headless.Enabled = true;
+		} else if (arg == "--frames") {
+			if (!hasValues(1)) return false;
+			headless.FrameCount = std::max(std::atoi(argv[++ix]), 1);
+		} else if (arg == "--capture-interval") {
+			if (!hasValues(1)) return false;
+			headless.CaptureInterval = std::max(std::atoi(argv[++ix]), 0);
+		} else if (arg == "--context") {
+			if (!hasValues(1)) return false;
+			std::string api = argv[++ix];
+			if (api == "osmesa") {
+				headless.ContextApi = GLFW_OSMESA_CONTEXT_API;
+			} else if (api == "egl") {
+				headless.ContextApi = GLFW_EGL_CONTEXT_API;
+			} else if (api == "native") {
+				headless.ContextApi = GLFW_NATIVE_CONTEXT_API;
+			} else {
+				LOG_ERROR("Unknown context API \"{}\", expected osmesa, egl or native", api);
+				return false;
+			}
+		} else if (arg == "--scene") {
+			if (!hasValues(1)) return false;
+			headless.ScenePath = argv[++ix];
+		} else if (arg == "--output") {
+			if (!hasValues(1)) return false;
+			headless.OutputDir = argv[++ix];
+		} else if (arg == "--size") {
+			if (!hasValues(2)) return false;
+			windowSize.x = std::max(std::atoi(argv[++ix]), 1);
+			windowSize.y = std::max(std::atoi(argv[++ix]), 1);
+		} else if (arg == "--render-thread") {
+			useRenderThread = true;
+		} else if (arg == "--text-bench") {
+			if (!hasValues(1)) return false;
+			textBenchCount = std::max(std::atoi(argv[++ix]), 0);
+		} else if (arg == "--draw-bench") {
+			if (!hasValues(1)) return false;
+			drawBenchCount = std::max(std::atoi(argv[++ix]), 0);
+		} else if (arg == "--forest-bench") {
+			if (!hasValues(1)) return false;
+			forestBenchCount = std::max(std::atoi(argv[++ix]), 0);
+		} else if (arg == "--no-texture-streaming") {
+			TextureStreamer::Enabled = false;
+		} else {
+			LOG_WARN("Ignoring unknown command line argument {}", arg);
+		}
+	}
+	return true;
+}
+
 /// <summary>
 /// Handles intializing GLFW, should be called before initGLAD, but after Logger::Init()
 /// Also handles creating the GLFW window
@@ -145,8 +271,23 @@ bool initGLFW() {
 		return false;
 	}
 
+	if (headless.Enabled) {
+		// We still need a window for GLFW to hand us a context, but it's never shown, and we
+		// let the user pick a context API that doesn't need a display (OSMesa or EGL)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, headless.ContextApi);
+		// Software renderers only expose GL 4.5 through core profile contexts
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	}
+
 	//Create a new GLFW window and make it current
 	window = glfwCreateWindow(windowSize.x, windowSize.y, windowTitle.c_str(), nullptr, nullptr);
+	if (window == nullptr) {
+		LOG_ERROR("Failed to create GLFW window{}", headless.Enabled ? " (is the headless context API available?)" : "");
+		return false;
+	}
 	glfwMakeContextCurrent(window);
 	
 	// Set our window resized callback
@@ -188,13 +329,17 @@ bool DrawSaveLoadImGui(Scene::Sptr& scene, std::string& path) {
 	ImGui::SameLine();
 	// Load scene from file button
 	if (ImGui::Button("Load")) {
-		// Since it's a reference to a ptr, this will
-		// overwrite the existing scene!
-		scene = nullptr;
-
-		std::string newFilename = std::filesystem::path(path).stem().string() + "-manifest.json";
-		ResourceManager::LoadManifest(newFilename);
-		scene = Scene::Load(path);
+		// Loading creates all of our GPU resources, so it needs to happen with the GL context. The
+		// old scene is also released there, so it's destroyed on the same thread as it's last frame
+		RenderThread::Invoke([&]() {
+			// Since it's a reference to a ptr, this will
+			// overwrite the existing scene!
+			scene = nullptr;
+
+			std::string newFilename = std::filesystem::path(path).stem().string() + "-manifest.json";
+			ResourceManager::LoadManifest(newFilename);
+			scene = Scene::Load(path);
+		});
 
 		return true;
 	}
@@ -227,9 +372,12 @@ bool DrawLightImGui(const Scene::Sptr& scene, const char* title, int ix) {
 	return result;
 }
 
-int main() {
+int main(int argc, char** argv) {
 	Logger::Init(); // We'll borrow the logger from the toolkit, but we need to initialize it
 
+	if (!parseCommandLine(argc, argv))
+		return 1;
+
 	//Initialize GLFW
 	if (!initGLFW())
 		return 1;
@@ -244,7 +392,10 @@ int main() {
 	glDebugMessageCallback(GlDebugMessage, nullptr);
 
 	// Initialize our ImGui helper
-	ImGuiHelper::Init(window);
+	ImGuiHelper::Init(window, headless.Enabled, useRenderThread);
+
+	// There's nobody to give us input when running headless
+	InputEngine::SetEnabled(!headless.Enabled);
 
 	// Initialize our resource manager
 	ResourceManager::Init();
@@ -276,47 +427,44 @@ int main() {
 	ComponentManager::RegisterType<ManaBarOutline>();
 	ComponentManager::RegisterType<MinigameTargetL>();
 	ComponentManager::RegisterType<MinigameTargetR>();
+	ComponentManager::RegisterType<HudSprite>();
+	ComponentManager::RegisterType<HudText>();
 	ComponentManager::RegisterType<MorphAnimator>();
 	ComponentManager::RegisterType<MorphMeshRenderer>();
 	ComponentManager::RegisterType<StaffBehaviour>();
 
 	// GL states, we'll enable depth testing and backface fulling
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// These go through the state cache so it starts off knowing the real GL state
+	GlStateCache::SetDepthTestEnabled(true);
+	GlStateCache::SetDepthFunc(GL_LESS);
+	GlStateCache::SetDepthWriteEnabled(true);
+	GlStateCache::SetCullEnabled(true);
+	GlStateCache::SetCullFace(GL_BACK);
+	GlStateCache::SetBlendEnabled(true);
+	GlStateCache::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
-	bool loadScene = false;
+	bool loadScene = !headless.ScenePath.empty();
 	// For now we can use a toggle to generate our scene vs load from file
 	if (loadScene) {
-		ResourceManager::LoadManifest("manifest.json");
-		scene = Scene::Load("scene.json");
+		const std::string& scenePath = headless.ScenePath;
+		// Scenes saved from the editor store their manifest alongside them
+		std::string manifestPath = std::filesystem::path(scenePath).stem().string() + "-manifest.json";
+		ResourceManager::LoadManifest(std::filesystem::exists(manifestPath) ? manifestPath : "manifest.json");
+		scene = Scene::Load(scenePath);
 
 		// Call scene awake to start up all of our components
 		scene->Window = window;
 		scene->Awake();
 	} 
 	else {
-		// This time we'll have 2 different shaders, and share data between both of them using the UBO
-		// This shader will handle reflective materials
-		Shader::Sptr reflectiveShader = ResourceManager::CreateAsset<Shader>(std::unordered_map<ShaderPartType, std::string>{
-			{ ShaderPartType::Vertex, "shaders/vertex_shader.glsl" },  
-			{ ShaderPartType::Fragment, "shaders/frag_environment_reflective.glsl" }  
-		}); 
-
-		// This shader handles our basic materials without reflections (cause they expensive)
+		// All of our lit materials share this shader, and pick the features they need with keywords
+		// (MORPH for animated meshes, REFLECTIVE for environment reflections)
 		Shader::Sptr basicShader = ResourceManager::CreateAsset<Shader>(std::unordered_map<ShaderPartType, std::string>{
 			{ ShaderPartType::Vertex, "shaders/vertex_shader.glsl" },
 			{ ShaderPartType::Fragment, "shaders/frag_blinn_phong_textured.glsl" }
 		});
 
-		Shader::Sptr morphShader = ResourceManager::CreateAsset<Shader>(std::unordered_map<ShaderPartType, std::string>{
-			{ ShaderPartType::Vertex, "shaders/morph_shader.glsl" },
-			{ ShaderPartType::Fragment, "shaders/frag_blinn_phong_textured.glsl" }
-		});
-
 		MeshResource::Sptr bobberMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Bobber.obj");
 		Texture2D::Sptr	   bobberTex = ResourceManager::CreateAsset<Texture2D>("Textures/BobberTex.png");
 
@@ -335,16 +483,14 @@ int main() {
 		Texture2D::Sptr	   greenfishTex = ResourceManager::CreateAsset<Texture2D>("Textures/GreenFishTex.png");
 		Texture2D::Sptr	   purplefishTex = ResourceManager::CreateAsset<Texture2D>("Textures/PurpleFishTex.png");
 
-		MeshResource::Sptr grassMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Grass.obj");
+		MeshResource::Sptr grassMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Grass.obj", false, true);
 		Texture2D::Sptr    grassTexture = ResourceManager::CreateAsset<Texture2D>("Textures/GrassTex.png");
 
-		MeshResource::Sptr lakeBottomMesh = ResourceManager::CreateAsset<MeshResource>("Objects/LakeBottom.obj");
+		MeshResource::Sptr lakeBottomMesh = ResourceManager::CreateAsset<MeshResource>("Objects/LakeBottom.obj", false, true);
 		Texture2D::Sptr    lakeBottomTexture = ResourceManager::CreateAsset<Texture2D>("Textures/LakeBottomTex.png");
 
-		MeshResource::Sptr minigamePointerMesh = ResourceManager::CreateAsset<MeshResource>("Objects/MinigamePointer.obj");
 		Texture2D::Sptr    minigamePointerTex = ResourceManager::CreateAsset<Texture2D>("Textures/MinigamePointerTex.png");
 
-		MeshResource::Sptr minigameTargetMesh = ResourceManager::CreateAsset<MeshResource>("Objects/MinigameTarget.obj");
 		Texture2D::Sptr    minigameTargetTex = ResourceManager::CreateAsset<Texture2D>("Textures/MinigamePointerTargetTex.png");
 
 		MeshResource::Sptr monkeyMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Monkey.obj");
@@ -362,7 +508,7 @@ int main() {
 		MeshResource::Sptr tableLeg2Mesh = ResourceManager::CreateAsset<MeshResource>("Objects/TableLeg2.obj");
 		Texture2D::Sptr    tableLegTex = ResourceManager::CreateAsset<Texture2D>("Textures/TableLegTex.png");
 
-		MeshResource::Sptr tableTopMesh = ResourceManager::CreateAsset<MeshResource>("Objects/TableTop.obj");
+		MeshResource::Sptr tableTopMesh = ResourceManager::CreateAsset<MeshResource>("Objects/TableTop.obj", false, true);
 		Texture2D::Sptr    tableTopTex = ResourceManager::CreateAsset<Texture2D>("Textures/TableTopTex.png");
 
 		MeshResource::Sptr targetMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Target.obj");
@@ -377,17 +523,15 @@ int main() {
 		MeshResource::Sptr titleMesh = ResourceManager::CreateAsset<MeshResource>("Objects/TitleScreen.obj");
 		Texture2D::Sptr    titleTex = ResourceManager::CreateAsset<Texture2D>("Textures/WizardFishingTitleTex.png");
 
-		MeshResource::Sptr manaMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Mana.obj");
 		Texture2D::Sptr    manaTex = ResourceManager::CreateAsset<Texture2D>("Textures/ManaBarFillTex.png");
 
-		MeshResource::Sptr manaOutlineMesh = ResourceManager::CreateAsset<MeshResource>("Objects/ManaBar.obj");
 		Texture2D::Sptr    manaOutlineTex = ResourceManager::CreateAsset<Texture2D>("Textures/ManaBarOutlineTex.png");
 
 		MeshResource::Sptr fireMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Fire.obj");
 		Texture2D::Sptr    fireTex = ResourceManager::CreateAsset<Texture2D>("Textures/FireTex.png");
 
-		MeshResource::Sptr forestMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Forrest.obj");
-		MeshResource::Sptr forest2Mesh = ResourceManager::CreateAsset<MeshResource>("Objects/Forrest2.obj");
+		MeshResource::Sptr forestMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Forrest.obj", true, true);
+		MeshResource::Sptr forest2Mesh = ResourceManager::CreateAsset<MeshResource>("Objects/Forrest2.obj", true, true);
 		Texture2D::Sptr    treeTex = ResourceManager::CreateAsset<Texture2D>("Textures/TreeTex.png");
 		Texture2D::Sptr    tree2Tex = ResourceManager::CreateAsset<Texture2D>("Textures/Tree2Tex.png");
 
@@ -398,9 +542,9 @@ int main() {
 		MeshResource::Sptr wizardTowerDoorsMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerDoors.obj");
 		MeshResource::Sptr wizardTowerPortalMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerPortal.obj");
 		MeshResource::Sptr wizardTowerRoofMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerRoof.obj");
-		MeshResource::Sptr wizardTowerStoneMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerStone.obj");
+		MeshResource::Sptr wizardTowerStoneMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerStone.obj", true, true);
 		MeshResource::Sptr wizardTowerWindowsMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerWindows.obj");
-		MeshResource::Sptr wizardTowerWoodMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerWood.obj");
+		MeshResource::Sptr wizardTowerWoodMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerWood.obj", false, true);
 		MeshResource::Sptr wizardTowerLightStoneMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Wizard_TowerLightStone.obj");
 		MeshResource::Sptr boatMesh = ResourceManager::CreateAsset<MeshResource>("Objects/Boat.obj");
 		MeshResource::Sptr boat1Mesh = ResourceManager::CreateAsset<MeshResource>("Objects/Boat2.obj");
@@ -517,7 +661,8 @@ int main() {
 		Material::Sptr treeAnimMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			treeAnimMaterial->Name = "Tree";
-			treeAnimMaterial->MatShader = morphShader;
+			treeAnimMaterial->MatShader = basicShader;
+			treeAnimMaterial->Keywords = { "MORPH" };
 			treeAnimMaterial->Texture = treeTex;
 			treeAnimMaterial->Shininess = 2.0f;
 		}
@@ -530,22 +675,6 @@ int main() {
 			tree2Material->Shininess = 2.0f;
 		}
 
-		Material::Sptr manaMaterial = ResourceManager::CreateAsset<Material>();
-		{
-			manaMaterial->Name = "Mana bar";
-			manaMaterial->MatShader = basicShader;
-			manaMaterial->Texture = manaTex;
-			manaMaterial->Shininess = 2.0f;
-		}
-
-		Material::Sptr manaOutlineMaterial = ResourceManager::CreateAsset<Material>();
-		{
-			manaOutlineMaterial->Name = "Mana Outline";
-			manaOutlineMaterial->MatShader = basicShader;
-			manaOutlineMaterial->Texture = manaOutlineTex;
-			manaOutlineMaterial->Shininess = 2.0f;
-		}
-
 		Material::Sptr bridgeMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			bridgeMaterial->Name = "Bridge";
@@ -565,7 +694,8 @@ int main() {
 		Material::Sptr boatMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			boatMaterial->Name = "Boat";
-			boatMaterial->MatShader = morphShader;
+			boatMaterial->MatShader = basicShader;
+			boatMaterial->Keywords = { "MORPH" };
 			boatMaterial->Texture = dockTex;
 			boatMaterial->Shininess = 2.0f;
 		}
@@ -573,7 +703,8 @@ int main() {
 		Material::Sptr redfishMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			redfishMaterial->Name = "Red Fish";
-			redfishMaterial->MatShader = morphShader;
+			redfishMaterial->MatShader = basicShader;
+			redfishMaterial->Keywords = { "MORPH" };
 			redfishMaterial->Texture = redfishTex;
 			redfishMaterial->Shininess = 256.0f;
 		}
@@ -581,7 +712,8 @@ int main() {
 		Material::Sptr greenfishMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			greenfishMaterial->Name = "Green Fish";
-			greenfishMaterial->MatShader = morphShader;
+			greenfishMaterial->MatShader = basicShader;
+			greenfishMaterial->Keywords = { "MORPH" };
 			greenfishMaterial->Texture = greenfishTex;
 			greenfishMaterial->Shininess = 256.0f;
 		}
@@ -589,7 +721,8 @@ int main() {
 		Material::Sptr purplefishMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			purplefishMaterial->Name = "Purple Fish";
-			purplefishMaterial->MatShader = morphShader;
+			purplefishMaterial->MatShader = basicShader;
+			purplefishMaterial->Keywords = { "MORPH" };
 			purplefishMaterial->Texture = purplefishTex;
 			purplefishMaterial->Shininess = 256.0f;
 		}
@@ -610,22 +743,6 @@ int main() {
 			lakeBottomMaterial->Shininess = 256.0f;
 		}
 
-		Material::Sptr minigamePointerMaterial = ResourceManager::CreateAsset<Material>();
-		{
-			minigamePointerMaterial->Name = "Minigame Pointer";
-			minigamePointerMaterial->MatShader = basicShader;
-			minigamePointerMaterial->Texture = minigamePointerTex;
-			minigamePointerMaterial->Shininess = 256.0f;
-		}
-
-		Material::Sptr minigameTargetMaterial = ResourceManager::CreateAsset<Material>();
-		{
-			minigameTargetMaterial->Name = "Minigame Pointer";
-			minigameTargetMaterial->MatShader = basicShader;
-			minigameTargetMaterial->Texture = minigameTargetTex;
-			minigameTargetMaterial->Shininess = 256.0f;
-		}
-
 		Material::Sptr titleMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			titleMaterial->Name = "Title Screen";
@@ -645,7 +762,8 @@ int main() {
 		Material::Sptr staffMaterial = ResourceManager::CreateAsset<Material>();
 		{
 			staffMaterial->Name = "Staff";
-			staffMaterial->MatShader = morphShader;
+			staffMaterial->MatShader = basicShader;
+			staffMaterial->Keywords = { "MORPH" };
 			staffMaterial->Texture = staffTex;
 			staffMaterial->Shininess = 256.0f;
 		}
@@ -791,16 +909,18 @@ int main() {
 			staff->Get<MorphAnimator>()->SetFrames(frames);
 		}
 
+		// The mana bar and minigame are drawn on the HUD, with sizes in pixels on a 1080p screen.
+		// The UV rects cut the artwork out of the empty space around it in each texture
 		GameObject::Sptr manaOutline = scene->CreateGameObject("Mana Outline");
 		{
-			// Scale up the plane
-			manaOutline->SetScale(glm::vec3(0.05f));
-			manaOutline->SetRotation(glm::vec3(0, 0, 0));
-
-			// Create and attach a RenderComponent to the object to draw our mesh
-			RenderComponent::Sptr renderer = manaOutline->Add<RenderComponent>();
-			renderer->SetMesh(manaOutlineMesh);
-			renderer->SetMaterial(manaOutlineMaterial);
+			// Sits at the bottom middle of the screen
+			HudSprite::Sptr sprite = manaOutline->Add<HudSprite>();
+			sprite->Texture = manaOutlineTex;
+			sprite->UvRect = glm::vec4(0.0436f, 0.4779f, 0.9541f, 0.6526f);
+			sprite->Anchor = glm::vec2(0.5f, 1.0f);
+			sprite->Offset = glm::vec2(0.0f, -60.0f);
+			sprite->Pivot = glm::vec2(0.5f, 1.0f);
+			sprite->Size = glm::vec2(600.0f, 72.0f);
 
 			manaOutline->Add<ManaBarOutline>();
 			manaOutline->Get<ManaBarOutline>()->cameraCords = camera->Get<SimpleCameraControl>();
@@ -808,14 +928,14 @@ int main() {
 
 		GameObject::Sptr mana = scene->CreateGameObject("Mana");
 		{
-			// Scale up the plane
-			mana->SetScale(glm::vec3(0.05f));
-			mana->SetRotation(glm::vec3(0, 0, 0));
-
-			// Create and attach a RenderComponent to the object to draw our mesh
-			RenderComponent::Sptr renderer = mana->Add<RenderComponent>();
-			renderer->SetMesh(manaMesh);
-			renderer->SetMaterial(manaMaterial);
+			// Fills from the left edge, centered inside the outline
+			HudSprite::Sptr sprite = mana->Add<HudSprite>();
+			sprite->Texture = manaTex;
+			sprite->UvRect = glm::vec4(0.1227f, 0.7224f, 0.8062f, 0.7610f);
+			sprite->Anchor = glm::vec2(0.5f, 1.0f);
+			sprite->Offset = glm::vec2(-225.0f, -96.0f);
+			sprite->Pivot = glm::vec2(0.0f, 0.5f);
+			sprite->Size = glm::vec2(450.0f, 16.0f);
 
 			mana->Add<ManaBar>();
 			mana->Get<ManaBar>()->cameraCords = camera->Get<SimpleCameraControl>();
@@ -823,14 +943,14 @@ int main() {
 
 		GameObject::Sptr MinigamePointer = scene->CreateGameObject("Minigame Pointer");
 		{
-			// Scale up the plane
-			MinigamePointer->SetScale(glm::vec3(0.5F));
-			MinigamePointer->SetRotation(glm::vec3(90, 0, 0));
-
-			// Create and attach a RenderComponent to the object to draw our mesh
-			RenderComponent::Sptr renderer = MinigamePointer->Add<RenderComponent>();
-			renderer->SetMesh(minigamePointerMesh);
-			renderer->SetMaterial(minigamePointerMaterial);
+			// Points down at the track, Minigame slides it from side to side
+			HudSprite::Sptr sprite = MinigamePointer->Add<HudSprite>();
+			sprite->Texture = minigamePointerTex;
+			sprite->UvRect = glm::vec4(0.3544f, 0.5735f, 0.6330f, 0.9265f);
+			sprite->Anchor = glm::vec2(0.5f);
+			sprite->Pivot = glm::vec2(0.5f, 1.0f);
+			sprite->Size = glm::vec2(90.0f, 71.0f);
+			sprite->IsEnabled = false;
 
 			MinigamePointer->Add<Minigame>();
 			MinigamePointer->Get<Minigame>()->pause = book->Get<PauseBehaviour>();
@@ -849,6 +969,8 @@ int main() {
 			RenderComponent::Sptr renderer = lakeBottom->Add<RenderComponent>();
 			renderer->SetMesh(lakeBottomMesh);
 			renderer->SetMaterial(lakeBottomMaterial);
+			// The scenery never moves, so it can be merged into the scene's static batches
+			renderer->SetStatic(true);
 
 		}
 		// Set up all our sample objects
@@ -862,6 +984,9 @@ int main() {
 			RenderComponent::Sptr renderer = grass->Add<RenderComponent>();
 			renderer->SetMesh(grassMesh);
 			renderer->SetMaterial(grassMaterial);
+			renderer->SetStatic(true);
+			// The ground hides anything that is below it, or behind a hill
+			renderer->SetOccluder(grassMesh);
 
 			// Attach a plane collider that extends infinitely along the X/Y axis
 			RigidBody::Sptr physics = grass->Add<RigidBody>(/*static by default*/);
@@ -878,6 +1003,7 @@ int main() {
 			RenderComponent::Sptr renderer = bridge->Add<RenderComponent>();
 			renderer->SetMesh(bridgeMesh);
 			renderer->SetMaterial(bridgeMaterial);
+			renderer->SetStatic(true);
 
 		}
 
@@ -945,13 +1071,14 @@ int main() {
 
 		GameObject::Sptr PointerTargetL = scene->CreateGameObject("Pointer Target Left");
 		{
-			// Scale up the plane
-			PointerTargetL->SetScale(glm::vec3(0.5F));
-
-			// Create and attach a RenderComponent to the object to draw our mesh
-			RenderComponent::Sptr renderer = PointerTargetL->Add<RenderComponent>();
-			renderer->SetMesh(minigameTargetMesh);
-			renderer->SetMaterial(minigameTargetMaterial);
+			// Sits just left of the target zone, pointing in towards it
+			HudSprite::Sptr sprite = PointerTargetL->Add<HudSprite>();
+			sprite->Texture = minigameTargetTex;
+			sprite->UvRect = glm::vec4(0.3438f, 0.1162f, 0.8525f, 0.9316f);
+			sprite->Anchor = glm::vec2(0.5f);
+			sprite->Pivot = glm::vec2(1.0f, 0.0f);
+			sprite->Size = glm::vec2(40.0f, 64.0f);
+			sprite->IsEnabled = false;
 
 			PointerTargetL->Add<MinigameTargetL>();
 			PointerTargetL->Get<MinigameTargetL>()->pause = book->Get<PauseBehaviour>();
@@ -961,13 +1088,15 @@ int main() {
 
 		GameObject::Sptr PointerTargetR = scene->CreateGameObject("Pointer Target Right");
 		{
-			// Scale up the plane
-			PointerTargetR->SetScale(glm::vec3(0.5F));
-
-			// Create and attach a RenderComponent to the object to draw our mesh
-			RenderComponent::Sptr renderer = PointerTargetR->Add<RenderComponent>();
-			renderer->SetMesh(minigameTargetMesh);
-			renderer->SetMaterial(minigameTargetMaterial);
+			// Mirrors the left target
+			HudSprite::Sptr sprite = PointerTargetR->Add<HudSprite>();
+			sprite->Texture = minigameTargetTex;
+			sprite->UvRect = glm::vec4(0.3438f, 0.1162f, 0.8525f, 0.9316f);
+			sprite->Anchor = glm::vec2(0.5f);
+			sprite->Pivot = glm::vec2(0.0f, 0.0f);
+			sprite->Size = glm::vec2(40.0f, 64.0f);
+			sprite->FlipX = true;
+			sprite->IsEnabled = false;
 
 			PointerTargetR->Add<MinigameTargetR>();
 			PointerTargetR->Get<MinigameTargetR>()->pause = book->Get<PauseBehaviour>();
@@ -1000,6 +1129,7 @@ int main() {
 			RenderComponent::Sptr renderer = dock->Add<RenderComponent>();
 			renderer->SetMesh(dockMesh);
 			renderer->SetMaterial(dockMaterial);
+			renderer->SetStatic(true);
 
 		}
 
@@ -1012,6 +1142,8 @@ int main() {
 			RenderComponent::Sptr renderer = tabletop->Add<RenderComponent>();
 			renderer->SetMesh(tableTopMesh);
 			renderer->SetMaterial(tableTopMaterial);
+			renderer->SetStatic(true);
+			renderer->SetOccluder(tableTopMesh);
 		}
 
 		GameObject::Sptr tableleg1 = scene->CreateGameObject("Table Leg 1");
@@ -1023,6 +1155,7 @@ int main() {
 			RenderComponent::Sptr renderer = tableleg1->Add<RenderComponent>();
 			renderer->SetMesh(tableLeg1Mesh);
 			renderer->SetMaterial(tableLegMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr tableleg2 = scene->CreateGameObject("Table Leg 2");
@@ -1034,6 +1167,7 @@ int main() {
 			RenderComponent::Sptr renderer = tableleg2->Add<RenderComponent>();
 			renderer->SetMesh(tableLeg1Mesh);
 			renderer->SetMaterial(tableLegMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr tableleg3 = scene->CreateGameObject("Table Leg 3");
@@ -1045,6 +1179,7 @@ int main() {
 			RenderComponent::Sptr renderer = tableleg3->Add<RenderComponent>();
 			renderer->SetMesh(tableLeg1Mesh);
 			renderer->SetMaterial(tableLegMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr tableleg4 = scene->CreateGameObject("Table Leg 4");
@@ -1056,6 +1191,7 @@ int main() {
 			RenderComponent::Sptr renderer = tableleg4->Add<RenderComponent>();
 			renderer->SetMesh(tableLeg2Mesh);
 			renderer->SetMaterial(tableLegMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerDoors = scene->CreateGameObject("Wizard Tower Doors");
@@ -1067,6 +1203,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerDoors->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerDoorsMesh);
 			renderer->SetMaterial(doorMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerPortal = scene->CreateGameObject("Wizard Tower Portal");
@@ -1078,6 +1215,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerPortal->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerPortalMesh);
 			renderer->SetMaterial(portalMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerRoof = scene->CreateGameObject("Wizard Tower Roof");
@@ -1089,6 +1227,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerRoof->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerRoofMesh);
 			renderer->SetMaterial(roofMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerStone = scene->CreateGameObject("Wizard Tower Stone");
@@ -1100,6 +1239,9 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerStone->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerStoneMesh);
 			renderer->SetMaterial(stoneMaterial);
+			renderer->SetStatic(true);
+			// The stone walls are the bulk of the tower, so they stand in for the whole thing
+			renderer->SetOccluder(wizardTowerStoneMesh);
 		}
 
 		GameObject::Sptr wizardTowerLightStone = scene->CreateGameObject("Wizard Tower Light Stone");
@@ -1112,6 +1254,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerLightStone->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerLightStoneMesh);
 			renderer->SetMaterial(lightStoneMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerWindow = scene->CreateGameObject("Wizard Tower Widnow");
@@ -1123,6 +1266,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerWindow->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerWindowsMesh);
 			renderer->SetMaterial(windowMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr wizardTowerWood = scene->CreateGameObject("Wizard Tower Wood");
@@ -1134,6 +1278,7 @@ int main() {
 			RenderComponent::Sptr renderer = wizardTowerWood->Add<RenderComponent>();
 			renderer->SetMesh(wizardTowerWoodMesh);
 			renderer->SetMaterial(dockMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr Boat = scene->CreateGameObject("Boat");
@@ -1168,6 +1313,7 @@ int main() {
 			RenderComponent::Sptr renderer = fire->Add<RenderComponent>();
 			renderer->SetMesh(fireMesh);
 			renderer->SetMaterial(fireMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr forest1 = scene->CreateGameObject("forest1");
@@ -1180,6 +1326,7 @@ int main() {
 			RenderComponent::Sptr renderer = forest1->Add<RenderComponent>();
 			renderer->SetMesh(forestMesh);
 			renderer->SetMaterial(treeMaterial);
+			renderer->SetStatic(true);
 		}
 
 		GameObject::Sptr TreeAnim = scene->CreateGameObject("TreeAnim");
@@ -1213,6 +1360,7 @@ int main() {
 			RenderComponent::Sptr renderer = forest2->Add<RenderComponent>();
 			renderer->SetMesh(forest2Mesh);
 			renderer->SetMaterial(tree2Material);
+			renderer->SetStatic(true);
 		}
 		GameObject::Sptr title = scene->CreateGameObject("Title");
 		{
@@ -1224,6 +1372,7 @@ int main() {
 			RenderComponent::Sptr renderer = title->Add<RenderComponent>();
 			renderer->SetMesh(titleMesh);
 			renderer->SetMaterial(titleMaterial);
+			renderer->SetStatic(true);
 		}
 		// Call scene awake to start up all of our components
 		scene->Window = window;
@@ -1235,6 +1384,82 @@ int main() {
 		scene->Save("scene.json");
 	}
 
+	// Pack same-sized material textures into texture arrays, so switching materials doesn't need a texture bind
+	Material::BuildTextureArrays(ResourceManager::GetAll<Material>());
+
+	// Lay the benchmark labels out in a grid over the whole screen. These are added after the scene
+	// is saved, so they never end up in scene.json
+	if (textBenchCount > 0) {
+		int columns = (int)glm::ceil(glm::sqrt((float)textBenchCount));
+		int rows = (textBenchCount + columns - 1) / columns;
+		for (int ix = 0; ix < textBenchCount; ix++) {
+			GameObject::Sptr label = scene->CreateGameObject("Text Bench " + std::to_string(ix));
+			HudText::Sptr text = label->Add<HudText>();
+			text->Text = "Label " + std::to_string(ix);
+			text->FontSize = 16.0f;
+			text->Anchor = glm::vec2((ix % columns + 0.5f) / columns, (ix / columns + 0.5f) / rows);
+			text->Color = glm::vec4(glm::vec3((ix % 7) / 6.0f, 1.0f, 1.0f - (ix % 5) / 4.0f), 1.0f);
+		}
+		LOG_INFO("Added {} text benchmark labels", textBenchCount);
+	}
+
+	// Copy the first mesh we can find into a big grid around the origin. These are small and
+	// spread out, so most of the cost is the per-object work rather than the GPU
+	if (drawBenchCount > 0) {
+		RenderComponent::Sptr source = nullptr;
+		ComponentManager::Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+			if (source == nullptr && renderable->GetMeshResource() != nullptr && renderable->GetMaterial() != nullptr) {
+				source = renderable;
+			}
+		});
+		if (source != nullptr) {
+			int side = (int)glm::ceil(glm::sqrt((float)drawBenchCount));
+			for (int ix = 0; ix < drawBenchCount; ix++) {
+				GameObject::Sptr object = scene->CreateGameObject("Draw Bench " + std::to_string(ix));
+				object->SetPostion(glm::vec3((ix % side - side / 2) * 2.0f, (ix / side - side / 2) * 2.0f, -5.0f));
+				object->SetScale(glm::vec3(0.25f));
+				RenderComponent::Sptr renderer = object->Add<RenderComponent>();
+				renderer->SetMesh(source->GetMeshResource());
+				renderer->SetMaterial(source->GetMaterial());
+			}
+			LOG_INFO("Added {} draw list benchmark objects", drawBenchCount);
+		} else {
+			LOG_WARN("The scene has no meshes to copy for --draw-bench");
+		}
+	}
+
+	// Scatter trees in a ring around the lake, with a fixed seed so every run sees the same forest.
+	// Only the nearest few are close enough to draw their mesh, the rest draw their impostors
+	if (forestBenchCount > 0) {
+		GameObject::Sptr treeSource = scene->FindObjectByName("TreeAnim");
+		GameObject::Sptr materialSource = scene->FindObjectByName("forest1");
+		// The animated tree's material expects morph targets, so we borrow the static forest's
+		RenderComponent::Sptr treeRenderer = treeSource != nullptr ? treeSource->Get<RenderComponent>() : nullptr;
+		RenderComponent::Sptr materialRenderer = materialSource != nullptr ? materialSource->Get<RenderComponent>() : nullptr;
+		if (treeRenderer != nullptr && treeRenderer->GetMeshResource() != nullptr && materialRenderer != nullptr) {
+			std::mt19937 random(1234);
+			std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+			std::uniform_real_distribution<float> radius(25.0f, 80.0f);
+			std::uniform_real_distribution<float> yaw(0.0f, 360.0f);
+			std::uniform_real_distribution<float> scale(0.8f, 1.2f);
+			for (int ix = 0; ix < forestBenchCount; ix++) {
+				float theta = angle(random);
+				float distance = radius(random);
+				GameObject::Sptr object = scene->CreateGameObject("Forest Bench " + std::to_string(ix));
+				object->SetPostion(glm::vec3(glm::cos(theta) * distance, glm::sin(theta) * distance, -0.6f));
+				object->SetRotation(glm::vec3(0.0f, 0.0f, yaw(random)));
+				object->SetScale(glm::vec3(0.5f * scale(random)));
+				RenderComponent::Sptr renderer = object->Add<RenderComponent>();
+				renderer->SetMesh(treeRenderer->GetMeshResource());
+				renderer->SetMaterial(materialRenderer->GetMaterial());
+				renderer->SetUseImpostor(true);
+			}
+			LOG_INFO("Added {} forest benchmark trees", forestBenchCount);
+		} else {
+			LOG_WARN("The scene has no trees to copy for --forest-bench");
+		}
+	}
+
 
 	// We'll use this to allow editing the save/load path
 	// via ImGui, note the reserve to allocate extra space
@@ -1248,20 +1473,62 @@ int main() {
 	// Our high-precision timer
 	double lastFrame = glfwGetTime();
 
+	// Used to benchmark the renderer, ex: comparing the scene with and without mesh LODs
+	int renderedTriangles = 0;
+	float averageFrameTime = 0.0f;
+
 
 	BulletDebugMode physicsDebugMode = BulletDebugMode::None;
 	float playbackSpeed = 1.0f;
 
 	nlohmann::json editorSceneState;
 
+	// When headless, we render into an offscreen target and record how long each frame takes
+	Framebuffer::Sptr headlessTarget = nullptr;
+	std::vector<double> headlessFrameTimes;
+	if (headless.Enabled) {
+		headlessTarget = Framebuffer::Create(windowSize.x, windowSize.y);
+		headlessFrameTimes.reserve(headless.FrameCount);
+		std::filesystem::create_directories(headless.OutputDir);
+		scene->MainCamera->ResizeWindow(windowSize.x, windowSize.y);
+		LOG_INFO("Running headless for {} frames at {}x{}", headless.FrameCount, windowSize.x, windowSize.y);
+	}
+
+	// The scene is rendered offscreen at a resolution that keeps the GPU within budget, then scaled up to the window
+	DynamicResolution::Sptr dynamicResolution = DynamicResolution::Create();
+	Upscaler::Sptr upscaler = Upscaler::Create();
+	// Objects hidden behind the scene's occluders are dropped before they reach the render thread
+	OcclusionCuller::Sptr occlusionCuller = OcclusionCuller::Create();
+	// The per-object part of building each frame's draw calls is spread over worker threads
+	DrawListBuilder::Sptr drawListBuilder = DrawListBuilder::Create();
+	// Each frame is declared as a set of passes, the graph owns the offscreen targets between them
+	RenderGraph::Sptr renderGraph = RenderGraph::Create();
+	// Screenshots, recordings and headless captures are read back and written without stalling the render thread
+	FrameCapture::Sptr frameCapture = FrameCapture::Create();
+	// Headless captures are compared between runs, so they are never dropped
+	frameCapture->BlockWhenFull = headless.Enabled;
+
+	// From here on, the GL context belongs to the render thread. Anything that needs it goes
+	// through RenderThread::Enqueue or Invoke, which run right away if there's no render thread
+	if (useRenderThread) {
+		RenderThread::Start(window);
+	}
+	// Frame times are written by the render thread, so we count the frames we've sent it instead
+	int submittedFrames = 0;
+
 	///// Game loop /////
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && (!headless.Enabled || submittedFrames < headless.FrameCount)) {
 		glfwPollEvents();
 		ImGuiHelper::StartFrame();
 
 		// Calculate the time since our last frame (dt)
 		double thisFrame = glfwGetTime();
 		float dt = static_cast<float>(thisFrame - lastFrame);
+		averageFrameTime = glm::mix(averageFrameTime, dt, 0.05f);
+		// Use a fixed timestep when headless, so every run simulates the same frames
+		if (headless.Enabled) {
+			dt = 1.0f / 60.0f;
+		}
 
 		// Showcasing how to use the imGui library!
 		bool isDebugWindowOpen = ImGui::Begin("Debugging");
@@ -1280,9 +1547,11 @@ int main() {
 
 				// If we've gone from playing to not playing, restore the state from before we started playing
 				if (!scene->IsPlaying) {
-					scene = nullptr;
-					// We reload to scene from our cached state
-					scene = Scene::FromJson(editorSceneState);
+					// We reload to scene from our cached state, this creates GPU resources so needs the GL context
+					RenderThread::Invoke([&]() {
+						scene = nullptr;
+						scene = Scene::FromJson(editorSceneState);
+					});
 					// Don't forget to reset the scene's window and wake all the objects!
 					scene->Window = window;
 					scene->Awake();
@@ -1300,6 +1569,9 @@ int main() {
 				// up all our components
 				scene->Window = window;
 				scene->Awake();
+
+				// The manifest will have given us new materials, so they need to be packed again
+				RenderThread::Invoke([]() { Material::BuildTextureArrays(ResourceManager::GetAll<Material>()); });
 			}
 			ImGui::Separator();
 			// Draw a dropdown to select our physics debug draw mode
@@ -1308,13 +1580,31 @@ int main() {
 			}
 			LABEL_LEFT(ImGui::SliderFloat, "Playback Speed:    ", &playbackSpeed, 0.0f, 10.0f);
 			ImGui::Separator();
+			ImGui::Checkbox("Use Mesh LODs", &RenderComponent::LodsEnabled);
+			ImGui::Checkbox("Use Texture Arrays", &Material::TextureArraysEnabled);
+			ImGui::Checkbox("Use Vertex Pulling", &GeometryPool::Enabled);
+			ImGui::Checkbox("Use Impostors", &Impostor::Enabled);
+			LABEL_LEFT(ImGui::SliderFloat, "Impostor Distance: ", &Impostor::SwitchDistance, 5.0f, 100.0f);
+			dynamicResolution->RenderImGui();
+			occlusionCuller->RenderImGui();
+			scene->GetStaticBatcher()->RenderImGui();
+			scene->GetGpuCuller()->RenderImGui();
+			drawListBuilder->RenderImGui();
+			renderGraph->RenderImGui();
+			frameCapture->RenderImGui();
+			ImGui::Text("Triangles:  %d", renderedTriangles);
+			const TextRenderer::Stats& textStats = TextRenderer::Get().GetStats();
+			ImGui::Text("Text:       %d glyphs in %d draws (%d/%d labels rebuilt)", (int)textStats.Glyphs, (int)textStats.DrawCalls, (int)textStats.RebuiltRuns, (int)textStats.Runs);
+			GeometryPool::Stats poolStats = GeometryPool::Get().GetStats();
+			ImGui::Text("Geometry:   %d meshes, %d/%d vertices, %d/%d indices (%d free blocks)", (int)poolStats.Meshes,
+				(int)poolStats.UsedVertices, (int)GeometryPool::VERTEX_CAPACITY, (int)poolStats.UsedIndices, (int)GeometryPool::INDEX_CAPACITY, (int)poolStats.FreeBlocks);
+			TextureStreamer::Get().RenderImGui();
+			Shader::VariantStats variantStats = Shader::GetVariantStats();
+			ImGui::Text("Shaders:    %d variants compiled, %d loaded from cache", variantStats.Compiled, variantStats.LoadedFromCache);
+			ImGui::Text("Frame Time: %.2f ms (avg %.2f ms)", dt * 1000.0f, averageFrameTime * 1000.0f);
+			ImGui::Separator();
 		}
 
-		// Clear the color and depth buffers
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// Update our application level uniforms every frame
-
 		// Draw some ImGui stuff for the lights
 		if (isDebugWindowOpen) {
 			for (int ix = 0; ix < scene->Lights.size(); ix++) {
@@ -1346,12 +1636,19 @@ int main() {
 		// Perform updates for all components
 		scene->Update(dt);
 
-		// Grab shorthands to the camera and shader from the scene
-		Camera::Sptr camera = scene->MainCamera;
+		// Pick this frame's resolution from how long the GPU has been taking
+		dynamicResolution->Update();
+		glm::ivec2 outputSize = windowSize;
+		glm::ivec2 renderSize = dynamicResolution->GetRenderSize(outputSize);
+		// A minimized window has no size, so there's nothing to scale to
+		bool useUpscaler = dynamicResolution->Enabled && outputSize.x > 0 && outputSize.y > 0;
+		float sharpness = dynamicResolution->Sharpness;
+
+		// Assign lights to the camera's clusters now that everything has moved
+		scene->UpdateLightClusters(useUpscaler ? renderSize : outputSize);
 
 		// Cache the camera's viewprojection
-		glm::mat4 viewProj = camera->GetViewProjection();
-		DebugDrawer::Get().SetViewProjection(viewProj);
+		DebugDrawer::Get().SetViewProjection(scene->MainCamera->GetViewProjection());
 
 		// Update our worlds physics!
 		scene->DoPhysics(dt);
@@ -1360,78 +1657,158 @@ int main() {
 		if (isDebugWindowOpen) {
 			scene->DrawAllGameObjectGUIs();
 		}
-		
-		// The current material that is bound for rendering
-		Material::Sptr currentMat = nullptr;
-		Shader::Sptr shader = nullptr;
 
-		TextureCube::Sptr environment = scene->GetSkyboxTexture();
-		if (environment) environment->Bind(0); 
+		// Grab everything the render thread needs to draw this frame, from here on the main
+		// thread can change the scene without affecting what gets drawn
+		TextureStreamer::Get().SetViewportHeight(useUpscaler ? renderSize.y : outputSize.y);
+		FramePacket::Sptr packet = FramePacket::Build(scene, *drawListBuilder, occlusionCuller);
+		renderedTriangles = packet->TriangleCount;
 
-		// Render all our objects
-		ComponentManager::Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
-			// Early bail if mesh not set
-			if (renderable->GetMesh() == nullptr) { 
-				return;
-			}
+		// The packet has recorded how big each texture is on screen, so we can stream in what it needs
+		TextureStreamer::Get().Update();
 
-			// If we don't have a material, try getting the scene's fallback material
-			// If none exists, do not draw anything
-			if (renderable->GetMaterial() == nullptr) {
-				if (scene->DefaultMaterial != nullptr) {
-					renderable->SetMaterial(scene->DefaultMaterial);
-				} else {
-					return;
-				}
-			}
+		// End our ImGui window
+		ImGui::End();
 
-			// If the material has changed, we need to bind the new shader and set up our material and frame data
-			// Note: This is a good reason why we should be sorting the render components in ComponentManager
-			if (renderable->GetMaterial() != currentMat) {
-				currentMat = renderable->GetMaterial();
-				shader = currentMat->MatShader;
+		// Show how long the GPU spent on each part of the frame
+		GpuProfiler::RenderImGui();
 
-				shader->Bind();
-				shader->SetUniform("u_CamPos", scene->MainCamera->GetGameObject()->GetPosition());
-				currentMat->Apply();
+		lastFrame = thisFrame;
+		ImGuiHelper::DrawData::Sptr imguiData = ImGuiHelper::EndFrame();
+
+		// Work out if this frame is being saved, headless runs capture on a fixed interval
+		std::string capturePath;
+		FrameCapture::Format captureFormat = FrameCapture::Format::Png;
+		if (headless.Enabled) {
+			if (headless.CaptureInterval > 0 && submittedFrames % headless.CaptureInterval == 0) {
+				capturePath = headless.OutputDir + "/frame_" + std::to_string(submittedFrames) + ".png";
+			}
+		} else {
+			frameCapture->TakeFrameRequest(capturePath, captureFormat);
+		}
+
+		// This waits for the render thread if it's still busy with the last frame
+		RenderThread::SubmitFrame([=, &headlessTarget, &headlessFrameTimes]() {
+			GpuProfiler::BeginFrame();
+
+			renderGraph->Reset();
+			GLuint outputFramebuffer = headlessTarget != nullptr ? headlessTarget->GetHandle() : 0;
+			RenderGraph::ResourceHandle output = renderGraph->ImportFramebuffer("Output", outputFramebuffer, outputSize);
+
+			if (useUpscaler) {
+				// The scene targets are allocated at the output size, and the scene only renders into
+				// the bottom left corner of them, so the graph doesn't re-compile as the scale changes
+				RenderGraph::ResourceHandle sceneColor = renderGraph->CreateTexture("Scene Color", { outputSize, GL_RGBA8 });
+				RenderGraph::ResourceHandle sceneDepth = renderGraph->CreateTexture("Scene Depth", { outputSize, GL_DEPTH24_STENCIL8 });
+				renderGraph->AddPass("Scene", [packet](const RenderGraph::PassContext&) {
+					packet->Render();
+				})
+					.WriteColor(sceneColor, RenderGraph::LoadOp::Discard)
+					.WriteDepth(sceneDepth, RenderGraph::LoadOp::Discard)
+					.SetViewport(renderSize);
+
+				renderGraph->AddPass("Upscale", [=](const RenderGraph::PassContext& context) {
+					GpuProfiler::BeginScope("Upscale");
+					upscaler->Resolve(context.GetTexture(sceneColor), context.GetSize(sceneColor), renderSize, sharpness);
+					GpuProfiler::EndScope();
+				})
+					.ReadTexture(sceneColor)
+					.WriteColor(output, RenderGraph::LoadOp::Discard);
+			} else {
+				renderGraph->AddPass("Scene", [packet](const RenderGraph::PassContext&) {
+					packet->Render();
+				})
+					.WriteColor(output, RenderGraph::LoadOp::Discard);
 			}
 
-			// Grab the game object so we can do some stuff with it
-			GameObject* object = renderable->GetGameObject();
-
-			// Set vertex shader parameters
-			shader->SetUniformMatrix("u_ModelViewProjection", viewProj * object->GetTransform());
-			shader->SetUniformMatrix("u_Model", object->GetTransform());
-			shader->SetUniformMatrix("u_NormalMatrix", glm::mat3(glm::transpose(glm::inverse(object->GetTransform()))));
-
-			if (object->Has<MorphMeshRenderer>()) {
-				shader->SetUniform("t", object->Get<MorphMeshRenderer>()->t);
+			// The HUD goes over the upscaled scene, so it's always drawn at full resolution
+			renderGraph->AddPass("HUD", [packet, outputSize](const RenderGraph::PassContext&) {
+				packet->RenderHud(outputSize);
+			})
+				.WriteColor(output);
+
+			// Added every frame so the graph keeps it's shape, and so finished captures get written
+			// even on frames that aren't captured. Runs before ImGui so the debug windows aren't saved
+			renderGraph->AddPass("Capture", [=](const RenderGraph::PassContext&) {
+				GpuProfiler::BeginScope("Capture");
+				frameCapture->Poll();
+				if (!capturePath.empty()) {
+					frameCapture->Capture(outputFramebuffer, outputSize, capturePath, captureFormat);
+				}
+				GpuProfiler::EndScope();
+			})
+				.WriteColor(output);
+
+			renderGraph->AddPass("ImGui", [imguiData](const RenderGraph::PassContext&) {
+				GpuProfiler::BeginScope("ImGui");
+				ImGuiHelper::RenderDrawData(imguiData);
+				GpuProfiler::EndScope();
+			})
+				.WriteColor(output);
+
+			renderGraph->Execute();
+
+			// ImGui restores the GL state it touches, so this should never fire unless
+			// something has bypassed the state cache (only active with GL_STATE_VALIDATION)
+			GlStateCache::Validate();
+
+			if (headless.Enabled) {
+				// Wait for the GPU so our frame times include all of the rendering work
+				glFinish();
+				headlessFrameTimes.push_back(glfwGetTime() - thisFrame);
+			} else {
+				glfwSwapBuffers(window);
 			}
-			// Draw the object
-			renderable->GetMesh()->Draw();
 		});
+		submittedFrames++;
+	}
 
-		// Use our cubemap to draw our skybox
-		scene->DrawSkybox();
-
-
-		// End our ImGui window
-		ImGui::End();
-
-		VertexArrayObject::Unbind();
+	// Let the render thread finish any queued frames, and take the context back for cleanup
+	RenderThread::Stop();
+	// Make sure every capture has hit the disk before we tear anything down
+	frameCapture->Flush();
+	// A missing capture would otherwise only show up when the images are compared
+	int exitCode = 0;
+	if (headless.Enabled && frameCapture->GetStats().Dropped > 0) {
+		LOG_ERROR("Headless run failed to write {} captures", frameCapture->GetStats().Dropped.load());
+		exitCode = 1;
+	}
 
-		lastFrame = thisFrame;
-		ImGuiHelper::EndFrame();
-		glfwSwapBuffers(window);
+	// Dump out our frame times so they can be compared between runs
+	if (headless.Enabled && !headlessFrameTimes.empty()) {
+		std::stringstream csv;
+		csv << "frame,ms" << std::endl;
+		double total = 0.0, worst = 0.0;
+		for (size_t ix = 0; ix < headlessFrameTimes.size(); ix++) {
+			csv << ix << "," << headlessFrameTimes[ix] * 1000.0 << std::endl;
+			total += headlessFrameTimes[ix];
+			worst = std::max(worst, headlessFrameTimes[ix]);
+		}
+		FileHelpers::WriteContentsToFile(headless.OutputDir + "/frame_times.csv", csv.str());
+		LOG_INFO("Headless run finished: {} frames, avg {:.3f} ms, worst {:.3f} ms", headlessFrameTimes.size(),
+			total / headlessFrameTimes.size() * 1000.0, worst * 1000.0);
 	}
+	headlessTarget = nullptr;
+	upscaler = nullptr;
+	renderGraph = nullptr;
+	frameCapture = nullptr;
 
 	// Clean up the ImGui library
 	ImGuiHelper::Cleanup();
 
+	// Release our GPU timer queries while we still have a context
+	GpuProfiler::Cleanup();
+
+	// Impostors own textures and shaders, so they need to go while we still have a context
+	Impostor::Uninitialize();
+
 	// Clean up the resource manager
 	ResourceManager::Cleanup();
 
+	// Stop reading texture levels, anything still in flight is thrown away
+	TextureStreamer::Uninitialize();
+
 	// Clean up the toolkit logger so we don't leak memory
 	Logger::Uninitialize();
-	return 0;
+	return exitCode;
 }
\ No newline at end of file